@@ -674,6 +674,7 @@ void LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
     ALBuf->mSampleLen = frames;
     ALBuf->mLoopStart = 0;
     ALBuf->mLoopEnd = ALBuf->mSampleLen;
+    ALBuf->mGeneration = NextBufferGeneration();
 
 #ifdef ALSOFT_EAX
     if(eax_g_is_enabled && ALBuf->eax_x_ram_mode != AL_STORAGE_ACCESSIBLE)
@@ -727,6 +728,7 @@ void PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
     ALBuf->mSampleLen = 0;
     ALBuf->mLoopStart = 0;
     ALBuf->mLoopEnd = ALBuf->mSampleLen;
+    ALBuf->mGeneration = NextBufferGeneration();
 }
 
 
@@ -1002,6 +1004,8 @@ START_API_FUNC
         else
         {
             void *retval{albuf->mData.data() + offset};
+            if((access&AL_MAP_WRITE_BIT_SOFT))
+                albuf->mGeneration = NextBufferGeneration();
             albuf->MappedAccess = access;
             albuf->MappedOffset = offset;
             albuf->MappedSize = length;
@@ -1029,6 +1033,8 @@ START_API_FUNC
         context->setError(AL_INVALID_OPERATION, "Unmapping unmapped buffer %u", buffer);
     else
     {
+        if((albuf->MappedAccess&AL_MAP_WRITE_BIT_SOFT))
+            albuf->mGeneration = NextBufferGeneration();
         albuf->MappedAccess = 0;
         albuf->MappedOffset = 0;
         albuf->MappedSize = 0;
@@ -1064,6 +1070,7 @@ START_API_FUNC
          * OpenAL's reading, and hope for the best...
          */
         std::atomic_thread_fence(std::memory_order_seq_cst);
+        albuf->mGeneration = NextBufferGeneration();
     }
 }
 END_API_FUNC
@@ -1146,6 +1153,7 @@ START_API_FUNC
                 assert(long{usrfmt->type} == long{albuf->mType});
                 memcpy(dst, data, size_t{samplen} * frame_size);
             }
+            albuf->mGeneration = NextBufferGeneration();
         }
     }
 }
@@ -10,10 +10,16 @@
 
 namespace {
 
-void Convolution_setParami(EffectProps* /*props*/, ALenum param, int /*val*/)
+void Convolution_setParami(EffectProps *props, ALenum param, int val)
 {
     switch(param)
     {
+    case AL_CONVOLUTION_TRUE_STEREO_SOFT:
+        if(!(val == AL_FALSE || val == AL_TRUE))
+            throw effect_exception{AL_INVALID_VALUE, "Convolution true stereo out of range"};
+        props->Convolution.TrueStereo = (val != AL_FALSE);
+        break;
+
     default:
         throw effect_exception{AL_INVALID_ENUM, "Invalid null effect integer property 0x%04x",
             param};
@@ -45,10 +51,14 @@ void Convolution_setParamfv(EffectProps *props, ALenum param, const float *vals)
     }
 }
 
-void Convolution_getParami(const EffectProps* /*props*/, ALenum param, int* /*val*/)
+void Convolution_getParami(const EffectProps *props, ALenum param, int *val)
 {
     switch(param)
     {
+    case AL_CONVOLUTION_TRUE_STEREO_SOFT:
+        *val = props->Convolution.TrueStereo;
+        break;
+
     default:
         throw effect_exception{AL_INVALID_ENUM, "Invalid null effect integer property 0x%04x",
             param};
@@ -83,6 +93,7 @@ void Convolution_getParamfv(const EffectProps *props, ALenum param, float *vals)
 EffectProps genDefaultProps() noexcept
 {
     EffectProps props{};
+    props.Convolution.TrueStereo = false;
     return props;
 }
 
@@ -30,6 +30,7 @@
 #include "AL/efx.h"
 
 #include "alc/context.h"
+#include "alc/inprogext.h"
 #include "almalloc.h"
 #include "atomic.h"
 #include "core/except.h"
@@ -101,6 +102,20 @@ START_API_FUNC
         UpdateProps(context.get());
         break;
 
+    case AL_VOICE_LOD_DISTANCE_SOFT:
+        if(!(value >= 0.0f))
+            SETERR_RETURN(context, AL_INVALID_VALUE,, "Listener LOD distance out of range");
+        listener.mLodDistance = value;
+        UpdateProps(context.get());
+        break;
+
+    case AL_VOICE_LOD_GAIN_SOFT:
+        if(!(value >= 0.0f && std::isfinite(value)))
+            SETERR_RETURN(context, AL_INVALID_VALUE,, "Listener LOD gain out of range");
+        listener.mLodGain = value;
+        UpdateProps(context.get());
+        break;
+
     default:
         context->setError(AL_INVALID_ENUM, "Invalid listener float property");
     }
@@ -150,6 +165,8 @@ START_API_FUNC
         {
         case AL_GAIN:
         case AL_METERS_PER_UNIT:
+        case AL_VOICE_LOD_DISTANCE_SOFT:
+        case AL_VOICE_LOD_GAIN_SOFT:
             alListenerf(param, values[0]);
             return;
 
@@ -287,6 +304,14 @@ START_API_FUNC
         *value = listener.mMetersPerUnit;
         break;
 
+    case AL_VOICE_LOD_DISTANCE_SOFT:
+        *value = listener.mLodDistance;
+        break;
+
+    case AL_VOICE_LOD_GAIN_SOFT:
+        *value = listener.mLodGain;
+        break;
+
     default:
         context->setError(AL_INVALID_ENUM, "Invalid listener float property");
     }
@@ -330,6 +355,8 @@ START_API_FUNC
     {
     case AL_GAIN:
     case AL_METERS_PER_UNIT:
+    case AL_VOICE_LOD_DISTANCE_SOFT:
+    case AL_VOICE_LOD_GAIN_SOFT:
         alGetListenerf(param, values);
         return;
 
@@ -2,6 +2,7 @@
 #define AL_LISTENER_H
 
 #include <array>
+#include <limits>
 
 #include "AL/al.h"
 #include "AL/alc.h"
@@ -18,6 +19,12 @@ struct ALlistener {
     float Gain{1.0f};
     float mMetersPerUnit{AL_DEFAULT_METERS_PER_UNIT};
 
+    /* Sources further than this distance, or quieter than this gain, are
+     * mixed with reduced detail.
+     */
+    float mLodDistance{std::numeric_limits<float>::infinity()};
+    float mLodGain{0.0f};
+
     DISABLE_ALLOC()
 };
 
@@ -27,6 +27,7 @@
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cinttypes>
 #include <climits>
 #include <cmath>
 #include <cstdint>
@@ -101,9 +102,10 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
 {
     /* Get an unused property container, or allocate a new one as needed. */
     VoicePropsItem *props{context->mFreeVoiceProps.load(std::memory_order_acquire)};
-    if(!props)
+    if(unlikely(!props))
     {
-        context->allocVoiceProps();
+        context->allocVoiceProps(1);
+        context->mVoiceAllocFallbacks.fetch_add(1u, std::memory_order_relaxed);
         props = context->mFreeVoiceProps.load(std::memory_order_acquire);
     }
     VoicePropsItem *next;
@@ -183,6 +185,79 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
     }
 }
 
+/* GetSourcePosition
+ *
+ * Gets a snapshot of the given Source's voice position, along with the device
+ * clock time it applies to, without waiting on the mixer. Returns false if the
+ * source isn't playing or paused, in which case only the clock time is set.
+ */
+bool GetSourcePosition(ALsource *Source, ALCcontext *context, Voice::PositionSnapshot *pos)
+{
+    ALCdevice *device{context->mALDevice.get()};
+    /* Get the device clock time first. If a mix finishes after this, the
+     * voice's snapshot will have a later time to use instead.
+     */
+    const nanoseconds devtime{device->mMixClockTime.load(std::memory_order_acquire)};
+    pos->ClockTime = devtime;
+
+    Voice *voice{GetSourceVoice(Source, context)};
+    if(!voice) return false;
+
+    *pos = voice->getPositionSnapshot();
+    /* If the voice stopped while getting the snapshot, its position no longer
+     * applies.
+     */
+    if(voice->mSourceID.load(std::memory_order_acquire) != Source->id)
+    {
+        pos->ClockTime = devtime;
+        return false;
+    }
+    pos->ClockTime = std::max(pos->ClockTime, devtime);
+    return true;
+}
+
+/* GetQueueOffset
+ *
+ * Gets the number of samples in the given Source's queue before the buffer
+ * the position snapshot is in, or the whole queue if it has no buffer.
+ */
+uint64_t GetQueueOffset(const ALsource *Source, const Voice::PositionSnapshot &pos)
+{
+    const ALbufferQueueItem &front = Source->mQueue.front();
+    if(pos.HasBuffer)
+        return pos.QueueOffset - front.mQueueOffset;
+    const ALbufferQueueItem &back = Source->mQueue.back();
+    return back.mQueueOffset + back.mSampleLen - front.mQueueOffset;
+}
+
+/* GetSourceProcessedCount
+ *
+ * Gets the number of buffers in the given Source's queue that have finished
+ * playing.
+ */
+uint GetSourceProcessedCount(ALsource *Source, ALCcontext *context)
+{
+    if(Source->state == AL_INITIAL)
+        return 0u;
+
+    Voice::PositionSnapshot pos;
+    if(GetSourcePosition(Source, context, &pos) && pos.HasBuffer)
+        return static_cast<uint>(pos.QueueIndex - Source->mQueue.front().mQueueIndex);
+    return static_cast<uint>(Source->mQueue.size());
+}
+
+/* GetSourceBufferFormat
+ *
+ * Gets the first buffer in the given Source's queue, for its format.
+ */
+const ALbuffer *GetSourceBufferFormat(const ALsource *Source)
+{
+    auto iter = std::find_if(Source->mQueue.cbegin(), Source->mQueue.cend(),
+        [](const ALbufferQueueItem &item) noexcept -> bool { return item.mBuffer != nullptr; });
+    ASSUME(iter != Source->mQueue.cend());
+    return iter->mBuffer;
+}
+
 /* GetSourceSampleOffset
  *
  * Gets the current read offset for the given Source, in 32.32 fixed-point
@@ -191,35 +266,15 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
  */
 int64_t GetSourceSampleOffset(ALsource *Source, ALCcontext *context, nanoseconds *clocktime)
 {
-    ALCdevice *device{context->mALDevice.get()};
-    const VoiceBufferItem *Current{};
-    uint64_t readPos{};
-    ALuint refcount;
-    Voice *voice;
-
-    do {
-        refcount = device->waitForMix();
-        *clocktime = GetDeviceClockTime(device);
-        voice = GetSourceVoice(Source, context);
-        if(voice)
-        {
-            Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
-
-            readPos  = uint64_t{voice->mPosition.load(std::memory_order_relaxed)} << 32;
-            readPos |= uint64_t{voice->mPositionFrac.load(std::memory_order_relaxed)} <<
-                       (32-MixerFracBits);
-        }
-        std::atomic_thread_fence(std::memory_order_acquire);
-    } while(refcount != device->MixCount.load(std::memory_order_relaxed));
-
-    if(!voice)
+    Voice::PositionSnapshot pos;
+    const bool playing{GetSourcePosition(Source, context, &pos)};
+    *clocktime = pos.ClockTime;
+    if(!playing)
         return 0;
 
-    for(auto &item : Source->mQueue)
-    {
-        if(&item == Current) break;
-        readPos += uint64_t{item.mSampleLen} << 32;
-    }
+    uint64_t readPos{uint64_t{pos.Position} << 32};
+    readPos |= uint64_t{pos.PositionFrac} << (32-MixerFracBits);
+    readPos += GetQueueOffset(Source, pos) << 32;
     return static_cast<int64_t>(minu64(readPos, 0x7fffffffffffffff_u64));
 }
 
@@ -230,44 +285,17 @@ int64_t GetSourceSampleOffset(ALsource *Source, ALCcontext *context, nanoseconds
  */
 double GetSourceSecOffset(ALsource *Source, ALCcontext *context, nanoseconds *clocktime)
 {
-    ALCdevice *device{context->mALDevice.get()};
-    const VoiceBufferItem *Current{};
-    uint64_t readPos{};
-    ALuint refcount;
-    Voice *voice;
-
-    do {
-        refcount = device->waitForMix();
-        *clocktime = GetDeviceClockTime(device);
-        voice = GetSourceVoice(Source, context);
-        if(voice)
-        {
-            Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
-
-            readPos  = uint64_t{voice->mPosition.load(std::memory_order_relaxed)} << MixerFracBits;
-            readPos |= voice->mPositionFrac.load(std::memory_order_relaxed);
-        }
-        std::atomic_thread_fence(std::memory_order_acquire);
-    } while(refcount != device->MixCount.load(std::memory_order_relaxed));
-
-    if(!voice)
+    Voice::PositionSnapshot pos;
+    const bool playing{GetSourcePosition(Source, context, &pos)};
+    *clocktime = pos.ClockTime;
+    if(!playing)
         return 0.0f;
 
-    const ALbuffer *BufferFmt{nullptr};
-    auto BufferList = Source->mQueue.cbegin();
-    while(BufferList != Source->mQueue.cend() && std::addressof(*BufferList) != Current)
-    {
-        if(!BufferFmt) BufferFmt = BufferList->mBuffer;
-        readPos += uint64_t{BufferList->mSampleLen} << MixerFracBits;
-        ++BufferList;
-    }
-    while(BufferList != Source->mQueue.cend() && !BufferFmt)
-    {
-        BufferFmt = BufferList->mBuffer;
-        ++BufferList;
-    }
-    ASSUME(BufferFmt != nullptr);
+    uint64_t readPos{uint64_t{pos.Position} << MixerFracBits};
+    readPos |= pos.PositionFrac;
+    readPos += GetQueueOffset(Source, pos) << MixerFracBits;
 
+    const ALbuffer *BufferFmt{GetSourceBufferFormat(Source)};
     return static_cast<double>(readPos) / double{MixerFracOne} / BufferFmt->mSampleRate;
 }
 
@@ -279,53 +307,24 @@ double GetSourceSecOffset(ALsource *Source, ALCcontext *context, nanoseconds *cl
  */
 double GetSourceOffset(ALsource *Source, ALenum name, ALCcontext *context)
 {
-    ALCdevice *device{context->mALDevice.get()};
-    const VoiceBufferItem *Current{};
-    ALuint readPos{};
-    ALuint readPosFrac{};
-    ALuint refcount;
-    Voice *voice;
-
-    do {
-        refcount = device->waitForMix();
-        voice = GetSourceVoice(Source, context);
-        if(voice)
-        {
-            Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
-
-            readPos = voice->mPosition.load(std::memory_order_relaxed);
-            readPosFrac = voice->mPositionFrac.load(std::memory_order_relaxed);
-        }
-        std::atomic_thread_fence(std::memory_order_acquire);
-    } while(refcount != device->MixCount.load(std::memory_order_relaxed));
-
-    if(!voice)
+    Voice::PositionSnapshot pos;
+    if(!GetSourcePosition(Source, context, &pos))
         return 0.0;
 
-    const ALbuffer *BufferFmt{nullptr};
-    auto BufferList = Source->mQueue.cbegin();
-    while(BufferList != Source->mQueue.cend() && std::addressof(*BufferList) != Current)
-    {
-        if(!BufferFmt) BufferFmt = BufferList->mBuffer;
-        readPos += BufferList->mSampleLen;
-        ++BufferList;
-    }
-    while(BufferList != Source->mQueue.cend() && !BufferFmt)
-    {
-        BufferFmt = BufferList->mBuffer;
-        ++BufferList;
-    }
-    ASSUME(BufferFmt != nullptr);
+    const uint64_t readPos{pos.Position + GetQueueOffset(Source, pos)};
+    const uint readPosFrac{pos.PositionFrac};
+    const ALbuffer *BufferFmt{GetSourceBufferFormat(Source)};
 
     double offset{};
     switch(name)
     {
     case AL_SEC_OFFSET:
-        offset = (readPos + readPosFrac/double{MixerFracOne}) / BufferFmt->mSampleRate;
+        offset = (static_cast<double>(readPos) + readPosFrac/double{MixerFracOne})
+            / BufferFmt->mSampleRate;
         break;
 
     case AL_SAMPLE_OFFSET:
-        offset = readPos + readPosFrac/double{MixerFracOne};
+        offset = static_cast<double>(readPos) + readPosFrac/double{MixerFracOne};
         break;
 
     case AL_BYTE_OFFSET:
@@ -472,18 +471,18 @@ al::optional<VoicePos> GetSampleOffset(al::deque<ALbufferQueueItem> &BufferList,
         break;
     }
 
-    /* Find the bufferlist item this offset belongs to. */
-    ALuint totalBufferLen{0u};
-    for(auto &item : BufferList)
+    /* Find the bufferlist item this offset belongs to, being the first one
+     * that ends after it.
+     */
+    const uint64_t queueStart{BufferList.front().mQueueOffset};
+    auto iter = std::partition_point(BufferList.begin(), BufferList.end(),
+        [queueStart,offset](const ALbufferQueueItem &item) noexcept -> bool
+        { return item.mQueueOffset-queueStart + item.mSampleLen <= offset; });
+    if(iter != BufferList.end())
     {
-        if(totalBufferLen > offset)
-            break;
-        if(item.mSampleLen > offset-totalBufferLen)
-        {
-            /* Offset is in this buffer */
-            return VoicePos{offset-totalBufferLen, frac, &item};
-        }
-        totalBufferLen += item.mSampleLen;
+        /* Offset is in this buffer */
+        const auto bufferStart = static_cast<ALuint>(iter->mQueueOffset - queueStart);
+        return VoicePos{offset-bufferStart, frac, std::addressof(*iter)};
     }
 
     /* Offset is out of range of the queue */
@@ -508,16 +507,24 @@ void InitVoice(Voice *voice, ALsource *source, ALbufferQueueItem *BufferList, AL
     voice->mAmbiLayout = IsUHJ(voice->mFmtChannels) ? AmbiLayout::FuMa : buffer->mAmbiLayout;
     voice->mAmbiScaling = IsUHJ(voice->mFmtChannels) ? AmbiScaling::UHJ : buffer->mAmbiScaling;
     voice->mAmbiOrder = (voice->mFmtChannels == FmtSuperStereo) ? 1 : buffer->mAmbiOrder;
+    /* FuMa only defines up to third-order, so any higher orders are dropped. */
+    if(voice->mAmbiLayout == AmbiLayout::FuMa || voice->mAmbiScaling == AmbiScaling::FuMa)
+        voice->mAmbiOrder = minu(voice->mAmbiOrder, 3);
 
     if(buffer->mCallback) voice->mFlags.set(VoiceIsCallback);
     else if(source->SourceType == AL_STATIC) voice->mFlags.set(VoiceIsStatic);
     voice->mNumCallbackSamples = 0;
 
-    voice->prepare(device);
+    if(voice->prepare(device))
+        context->mVoiceAllocFallbacks.fetch_add(1u, std::memory_order_relaxed);
 
     source->mPropsDirty = false;
     UpdateSourceProps(source, voice, context);
 
+    /* The voice isn't being mixed, so publish its starting position. The
+     * clock time is left for the device clock to override.
+     */
+    voice->publishPosition(nanoseconds{});
     voice->mSourceID.store(source->id, std::memory_order_release);
 }
 
@@ -527,7 +534,8 @@ VoiceChange *GetVoiceChanger(ALCcontext *ctx)
     VoiceChange *vchg{ctx->mVoiceChangeTail};
     if UNLIKELY(vchg == ctx->mCurrentVoiceChange.load(std::memory_order_acquire))
     {
-        ctx->allocVoiceChanges();
+        ctx->allocVoiceChanges(1);
+        ctx->mVoiceAllocFallbacks.fetch_add(1u, std::memory_order_relaxed);
         vchg = ctx->mVoiceChangeTail;
     }
 
@@ -589,7 +597,10 @@ bool SetVoiceOffset(Voice *oldvoice, const VoicePos &vpos, ALsource *source, ALC
     {
         auto &allvoices = *context->mVoices.load(std::memory_order_relaxed);
         if(allvoices.size() == voicelist.size())
+        {
             context->allocVoices(1);
+            context->mVoiceAllocFallbacks.fetch_add(1u, std::memory_order_relaxed);
+        }
         context->mActiveVoiceCount.fetch_add(1, std::memory_order_release);
         voicelist = context->getVoicesSpan();
 
@@ -2115,22 +2126,7 @@ bool GetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop, const a
             values[0] = 0;
         }
         else
-        {
-            int played{0};
-            if(Source->state != AL_INITIAL)
-            {
-                const VoiceBufferItem *Current{nullptr};
-                if(Voice *voice{GetSourceVoice(Source, Context)})
-                    Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
-                for(auto &item : Source->mQueue)
-                {
-                    if(&item == Current)
-                        break;
-                    ++played;
-                }
-            }
-            values[0] = played;
-        }
+            values[0] = static_cast<int>(GetSourceProcessedCount(Source, Context));
         return true;
 
     case AL_SOURCE_TYPE:
@@ -2406,6 +2402,211 @@ bool GetSourcei64v(ALsource *Source, ALCcontext *Context, SourceProp prop, const
     return false;
 }
 
+/* Starts playing the given sources, at the given device clock time. Sources
+ * with a start time that has already passed start at the next update.
+ */
+void StartSources(ALCcontext *const context, const al::span<ALsource*> srchandles,
+    const std::chrono::nanoseconds start_time=std::chrono::nanoseconds::min())
+{
+    ALCdevice *device{context->mALDevice.get()};
+    /* If the device is disconnected, and voices stop on disconnect, go right
+     * to stopped.
+     */
+    if UNLIKELY(!device->Connected.load(std::memory_order_acquire))
+    {
+        if(context->mStopVoicesOnDisconnect.load(std::memory_order_acquire))
+        {
+            for(ALsource *source : srchandles)
+            {
+                /* TODO: Send state change event? */
+                source->Offset = 0.0;
+                source->OffsetType = AL_NONE;
+                source->state = AL_STOPPED;
+            }
+            return;
+        }
+    }
+
+    /* Count the number of reusable voices. */
+    auto voicelist = context->getVoicesSpan();
+    size_t free_voices{0};
+    for(const Voice *voice : voicelist)
+    {
+        free_voices += (voice->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
+            && voice->mSourceID.load(std::memory_order_relaxed) == 0u
+            && voice->mPendingChange.load(std::memory_order_relaxed) == false);
+        if(free_voices == srchandles.size())
+            break;
+    }
+    if UNLIKELY(srchandles.size() != free_voices)
+    {
+        const size_t inc_amount{srchandles.size() - free_voices};
+        auto &allvoices = *context->mVoices.load(std::memory_order_relaxed);
+        if(inc_amount > allvoices.size() - voicelist.size())
+        {
+            /* Increase the number of voices to handle the request. */
+            context->allocVoices(inc_amount - (allvoices.size() - voicelist.size()));
+            context->mVoiceAllocFallbacks.fetch_add(1u, std::memory_order_relaxed);
+        }
+        context->mActiveVoiceCount.fetch_add(inc_amount, std::memory_order_release);
+        voicelist = context->getVoicesSpan();
+    }
+
+    auto voiceiter = voicelist.begin();
+    ALuint vidx{0};
+    VoiceChange *tail{}, *cur{};
+    for(ALsource *source : srchandles)
+    {
+        /* Check that there is a queue containing at least one valid, non zero
+         * length buffer.
+         */
+        auto BufferList = source->mQueue.begin();
+        for(;BufferList != source->mQueue.end();++BufferList)
+        {
+            if(BufferList->mSampleLen != 0 || BufferList->mCallback)
+                break;
+        }
+
+        /* If there's nothing to play, go right to stopped. */
+        if UNLIKELY(BufferList == source->mQueue.end())
+        {
+            /* NOTE: A source without any playable buffers should not have a
+             * Voice since it shouldn't be in a playing or paused state. So
+             * there's no need to look up its voice and clear the source.
+             */
+            source->Offset = 0.0;
+            source->OffsetType = AL_NONE;
+            source->state = AL_STOPPED;
+            continue;
+        }
+
+        if(!cur)
+            cur = tail = GetVoiceChanger(context);
+        else
+        {
+            cur->mNext.store(GetVoiceChanger(context), std::memory_order_relaxed);
+            cur = cur->mNext.load(std::memory_order_relaxed);
+        }
+
+        Voice *voice{GetSourceVoice(source, context)};
+        switch(GetSourceState(source, voice))
+        {
+        case AL_PAUSED:
+            /* A source that's paused simply resumes. If there's no voice, it
+             * was lost from a disconnect, so just start over with a new one.
+             */
+            cur->mOldVoice = nullptr;
+            if(!voice) break;
+            cur->mVoice = voice;
+            cur->mSourceID = source->id;
+            cur->mState = VChangeState::Play;
+            cur->mTime = start_time;
+            source->state = AL_PLAYING;
+#ifdef ALSOFT_EAX
+            if(source->eax_is_initialized())
+                source->eax_commit();
+#endif // ALSOFT_EAX
+            continue;
+
+        case AL_PLAYING:
+            /* A source that's already playing is restarted from the beginning.
+             * Stop the current voice and start a new one so it properly cross-
+             * fades back to the beginning.
+             */
+            if(voice)
+                voice->mPendingChange.store(true, std::memory_order_relaxed);
+            cur->mOldVoice = voice;
+            voice = nullptr;
+            break;
+
+        default:
+            assert(voice == nullptr);
+            cur->mOldVoice = nullptr;
+#ifdef ALSOFT_EAX
+            if(source->eax_is_initialized())
+                source->eax_commit();
+#endif // ALSOFT_EAX
+            break;
+        }
+
+        /* Find the next unused voice to play this source with. */
+        for(;voiceiter != voicelist.end();++voiceiter,++vidx)
+        {
+            Voice *v{*voiceiter};
+            if(v->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
+                && v->mSourceID.load(std::memory_order_relaxed) == 0u
+                && v->mPendingChange.load(std::memory_order_relaxed) == false)
+            {
+                voice = v;
+                break;
+            }
+        }
+        ASSUME(voice != nullptr);
+
+        voice->mPosition.store(0u, std::memory_order_relaxed);
+        voice->mPositionFrac.store(0, std::memory_order_relaxed);
+        voice->mCurrentBuffer.store(&source->mQueue.front(), std::memory_order_relaxed);
+        voice->mFlags.reset();
+        /* A source that's not playing or paused has any offset applied when it
+         * starts playing.
+         */
+        if(const ALenum offsettype{source->OffsetType})
+        {
+            const double offset{source->Offset};
+            source->OffsetType = AL_NONE;
+            source->Offset = 0.0;
+            if(auto vpos = GetSampleOffset(source->mQueue, offsettype, offset))
+            {
+                voice->mPosition.store(vpos->pos, std::memory_order_relaxed);
+                voice->mPositionFrac.store(vpos->frac, std::memory_order_relaxed);
+                voice->mCurrentBuffer.store(vpos->bufferitem, std::memory_order_relaxed);
+                if(vpos->pos!=0 || vpos->frac!=0 || vpos->bufferitem!=&source->mQueue.front())
+                    voice->mFlags.set(VoiceIsFading);
+            }
+        }
+        InitVoice(voice, source, std::addressof(*BufferList), context, device);
+
+        source->VoiceIdx = vidx;
+        source->state = AL_PLAYING;
+
+        cur->mVoice = voice;
+        cur->mSourceID = source->id;
+        cur->mState = VChangeState::Play;
+        cur->mTime = start_time;
+    }
+    if LIKELY(tail)
+        SendVoiceChanges(context, tail);
+}
+
+/* Schedules the given sources to stop at the given device clock time. Only
+ * playing sources are affected, and playing a source again clears its stop.
+ */
+void StopSourcesAtTime(ALCcontext *const context, const al::span<ALsource*> srchandles,
+    const std::chrono::nanoseconds stop_time)
+{
+    VoiceChange *tail{}, *cur{};
+    for(ALsource *source : srchandles)
+    {
+        Voice *voice{GetSourceVoice(source, context)};
+        if(GetSourceState(source, voice) != AL_PLAYING)
+            continue;
+
+        if(!cur)
+            cur = tail = GetVoiceChanger(context);
+        else
+        {
+            cur->mNext.store(GetVoiceChanger(context), std::memory_order_relaxed);
+            cur = cur->mNext.load(std::memory_order_relaxed);
+        }
+        cur->mVoice = voice;
+        cur->mSourceID = source->id;
+        cur->mState = VChangeState::StopAt;
+        cur->mTime = stop_time;
+    }
+    if LIKELY(tail)
+        SendVoiceChanges(context, tail);
+}
+
 } // namespace
 
 AL_API void AL_APIENTRY alGenSources(ALsizei n, ALuint *sources)
@@ -3038,171 +3239,50 @@ START_API_FUNC
         ++sources;
     }
 
-    ALCdevice *device{context->mALDevice.get()};
-    /* If the device is disconnected, and voices stop on disconnect, go right
-     * to stopped.
-     */
-    if UNLIKELY(!device->Connected.load(std::memory_order_acquire))
-    {
-        if(context->mStopVoicesOnDisconnect.load(std::memory_order_acquire))
-        {
-            for(ALsource *source : srchandles)
-            {
-                /* TODO: Send state change event? */
-                source->Offset = 0.0;
-                source->OffsetType = AL_NONE;
-                source->state = AL_STOPPED;
-            }
-            return;
-        }
-    }
-
-    /* Count the number of reusable voices. */
-    auto voicelist = context->getVoicesSpan();
-    size_t free_voices{0};
-    for(const Voice *voice : voicelist)
-    {
-        free_voices += (voice->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
-            && voice->mSourceID.load(std::memory_order_relaxed) == 0u
-            && voice->mPendingChange.load(std::memory_order_relaxed) == false);
-        if(free_voices == srchandles.size())
-            break;
-    }
-    if UNLIKELY(srchandles.size() != free_voices)
-    {
-        const size_t inc_amount{srchandles.size() - free_voices};
-        auto &allvoices = *context->mVoices.load(std::memory_order_relaxed);
-        if(inc_amount > allvoices.size() - voicelist.size())
-        {
-            /* Increase the number of voices to handle the request. */
-            context->allocVoices(inc_amount - (allvoices.size() - voicelist.size()));
-        }
-        context->mActiveVoiceCount.fetch_add(inc_amount, std::memory_order_release);
-        voicelist = context->getVoicesSpan();
-    }
-
-    auto voiceiter = voicelist.begin();
-    ALuint vidx{0};
-    VoiceChange *tail{}, *cur{};
-    for(ALsource *source : srchandles)
-    {
-        /* Check that there is a queue containing at least one valid, non zero
-         * length buffer.
-         */
-        auto BufferList = source->mQueue.begin();
-        for(;BufferList != source->mQueue.end();++BufferList)
-        {
-            if(BufferList->mSampleLen != 0 || BufferList->mCallback)
-                break;
-        }
-
-        /* If there's nothing to play, go right to stopped. */
-        if UNLIKELY(BufferList == source->mQueue.end())
-        {
-            /* NOTE: A source without any playable buffers should not have a
-             * Voice since it shouldn't be in a playing or paused state. So
-             * there's no need to look up its voice and clear the source.
-             */
-            source->Offset = 0.0;
-            source->OffsetType = AL_NONE;
-            source->state = AL_STOPPED;
-            continue;
-        }
-
-        if(!cur)
-            cur = tail = GetVoiceChanger(context.get());
-        else
-        {
-            cur->mNext.store(GetVoiceChanger(context.get()), std::memory_order_relaxed);
-            cur = cur->mNext.load(std::memory_order_relaxed);
-        }
-
-        Voice *voice{GetSourceVoice(source, context.get())};
-        switch(GetSourceState(source, voice))
-        {
-        case AL_PAUSED:
-            /* A source that's paused simply resumes. If there's no voice, it
-             * was lost from a disconnect, so just start over with a new one.
-             */
-            cur->mOldVoice = nullptr;
-            if(!voice) break;
-            cur->mVoice = voice;
-            cur->mSourceID = source->id;
-            cur->mState = VChangeState::Play;
-            source->state = AL_PLAYING;
-#ifdef ALSOFT_EAX
-            if(source->eax_is_initialized())
-                source->eax_commit();
-#endif // ALSOFT_EAX
-            continue;
+    StartSources(context.get(), srchandles);
+}
+END_API_FUNC
 
-        case AL_PLAYING:
-            /* A source that's already playing is restarted from the beginning.
-             * Stop the current voice and start a new one so it properly cross-
-             * fades back to the beginning.
-             */
-            if(voice)
-                voice->mPendingChange.store(true, std::memory_order_relaxed);
-            cur->mOldVoice = voice;
-            voice = nullptr;
-            break;
+AL_API void AL_APIENTRY alSourcePlayAtTimeSOFT(ALuint source, ALint64SOFT start_time)
+START_API_FUNC
+{ alSourcePlayAtTimevSOFT(1, &source, start_time); }
+END_API_FUNC
 
-        default:
-            assert(voice == nullptr);
-            cur->mOldVoice = nullptr;
-#ifdef ALSOFT_EAX
-            if(source->eax_is_initialized())
-                source->eax_commit();
-#endif // ALSOFT_EAX
-            break;
-        }
+AL_API void AL_APIENTRY alSourcePlayAtTimevSOFT(ALsizei n, const ALuint *sources,
+    ALint64SOFT start_time)
+START_API_FUNC
+{
+    ContextRef context{GetContextRef()};
+    if UNLIKELY(!context) return;
 
-        /* Find the next unused voice to play this source with. */
-        for(;voiceiter != voicelist.end();++voiceiter,++vidx)
-        {
-            Voice *v{*voiceiter};
-            if(v->mPlayState.load(std::memory_order_acquire) == Voice::Stopped
-                && v->mSourceID.load(std::memory_order_relaxed) == 0u
-                && v->mPendingChange.load(std::memory_order_relaxed) == false)
-            {
-                voice = v;
-                break;
-            }
-        }
-        ASSUME(voice != nullptr);
+    if UNLIKELY(n < 0)
+        context->setError(AL_INVALID_VALUE, "Playing %d sources", n);
+    if UNLIKELY(n <= 0) return;
 
-        voice->mPosition.store(0u, std::memory_order_relaxed);
-        voice->mPositionFrac.store(0, std::memory_order_relaxed);
-        voice->mCurrentBuffer.store(&source->mQueue.front(), std::memory_order_relaxed);
-        voice->mFlags.reset();
-        /* A source that's not playing or paused has any offset applied when it
-         * starts playing.
-         */
-        if(const ALenum offsettype{source->OffsetType})
-        {
-            const double offset{source->Offset};
-            source->OffsetType = AL_NONE;
-            source->Offset = 0.0;
-            if(auto vpos = GetSampleOffset(source->mQueue, offsettype, offset))
-            {
-                voice->mPosition.store(vpos->pos, std::memory_order_relaxed);
-                voice->mPositionFrac.store(vpos->frac, std::memory_order_relaxed);
-                voice->mCurrentBuffer.store(vpos->bufferitem, std::memory_order_relaxed);
-                if(vpos->pos!=0 || vpos->frac!=0 || vpos->bufferitem!=&source->mQueue.front())
-                    voice->mFlags.set(VoiceIsFading);
-            }
-        }
-        InitVoice(voice, source, std::addressof(*BufferList), context.get(), device);
+    if UNLIKELY(start_time < 0)
+        SETERR_RETURN(context, AL_INVALID_VALUE,, "Invalid time point %" PRId64, start_time);
 
-        source->VoiceIdx = vidx;
-        source->state = AL_PLAYING;
+    al::vector<ALsource*> extra_sources;
+    std::array<ALsource*,8> source_storage;
+    al::span<ALsource*> srchandles;
+    if LIKELY(static_cast<ALuint>(n) <= source_storage.size())
+        srchandles = {source_storage.data(), static_cast<ALuint>(n)};
+    else
+    {
+        extra_sources.resize(static_cast<ALuint>(n));
+        srchandles = {extra_sources.data(), extra_sources.size()};
+    }
 
-        cur->mVoice = voice;
-        cur->mSourceID = source->id;
-        cur->mState = VChangeState::Play;
+    std::lock_guard<std::mutex> _{context->mSourceLock};
+    for(auto &srchdl : srchandles)
+    {
+        srchdl = LookupSource(context.get(), *sources);
+        if(!srchdl)
+            SETERR_RETURN(context, AL_INVALID_NAME,, "Invalid source ID %u", *sources);
+        ++sources;
     }
-    if LIKELY(tail)
-        SendVoiceChanges(context.get(), tail);
+
+    StartSources(context.get(), srchandles, std::chrono::nanoseconds{start_time});
 }
 END_API_FUNC
 
@@ -3346,6 +3426,50 @@ START_API_FUNC
 END_API_FUNC
 
 
+AL_API void AL_APIENTRY alSourceStopAtTimeSOFT(ALuint source, ALint64SOFT stop_time)
+START_API_FUNC
+{ alSourceStopAtTimevSOFT(1, &source, stop_time); }
+END_API_FUNC
+
+AL_API void AL_APIENTRY alSourceStopAtTimevSOFT(ALsizei n, const ALuint *sources,
+    ALint64SOFT stop_time)
+START_API_FUNC
+{
+    ContextRef context{GetContextRef()};
+    if UNLIKELY(!context) return;
+
+    if UNLIKELY(n < 0)
+        context->setError(AL_INVALID_VALUE, "Stopping %d sources", n);
+    if UNLIKELY(n <= 0) return;
+
+    if UNLIKELY(stop_time < 0)
+        SETERR_RETURN(context, AL_INVALID_VALUE,, "Invalid time point %" PRId64, stop_time);
+
+    al::vector<ALsource*> extra_sources;
+    std::array<ALsource*,8> source_storage;
+    al::span<ALsource*> srchandles;
+    if LIKELY(static_cast<ALuint>(n) <= source_storage.size())
+        srchandles = {source_storage.data(), static_cast<ALuint>(n)};
+    else
+    {
+        extra_sources.resize(static_cast<ALuint>(n));
+        srchandles = {extra_sources.data(), extra_sources.size()};
+    }
+
+    std::lock_guard<std::mutex> _{context->mSourceLock};
+    for(auto &srchdl : srchandles)
+    {
+        srchdl = LookupSource(context.get(), *sources);
+        if(!srchdl)
+            SETERR_RETURN(context, AL_INVALID_NAME,, "Invalid source ID %u", *sources);
+        ++sources;
+    }
+
+    StopSourcesAtTime(context.get(), srchandles, std::chrono::nanoseconds{stop_time});
+}
+END_API_FUNC
+
+
 AL_API void AL_APIENTRY alSourceRewind(ALuint source)
 START_API_FUNC
 { alSourceRewindv(1, &source); }
@@ -3458,6 +3582,12 @@ START_API_FUNC
         }
 
         source->mQueue.emplace_back();
+        if(source->mQueue.size() > 1)
+        {
+            const auto &prev = *(source->mQueue.end()-2);
+            source->mQueue.back().mQueueIndex = prev.mQueueIndex + 1;
+            source->mQueue.back().mQueueOffset = prev.mQueueOffset + prev.mSampleLen;
+        }
         if(!BufferList)
             BufferList = &source->mQueue.back();
         else
@@ -3548,19 +3678,7 @@ START_API_FUNC
         SETERR_RETURN(context, AL_INVALID_VALUE,, "Unqueueing from looping source %u", src);
 
     /* Make sure enough buffers have been processed to unqueue. */
-    uint processed{0u};
-    if LIKELY(source->state != AL_INITIAL)
-    {
-        VoiceBufferItem *Current{nullptr};
-        if(Voice *voice{GetSourceVoice(source, context.get())})
-            Current = voice->mCurrentBuffer.load(std::memory_order_relaxed);
-        for(auto &item : source->mQueue)
-        {
-            if(&item == Current)
-                break;
-            ++processed;
-        }
-    }
+    const uint processed{GetSourceProcessedCount(source, context.get())};
     if UNLIKELY(processed < static_cast<ALuint>(nb))
         SETERR_RETURN(context, AL_INVALID_VALUE,, "Unqueueing %d buffer%s (only %u processed)",
             nb, (nb==1)?"":"s", processed);
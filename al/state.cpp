@@ -942,6 +942,8 @@ void UpdateContextProps(ALCcontext *context)
     props->OrientUp = listener.OrientUp;
     props->Gain = listener.Gain;
     props->MetersPerUnit = listener.mMetersPerUnit;
+    props->LodDistance = listener.mLodDistance;
+    props->LodGain = listener.mLodGain;
 
     props->AirAbsorptionGainHF = context->mAirAbsorptionGainHF;
     props->DopplerFactor = context->mDopplerFactor;
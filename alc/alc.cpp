@@ -51,6 +51,7 @@
 #include <stddef.h>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -68,7 +69,9 @@
 #include "albit.h"
 #include "albyte.h"
 #include "alconfig.h"
+#include "alfstream.h"
 #include "almalloc.h"
+#include "alnumbers.h"
 #include "alnumeric.h"
 #include "aloptional.h"
 #include "alspan.h"
@@ -83,9 +86,11 @@
 #include "core/cpu_caps.h"
 #include "core/devformat.h"
 #include "core/device.h"
+#include "core/effect_threads.h"
 #include "core/effectslot.h"
 #include "core/except.h"
 #include "core/helpers.h"
+#include "core/hrtf.h"
 #include "core/mastering.h"
 #include "core/mixer/hrtfdefs.h"
 #include "core/fpu_ctrl.h"
@@ -260,6 +265,68 @@ BackendInfo BackendList[] = {
 BackendFactory *PlaybackFactory{};
 BackendFactory *CaptureFactory{};
 
+enum class BackendState : unsigned char {
+    Untried,
+    Failed,
+    Ready
+};
+
+/* The backends selected for playback and capture the last time the library
+ * initialized them, stored in the user's cache directory.
+ */
+/* The backend list is stored with the selections, so a change in the list or
+ * its priority order invalidates them.
+ */
+struct BackendCache {
+    std::string backends;
+    std::string playback;
+    std::string capture;
+};
+
+void ReadBackendCache(const std::string &fname, BackendCache &ret)
+{
+    al::ifstream f{fname};
+    if(!f.is_open())
+        return;
+
+    std::string line;
+    while(std::getline(f, line))
+    {
+        if(line.compare(0, 9, "backends=") == 0)
+            ret.backends = line.substr(9);
+        else if(line.compare(0, 9, "playback=") == 0)
+            ret.playback = line.substr(9);
+        else if(line.compare(0, 8, "capture=") == 0)
+            ret.capture = line.substr(8);
+    }
+    TRACE("Read backend cache %s: playback \"%s\", capture \"%s\"\n", fname.c_str(),
+        ret.playback.c_str(), ret.capture.c_str());
+}
+
+void WriteBackendCache(const std::string &fname, const BackendCache &cache)
+{
+#ifdef _WIN32
+    FILE *f{_wfopen(utf8_to_wstr(fname.c_str()).c_str(), L"wt")};
+#else
+    FILE *f{fopen(fname.c_str(), "wt")};
+#endif
+    if(!f)
+    {
+        WARN("Failed to write backend cache %s\n", fname.c_str());
+        return;
+    }
+    fprintf(f, "backends=%s\nplayback=%s\ncapture=%s\n", cache.backends.c_str(),
+        cache.playback.c_str(), cache.capture.c_str());
+    fclose(f);
+}
+
+
+double MillisecondsSince(const std::chrono::steady_clock::time_point start)
+{
+    using milliseconds_d = std::chrono::duration<double,std::milli>;
+    return milliseconds_d{std::chrono::steady_clock::now() - start}.count();
+}
+
 
 /************************************************
  * Functions, enums, and errors
@@ -307,6 +374,8 @@ const struct {
 
     DECL(alcReopenDeviceSOFT),
 
+    DECL(alcReloadConfigSOFT),
+
     DECL(alEnable),
     DECL(alDisable),
     DECL(alIsEnabled),
@@ -452,6 +521,11 @@ const struct {
     DECL(alAuxiliaryEffectSlotPlayvSOFT),
     DECL(alAuxiliaryEffectSlotStopSOFT),
     DECL(alAuxiliaryEffectSlotStopvSOFT),
+
+    DECL(alSourcePlayAtTimeSOFT),
+    DECL(alSourcePlayAtTimevSOFT),
+    DECL(alSourceStopAtTimeSOFT),
+    DECL(alSourceStopAtTimevSOFT),
 #ifdef ALSOFT_EAX
 }, eaxFunctions[] = {
     DECL(EAXGet),
@@ -545,6 +619,15 @@ constexpr struct {
     DECL(ALC_SURROUND_6_1_SOFT),
     DECL(ALC_SURROUND_7_1_SOFT),
 
+    DECL(ALC_DEVICE_UNDERRUN_COUNT_SOFT),
+    DECL(ALC_DEVICE_TARGET_LATENCY_SOFT),
+    DECL(ALC_DEVICE_MAX_JITTER_SOFT),
+    DECL(ALC_DEVICE_LATENCY_HISTORY_SIZE_SOFT),
+    DECL(ALC_DEVICE_LATENCY_HISTORY_SOFT),
+
+    DECL(ALC_PREALLOC_VOICES_SOFT),
+    DECL(ALC_VOICE_ALLOC_FALLBACKS_SOFT),
+
     DECL(ALC_NO_ERROR),
     DECL(ALC_INVALID_DEVICE),
     DECL(ALC_INVALID_CONTEXT),
@@ -892,6 +975,9 @@ constexpr struct {
 
     DECL(AL_STOP_SOURCES_ON_DISCONNECT_SOFT),
 
+    DECL(AL_VOICE_LOD_DISTANCE_SOFT),
+    DECL(AL_VOICE_LOD_GAIN_SOFT),
+
 #ifdef ALSOFT_EAX
 }, eaxEnumerations[] = {
     DECL(AL_EAX_RAM_SIZE),
@@ -933,6 +1019,9 @@ bool TrapALCError{false};
 /* One-time configuration init control */
 std::once_flag alc_config_once{};
 
+/* One-time backend init control */
+std::once_flag alc_backends_once{};
+
 /* Flag to specify if alcSuspendContext/alcProcessContext should defer/process
  * updates.
  */
@@ -941,6 +1030,9 @@ bool SuspendDefers{true};
 /* Initial seed for dithering. */
 constexpr uint DitherRNGSeed{22222u};
 
+/* Limit for the number of voices an app can have preallocated for a context. */
+constexpr uint MaxPreallocVoices{16384u};
+
 
 /************************************************
  * ALC information
@@ -953,7 +1045,8 @@ constexpr ALCchar alcNoDeviceExtList[] =
     "ALC_EXT_thread_local_context "
     "ALC_SOFT_loopback "
     "ALC_SOFT_loopback_bformat "
-    "ALC_SOFT_reopen_device";
+    "ALC_SOFT_reopen_device "
+    "ALC_SOFTX_reload_config";
 constexpr ALCchar alcExtensionList[] =
     "ALC_ENUMERATE_ALL_EXT "
     "ALC_ENUMERATION_EXT "
@@ -969,7 +1062,10 @@ constexpr ALCchar alcExtensionList[] =
     "ALC_SOFT_output_limiter "
     "ALC_SOFT_output_mode "
     "ALC_SOFT_pause_device "
-    "ALC_SOFT_reopen_device";
+    "ALC_SOFT_reopen_device "
+    "ALC_SOFTX_device_latency_stats "
+    "ALC_SOFTX_reload_config "
+    "ALC_SOFTX_voice_prealloc";
 constexpr int alcMajorVersion{1};
 constexpr int alcMinorVersion{1};
 
@@ -991,6 +1087,8 @@ std::recursive_mutex ListLock;
 
 void alc_initconfig(void)
 {
+    const auto inittime = std::chrono::steady_clock::now();
+
     if(auto loglevel = al::getenv("ALSOFT_LOGLEVEL"))
     {
         long lvl = strtol(loglevel->c_str(), nullptr, 0);
@@ -1024,23 +1122,8 @@ void alc_initconfig(void)
 
     TRACE("Initializing library v%s-%s %s\n", ALSOFT_VERSION, ALSOFT_GIT_COMMIT_HASH,
         ALSOFT_GIT_BRANCH);
-    {
-        std::string names;
-        if(al::size(BackendList) < 1)
-            names = "(none)";
-        else
-        {
-            const al::span<const BackendInfo> infos{BackendList};
-            names = infos[0].name;
-            for(const auto &backend : infos.subspan<1>())
-            {
-                names += ", ";
-                names += backend.name;
-            }
-        }
-        TRACE("Supported backends: %s\n", names.c_str());
-    }
     ReadALConfig();
+    TRACE("Loaded config in %.2fms\n", MillisecondsSince(inittime));
 
     if(auto suspendmode = al::getenv("__ALSOFT_SUSPEND_CONTEXT"))
     {
@@ -1140,6 +1223,20 @@ void alc_initconfig(void)
     compatflags.set(CompatFlags::ReverseY, checkflag("__ALSOFT_REVERSE_Y", "reverse-y"));
     compatflags.set(CompatFlags::ReverseZ, checkflag("__ALSOFT_REVERSE_Z", "reverse-z"));
 
+    auto get_uhj_quality = [](const char *optname) -> UhjQualityType
+    {
+        auto uhjopt = ConfigValueStr(nullptr, "uhj", optname);
+        if(!uhjopt) return UhjQualityType::Default;
+        if(al::strcasecmp(uhjopt->c_str(), "iir") == 0)
+            return UhjQualityType::IIR;
+        if(al::strcasecmp(uhjopt->c_str(), "fir256") == 0)
+            return UhjQualityType::FIR256;
+        WARN("Unsupported uhj/%s: %s\n", optname, uhjopt->c_str());
+        return UhjQualityType::Default;
+    };
+    UhjDecodeQuality = get_uhj_quality("decode-filter");
+    UhjEncodeQuality = get_uhj_quality("encode-filter");
+
     aluInit(compatflags, ConfigValueFloat(nullptr, "game_compat", "nfc-scale").value_or(1.0f));
     Voice::InitMixer(ConfigValueStr(nullptr, nullptr, "resampler"));
 
@@ -1173,6 +1270,117 @@ void alc_initconfig(void)
         ReverbBoost *= std::pow(10.0f, valf / 20.0f);
     }
 
+    if(auto modeopt = ConfigValueStr(nullptr, "pshifter", "mode"))
+    {
+        if(al::strcasecmp(modeopt->c_str(), "stft") == 0)
+            PshifterProcessMode = PshifterMode::Stft;
+        else if(al::strcasecmp(modeopt->c_str(), "psola") == 0)
+            PshifterProcessMode = PshifterMode::Psola;
+        else
+            ERR("Unhandled pitch shifter mode: \"%s\"\n", modeopt->c_str());
+    }
+    if(auto sizeopt = ConfigValueUInt(nullptr, "pshifter", "fft-size"))
+    {
+        const uint fftsize{NextPowerOf2(clampu(*sizeopt, 256, 4096))};
+        if(fftsize != *sizeopt)
+            WARN("Pitch shifter FFT size %u adjusted to %u\n", *sizeopt, fftsize);
+        PshifterFftSize = fftsize;
+    }
+    if(auto overlapopt = ConfigValueUInt(nullptr, "pshifter", "overlap"))
+    {
+        const uint overlap{NextPowerOf2(clampu(*overlapopt, 4, 16))};
+        if(overlap != *overlapopt)
+            WARN("Pitch shifter overlap %u adjusted to %u\n", *overlapopt, overlap);
+        PshifterOverlap = overlap;
+    }
+
+    if(auto asyncopt = ConfigValueBool(nullptr, "convolution", "async-load"))
+        ConvolutionAsyncLoad = *asyncopt;
+    if(auto cacheopt = ConfigValueUInt(nullptr, "convolution", "cache-size"))
+        ConvolutionCacheSize = size_t{minu(*cacheopt, 4096u)} * 1024u * 1024u;
+
+    LoopbackBackendFactory::getFactory().init();
+
+    if(auto exclopt = ConfigValueStr(nullptr, nullptr, "excludefx"))
+    {
+        const char *next{exclopt->c_str()};
+        do {
+            const char *str{next};
+            next = strchr(str, ',');
+
+            if(!str[0] || next == str)
+                continue;
+
+            size_t len{next ? static_cast<size_t>(next-str) : strlen(str)};
+            for(const EffectList &effectitem : gEffectList)
+            {
+                if(len == strlen(effectitem.name) &&
+                   strncmp(effectitem.name, str, len) == 0)
+                    DisabledEffects[effectitem.type] = true;
+            }
+        } while(next++);
+    }
+
+    InitEffect(&ALCcontext::sDefaultEffect);
+    auto defrevopt = al::getenv("ALSOFT_DEFAULT_REVERB");
+    if(defrevopt || (defrevopt=ConfigValueStr(nullptr, nullptr, "default-reverb")))
+        LoadReverbPreset(defrevopt->c_str(), &ALCcontext::sDefaultEffect);
+
+#ifdef ALSOFT_EAX
+    {
+        static constexpr char eax_block_name[] = "eax";
+
+        if(const auto eax_enable_opt = ConfigValueBool(nullptr, eax_block_name, "enable"))
+        {
+            eax_g_is_enabled = *eax_enable_opt;
+            if(!eax_g_is_enabled)
+                TRACE("%s\n", "EAX disabled by a configuration.");
+        }
+        else
+            eax_g_is_enabled = true;
+
+        if((DisabledEffects[EAXREVERB_EFFECT] || DisabledEffects[CHORUS_EFFECT])
+            && eax_g_is_enabled)
+        {
+            eax_g_is_enabled = false;
+            TRACE("EAX disabled because %s disabled.\n",
+                (DisabledEffects[EAXREVERB_EFFECT] && DisabledEffects[CHORUS_EFFECT])
+                    ? "EAXReverb and Chorus are" :
+                DisabledEffects[EAXREVERB_EFFECT] ? "EAXReverb is" :
+                DisabledEffects[CHORUS_EFFECT] ? "Chorus is" : "");
+        }
+    }
+#endif // ALSOFT_EAX
+
+    TRACE("Library initialized in %.2fms\n", MillisecondsSince(inittime));
+}
+inline void InitConfig()
+{ std::call_once(alc_config_once, [](){alc_initconfig();}); }
+
+
+/* Backends are only initialized once a device is opened or enumerated, since
+ * some can take a while to load their libraries and connect to servers.
+ */
+void alc_initbackends(void)
+{
+    const auto inittime = std::chrono::steady_clock::now();
+    {
+        std::string names;
+        if(al::size(BackendList) < 1)
+            names = "(none)";
+        else
+        {
+            const al::span<const BackendInfo> infos{BackendList};
+            names = infos[0].name;
+            for(const auto &backend : infos.subspan<1>())
+            {
+                names += ", ";
+                names += backend.name;
+            }
+        }
+        TRACE("Supported backends: %s\n", names.c_str());
+    }
+
     auto BackendListEnd = std::end(BackendList);
     auto devopt = al::getenv("ALSOFT_DRIVERS");
     if(devopt || (devopt=ConfigValueStr(nullptr, nullptr, "drivers")))
@@ -1228,92 +1436,182 @@ void alc_initconfig(void)
             BackendListEnd = backendlist_cur;
     }
 
-    auto init_backend = [](BackendInfo &backend) -> void
-    {
-        if(PlaybackFactory && CaptureFactory)
-            return;
+    const al::span<BackendInfo> backends{std::begin(BackendList), BackendListEnd};
+    al::vector<BackendState> states(backends.size(), BackendState::Untried);
 
-        BackendFactory &factory = backend.getFactory();
-        if(!factory.init())
+    auto init_backend = [](BackendInfo &backend) -> BackendState
+    {
+        const auto starttime = std::chrono::steady_clock::now();
+        if(!backend.getFactory().init())
         {
             WARN("Failed to initialize backend \"%s\"\n", backend.name);
-            return;
+            return BackendState::Failed;
         }
+        TRACE("Initialized backend \"%s\" in %.2fms\n", backend.name,
+            MillisecondsSince(starttime));
+        return BackendState::Ready;
+    };
 
-        TRACE("Initialized backend \"%s\"\n", backend.name);
+    size_t playbackIdx{backends.size()};
+    size_t captureIdx{backends.size()};
+    auto select_playback = [backends,&playbackIdx](size_t idx) -> void
+    {
+        BackendFactory &factory = backends[idx].getFactory();
         if(!PlaybackFactory && factory.querySupport(BackendType::Playback))
         {
             PlaybackFactory = &factory;
-            TRACE("Added \"%s\" for playback\n", backend.name);
+            playbackIdx = idx;
+            TRACE("Added \"%s\" for playback\n", backends[idx].name);
         }
+    };
+    auto select_capture = [backends,&captureIdx](size_t idx) -> void
+    {
+        BackendFactory &factory = backends[idx].getFactory();
         if(!CaptureFactory && factory.querySupport(BackendType::Capture))
         {
             CaptureFactory = &factory;
-            TRACE("Added \"%s\" for capture\n", backend.name);
+            captureIdx = idx;
+            TRACE("Added \"%s\" for capture\n", backends[idx].name);
         }
     };
-    std::for_each(std::begin(BackendList), BackendListEnd, init_backend);
-
-    LoopbackBackendFactory::getFactory().init();
-
-    if(!PlaybackFactory)
-        WARN("No playback backend available!\n");
-    if(!CaptureFactory)
-        WARN("No capture backend available!\n");
 
-    if(auto exclopt = ConfigValueStr(nullptr, nullptr, "excludefx"))
+    /* Try the backends that were selected last time first. If they still
+     * work, the backends ahead of them in the list don't need to be
+     * initialized. Playback and capture are selected independently, since
+     * they may have come from different backends.
+     */
+    std::string cachepath;
+    std::string backendnames;
+    BackendCache cache;
+    if(GetConfigValueBool(nullptr, nullptr, "backend-cache", false))
     {
-        const char *next{exclopt->c_str()};
-        do {
-            const char *str{next};
-            next = strchr(str, ',');
-
-            if(!str[0] || next == str)
-                continue;
-
-            size_t len{next ? static_cast<size_t>(next-str) : strlen(str)};
-            for(const EffectList &effectitem : gEffectList)
+        cachepath = GetUserCachePath("backends");
+        if(!cachepath.empty())
+        {
+            cachepath += "/alsoft-backends.cache";
+            for(const BackendInfo &backend : backends)
             {
-                if(len == strlen(effectitem.name) &&
-                   strncmp(effectitem.name, str, len) == 0)
-                    DisabledEffects[effectitem.type] = true;
+                if(!backendnames.empty()) backendnames += ',';
+                backendnames += backend.name;
             }
-        } while(next++);
+            ReadBackendCache(cachepath, cache);
+            if(cache.backends != backendnames)
+            {
+                if(!cache.backends.empty())
+                    TRACE("Backend list changed, ignoring cache\n");
+                cache.playback.clear();
+                cache.capture.clear();
+            }
+        }
+    }
+    auto try_cached = [backends,&states,init_backend](const std::string &name) -> size_t
+    {
+        auto find_backend = [&name](const BackendInfo &backend) -> bool
+        { return name == backend.name; };
+        auto iter = std::find_if(backends.begin(), backends.end(), find_backend);
+        const auto idx = static_cast<size_t>(iter - backends.begin());
+        if(iter == backends.end())
+            return idx;
+
+        if(states[idx] == BackendState::Untried)
+        {
+            TRACE("Trying cached backend \"%s\"\n", iter->name);
+            states[idx] = init_backend(*iter);
+        }
+        return (states[idx] == BackendState::Ready) ? idx : backends.size();
+    };
+    if(!cache.playback.empty())
+    {
+        const size_t idx{try_cached(cache.playback)};
+        if(idx < backends.size())
+            select_playback(idx);
+    }
+    if(!cache.capture.empty())
+    {
+        const size_t idx{try_cached(cache.capture)};
+        if(idx < backends.size())
+            select_capture(idx);
     }
 
-    InitEffect(&ALCcontext::sDefaultEffect);
-    auto defrevopt = al::getenv("ALSOFT_DEFAULT_REVERB");
-    if(defrevopt || (defrevopt=ConfigValueStr(nullptr, nullptr, "default-reverb")))
-        LoadReverbPreset(defrevopt->c_str(), &ALCcontext::sDefaultEffect);
-
-#ifdef ALSOFT_EAX
+    if(!PlaybackFactory || !CaptureFactory)
     {
-        static constexpr char eax_block_name[] = "eax";
+        /* Initializing the remaining backends in parallel avoids waiting on
+         * each one in turn, though every backend then gets initialized.
+         */
+        if(GetConfigValueBool(nullptr, nullptr, "parallel-backend-init", false))
+        {
+            al::vector<std::thread> threads;
+            threads.reserve(backends.size());
+            try {
+                for(size_t i{0};i < backends.size();++i)
+                {
+                    if(states[i] != BackendState::Untried)
+                        continue;
+                    threads.emplace_back([&backends,&states,init_backend,i]()
+                    { states[i] = init_backend(backends[i]); });
+                }
+            }
+            catch(std::exception &e) {
+                /* Whatever didn't start will be initialized below. */
+                ERR("Failed to start backend init thread: %s\n", e.what());
+            }
+            for(auto &thrd : threads)
+                thrd.join();
+        }
 
-        if(const auto eax_enable_opt = ConfigValueBool(nullptr, eax_block_name, "enable"))
+        for(size_t i{0};i < backends.size();++i)
         {
-            eax_g_is_enabled = *eax_enable_opt;
-            if(!eax_g_is_enabled)
-                TRACE("%s\n", "EAX disabled by a configuration.");
+            if(PlaybackFactory && CaptureFactory)
+                break;
+            if(states[i] == BackendState::Untried)
+                states[i] = init_backend(backends[i]);
+            if(states[i] == BackendState::Ready)
+            {
+                select_playback(i);
+                select_capture(i);
+            }
         }
-        else
-            eax_g_is_enabled = true;
+    }
 
-        if((DisabledEffects[EAXREVERB_EFFECT] || DisabledEffects[CHORUS_EFFECT])
-            && eax_g_is_enabled)
+    if(!PlaybackFactory)
+        WARN("No playback backend available!\n");
+    if(!CaptureFactory)
+        WARN("No capture backend available!\n");
+
+    /* Only remember a selection if no backend ahead of it failed. Otherwise a
+     * higher priority backend that was only temporarily unavailable (e.g. a
+     * sound server that wasn't running) would never be tried again.
+     */
+    if(!cachepath.empty())
+    {
+        auto cacheable = [backends,&states](size_t idx) -> const char*
         {
-            eax_g_is_enabled = false;
-            TRACE("EAX disabled because %s disabled.\n",
-                (DisabledEffects[EAXREVERB_EFFECT] && DisabledEffects[CHORUS_EFFECT])
-                    ? "EAXReverb and Chorus are" :
-                DisabledEffects[EAXREVERB_EFFECT] ? "EAXReverb is" :
-                DisabledEffects[CHORUS_EFFECT] ? "Chorus is" : "");
+            if(idx >= backends.size())
+                return "";
+            const auto end = states.begin() + static_cast<ptrdiff_t>(idx);
+            if(std::find(states.begin(), end, BackendState::Failed) != end)
+                return "";
+            return backends[idx].name;
+        };
+        const char *playbackName{cacheable(playbackIdx)};
+        const char *captureName{cacheable(captureIdx)};
+        if(cache.backends != backendnames || cache.playback != playbackName
+            || cache.capture != captureName)
+        {
+            cache.backends = backendnames;
+            cache.playback = playbackName;
+            cache.capture = captureName;
+            WriteBackendCache(cachepath, cache);
         }
     }
-#endif // ALSOFT_EAX
+
+    TRACE("Backends initialized in %.2fms\n", MillisecondsSince(inittime));
+}
+inline void InitBackends()
+{
+    InitConfig();
+    std::call_once(alc_backends_once, [](){alc_initbackends();});
 }
-inline void InitConfig()
-{ std::call_once(alc_config_once, [](){alc_initconfig();}); }
 
 
 /************************************************
@@ -1321,7 +1619,7 @@ inline void InitConfig()
  ************************************************/
 void ProbeAllDevicesList()
 {
-    InitConfig();
+    InitBackends();
 
     std::lock_guard<std::recursive_mutex> _{ListLock};
     if(!PlaybackFactory)
@@ -1335,7 +1633,7 @@ void ProbeAllDevicesList()
 }
 void ProbeCaptureDeviceList()
 {
-    InitConfig();
+    InitBackends();
 
     std::lock_guard<std::recursive_mutex> _{ListLock};
     if(!CaptureFactory)
@@ -1550,7 +1848,7 @@ void alcSetError(ALCdevice *device, ALCenum errorCode)
 }
 
 
-std::unique_ptr<Compressor> CreateDeviceLimiter(const ALCdevice *device, const float threshold)
+al::arena_ptr<Compressor> CreateDeviceLimiter(ALCdevice *device, const float threshold)
 {
     static constexpr bool AutoKnee{true};
     static constexpr bool AutoAttack{true};
@@ -1566,8 +1864,8 @@ std::unique_ptr<Compressor> CreateDeviceLimiter(const ALCdevice *device, const f
     static constexpr float AttackTime{0.02f};
     static constexpr float ReleaseTime{0.2f};
 
-    return Compressor::Create(device->RealOut.Buffer.size(), static_cast<float>(device->Frequency),
-        AutoKnee, AutoAttack, AutoRelease, AutoPostGain, AutoDeclip, LookAheadTime, HoldTime,
+    return Compressor::Create(device->mArena, device->RealOut.Buffer.size(),
+        static_cast<float>(device->Frequency), AutoKnee, AutoAttack, AutoRelease, AutoPostGain, AutoDeclip, LookAheadTime, HoldTime,
         PreGainDb, PostGainDb, threshold, Ratio, KneeDb, AttackTime, ReleaseTime);
 }
 
@@ -1690,6 +1988,10 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
                 outmode = attrList[attrIdx + 1];
                 break;
 
+            case ATTRIBUTE(ALC_PREALLOC_VOICES_SOFT)
+                /* Context attribute, handled when creating the context. */
+                break;
+
             default:
                 TRACE("0x%04X = %d (0x%x)\n", attrList[attrIdx],
                     attrList[attrIdx + 1], attrList[attrIdx + 1]);
@@ -1847,6 +2149,7 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
 
     device->AvgSpeakerDist = 0.0f;
     device->mNFCtrlFilter = NfcFilter{};
+    device->mHrtfState = nullptr;
     device->mUhjEncoder = nullptr;
     device->AmbiDecoder = nullptr;
     device->Bs2b = nullptr;
@@ -1854,6 +2157,7 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
 
     device->Limiter = nullptr;
     device->ChannelDelays = nullptr;
+    device->mEffectThreads = nullptr;
 
     std::fill(std::begin(device->HrtfAccumData), std::end(device->HrtfAccumData), float2{});
 
@@ -1863,8 +2167,13 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     device->RealOut.RemixMap = {};
     device->RealOut.ChannelIndex.fill(INVALID_CHANNEL_INDEX);
     device->RealOut.Buffer = {};
-    device->MixBuffer.clear();
-    device->MixBuffer.shrink_to_fit();
+    device->MixBuffer = {};
+
+    /* With everything allocated from the arena now cleared, the arena can be
+     * reset for the new setup.
+     */
+    device->mArena.setHugePages(device->configValue<bool>(nullptr, "huge-pages").value_or(false));
+    device->mArena.reset();
 
     UpdateClockBase(device);
     device->FixedLatency = nanoseconds::zero();
@@ -1924,6 +2233,10 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
                 { "ambi1", DevFmtAmbi3D, 1 },
                 { "ambi2", DevFmtAmbi3D, 2 },
                 { "ambi3", DevFmtAmbi3D, 3 },
+                { "ambi4", DevFmtAmbi3D, 4 },
+                { "ambi5", DevFmtAmbi3D, 5 },
+                { "ambi6", DevFmtAmbi3D, 6 },
+                { "ambi7", DevFmtAmbi3D, 7 },
             };
 
             const ALCchar *fmt{chanopt->c_str()};
@@ -2105,7 +2418,7 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
 
     nanoseconds::rep sample_delay{0};
     if(device->mUhjEncoder)
-        sample_delay += UhjEncoder::sFilterDelay;
+        sample_delay += static_cast<nanoseconds::rep>(device->mUhjEncoder->getDelay());
     if(auto *ambidec = device->AmbiDecoder.get())
     {
         if(ambidec->hasStablizer())
@@ -2200,10 +2513,35 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
         TRACE("Output limiter enabled, %.4fdB limit\n", thrshld_dB);
     }
 
+    TRACE("Mixer state arena: %zu bytes used\n", device->mArena.used());
+
     /* Convert the sample delay from samples to nanosamples to nanoseconds. */
     device->FixedLatency += nanoseconds{seconds{sample_delay}} / device->Frequency;
     TRACE("Fixed device latency: %" PRId64 "ns\n", int64_t{device->FixedLatency.count()});
 
+    if(auto numthreads = device->configValue<uint>(nullptr, "effect-threads"))
+    {
+        static constexpr uint MaxEffectThreads{16};
+        if(*numthreads > MaxEffectThreads)
+        {
+            WARN("Effect thread count %u exceeds the max (%u), clamping\n", *numthreads,
+                MaxEffectThreads);
+            *numthreads = MaxEffectThreads;
+        }
+        if(*numthreads > 0)
+        {
+            try {
+                device->mEffectThreads = std::make_unique<EffectThreadPool>(*numthreads,
+                    device->Dry.Buffer.size());
+                TRACE("Using %u effect worker thread%s\n", *numthreads,
+                    (*numthreads == 1) ? "" : "s");
+            }
+            catch(std::exception &e) {
+                ERR("Failed to start effect worker threads: %s\n", e.what());
+            }
+        }
+    }
+
     FPUCtl mixer_mode{};
     for(ContextBase *ctxbase : *device->mContexts.load())
     {
@@ -2304,6 +2642,15 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
             }
         }
 
+        /* Preallocated voices need their storage reserved again for the new
+         * channel and send counts.
+         */
+        if(context->mPreallocVoices > 0)
+        {
+            for(Voice *voice : *context->mVoices.load(std::memory_order_relaxed))
+                voice->reserve(device);
+        }
+
         auto voicelist = context->getVoicesSpan();
         for(Voice *voice : voicelist)
         {
@@ -2312,6 +2659,11 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
                 VoiceProps::SendData{});
 
             std::fill(voice->mSend.begin()+num_sends, voice->mSend.end(), Voice::TargetData{});
+            /* The device's mixing buffers were reallocated, so don't leave a
+             * fade out from the old direct buffer.
+             */
+            voice->mDirect.Buffer = {};
+            voice->mPrevDirectBuffer = {};
             for(auto &chandata : voice->mChans)
             {
                 std::fill(chandata.mWetParams.begin()+num_sends, chandata.mWetParams.end(),
@@ -2330,9 +2682,13 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
 
             voice->prepare(device);
         }
-        /* Clear all voice props to let them get allocated again. */
+        /* Clear all voice props to let them get allocated again, keeping any
+         * preallocated amount available.
+         */
         context->mVoicePropClusters.clear();
         context->mFreeVoiceProps.store(nullptr, std::memory_order_relaxed);
+        if(context->mPreallocVoices > 0)
+            context->allocVoiceProps(context->mPreallocVoices);
         srclock.unlock();
 
         context->mPropsDirty = false;
@@ -2390,10 +2746,12 @@ bool ResetDeviceParams(ALCdevice *device, const int *attrList)
 
             ctx->mVoicePropClusters.clear();
             ctx->mFreeVoiceProps.store(nullptr, std::memory_order_relaxed);
+            if(ctx->mPreallocVoices > 0)
+                ctx->allocVoiceProps(ctx->mPreallocVoices);
 
             ctx->mVoiceClusters.clear();
-            ctx->allocVoices(std::max<size_t>(256,
-                ctx->mActiveVoiceCount.load(std::memory_order_relaxed)));
+            ctx->allocVoices(std::max({size_t{256}, ctx->mPreallocVoices,
+                ctx->mActiveVoiceCount.load(std::memory_order_relaxed)}));
         }
 
         device->Connected.store(true);
@@ -2941,6 +3299,24 @@ static size_t GetIntegerv(ALCdevice *device, ALCenum param, const al::span<int>
         values[0] = static_cast<ALCenum>(device->getOutputMode1());
         return 1;
 
+    case ALC_DEVICE_UNDERRUN_COUNT_SOFT:
+        values[0] = static_cast<int>(minu(device->Backend->getLatencyStats().Underruns,
+            std::numeric_limits<int>::max()));
+        return 1;
+
+    case ALC_DEVICE_LATENCY_HISTORY_SIZE_SOFT:
+        values[0] = static_cast<int>(device->Backend->getLatencyStats().HistoryCount);
+        return 1;
+
+    case ALC_VOICE_ALLOC_FALLBACKS_SOFT:
+    {
+        uint count{0u};
+        for(ContextBase *ctx : *device->mContexts.load(std::memory_order_acquire))
+            count += ctx->mVoiceAllocFallbacks.load(std::memory_order_relaxed);
+        values[0] = static_cast<int>(minu(count, std::numeric_limits<int>::max()));
+        return 1;
+    }
+
     default:
         alcSetError(device, ALC_INVALID_ENUM);
     }
@@ -3087,6 +3463,27 @@ START_API_FUNC
         }
         break;
 
+    case ALC_DEVICE_TARGET_LATENCY_SOFT:
+        *values = dev->Backend->getLatencyStats().TargetLatency.count();
+        break;
+
+    case ALC_DEVICE_MAX_JITTER_SOFT:
+        *values = dev->Backend->getLatencyStats().MaxJitter.count();
+        break;
+
+    case ALC_DEVICE_LATENCY_HISTORY_SOFT:
+        {
+            /* Pairs of target latency and underrun count, newest first. */
+            const LatencyStats stats{dev->Backend->getLatencyStats()};
+            const size_t count{minz(stats.HistoryCount, static_cast<uint>(size)/2u)};
+            for(size_t i{0};i < count;++i)
+            {
+                values[i*2 + 0] = stats.History[i].Latency.count();
+                values[i*2 + 1] = stats.History[i].Underruns;
+            }
+        }
+        break;
+
     default:
         auto ivals = al::vector<int>(static_cast<uint>(size));
         if(size_t got{GetIntegerv(dev.get(), pname, ivals)})
@@ -3204,6 +3601,27 @@ START_API_FUNC
 
     dev->LastError.store(ALC_NO_ERROR);
 
+    uint prealloc_voices{0u};
+    for(size_t attrIdx{0};attrList && attrList[attrIdx];attrIdx += 2)
+    {
+        if(attrList[attrIdx] == ALC_PREALLOC_VOICES_SOFT)
+        {
+            if(attrList[attrIdx + 1] < 0)
+            {
+                WARN("Invalid preallocated voice count: %d\n", attrList[attrIdx + 1]);
+                alcSetError(dev.get(), ALC_INVALID_VALUE);
+                return nullptr;
+            }
+            prealloc_voices = static_cast<uint>(attrList[attrIdx + 1]);
+            if(prealloc_voices > MaxPreallocVoices)
+            {
+                WARN("Preallocated voice count %u clamped to %u\n", prealloc_voices,
+                    MaxPreallocVoices);
+                prealloc_voices = MaxPreallocVoices;
+            }
+        }
+    }
+
     ALCenum err{UpdateDeviceParams(dev.get(), attrList)};
     if(err != ALC_NO_ERROR)
     {
@@ -3212,6 +3630,29 @@ START_API_FUNC
     }
 
     ContextRef context{new ALCcontext{dev}};
+    context->mPreallocVoices = prealloc_voices;
+
+    if(auto distopt = dev->configValue<float>(nullptr, "voice-lod-distance"))
+    {
+        if(!(*distopt >= 0.0f))
+            ERR("voice-lod-distance must not be negative: %f\n", *distopt);
+        else
+            context->mListener.mLodDistance = *distopt;
+    }
+    if(auto gainopt = dev->configValue<float>(nullptr, "voice-lod-gain"))
+    {
+        const float valf{*gainopt};
+        if(!std::isfinite(valf))
+            ERR("voice-lod-gain must be finite: %f\n", valf);
+        else
+        {
+            const float db{minf(valf, 0.0f)};
+            if(db != valf)
+                WARN("voice-lod-gain clamped: %f, max: %f\n", valf, 0.0f);
+            context->mListener.mLodGain = std::pow(10.0f, db/20.0f);
+        }
+    }
+
     context->init();
 
     if(auto volopt = dev->configValue<float>(nullptr, "volume-adjust"))
@@ -3229,6 +3670,33 @@ START_API_FUNC
         }
     }
 
+    if(auto distopt = dev->configValue<float>(nullptr, "update-distance-threshold"))
+    {
+        if(!(*distopt >= 0.0f && std::isfinite(*distopt)))
+            ERR("update-distance-threshold out of range: %f\n", *distopt);
+        else
+            context->mPanningDistanceLimit = *distopt;
+    }
+    if(auto angleopt = dev->configValue<float>(nullptr, "update-angle-threshold"))
+    {
+        if(!(*angleopt >= 0.0f && *angleopt <= 180.0f))
+            ERR("update-angle-threshold out of range: %f\n", *angleopt);
+        else
+        {
+            context->mPanningAngleLimit = *angleopt * al::numbers::pi_v<float> / 180.0f;
+            context->mPanningCosAngleLimit = std::cos(context->mPanningAngleLimit);
+        }
+    }
+    if(auto gainopt = dev->configValue<float>(nullptr, "update-gain-threshold"))
+    {
+        if(!(*gainopt >= 0.0f && *gainopt <= 24.0f))
+            ERR("update-gain-threshold out of range: %f\n", *gainopt);
+        else
+            context->mPanningGainRatioLimit = std::pow(10.0f, *gainopt/20.0f);
+    }
+    if(auto limitopt = dev->configValue<uint>(nullptr, "update-voice-limit"))
+        context->mPanningUpdateLimit = *limitopt;
+
     {
         using ContextArray = al::FlexArray<ContextBase*>;
 
@@ -3396,7 +3864,7 @@ END_API_FUNC
 ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName)
 START_API_FUNC
 {
-    InitConfig();
+    InitBackends();
 
     if(!PlaybackFactory)
     {
@@ -3556,7 +4024,7 @@ END_API_FUNC
 ALC_API ALCdevice* ALC_APIENTRY alcCaptureOpenDevice(const ALCchar *deviceName, ALCuint frequency, ALCenum format, ALCsizei samples)
 START_API_FUNC
 {
-    InitConfig();
+    InitBackends();
 
     if(!CaptureFactory)
     {
@@ -4043,3 +4511,22 @@ START_API_FUNC
     return ALC_TRUE;
 }
 END_API_FUNC
+
+
+/************************************************
+ * ALC config reload functions
+ ************************************************/
+
+/** Reloads the config files. Devices pick up the new settings when they are
+ * next opened or reset; library-wide settings are only read once and keep
+ * their values.
+ */
+FORCE_ALIGN void ALC_APIENTRY alcReloadConfigSOFT(void)
+START_API_FUNC
+{
+    InitConfig();
+
+    TRACE("Reloading config\n");
+    ReadALConfig();
+}
+END_API_FUNC
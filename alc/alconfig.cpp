@@ -35,7 +35,9 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "alfstream.h"
@@ -43,16 +45,36 @@
 #include "core/helpers.h"
 #include "core/logging.h"
 #include "strutils.h"
-#include "vector.h"
 
 
 namespace {
 
-struct ConfigEntry {
-    std::string key;
-    std::string value;
+/* The loaded options, keyed by their full "block/key" or "block/device/key"
+ * name.
+ */
+using ConfigMap = std::unordered_map<std::string,std::string>;
+
+/* A resolved option lookup, with the value pre-converted to each type it may
+ * be queried as. str is null if the option isn't set.
+ */
+struct ConfigValue {
+    const std::string *str{nullptr};
+    int intval{0};
+    unsigned int uintval{0u};
+    float floatval{0.0f};
+    bool boolval{false};
 };
-al::vector<ConfigEntry> ConfOpts;
+using ValueCache = std::unordered_map<std::string,ConfigValue>;
+
+/* Device resets look up the same options repeatedly, so the results are
+ * cached for each device name (and separately for lookups without a device),
+ * keyed by the option name without the device. The caches are cleared when
+ * the config is (re)loaded, since they point into ConfOpts.
+ */
+std::mutex ConfigLock;
+ConfigMap ConfOpts;
+ValueCache GeneralCache;
+std::unordered_map<std::string,ValueCache> DeviceCaches;
 
 
 std::string &lstrip(std::string &line)
@@ -128,7 +150,7 @@ std::string expdup(const char *str)
     return output;
 }
 
-void LoadConfigFromFile(std::istream &f)
+void LoadConfigFromFile(ConfigMap &opts, std::istream &f)
 {
     std::string curSection;
     std::string buffer;
@@ -260,28 +282,16 @@ void LoadConfigFromFile(std::istream &f)
 
         TRACE(" found '%s' = '%s'\n", fullKey.c_str(), value.c_str());
 
-        /* Check if we already have this option set */
-        auto find_key = [&fullKey](const ConfigEntry &entry) -> bool
-        { return entry.key == fullKey; };
-        auto ent = std::find_if(ConfOpts.begin(), ConfOpts.end(), find_key);
-        if(ent != ConfOpts.end())
-        {
-            if(!value.empty())
-                ent->value = expdup(value.c_str());
-            else
-                ConfOpts.erase(ent);
-        }
-        else if(!value.empty())
-            ConfOpts.emplace_back(ConfigEntry{std::move(fullKey), expdup(value.c_str())});
+        /* An empty value unsets an option set by an earlier file. */
+        if(!value.empty())
+            opts[std::move(fullKey)] = expdup(value.c_str());
+        else
+            opts.erase(fullKey);
     }
-    ConfOpts.shrink_to_fit();
 }
 
-const char *GetConfigValue(const char *devName, const char *blockName, const char *keyName)
+std::string MakeKeyName(const char *devName, const char *blockName, const char *keyName)
 {
-    if(!keyName)
-        return nullptr;
-
     std::string key;
     if(blockName && al::strcasecmp(blockName, "general") != 0)
     {
@@ -303,31 +313,60 @@ const char *GetConfigValue(const char *devName, const char *blockName, const cha
         }
         key += keyName;
     }
+    return key;
+}
 
-    auto iter = std::find_if(ConfOpts.cbegin(), ConfOpts.cend(),
-        [&key](const ConfigEntry &entry) -> bool
-        { return entry.key == key; });
-    if(iter != ConfOpts.cend())
+ConfigValue ResolveConfigValue(const char *devName, const char *blockName, const char *keyName)
+{
+    std::string key{MakeKeyName(devName, blockName, keyName)};
+    auto iter = ConfOpts.find(key);
+    if(iter == ConfOpts.end() && devName)
     {
-        TRACE("Found %s = \"%s\"\n", key.c_str(), iter->value.c_str());
-        if(!iter->value.empty())
-            return iter->value.c_str();
-        return nullptr;
+        key = MakeKeyName(nullptr, blockName, keyName);
+        iter = ConfOpts.find(key);
     }
 
-    if(!devName)
+    ConfigValue ret{};
+    if(iter == ConfOpts.end())
     {
         TRACE("Key %s not found\n", key.c_str());
-        return nullptr;
+        return ret;
     }
-    return GetConfigValue(nullptr, blockName, keyName);
+    TRACE("Found %s = \"%s\"\n", key.c_str(), iter->second.c_str());
+
+    const char *val{iter->second.c_str()};
+    ret.str = &iter->second;
+    ret.intval = static_cast<int>(std::strtol(val, nullptr, 0));
+    ret.uintval = static_cast<unsigned int>(std::strtoul(val, nullptr, 0));
+    ret.floatval = std::strtof(val, nullptr);
+    ret.boolval = al::strcasecmp(val, "on") == 0 || al::strcasecmp(val, "yes") == 0
+        || al::strcasecmp(val, "true") == 0 || atoi(val) != 0;
+    return ret;
 }
 
-} // namespace
+/* Looks up the given option, falling back to the non-device option if the
+ * device doesn't set it. Must be called with ConfigLock held, and the result
+ * is only valid while it is.
+ */
+const ConfigValue *GetConfigValue(const char *devName, const char *blockName, const char *keyName)
+{
+    if(!keyName)
+        return nullptr;
+
+    ValueCache &cache = devName ? DeviceCaches[devName] : GeneralCache;
+    std::string key{MakeKeyName(nullptr, blockName, keyName)};
+    auto iter = cache.find(key);
+    if(iter == cache.end())
+    {
+        ConfigValue value{ResolveConfigValue(devName, blockName, keyName)};
+        iter = cache.emplace(std::move(key), value).first;
+    }
+    return iter->second.str ? &iter->second : nullptr;
+}
 
 
 #ifdef _WIN32
-void ReadALConfig()
+void LoadConfigFiles(ConfigMap &opts)
 {
     WCHAR buffer[MAX_PATH];
     if(SHGetSpecialFolderPathW(nullptr, buffer, CSIDL_APPDATA, FALSE) != FALSE)
@@ -338,7 +377,7 @@ void ReadALConfig()
         TRACE("Loading config %s...\n", filepath.c_str());
         al::ifstream f{filepath};
         if(f.is_open())
-            LoadConfigFromFile(f);
+            LoadConfigFromFile(opts, f);
     }
 
     std::string ppath{GetProcBinary().path};
@@ -348,7 +387,7 @@ void ReadALConfig()
         TRACE("Loading config %s...\n", ppath.c_str());
         al::ifstream f{ppath};
         if(f.is_open())
-            LoadConfigFromFile(f);
+            LoadConfigFromFile(opts, f);
     }
 
     if(auto confpath = al::getenv(L"ALSOFT_CONF"))
@@ -356,20 +395,22 @@ void ReadALConfig()
         TRACE("Loading config %s...\n", wstr_to_utf8(confpath->c_str()).c_str());
         al::ifstream f{*confpath};
         if(f.is_open())
-            LoadConfigFromFile(f);
+            LoadConfigFromFile(opts, f);
     }
 }
 
+} // namespace
+
 #else
 
-void ReadALConfig()
+void LoadConfigFiles(ConfigMap &opts)
 {
     const char *str{"/etc/openal/alsoft.conf"};
 
     TRACE("Loading config %s...\n", str);
     al::ifstream f{str};
     if(f.is_open())
-        LoadConfigFromFile(f);
+        LoadConfigFromFile(opts, f);
     f.close();
 
     std::string confpaths{al::getenv("XDG_CONFIG_DIRS").value_or("/etc/xdg")};
@@ -403,7 +444,7 @@ void ReadALConfig()
             TRACE("Loading config %s...\n", fname.c_str());
             f = al::ifstream{fname};
             if(f.is_open())
-                LoadConfigFromFile(f);
+                LoadConfigFromFile(opts, f);
         }
         fname.clear();
     }
@@ -420,7 +461,7 @@ void ReadALConfig()
         {
             f = al::ifstream{reinterpret_cast<char*>(fileName)};
             if(f.is_open())
-                LoadConfigFromFile(f);
+                LoadConfigFromFile(opts, f);
         }
     }
 #endif
@@ -434,7 +475,7 @@ void ReadALConfig()
         TRACE("Loading config %s...\n", fname.c_str());
         f = al::ifstream{fname};
         if(f.is_open())
-            LoadConfigFromFile(f);
+            LoadConfigFromFile(opts, f);
     }
 
     if(auto configdir = al::getenv("XDG_CONFIG_HOME"))
@@ -458,7 +499,7 @@ void ReadALConfig()
         TRACE("Loading config %s...\n", fname.c_str());
         f = al::ifstream{fname};
         if(f.is_open())
-            LoadConfigFromFile(f);
+            LoadConfigFromFile(opts, f);
     }
 
     std::string ppath{GetProcBinary().path};
@@ -470,7 +511,7 @@ void ReadALConfig()
         TRACE("Loading config %s...\n", ppath.c_str());
         f = al::ifstream{ppath};
         if(f.is_open())
-            LoadConfigFromFile(f);
+            LoadConfigFromFile(opts, f);
     }
 
     if(auto confname = al::getenv("ALSOFT_CONF"))
@@ -478,51 +519,70 @@ void ReadALConfig()
         TRACE("Loading config %s...\n", confname->c_str());
         f = al::ifstream{*confname};
         if(f.is_open())
-            LoadConfigFromFile(f);
+            LoadConfigFromFile(opts, f);
     }
 }
+
+} // namespace
+
 #endif
 
+
+void ReadALConfig()
+{
+    ConfigMap opts;
+    LoadConfigFiles(opts);
+
+    std::lock_guard<std::mutex> _{ConfigLock};
+    ConfOpts.swap(opts);
+    GeneralCache.clear();
+    DeviceCaches.clear();
+}
+
 al::optional<std::string> ConfigValueStr(const char *devName, const char *blockName, const char *keyName)
 {
-    if(const char *val{GetConfigValue(devName, blockName, keyName)})
-        return al::make_optional<std::string>(val);
+    std::lock_guard<std::mutex> _{ConfigLock};
+    if(const ConfigValue *val{GetConfigValue(devName, blockName, keyName)})
+        return al::make_optional(*val->str);
     return al::nullopt;
 }
 
 al::optional<int> ConfigValueInt(const char *devName, const char *blockName, const char *keyName)
 {
-    if(const char *val{GetConfigValue(devName, blockName, keyName)})
-        return al::make_optional(static_cast<int>(std::strtol(val, nullptr, 0)));
+    std::lock_guard<std::mutex> _{ConfigLock};
+    if(const ConfigValue *val{GetConfigValue(devName, blockName, keyName)})
+        return al::make_optional(val->intval);
     return al::nullopt;
 }
 
 al::optional<unsigned int> ConfigValueUInt(const char *devName, const char *blockName, const char *keyName)
 {
-    if(const char *val{GetConfigValue(devName, blockName, keyName)})
-        return al::make_optional(static_cast<unsigned int>(std::strtoul(val, nullptr, 0)));
+    std::lock_guard<std::mutex> _{ConfigLock};
+    if(const ConfigValue *val{GetConfigValue(devName, blockName, keyName)})
+        return al::make_optional(val->uintval);
     return al::nullopt;
 }
 
 al::optional<float> ConfigValueFloat(const char *devName, const char *blockName, const char *keyName)
 {
-    if(const char *val{GetConfigValue(devName, blockName, keyName)})
-        return al::make_optional(std::strtof(val, nullptr));
+    std::lock_guard<std::mutex> _{ConfigLock};
+    if(const ConfigValue *val{GetConfigValue(devName, blockName, keyName)})
+        return al::make_optional(val->floatval);
     return al::nullopt;
 }
 
 al::optional<bool> ConfigValueBool(const char *devName, const char *blockName, const char *keyName)
 {
-    if(const char *val{GetConfigValue(devName, blockName, keyName)})
-        return al::make_optional(al::strcasecmp(val, "on") == 0 || al::strcasecmp(val, "yes") == 0
-            || al::strcasecmp(val, "true")==0 || atoi(val) != 0);
+    std::lock_guard<std::mutex> _{ConfigLock};
+    if(const ConfigValue *val{GetConfigValue(devName, blockName, keyName)})
+        return al::make_optional(val->boolval);
     return al::nullopt;
 }
 
 bool GetConfigValueBool(const char *devName, const char *blockName, const char *keyName, bool def)
 {
-    if(const char *val{GetConfigValue(devName, blockName, keyName)})
-        return (al::strcasecmp(val, "on") == 0 || al::strcasecmp(val, "yes") == 0
-            || al::strcasecmp(val, "true") == 0 || atoi(val) != 0);
+    std::lock_guard<std::mutex> _{ConfigLock};
+    if(const ConfigValue *val{GetConfigValue(devName, blockName, keyName)})
+        return val->boolval;
     return def;
 }
@@ -5,6 +5,9 @@
 
 #include "aloptional.h"
 
+/* Loads (or reloads) the config files, replacing any previously loaded
+ * options. Safe to call while other threads are looking up options.
+ */
 void ReadALConfig();
 
 bool GetConfigValueBool(const char *devName, const char *blockName, const char *keyName, bool def);
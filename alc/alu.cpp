@@ -28,9 +28,11 @@
 #include <cassert>
 #include <chrono>
 #include <climits>
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <iterator>
 #include <limits>
@@ -39,6 +41,12 @@
 #include <stdint.h>
 #include <utility>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <emmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "almalloc.h"
 #include "alnumbers.h"
 #include "alnumeric.h"
@@ -57,6 +65,7 @@
 #include "core/cpu_caps.h"
 #include "core/devformat.h"
 #include "core/device.h"
+#include "core/effect_threads.h"
 #include "core/effects/base.h"
 #include "core/effectslot.h"
 #include "core/filters/biquad.h"
@@ -396,6 +405,8 @@ bool CalcContextParams(ContextBase *ctx)
     ctx->mParams.Gain = props->Gain * ctx->mGainBoost;
     ctx->mParams.MetersPerUnit = props->MetersPerUnit;
     ctx->mParams.AirAbsorptionGainHF = props->AirAbsorptionGainHF;
+    ctx->mParams.LodDistance = props->LodDistance;
+    ctx->mParams.LodGain = props->LodGain;
 
     ctx->mParams.DopplerFactor = props->DopplerFactor;
     ctx->mParams.SpeedOfSound = props->SpeedOfSound * props->DopplerVelocity;
@@ -556,8 +567,8 @@ struct RotatorCoeffs {
 
                 const int abs_m{std::abs(m)};
                 coeffs->u = std::sqrt(static_cast<float>(l*l - m*m)/denom);
-                coeffs->v = std::sqrt(static_cast<float>(l+abs_m-1) * static_cast<float>(l+abs_m) /
-                    denom) * (1.0f+d) * (1.0f - 2.0f*d) * 0.5f;
+                coeffs->v = std::sqrt(static_cast<float>(1+d) * static_cast<float>(l+abs_m-1) *
+                    static_cast<float>(l+abs_m) / denom) * (1.0f - 2.0f*d) * 0.5f;
                 coeffs->w = std::sqrt(static_cast<float>(l-abs_m-1) * static_cast<float>(l-abs_m) /
                     denom) * (1.0f-d) * -0.5f;
                 ++coeffs;
@@ -567,13 +578,21 @@ struct RotatorCoeffs {
         return ret;
     }
 };
-const auto RotatorCoeffArray = RotatorCoeffs::ConcatArrays(RotatorCoeffs::GenCoeffs<2>(),
-    RotatorCoeffs::GenCoeffs<3>());
+const auto RotatorCoeffArray = RotatorCoeffs::ConcatArrays(
+    RotatorCoeffs::ConcatArrays(RotatorCoeffs::ConcatArrays(RotatorCoeffs::GenCoeffs<2>(),
+        RotatorCoeffs::GenCoeffs<3>()), RotatorCoeffs::ConcatArrays(RotatorCoeffs::GenCoeffs<4>(),
+        RotatorCoeffs::GenCoeffs<5>())),
+    RotatorCoeffs::ConcatArrays(RotatorCoeffs::GenCoeffs<6>(), RotatorCoeffs::GenCoeffs<7>()));
+static_assert(MaxAmbiOrder == 7, "Rotator coefficients need updating for MaxAmbiOrder");
 
 /**
  * Given the matrix, pre-filled with the (zeroth- and) first-order rotation
  * coefficients, this fills in the coefficients for the higher orders up to and
  * including the given order. The matrix is in ACN layout.
+ *
+ * A rotation doesn't mix between orders, so only the square block along the
+ * diagonal for each order is written and read. Anything outside of those
+ * blocks is left as-is.
  */
 void AmbiRotator(AmbiRotateMatrix &matrix, const int order)
 {
@@ -668,6 +687,52 @@ constexpr float Deg2Rad(float x) noexcept
 
 struct GainTriplet { float Base, HF, LF; };
 
+void CalcVoiceFilters(Voice *voice, const VoiceProps *props, const GainTriplet &DryGain,
+    const al::span<const GainTriplet,MAX_SENDS> WetGain, const DeviceBase *Device)
+{
+    const auto Frequency = static_cast<float>(Device->Frequency);
+    const uint NumSends{Device->NumAuxSends};
+    const size_t num_channels{voice->mChans.size()};
+
+    {
+        const float hfNorm{props->Direct.HFReference / Frequency};
+        const float lfNorm{props->Direct.LFReference / Frequency};
+
+        voice->mDirect.FilterType = AF_None;
+        if(DryGain.HF != 1.0f) voice->mDirect.FilterType |= AF_LowPass;
+        if(DryGain.LF != 1.0f) voice->mDirect.FilterType |= AF_HighPass;
+
+        auto &lowpass = voice->mChans[0].mDryParams.LowPass;
+        auto &highpass = voice->mChans[0].mDryParams.HighPass;
+        lowpass.setParamsFromSlope(BiquadType::HighShelf, hfNorm, DryGain.HF, 1.0f);
+        highpass.setParamsFromSlope(BiquadType::LowShelf, lfNorm, DryGain.LF, 1.0f);
+        for(size_t c{1};c < num_channels;c++)
+        {
+            voice->mChans[c].mDryParams.LowPass.copyParamsFrom(lowpass);
+            voice->mChans[c].mDryParams.HighPass.copyParamsFrom(highpass);
+        }
+    }
+    for(uint i{0};i < NumSends;i++)
+    {
+        const float hfNorm{props->Send[i].HFReference / Frequency};
+        const float lfNorm{props->Send[i].LFReference / Frequency};
+
+        voice->mSend[i].FilterType = AF_None;
+        if(WetGain[i].HF != 1.0f) voice->mSend[i].FilterType |= AF_LowPass;
+        if(WetGain[i].LF != 1.0f) voice->mSend[i].FilterType |= AF_HighPass;
+
+        auto &lowpass = voice->mChans[0].mWetParams[i].LowPass;
+        auto &highpass = voice->mChans[0].mWetParams[i].HighPass;
+        lowpass.setParamsFromSlope(BiquadType::HighShelf, hfNorm, WetGain[i].HF, 1.0f);
+        highpass.setParamsFromSlope(BiquadType::LowShelf, lfNorm, WetGain[i].LF, 1.0f);
+        for(size_t c{1};c < num_channels;c++)
+        {
+            voice->mChans[c].mWetParams[i].LowPass.copyParamsFrom(lowpass);
+            voice->mChans[c].mWetParams[i].HighPass.copyParamsFrom(highpass);
+        }
+    }
+}
+
 void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, const float zpos,
     const float Distance, const float Spread, const GainTriplet &DryGain,
     const al::span<const GainTriplet,MAX_SENDS> WetGain, EffectSlot *(&SendSlots)[MAX_SENDS],
@@ -723,9 +788,11 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
     for(auto &chandata : voice->mChans)
     {
         chandata.mDryParams.Hrtf.Target = HrtfFilter{};
-        chandata.mDryParams.Gains.Target.fill(0.0f);
+        std::fill(chandata.mDryParams.Gains.Target.begin(),
+            chandata.mDryParams.Gains.Target.end(), 0.0f);
         std::for_each(chandata.mWetParams.begin(), chandata.mWetParams.begin()+NumSends,
-            [](SendParams &params) -> void { params.Gains.Target.fill(0.0f); });
+            [](SendParams &params) -> void
+            { std::fill(params.Gains.Target.begin(), params.Gains.Target.end(), 0.0f); });
     }
 
     DirectMode DirectChannels{props->DirectChannels};
@@ -766,7 +833,11 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
         break;
     }
 
+    const bool hadHrtf{voice->mFlags.test(VoiceHasHrtf)};
+    const al::span<FloatBufferLine> prevDirectBuffer{voice->mDirect.Buffer};
+    const bool lowDetail{voice->mFlags.test(VoiceIsLowDetail)};
     voice->mFlags.reset(VoiceHasHrtf).reset(VoiceHasNfc);
+    voice->mDirect.Buffer = Device->Dry.Buffer;
     if(auto *decoder{voice->mDecoder.get()})
         decoder->mWidthControl = minf(props->EnhWidth, 0.7f);
 
@@ -774,7 +845,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
     {
         /* Special handling for B-Format and UHJ sources. */
 
-        if(Device->AvgSpeakerDist > 0.0f && voice->mFmtChannels != FmtUHJ2
+        if(Device->AvgSpeakerDist > 0.0f && !lowDetail && voice->mFmtChannels != FmtUHJ2
             && voice->mFmtChannels != FmtSuperStereo)
         {
             if(!(Distance > std::numeric_limits<float>::epsilon()))
@@ -862,10 +933,10 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
 
             /* Build a rotation matrix. Manually fill the zeroth- and first-
              * order elements, then construct the rotation for the higher
-             * orders.
+             * orders. Only the per-order blocks along the diagonal are used,
+             * so the rest of the matrix doesn't need to be cleared.
              */
             AmbiRotateMatrix &shrot = Device->mAmbiRotateMatrix;
-            shrot.fill({});
 
             shrot[0][0] = 1.0f;
             shrot[1][1] =  U[0]; shrot[1][2] = -V[0]; shrot[1][3] = -N[0];
@@ -880,14 +951,12 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                 GetAmbi2DLayout(voice->mAmbiLayout).data() :
                 GetAmbiLayout(voice->mAmbiLayout).data()};
 
-            static const uint8_t ChansPerOrder[MaxAmbiOrder+1]{1, 3, 5, 7,};
-            static const uint8_t OrderOffset[MaxAmbiOrder+1]{0, 1, 4, 9,};
             for(size_t c{1};c < num_channels;c++)
             {
                 const size_t acn{index_map[c]};
                 const size_t order{AmbiIndex::OrderFromChannel()[acn]};
-                const size_t tocopy{ChansPerOrder[order]};
-                const size_t offset{OrderOffset[order]};
+                const size_t tocopy{order*2 + 1};
+                const size_t offset{order*order};
                 const float scale{scales[acn] * coverage};
                 auto in = shrot.cbegin() + offset;
 
@@ -953,7 +1022,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
             }
         }
     }
-    else if(Device->mRenderMode == RenderMode::Hrtf)
+    else if(Device->mRenderMode == RenderMode::Hrtf && !lowDetail)
     {
         /* Full HRTF rendering. Skip the virtual channels and render to the
          * real outputs.
@@ -1066,7 +1135,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
         if(Distance > std::numeric_limits<float>::epsilon())
         {
             /* Calculate NFC filter coefficient if needed. */
-            if(Device->AvgSpeakerDist > 0.0f)
+            if(Device->AvgSpeakerDist > 0.0f && !lowDetail)
             {
                 /* Clamp the distance for really close sources, to prevent
                  * excessive bass.
@@ -1158,7 +1227,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
         }
         else
         {
-            if(Device->AvgSpeakerDist > 0.0f)
+            if(Device->AvgSpeakerDist > 0.0f && !lowDetail)
             {
                 /* If the source distance is 0, simulate a plane-wave by using
                  * infinite distance, which results in a w0 of 0.
@@ -1205,42 +1274,54 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
         }
     }
 
+    if(voice->mFlags.test(VoiceHasHrtf) != hadHrtf && voice->mFlags.test(VoiceIsFading))
     {
-        const float hfNorm{props->Direct.HFReference / Frequency};
-        const float lfNorm{props->Direct.LFReference / Frequency};
-
-        voice->mDirect.FilterType = AF_None;
-        if(DryGain.HF != 1.0f) voice->mDirect.FilterType |= AF_LowPass;
-        if(DryGain.LF != 1.0f) voice->mDirect.FilterType |= AF_HighPass;
-
-        auto &lowpass = voice->mChans[0].mDryParams.LowPass;
-        auto &highpass = voice->mChans[0].mDryParams.HighPass;
-        lowpass.setParamsFromSlope(BiquadType::HighShelf, hfNorm, DryGain.HF, 1.0f);
-        highpass.setParamsFromSlope(BiquadType::LowShelf, lfNorm, DryGain.LF, 1.0f);
-        for(size_t c{1};c < num_channels;c++)
+        /* The direct path is switching between per-source HRTF and panning,
+         * which mix through separate gains. The mixer fades out the old path
+         * while the new one fades in from silence.
+         */
+        voice->mFlags.set(VoiceHrtfChanged);
+        for(auto &chandata : voice->mChans)
         {
-            voice->mChans[c].mDryParams.LowPass.copyParamsFrom(lowpass);
-            voice->mChans[c].mDryParams.HighPass.copyParamsFrom(highpass);
+            DirectParams &parms = chandata.mDryParams;
+            if(hadHrtf)
+                std::fill(parms.Gains.Current.begin(), parms.Gains.Current.end(), 0.0f);
+            else
+            {
+                parms.Hrtf.Old.Gain = 0.0f;
+                parms.Hrtf.History.fill(0.0f);
+            }
         }
+        /* The old panned gains are for the buffer it was mixing to, which may
+         * not be the ambisonic dry buffer (e.g. direct channels to RealOut).
+         */
+        voice->mPrevDirectBuffer = prevDirectBuffer;
     }
-    for(uint i{0};i < NumSends;i++)
-    {
-        const float hfNorm{props->Send[i].HFReference / Frequency};
-        const float lfNorm{props->Send[i].LFReference / Frequency};
 
-        voice->mSend[i].FilterType = AF_None;
-        if(WetGain[i].HF != 1.0f) voice->mSend[i].FilterType |= AF_LowPass;
-        if(WetGain[i].LF != 1.0f) voice->mSend[i].FilterType |= AF_HighPass;
+    CalcVoiceFilters(voice, props, DryGain, WetGain, Device);
+}
 
-        auto &lowpass = voice->mChans[0].mWetParams[i].LowPass;
-        auto &highpass = voice->mChans[0].mWetParams[i].HighPass;
-        lowpass.setParamsFromSlope(BiquadType::HighShelf, hfNorm, WetGain[i].HF, 1.0f);
-        highpass.setParamsFromSlope(BiquadType::LowShelf, lfNorm, WetGain[i].LF, 1.0f);
-        for(size_t c{1};c < num_channels;c++)
-        {
-            voice->mChans[c].mWetParams[i].LowPass.copyParamsFrom(lowpass);
-            voice->mChans[c].mWetParams[i].HighPass.copyParamsFrom(highpass);
-        }
+/* How far back within the LOD thresholds a voice needs to come before going
+ * back to full detail, to keep voices near the thresholds from switching on
+ * every update.
+ */
+constexpr float LodDistanceHysteresis{0.9f};
+constexpr float LodGainHysteresis{1.122018454f}; /* +1dB */
+
+void SetVoiceLowDetail(Voice *voice, const bool lowDetail, const DeviceBase *Device)
+{
+    if(voice->mFlags.test(VoiceIsLowDetail) == lowDetail)
+        return;
+    voice->mFlags.set(VoiceIsLowDetail, lowDetail);
+    voice->mPanningKey.Valid = false;
+
+    /* The near-field filters aren't run with reduced detail, so restart them
+     * when coming back rather than resume from stale history.
+     */
+    if(!lowDetail)
+    {
+        for(auto &chandata : voice->mChans)
+            chandata.mDryParams.NFCtrlFilter = Device->mNFCtrlFilter;
     }
 }
 
@@ -1249,7 +1330,6 @@ void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const Contex
     DeviceBase *Device{context->mDevice};
     EffectSlot *SendSlots[MAX_SENDS];
 
-    voice->mDirect.Buffer = Device->Dry.Buffer;
     for(uint i{0};i < Device->NumAuxSends;i++)
     {
         SendSlots[i] = props->Send[i].Slot;
@@ -1260,6 +1340,7 @@ void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const Contex
         }
         else
             voice->mSend[i].Buffer = SendSlots[i]->Wet.Buffer;
+        voice->mSend[i].Slot = SendSlots[i];
     }
 
     /* Calculate the stepping value */
@@ -1286,37 +1367,315 @@ void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const Contex
         WetGain[i].LF = props->Send[i].GainLF;
     }
 
+    /* Non-spatialized sources always get full detail, and are always fully
+     * recalculated.
+     */
+    SetVoiceLowDetail(voice, false, Device);
+    voice->mPanningKey.Valid = false;
+    voice->mFlags.reset(VoicePanningDeferred);
+
     CalcPanningAndFilters(voice, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, DryGain, WetGain, SendSlots, props,
         context->mParams, Device);
 }
 
-void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBase *context)
+/* Checks if a gain is within the given ratio of the previous one. */
+inline bool GainNear(const float prev, const float cur, const float ratio) noexcept
+{ return cur == prev || (cur > prev/ratio && cur < prev*ratio); }
+
+inline bool GainsNear(const std::array<float,3> &prev, const GainTriplet &cur, const float ratio)
+    noexcept
 {
-    DeviceBase *Device{context->mDevice};
-    const uint NumSends{Device->NumAuxSends};
+    return GainNear(prev[0], cur.Base, ratio) && GainNear(prev[1], cur.HF, ratio)
+        && GainNear(prev[2], cur.LF, ratio);
+}
 
-    /* Set mixing buffers and get send parameters. */
-    voice->mDirect.Buffer = Device->Dry.Buffer;
-    EffectSlot *SendSlots[MAX_SENDS];
-    uint UseDryAttnForRoom{0};
-    for(uint i{0};i < NumSends;i++)
-    {
-        SendSlots[i] = props->Send[i].Slot;
-        if(!SendSlots[i] || SendSlots[i]->EffectType == EffectSlotType::None)
-            SendSlots[i] = nullptr;
-        else if(!SendSlots[i]->AuxSendAuto)
-        {
-            /* If the slot's auxiliary send auto is off, the data sent to the
-             * effect slot is the same as the dry path, sans filter effects.
-             */
-            UseDryAttnForRoom |= 1u<<i;
-        }
+/* Checks if a direction is within the given angle (as a cosine) of the
+ * previous one. Both are expected to be normalized, or null.
+ */
+inline bool DirectionNear(const std::array<float,3> &prev, const alu::Vector &cur,
+    const float cosangle) noexcept
+{
+    if(prev[0] == cur[0] && prev[1] == cur[1] && prev[2] == cur[2])
+        return true;
+    return prev[0]*cur[0] + prev[1]*cur[1] + prev[2]*cur[2] > cosangle;
+}
 
-        if(!SendSlots[i])
-            voice->mSend[i].Buffer = {};
-        else
-            voice->mSend[i].Buffer = SendSlots[i]->Wet.Buffer;
-    }
+/* Fast approximations of log2, exp2, and acos for the attenuation
+ * calculations. The vector versions below use the same method as these, so a
+ * voice gets (nearly) the same result no matter where it falls in a batch.
+ * log2 expects a positive normal value, and exp2 clamps the exponent so the
+ * result stays a normal float.
+ */
+constexpr float Log2C1{2.885390082f}; /* 2 / (n*ln(2)) */
+constexpr float Log2C3{0.961796694f};
+constexpr float Log2C5{0.577078016f};
+constexpr float Log2C7{0.412198583f};
+constexpr float Log2C9{0.320598898f};
+
+constexpr float Exp2C1{0.693147181f}; /* ln(2)^n / n! */
+constexpr float Exp2C2{0.240226507f};
+constexpr float Exp2C3{0.055504109f};
+constexpr float Exp2C4{0.009618129f};
+constexpr float Exp2C5{0.001333356f};
+constexpr float Exp2C6{0.000154035f};
+
+/* Abramowitz and Stegun 4.4.46, with an absolute error within 2e-8. */
+constexpr float AcosC0{ 1.5707963050f};
+constexpr float AcosC1{-0.2145988016f};
+constexpr float AcosC2{ 0.0889789874f};
+constexpr float AcosC3{-0.0501743046f};
+constexpr float AcosC4{ 0.0308918810f};
+constexpr float AcosC5{-0.0170881256f};
+constexpr float AcosC6{ 0.0066700901f};
+constexpr float AcosC7{-0.0012624911f};
+
+/* 0x3f3504f3 is the bit pattern of sqrt(1/2). */
+constexpr int32_t Log2MantissaBase{0x3f3504f3};
+
+inline float fast_log2f(const float x) noexcept
+{
+    /* Split the value into an exponent and a mantissa in [sqrt(1/2),sqrt(2)),
+     * and use a series in (m-1)/(m+1) for the log of the mantissa.
+     */
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    const int32_t e{(bits - Log2MantissaBase) >> 23};
+    bits -= e * (1<<23);
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+
+    const float t{(m-1.0f) / (m+1.0f)};
+    const float t2{t*t};
+    const float p{(((Log2C9*t2 + Log2C7)*t2 + Log2C5)*t2 + Log2C3)*t2 + Log2C1};
+    return static_cast<float>(e) + p*t;
+}
+
+inline float fast_exp2f(float x) noexcept
+{
+    /* Split off the nearest integer as the exponent, and use a polynomial for
+     * the remaining fraction in [-0.5,0.5).
+     */
+    x = clampf(x, -125.0f, 127.0f);
+    const int32_t n{float2int(x + 128.5f) - 128};
+    const float f{x - static_cast<float>(n)};
+    const float p{(((((Exp2C6*f + Exp2C5)*f + Exp2C4)*f + Exp2C3)*f + Exp2C2)*f + Exp2C1)*f
+        + 1.0f};
+
+    int32_t bits;
+    std::memcpy(&bits, &p, sizeof(bits));
+    bits += n * (1<<23);
+    float ret;
+    std::memcpy(&ret, &bits, sizeof(ret));
+    return ret;
+}
+
+inline float fast_acosf(const float x) noexcept
+{
+    const float ax{std::abs(x)};
+    const float p{((((((AcosC7*ax + AcosC6)*ax + AcosC5)*ax + AcosC4)*ax + AcosC3)*ax
+        + AcosC2)*ax + AcosC1)*ax + AcosC0};
+    const float r{std::sqrt(1.0f - ax) * p};
+    return (x < 0.0f) ? al::numbers::pi_v<float> - r : r;
+}
+
+#ifdef HAVE_SSE_INTRINSICS
+
+inline __m128 select_ps(const __m128 mask, const __m128 a, const __m128 b) noexcept
+{ return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+inline __m128 fast_log2_ps(const __m128 x) noexcept
+{
+    const __m128i bits{_mm_castps_si128(x)};
+    const __m128i e{_mm_srai_epi32(_mm_sub_epi32(bits, _mm_set1_epi32(Log2MantissaBase)), 23)};
+    const __m128 m{_mm_castsi128_ps(_mm_sub_epi32(bits, _mm_slli_epi32(e, 23)))};
+
+    const __m128 one{_mm_set1_ps(1.0f)};
+    const __m128 t{_mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one))};
+    const __m128 t2{_mm_mul_ps(t, t)};
+    __m128 p{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Log2C9), t2), _mm_set1_ps(Log2C7))};
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(Log2C5));
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(Log2C3));
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(Log2C1));
+    return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(p, t));
+}
+
+inline __m128 fast_exp2_ps(__m128 x) noexcept
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-125.0f)), _mm_set1_ps(127.0f));
+    const __m128i n{_mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(x, _mm_set1_ps(128.5f))),
+        _mm_set1_epi32(128))};
+    const __m128 f{_mm_sub_ps(x, _mm_cvtepi32_ps(n))};
+    __m128 p{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Exp2C6), f), _mm_set1_ps(Exp2C5))};
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(Exp2C4));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(Exp2C3));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(Exp2C2));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(Exp2C1));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+    return _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(p), _mm_slli_epi32(n, 23)));
+}
+
+inline __m128 fast_acos_ps(const __m128 x) noexcept
+{
+    const __m128 signmask{_mm_set1_ps(-0.0f)};
+    const __m128 ax{_mm_andnot_ps(signmask, x)};
+    __m128 p{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(AcosC7), ax), _mm_set1_ps(AcosC6))};
+    p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(AcosC5));
+    p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(AcosC4));
+    p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(AcosC3));
+    p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(AcosC2));
+    p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(AcosC1));
+    p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(AcosC0));
+    const __m128 r{_mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), ax)), p)};
+    const __m128 neg{_mm_cmplt_ps(x, _mm_setzero_ps())};
+    return select_ps(neg, _mm_sub_ps(_mm_set1_ps(al::numbers::pi_v<float>), r), r);
+}
+
+#elif defined(HAVE_NEON)
+
+inline float32x4_t select_ps(const uint32x4_t mask, const float32x4_t a, const float32x4_t b)
+    noexcept
+{ return vbslq_f32(mask, a, b); }
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+
+inline float32x4_t div_ps(const float32x4_t a, const float32x4_t b) noexcept
+{ return vdivq_f32(a, b); }
+
+inline float32x4_t sqrt_ps(const float32x4_t x) noexcept
+{ return vsqrtq_f32(x); }
+
+#else
+
+/* 32-bit NEON has no vector divide or square root, so use the estimates with
+ * a couple refinement steps. These can be off from the scalar results by an
+ * ulp or two.
+ */
+inline float32x4_t div_ps(const float32x4_t a, const float32x4_t b) noexcept
+{
+    float32x4_t r{vrecpeq_f32(b)};
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+}
+
+inline float32x4_t sqrt_ps(const float32x4_t x) noexcept
+{
+    float32x4_t r{vrsqrteq_f32(x)};
+    r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x, r), r), r);
+    r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x, r), r), r);
+    return select_ps(vcgtq_f32(x, vdupq_n_f32(0.0f)), vmulq_f32(x, r), vdupq_n_f32(0.0f));
+}
+#endif
+
+inline float32x4_t fast_log2_ps(const float32x4_t x) noexcept
+{
+    const int32x4_t bits{vreinterpretq_s32_f32(x)};
+    const int32x4_t e{vshrq_n_s32(vsubq_s32(bits, vdupq_n_s32(Log2MantissaBase)), 23)};
+    const float32x4_t m{vreinterpretq_f32_s32(vsubq_s32(bits, vshlq_n_s32(e, 23)))};
+
+    const float32x4_t one{vdupq_n_f32(1.0f)};
+    const float32x4_t t{div_ps(vsubq_f32(m, one), vaddq_f32(m, one))};
+    const float32x4_t t2{vmulq_f32(t, t)};
+    float32x4_t p{vmlaq_f32(vdupq_n_f32(Log2C7), vdupq_n_f32(Log2C9), t2)};
+    p = vmlaq_f32(vdupq_n_f32(Log2C5), p, t2);
+    p = vmlaq_f32(vdupq_n_f32(Log2C3), p, t2);
+    p = vmlaq_f32(vdupq_n_f32(Log2C1), p, t2);
+    return vmlaq_f32(vcvtq_f32_s32(e), p, t);
+}
+
+inline float32x4_t fast_exp2_ps(float32x4_t x) noexcept
+{
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-125.0f)), vdupq_n_f32(127.0f));
+    const int32x4_t n{vsubq_s32(vcvtq_s32_f32(vaddq_f32(x, vdupq_n_f32(128.5f))),
+        vdupq_n_s32(128))};
+    const float32x4_t f{vsubq_f32(x, vcvtq_f32_s32(n))};
+    float32x4_t p{vmlaq_f32(vdupq_n_f32(Exp2C5), vdupq_n_f32(Exp2C6), f)};
+    p = vmlaq_f32(vdupq_n_f32(Exp2C4), p, f);
+    p = vmlaq_f32(vdupq_n_f32(Exp2C3), p, f);
+    p = vmlaq_f32(vdupq_n_f32(Exp2C2), p, f);
+    p = vmlaq_f32(vdupq_n_f32(Exp2C1), p, f);
+    p = vmlaq_f32(vdupq_n_f32(1.0f), p, f);
+    return vreinterpretq_f32_s32(vaddq_s32(vreinterpretq_s32_f32(p), vshlq_n_s32(n, 23)));
+}
+
+inline float32x4_t fast_acos_ps(const float32x4_t x) noexcept
+{
+    const float32x4_t ax{vabsq_f32(x)};
+    float32x4_t p{vmlaq_f32(vdupq_n_f32(AcosC6), vdupq_n_f32(AcosC7), ax)};
+    p = vmlaq_f32(vdupq_n_f32(AcosC5), p, ax);
+    p = vmlaq_f32(vdupq_n_f32(AcosC4), p, ax);
+    p = vmlaq_f32(vdupq_n_f32(AcosC3), p, ax);
+    p = vmlaq_f32(vdupq_n_f32(AcosC2), p, ax);
+    p = vmlaq_f32(vdupq_n_f32(AcosC1), p, ax);
+    p = vmlaq_f32(vdupq_n_f32(AcosC0), p, ax);
+    const float32x4_t r{vmulq_f32(sqrt_ps(vsubq_f32(vdupq_n_f32(1.0f), ax)), p)};
+    const uint32x4_t neg{vcltq_f32(x, vdupq_n_f32(0.0f))};
+    return select_ps(neg, vsubq_f32(vdupq_n_f32(al::numbers::pi_v<float>), r), r);
+}
+
+#endif
+
+/* Source parameters and results for the distance, cone, and doppler
+ * calculations of a batch of voices. The values are kept in separate arrays
+ * so the calculations can be done for several voices at once.
+ */
+struct AttnBatch {
+    static constexpr size_t MaxVoices{64};
+
+    template<typename T>
+    using Lanes = std::array<T,MaxVoices>;
+
+    /* The distance models, after the clamped models are resolved. */
+    static constexpr int32_t ModelNone{0};
+    static constexpr int32_t ModelInverse{1};
+    static constexpr int32_t ModelLinear{2};
+    static constexpr int32_t ModelExponent{3};
+
+    size_t Count{0};
+    Lanes<Voice*> Voices;
+    Lanes<size_t> Indices;
+    Lanes<alu::Vector> ToSource;
+
+    /* Inputs. Sources without a cone have infinite cone angles. */
+    alignas(16) Lanes<int32_t> Model;
+    alignas(16) Lanes<float> Distance;
+    alignas(16) Lanes<float> ClampedDist;
+    alignas(16) Lanes<float> RefDistance;
+    alignas(16) Lanes<float> MaxDistance;
+    alignas(16) Lanes<float> Rolloff;
+    alignas(16) Lanes<float> RoomRolloff;
+    alignas(16) Lanes<float> Gain;
+    alignas(16) Lanes<float> MinGain;
+    alignas(16) Lanes<float> MaxGain;
+    alignas(16) Lanes<float> ConeCos;
+    alignas(16) Lanes<float> InnerAngle;
+    alignas(16) Lanes<float> OuterAngle;
+    alignas(16) Lanes<float> OuterGain;
+    alignas(16) Lanes<float> OuterGainHF;
+    alignas(16) Lanes<float> DryGainHFAuto;
+    alignas(16) Lanes<float> WetGainAuto;
+    alignas(16) Lanes<float> WetGainHFAuto;
+    alignas(16) Lanes<float> AirAbsorption;
+    alignas(16) Lanes<float> DopplerFactor;
+    alignas(16) Lanes<float> SourceSpeed;
+    alignas(16) Lanes<float> ListenerSpeed;
+
+    /* Results. The pitch (initially the source pitch) gets the doppler shift
+     * applied.
+     */
+    alignas(16) Lanes<float> Pitch;
+    alignas(16) Lanes<float> DryGain;
+    alignas(16) Lanes<float> WetGain;
+    alignas(16) Lanes<float> ConeHF;
+    alignas(16) Lanes<float> WetConeHF;
+    alignas(16) Lanes<float> AirHF;
+};
+
+/* Transforms a voice's source to listener space and adds it to the batch. */
+void AddAttnVoice(AttnBatch &batch, Voice *voice, const size_t idx, const ContextBase *context)
+{
+    const VoiceProps *props{&voice->mProps};
+    const size_t i{batch.Count++};
 
     /* Transform source to listener space (convert to head relative) */
     alu::Vector Position{props->Position[0], props->Position[1], props->Position[2], 1.0f};
@@ -1339,11 +1698,11 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
     alu::Vector ToSource{Position[0], Position[1], Position[2], 0.0f};
     const float Distance{ToSource.normalize()};
 
-    /* Calculate distance attenuation */
+    /* The clamped distance models don't attenuate if the max distance is
+     * less than the reference distance.
+     */
     float ClampedDist{Distance};
-    float DryGainBase{props->Gain};
-    float WetGainBase{props->Gain};
-
+    int32_t model{AttnBatch::ModelNone};
     switch(context->mParams.SourceDistanceModel ? props->mDistanceModel
         : context->mParams.mDistanceModel)
     {
@@ -1352,14 +1711,7 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
             ClampedDist = clampf(ClampedDist, props->RefDistance, props->MaxDistance);
             /*fall-through*/
         case DistanceModel::Inverse:
-            if(props->RefDistance > 0.0f)
-            {
-                float dist{lerpf(props->RefDistance, ClampedDist, props->RolloffFactor)};
-                if(dist > 0.0f) DryGainBase *= props->RefDistance / dist;
-
-                dist = lerpf(props->RefDistance, ClampedDist, props->RoomRolloffFactor);
-                if(dist > 0.0f) WetGainBase *= props->RefDistance / dist;
-            }
+            model = AttnBatch::ModelInverse;
             break;
 
         case DistanceModel::LinearClamped:
@@ -1367,16 +1719,7 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
             ClampedDist = clampf(ClampedDist, props->RefDistance, props->MaxDistance);
             /*fall-through*/
         case DistanceModel::Linear:
-            if(props->MaxDistance != props->RefDistance)
-            {
-                float attn{(ClampedDist-props->RefDistance) /
-                    (props->MaxDistance-props->RefDistance) * props->RolloffFactor};
-                DryGainBase *= maxf(1.0f - attn, 0.0f);
-
-                attn = (ClampedDist-props->RefDistance) /
-                    (props->MaxDistance-props->RefDistance) * props->RoomRolloffFactor;
-                WetGainBase *= maxf(1.0f - attn, 0.0f);
-            }
+            model = AttnBatch::ModelLinear;
             break;
 
         case DistanceModel::ExponentClamped:
@@ -1384,51 +1727,384 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
             ClampedDist = clampf(ClampedDist, props->RefDistance, props->MaxDistance);
             /*fall-through*/
         case DistanceModel::Exponent:
-            if(ClampedDist > 0.0f && props->RefDistance > 0.0f)
-            {
-                const float dist_ratio{ClampedDist/props->RefDistance};
-                DryGainBase *= std::pow(dist_ratio, -props->RolloffFactor);
-                WetGainBase *= std::pow(dist_ratio, -props->RoomRolloffFactor);
-            }
+            model = AttnBatch::ModelExponent;
             break;
 
         case DistanceModel::Disable:
             break;
     }
 
-    /* Calculate directional soundcones */
-    float ConeHF{1.0f}, WetConeHF{1.0f};
+    batch.Voices[i] = voice;
+    batch.Indices[i] = idx;
+    batch.ToSource[i] = ToSource;
+
+    batch.Model[i] = model;
+    batch.Distance[i] = Distance;
+    batch.ClampedDist[i] = ClampedDist;
+    batch.RefDistance[i] = props->RefDistance;
+    batch.MaxDistance[i] = props->MaxDistance;
+    batch.Rolloff[i] = props->RolloffFactor;
+    batch.RoomRolloff[i] = props->RoomRolloffFactor;
+    batch.Gain[i] = props->Gain;
+    batch.MinGain[i] = props->MinGain;
+    batch.MaxGain[i] = props->MaxGain;
     if(directional && props->InnerAngle < 360.0f)
     {
-        static constexpr float Rad2Deg{static_cast<float>(180.0 / al::numbers::pi)};
-        const float Angle{Rad2Deg*2.0f * std::acos(-Direction.dot_product(ToSource)) * ConeScale};
+        batch.ConeCos[i] = -Direction.dot_product(ToSource);
+        batch.InnerAngle[i] = props->InnerAngle;
+        batch.OuterAngle[i] = props->OuterAngle;
+    }
+    else
+    {
+        batch.ConeCos[i] = 1.0f;
+        batch.InnerAngle[i] = std::numeric_limits<float>::infinity();
+        batch.OuterAngle[i] = std::numeric_limits<float>::infinity();
+    }
+    batch.OuterGain[i] = props->OuterGain;
+    batch.OuterGainHF[i] = props->OuterGainHF;
+    batch.DryGainHFAuto[i] = props->DryGainHFAuto ? 1.0f : 0.0f;
+    batch.WetGainAuto[i] = props->WetGainAuto ? 1.0f : 0.0f;
+    batch.WetGainHFAuto[i] = props->WetGainHFAuto ? 1.0f : 0.0f;
+    batch.AirAbsorption[i] = props->AirAbsorptionFactor;
+    batch.DopplerFactor[i] = props->DopplerFactor * context->mParams.DopplerFactor;
+    batch.SourceSpeed[i] = Velocity.dot_product(ToSource);
+    batch.ListenerSpeed[i] = context->mParams.Velocity.dot_product(ToSource);
+    batch.Pitch[i] = props->Pitch;
+}
+
+/* Calculates the distance and cone attenuation, air absorption, and doppler
+ * shift for the voices in the batch.
+ */
+void CalcAttnBatch(AttnBatch &batch, const ContextBase *context)
+{
+    static constexpr float Rad2Deg{static_cast<float>(180.0 / al::numbers::pi)};
+    const float ConeAngleScale{Rad2Deg*2.0f * ConeScale};
+    const float ContextGain{context->mParams.Gain};
+    const float MetersPerUnit{context->mParams.MetersPerUnit};
+    const float Log2AirGainHF{std::log2(context->mParams.AirAbsorptionGainHF)};
+    const float SpeedOfSound{context->mParams.SpeedOfSound};
+    static constexpr float Epsilon{std::numeric_limits<float>::epsilon()};
+    static constexpr float Infinity{std::numeric_limits<float>::infinity()};
+
+    const size_t count{batch.Count};
+    size_t i{0};
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 zero{_mm_setzero_ps()};
+    const __m128 one{_mm_set1_ps(1.0f)};
+    for(;count-i >= 4;i += 4)
+    {
+        const __m128i model{_mm_load_si128(reinterpret_cast<const __m128i*>(&batch.Model[i]))};
+        const __m128 dist{_mm_load_ps(&batch.ClampedDist[i])};
+        const __m128 refdist{_mm_load_ps(&batch.RefDistance[i])};
+        const __m128 rolloff{_mm_load_ps(&batch.Rolloff[i])};
+        const __m128 roomrolloff{_mm_load_ps(&batch.RoomRolloff[i])};
+        const __m128 hasref{_mm_cmpgt_ps(refdist, zero)};
+
+        /* Inverse distance. */
+        __m128 d{_mm_add_ps(refdist, _mm_mul_ps(_mm_sub_ps(dist, refdist), rolloff))};
+        const __m128 dryinv{select_ps(_mm_and_ps(hasref, _mm_cmpgt_ps(d, zero)),
+            _mm_div_ps(refdist, d), one)};
+        d = _mm_add_ps(refdist, _mm_mul_ps(_mm_sub_ps(dist, refdist), roomrolloff));
+        const __m128 wetinv{select_ps(_mm_and_ps(hasref, _mm_cmpgt_ps(d, zero)),
+            _mm_div_ps(refdist, d), one)};
+
+        /* Linear distance. */
+        const __m128 maxdist{_mm_load_ps(&batch.MaxDistance[i])};
+        const __m128 hasrange{_mm_cmpneq_ps(maxdist, refdist)};
+        const __m128 scale{_mm_div_ps(_mm_sub_ps(dist, refdist), _mm_sub_ps(maxdist, refdist))};
+        const __m128 drylin{select_ps(hasrange,
+            _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(scale, rolloff)), zero), one)};
+        const __m128 wetlin{select_ps(hasrange,
+            _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(scale, roomrolloff)), zero), one)};
+
+        /* Exponential distance. */
+        const __m128 isexp{_mm_castsi128_ps(_mm_cmpeq_epi32(model,
+            _mm_set1_epi32(AttnBatch::ModelExponent)))};
+        __m128 dryexp{one}, wetexp{one};
+        if(_mm_movemask_ps(isexp))
+        {
+            const __m128 valid{_mm_and_ps(hasref, _mm_cmpgt_ps(dist, zero))};
+            const __m128 ratio{fast_log2_ps(select_ps(valid, _mm_div_ps(dist, refdist), one))};
+            dryexp = fast_exp2_ps(_mm_mul_ps(ratio, _mm_sub_ps(zero, rolloff)));
+            wetexp = fast_exp2_ps(_mm_mul_ps(ratio, _mm_sub_ps(zero, roomrolloff)));
+        }
 
-        float ConeGain{1.0f};
-        if(Angle >= props->OuterAngle)
+        const __m128 isinv{_mm_castsi128_ps(_mm_cmpeq_epi32(model,
+            _mm_set1_epi32(AttnBatch::ModelInverse)))};
+        const __m128 islin{_mm_castsi128_ps(_mm_cmpeq_epi32(model,
+            _mm_set1_epi32(AttnBatch::ModelLinear)))};
+        const __m128 gain{_mm_load_ps(&batch.Gain[i])};
+        __m128 drygain{_mm_mul_ps(gain, select_ps(isinv, dryinv,
+            select_ps(islin, drylin, select_ps(isexp, dryexp, one))))};
+        __m128 wetgain{_mm_mul_ps(gain, select_ps(isinv, wetinv,
+            select_ps(islin, wetlin, select_ps(isexp, wetexp, one))))};
+
+        /* Directional sound cones. */
+        const __m128 conecos{_mm_min_ps(_mm_max_ps(_mm_load_ps(&batch.ConeCos[i]),
+            _mm_set1_ps(-1.0f)), one)};
+        const __m128 angle{_mm_mul_ps(fast_acos_ps(conecos), _mm_set1_ps(ConeAngleScale))};
+        const __m128 inner{_mm_load_ps(&batch.InnerAngle[i])};
+        const __m128 outer{_mm_load_ps(&batch.OuterAngle[i])};
+        const __m128 conescale{select_ps(_mm_cmpge_ps(angle, outer), one,
+            select_ps(_mm_cmpge_ps(angle, inner),
+                _mm_div_ps(_mm_sub_ps(angle, inner), _mm_sub_ps(outer, inner)), zero))};
+        const __m128 outergain{_mm_load_ps(&batch.OuterGain[i])};
+        const __m128 outergainhf{_mm_load_ps(&batch.OuterGainHF[i])};
+        const __m128 conegain{_mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(outergain, one),
+            conescale))};
+        const __m128 conehf{_mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(outergainhf, one),
+            _mm_mul_ps(conescale, _mm_load_ps(&batch.DryGainHFAuto[i]))))};
+        drygain = _mm_mul_ps(drygain, conegain);
+        wetgain = _mm_mul_ps(wetgain, _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(conegain, one),
+            _mm_load_ps(&batch.WetGainAuto[i]))));
+        _mm_store_ps(&batch.ConeHF[i], conehf);
+        _mm_store_ps(&batch.WetConeHF[i], _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(conehf, one),
+            _mm_load_ps(&batch.WetGainHFAuto[i]))));
+
+        const __m128 mingain{_mm_load_ps(&batch.MinGain[i])};
+        const __m128 maxgain{_mm_load_ps(&batch.MaxGain[i])};
+        const __m128 ctxgain{_mm_set1_ps(ContextGain)};
+        drygain = _mm_mul_ps(_mm_min_ps(maxgain, _mm_max_ps(mingain, drygain)), ctxgain);
+        wetgain = _mm_mul_ps(_mm_min_ps(maxgain, _mm_max_ps(mingain, wetgain)), ctxgain);
+        _mm_store_ps(&batch.DryGain[i], drygain);
+        _mm_store_ps(&batch.WetGain[i], wetgain);
+
+        /* Distance-based air absorption. */
+        const __m128 distbase{_mm_mul_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(&batch.Distance[i]),
+            refdist), zero), rolloff)};
+        const __m128 absorb{_mm_mul_ps(_mm_mul_ps(distbase, _mm_set1_ps(MetersPerUnit)),
+            _mm_load_ps(&batch.AirAbsorption[i]))};
+        _mm_store_ps(&batch.AirHF[i], select_ps(_mm_cmpgt_ps(absorb, _mm_set1_ps(Epsilon)),
+            fast_exp2_ps(_mm_mul_ps(absorb, _mm_set1_ps(Log2AirGainHF))), one));
+
+        /* Velocity-based doppler shift. A listener moving away from the
+         * source at the speed of sound can't be reached by the sound, and a
+         * source moving toward the listener at the speed of sound bunches the
+         * sound up to extreme frequencies.
+         */
+        const __m128 doppler{_mm_load_ps(&batch.DopplerFactor[i])};
+        const __m128 vss{_mm_mul_ps(_mm_load_ps(&batch.SourceSpeed[i]),
+            _mm_sub_ps(zero, doppler))};
+        const __m128 vls{_mm_mul_ps(_mm_load_ps(&batch.ListenerSpeed[i]),
+            _mm_sub_ps(zero, doppler))};
+        const __m128 sos{_mm_set1_ps(SpeedOfSound)};
+        const __m128 pitch{_mm_load_ps(&batch.Pitch[i])};
+        const __m128 shifted{select_ps(_mm_cmplt_ps(vls, sos),
+            select_ps(_mm_cmplt_ps(vss, sos),
+                _mm_mul_ps(pitch, _mm_div_ps(_mm_sub_ps(sos, vls), _mm_sub_ps(sos, vss))),
+                _mm_set1_ps(Infinity)),
+            zero)};
+        _mm_store_ps(&batch.Pitch[i], select_ps(_mm_cmpgt_ps(doppler, zero), shifted, pitch));
+    }
+#elif defined(HAVE_NEON)
+    const float32x4_t zero{vdupq_n_f32(0.0f)};
+    const float32x4_t one{vdupq_n_f32(1.0f)};
+    for(;count-i >= 4;i += 4)
+    {
+        const int32x4_t model{vld1q_s32(&batch.Model[i])};
+        const float32x4_t dist{vld1q_f32(&batch.ClampedDist[i])};
+        const float32x4_t refdist{vld1q_f32(&batch.RefDistance[i])};
+        const float32x4_t rolloff{vld1q_f32(&batch.Rolloff[i])};
+        const float32x4_t roomrolloff{vld1q_f32(&batch.RoomRolloff[i])};
+        const uint32x4_t hasref{vcgtq_f32(refdist, zero)};
+
+        /* Inverse distance. */
+        float32x4_t d{vmlaq_f32(refdist, vsubq_f32(dist, refdist), rolloff)};
+        const float32x4_t dryinv{select_ps(vandq_u32(hasref, vcgtq_f32(d, zero)),
+            div_ps(refdist, d), one)};
+        d = vmlaq_f32(refdist, vsubq_f32(dist, refdist), roomrolloff);
+        const float32x4_t wetinv{select_ps(vandq_u32(hasref, vcgtq_f32(d, zero)),
+            div_ps(refdist, d), one)};
+
+        /* Linear distance. */
+        const float32x4_t maxdist{vld1q_f32(&batch.MaxDistance[i])};
+        const uint32x4_t hasrange{vmvnq_u32(vceqq_f32(maxdist, refdist))};
+        const float32x4_t scale{div_ps(vsubq_f32(dist, refdist), vsubq_f32(maxdist, refdist))};
+        const float32x4_t drylin{select_ps(hasrange,
+            vmaxq_f32(vmlsq_f32(one, scale, rolloff), zero), one)};
+        const float32x4_t wetlin{select_ps(hasrange,
+            vmaxq_f32(vmlsq_f32(one, scale, roomrolloff), zero), one)};
+
+        /* Exponential distance. */
+        const uint32x4_t isexp{vceqq_s32(model, vdupq_n_s32(AttnBatch::ModelExponent))};
+        float32x4_t dryexp{one}, wetexp{one};
+        const uint32x2_t anyexp{vorr_u32(vget_low_u32(isexp), vget_high_u32(isexp))};
+        if((vget_lane_u32(anyexp, 0) | vget_lane_u32(anyexp, 1)) != 0)
         {
-            ConeGain = props->OuterGain;
-            ConeHF = lerpf(1.0f, props->OuterGainHF, props->DryGainHFAuto);
+            const uint32x4_t valid{vandq_u32(hasref, vcgtq_f32(dist, zero))};
+            const float32x4_t ratio{fast_log2_ps(select_ps(valid, div_ps(dist, refdist), one))};
+            dryexp = fast_exp2_ps(vmulq_f32(ratio, vnegq_f32(rolloff)));
+            wetexp = fast_exp2_ps(vmulq_f32(ratio, vnegq_f32(roomrolloff)));
         }
-        else if(Angle >= props->InnerAngle)
+
+        const uint32x4_t isinv{vceqq_s32(model, vdupq_n_s32(AttnBatch::ModelInverse))};
+        const uint32x4_t islin{vceqq_s32(model, vdupq_n_s32(AttnBatch::ModelLinear))};
+        const float32x4_t gain{vld1q_f32(&batch.Gain[i])};
+        float32x4_t drygain{vmulq_f32(gain, select_ps(isinv, dryinv,
+            select_ps(islin, drylin, select_ps(isexp, dryexp, one))))};
+        float32x4_t wetgain{vmulq_f32(gain, select_ps(isinv, wetinv,
+            select_ps(islin, wetlin, select_ps(isexp, wetexp, one))))};
+
+        /* Directional sound cones. */
+        const float32x4_t conecos{vminq_f32(vmaxq_f32(vld1q_f32(&batch.ConeCos[i]),
+            vdupq_n_f32(-1.0f)), one)};
+        const float32x4_t angle{vmulq_n_f32(fast_acos_ps(conecos), ConeAngleScale)};
+        const float32x4_t inner{vld1q_f32(&batch.InnerAngle[i])};
+        const float32x4_t outer{vld1q_f32(&batch.OuterAngle[i])};
+        const float32x4_t conescale{select_ps(vcgeq_f32(angle, outer), one,
+            select_ps(vcgeq_f32(angle, inner),
+                div_ps(vsubq_f32(angle, inner), vsubq_f32(outer, inner)), zero))};
+        const float32x4_t outergain{vld1q_f32(&batch.OuterGain[i])};
+        const float32x4_t outergainhf{vld1q_f32(&batch.OuterGainHF[i])};
+        const float32x4_t conegain{vmlaq_f32(one, vsubq_f32(outergain, one), conescale)};
+        const float32x4_t conehf{vmlaq_f32(one, vsubq_f32(outergainhf, one),
+            vmulq_f32(conescale, vld1q_f32(&batch.DryGainHFAuto[i])))};
+        drygain = vmulq_f32(drygain, conegain);
+        wetgain = vmulq_f32(wetgain, vmlaq_f32(one, vsubq_f32(conegain, one),
+            vld1q_f32(&batch.WetGainAuto[i])));
+        vst1q_f32(&batch.ConeHF[i], conehf);
+        vst1q_f32(&batch.WetConeHF[i], vmlaq_f32(one, vsubq_f32(conehf, one),
+            vld1q_f32(&batch.WetGainHFAuto[i])));
+
+        const float32x4_t mingain{vld1q_f32(&batch.MinGain[i])};
+        const float32x4_t maxgain{vld1q_f32(&batch.MaxGain[i])};
+        drygain = vmulq_n_f32(vminq_f32(maxgain, vmaxq_f32(mingain, drygain)), ContextGain);
+        wetgain = vmulq_n_f32(vminq_f32(maxgain, vmaxq_f32(mingain, wetgain)), ContextGain);
+        vst1q_f32(&batch.DryGain[i], drygain);
+        vst1q_f32(&batch.WetGain[i], wetgain);
+
+        /* Distance-based air absorption. */
+        const float32x4_t distbase{vmulq_f32(vmaxq_f32(vsubq_f32(vld1q_f32(&batch.Distance[i]),
+            refdist), zero), rolloff)};
+        const float32x4_t absorb{vmulq_f32(vmulq_n_f32(distbase, MetersPerUnit),
+            vld1q_f32(&batch.AirAbsorption[i]))};
+        vst1q_f32(&batch.AirHF[i], select_ps(vcgtq_f32(absorb, vdupq_n_f32(Epsilon)),
+            fast_exp2_ps(vmulq_n_f32(absorb, Log2AirGainHF)), one));
+
+        /* Velocity-based doppler shift. */
+        const float32x4_t doppler{vld1q_f32(&batch.DopplerFactor[i])};
+        const float32x4_t vss{vmulq_f32(vld1q_f32(&batch.SourceSpeed[i]), vnegq_f32(doppler))};
+        const float32x4_t vls{vmulq_f32(vld1q_f32(&batch.ListenerSpeed[i]), vnegq_f32(doppler))};
+        const float32x4_t sos{vdupq_n_f32(SpeedOfSound)};
+        const float32x4_t pitch{vld1q_f32(&batch.Pitch[i])};
+        const float32x4_t shifted{select_ps(vcltq_f32(vls, sos),
+            select_ps(vcltq_f32(vss, sos),
+                vmulq_f32(pitch, div_ps(vsubq_f32(sos, vls), vsubq_f32(sos, vss))),
+                vdupq_n_f32(Infinity)),
+            zero)};
+        vst1q_f32(&batch.Pitch[i], select_ps(vcgtq_f32(doppler, zero), shifted, pitch));
+    }
+#endif
+    for(;i < count;++i)
+    {
+        const float dist{batch.ClampedDist[i]};
+        const float refdist{batch.RefDistance[i]};
+        float DryGainBase{batch.Gain[i]};
+        float WetGainBase{batch.Gain[i]};
+        switch(batch.Model[i])
         {
-            const float scale{(Angle-props->InnerAngle) / (props->OuterAngle-props->InnerAngle)};
-            ConeGain = lerpf(1.0f, props->OuterGain, scale);
-            ConeHF = lerpf(1.0f, props->OuterGainHF, scale * props->DryGainHFAuto);
+        case AttnBatch::ModelInverse:
+            if(refdist > 0.0f)
+            {
+                float d{lerpf(refdist, dist, batch.Rolloff[i])};
+                if(d > 0.0f) DryGainBase *= refdist / d;
+
+                d = lerpf(refdist, dist, batch.RoomRolloff[i]);
+                if(d > 0.0f) WetGainBase *= refdist / d;
+            }
+            break;
+        case AttnBatch::ModelLinear:
+            if(batch.MaxDistance[i] != refdist)
+            {
+                const float scale{(dist-refdist) / (batch.MaxDistance[i]-refdist)};
+                DryGainBase *= maxf(1.0f - scale*batch.Rolloff[i], 0.0f);
+                WetGainBase *= maxf(1.0f - scale*batch.RoomRolloff[i], 0.0f);
+            }
+            break;
+        case AttnBatch::ModelExponent:
+            if(dist > 0.0f && refdist > 0.0f)
+            {
+                const float ratio{fast_log2f(dist/refdist)};
+                DryGainBase *= fast_exp2f(ratio * -batch.Rolloff[i]);
+                WetGainBase *= fast_exp2f(ratio * -batch.RoomRolloff[i]);
+            }
+            break;
         }
 
+        const float Angle{fast_acosf(clampf(batch.ConeCos[i], -1.0f, 1.0f)) * ConeAngleScale};
+        float conescale{0.0f};
+        if(Angle >= batch.OuterAngle[i])
+            conescale = 1.0f;
+        else if(Angle >= batch.InnerAngle[i])
+            conescale = (Angle-batch.InnerAngle[i]) / (batch.OuterAngle[i]-batch.InnerAngle[i]);
+        const float ConeGain{lerpf(1.0f, batch.OuterGain[i], conescale)};
+        const float ConeHF{lerpf(1.0f, batch.OuterGainHF[i], conescale*batch.DryGainHFAuto[i])};
         DryGainBase *= ConeGain;
-        WetGainBase *= lerpf(1.0f, ConeGain, props->WetGainAuto);
+        WetGainBase *= lerpf(1.0f, ConeGain, batch.WetGainAuto[i]);
+        batch.ConeHF[i] = ConeHF;
+        batch.WetConeHF[i] = lerpf(1.0f, ConeHF, batch.WetGainHFAuto[i]);
+
+        batch.DryGain[i] = clampf(DryGainBase, batch.MinGain[i], batch.MaxGain[i]) * ContextGain;
+        batch.WetGain[i] = clampf(WetGainBase, batch.MinGain[i], batch.MaxGain[i]) * ContextGain;
+
+        const float distance_base{maxf(batch.Distance[i]-refdist, 0.0f) * batch.Rolloff[i]};
+        const float dryabsorb{distance_base * MetersPerUnit * batch.AirAbsorption[i]};
+        batch.AirHF[i] = (dryabsorb > Epsilon) ? fast_exp2f(dryabsorb * Log2AirGainHF) : 1.0f;
+
+        const float DopplerFactor{batch.DopplerFactor[i]};
+        if(DopplerFactor > 0.0f)
+        {
+            const float vss{batch.SourceSpeed[i] * -DopplerFactor};
+            const float vls{batch.ListenerSpeed[i] * -DopplerFactor};
+            if(!(vls < SpeedOfSound))
+                batch.Pitch[i] = 0.0f;
+            else if(!(vss < SpeedOfSound))
+                batch.Pitch[i] = Infinity;
+            else
+                batch.Pitch[i] *= (SpeedOfSound-vls) / (SpeedOfSound-vss);
+        }
+    }
+}
+
+void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBase *context,
+    const AttnBatch &batch, const size_t bidx, uint &panBudget)
+{
+    DeviceBase *Device{context->mDevice};
+    const uint NumSends{Device->NumAuxSends};
 
-        WetConeHF = lerpf(1.0f, ConeHF, props->WetGainHFAuto);
+    /* Set send buffers and get send parameters. */
+    EffectSlot *SendSlots[MAX_SENDS];
+    uint UseDryAttnForRoom{0};
+    for(uint i{0};i < NumSends;i++)
+    {
+        SendSlots[i] = props->Send[i].Slot;
+        if(!SendSlots[i] || SendSlots[i]->EffectType == EffectSlotType::None)
+            SendSlots[i] = nullptr;
+        else if(!SendSlots[i]->AuxSendAuto)
+        {
+            /* If the slot's auxiliary send auto is off, the data sent to the
+             * effect slot is the same as the dry path, sans filter effects.
+             */
+            UseDryAttnForRoom |= 1u<<i;
+        }
+
+        if(!SendSlots[i])
+            voice->mSend[i].Buffer = {};
+        else
+            voice->mSend[i].Buffer = SendSlots[i]->Wet.Buffer;
+        voice->mSend[i].Slot = SendSlots[i];
     }
 
-    /* Apply gain and frequency filters */
-    DryGainBase = clampf(DryGainBase, props->MinGain, props->MaxGain) * context->mParams.Gain;
-    WetGainBase = clampf(WetGainBase, props->MinGain, props->MaxGain) * context->mParams.Gain;
+    const alu::Vector &ToSource = batch.ToSource[bidx];
+    const float Distance{batch.Distance[bidx]};
+    const float DryGainBase{batch.DryGain[bidx]};
+    const float WetGainBase{batch.WetGain[bidx]};
+    const float ConeHF{batch.ConeHF[bidx]};
+    const float WetConeHF{batch.WetConeHF[bidx]};
 
     GainTriplet DryGain{};
     DryGain.Base = minf(DryGainBase * props->Direct.Gain, GainMixMax);
-    DryGain.HF = ConeHF * props->Direct.GainHF;
+    DryGain.HF = ConeHF * props->Direct.GainHF * batch.AirHF[bidx];
     DryGain.LF = props->Direct.GainLF;
     GainTriplet WetGain[MAX_SENDS]{};
     for(uint i{0};i < NumSends;i++)
@@ -1445,14 +2121,11 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
         WetGain[i].LF = props->Send[i].GainLF;
     }
 
-    /* Distance-based air absorption and initial send decay. */
+    /* Distance-based initial send decay. */
     if(likely(Distance > props->RefDistance))
     {
         const float distance_base{(Distance-props->RefDistance) * props->RolloffFactor};
         const float distance_meters{distance_base * context->mParams.MetersPerUnit};
-        const float dryabsorb{distance_meters * props->AirAbsorptionFactor};
-        if(dryabsorb > std::numeric_limits<float>::epsilon())
-            DryGain.HF *= std::pow(context->mParams.AirAbsorptionGainHF, dryabsorb);
 
         /* If the source's Auxiliary Send Filter Gain Auto is off, no extra
          * adjustment is applied to the send gains.
@@ -1531,42 +2204,39 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
         }
     }
 
-
-    /* Initial source pitch */
-    float Pitch{props->Pitch};
-
-    /* Calculate velocity-based doppler effect */
-    float DopplerFactor{props->DopplerFactor * context->mParams.DopplerFactor};
-    if(DopplerFactor > 0.0f)
+    /* Distant or quiet sources get reduced detail. They use at most a linear
+     * resampler, skip near-field filtering, use normal panning instead of
+     * per-source HRTF, and drop sends too quiet to matter.
+     */
     {
-        const alu::Vector &lvelocity = context->mParams.Velocity;
-        float vss{Velocity.dot_product(ToSource) * -DopplerFactor};
-        float vls{lvelocity.dot_product(ToSource) * -DopplerFactor};
+        const bool wasLowDetail{voice->mFlags.test(VoiceIsLowDetail)};
+        const float lodDistance{context->mParams.LodDistance *
+            (wasLowDetail ? LodDistanceHysteresis : 1.0f)};
+        const float lodGain{context->mParams.LodGain * (wasLowDetail ? LodGainHysteresis : 1.0f)};
 
-        const float SpeedOfSound{context->mParams.SpeedOfSound};
-        if(!(vls < SpeedOfSound))
+        float maxGain{DryGain.Base};
+        for(uint i{0};i < NumSends;++i)
         {
-            /* Listener moving away from the source at the speed of sound.
-             * Sound waves can't catch it.
-             */
-            Pitch = 0.0f;
+            if(SendSlots[i])
+                maxGain = maxf(maxGain, WetGain[i].Base);
         }
-        else if(!(vss < SpeedOfSound))
-        {
-            /* Source moving toward the listener at the speed of sound. Sound
-             * waves bunch up to extreme frequencies.
-             */
-            Pitch = std::numeric_limits<float>::infinity();
-        }
-        else
+
+        const bool lowDetail{Distance > lodDistance || maxGain < lodGain};
+        if(lowDetail)
         {
-            /* Source and listener movement is nominal. Calculate the proper
-             * doppler shift.
-             */
-            Pitch *= (SpeedOfSound-vls) / (SpeedOfSound-vss);
+            for(uint i{0};i < NumSends;++i)
+            {
+                if(WetGain[i].Base < lodGain)
+                    WetGain[i].Base = 0.0f;
+            }
         }
+        SetVoiceLowDetail(voice, lowDetail, Device);
     }
 
+
+    /* Source pitch, with the doppler shift. */
+    float Pitch{batch.Pitch[bidx]};
+
     /* Adjust pitch based on the buffer and output frequencies, and calculate
      * fixed-point stepping value.
      */
@@ -1575,7 +2245,9 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
         voice->mStep = MaxPitch<<MixerFracBits;
     else
         voice->mStep = maxu(fastf2u(Pitch * MixerFracOne), 1);
-    voice->mResampler = PrepareResampler(props->mResampler, voice->mStep, &voice->mResampleState);
+    const Resampler resampler{voice->mFlags.test(VoiceIsLowDetail)
+        ? std::min(props->mResampler, Resampler::Linear) : props->mResampler};
+    voice->mResampler = PrepareResampler(resampler, voice->mStep, &voice->mResampleState);
 
     float spread{0.0f};
     if(props->Radius > Distance)
@@ -1583,29 +2255,161 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
     else if(Distance > 0.0f)
         spread = std::asin(props->Radius/Distance) * 2.0f;
 
-    CalcPanningAndFilters(voice, ToSource[0]*XScale, ToSource[1]*YScale, ToSource[2]*ZScale,
-        Distance, spread, DryGain, WetGain, SendSlots, props, context->mParams, Device);
+    /* B-Format sources are also panned by their (listener-relative)
+     * orientation.
+     */
+    alu::Vector OrientAt{}, OrientUp{};
+    if(IsAmbisonic(voice->mFmtChannels))
+    {
+        OrientAt = alu::Vector{props->OrientAt[0], props->OrientAt[1], props->OrientAt[2], 0.0f};
+        OrientUp = alu::Vector{props->OrientUp[0], props->OrientUp[1], props->OrientUp[2], 0.0f};
+        if(!props->HeadRelative)
+        {
+            OrientAt = context->mParams.Matrix * OrientAt;
+            OrientUp = context->mParams.Matrix * OrientUp;
+        }
+        OrientAt.normalize();
+        OrientUp.normalize();
+    }
+
+    /* The panning needs to be recalculated if it's not been yet, if the sends
+     * changed, or if a path is coming up from silence (which can't be scaled
+     * up from the current gains).
+     */
+    Voice::PanningKey &key = voice->mPanningKey;
+    bool recalc{!key.Valid || !std::equal(SendSlots, SendSlots+NumSends, key.Slots.cbegin())};
+    if(!recalc)
+    {
+        recalc = !(key.Gains[0][0] > 0.0f) && DryGain.Base > 0.0f;
+        for(uint i{0};i < NumSends && !recalc;++i)
+            recalc = !(key.Gains[i+1][0] > 0.0f) && WetGain[i].Base > 0.0f;
+    }
+    if(!recalc)
+    {
+        /* Otherwise it only needs to be recalculated if the source moved far
+         * enough. When there's a limit to how many voices get recalculated
+         * per update, the rest keep their current panning and try again next
+         * update.
+         */
+        const float cosangle{context->mPanningCosAngleLimit};
+        const bool moved{!(std::abs(Distance - key.Distance) <= context->mPanningDistanceLimit)
+            || !DirectionNear(key.Direction, ToSource, cosangle)
+            || !DirectionNear(key.OrientAt, OrientAt, cosangle)
+            || !DirectionNear(key.OrientUp, OrientUp, cosangle)
+            || !(std::abs(spread - key.Spread) <= context->mPanningAngleLimit)};
+        if(!moved)
+            voice->mFlags.reset(VoicePanningDeferred);
+        else if(panBudget > 0)
+            recalc = true;
+        else
+            voice->mFlags.set(VoicePanningDeferred);
+    }
+
+    if(recalc)
+    {
+        if(panBudget > 0) --panBudget;
+        voice->mFlags.reset(VoicePanningDeferred);
+
+        CalcPanningAndFilters(voice, ToSource[0]*XScale, ToSource[1]*YScale, ToSource[2]*ZScale,
+            Distance, spread, DryGain, WetGain, SendSlots, props, context->mParams, Device);
+
+        key.Valid = true;
+        key.Direction = {ToSource[0], ToSource[1], ToSource[2]};
+        key.Distance = Distance;
+        key.Spread = spread;
+        key.OrientAt = {OrientAt[0], OrientAt[1], OrientAt[2]};
+        key.OrientUp = {OrientUp[0], OrientUp[1], OrientUp[2]};
+        key.Gains[0] = {DryGain.Base, DryGain.HF, DryGain.LF};
+        for(uint i{0};i < NumSends;++i)
+        {
+            key.Gains[i+1] = {WetGain[i].Base, WetGain[i].HF, WetGain[i].LF};
+            key.Slots[i] = SendSlots[i];
+        }
+        return;
+    }
+
+    /* Keep the current panning, and only update the gains and filters if
+     * they changed enough. The gains are linear in the base gain, so they
+     * can be rescaled, and the mixer fades to them as usual.
+     */
+    const float ratio{context->mPanningGainRatioLimit};
+    bool gainsNear{GainsNear(key.Gains[0], DryGain, ratio)};
+    for(uint i{0};i < NumSends && gainsNear;++i)
+        gainsNear = GainsNear(key.Gains[i+1], WetGain[i], ratio);
+    if(gainsNear)
+        return;
+
+    auto rescale = [](const al::span<float> gains, const float scale) noexcept -> void
+    {
+        std::transform(gains.begin(), gains.end(), gains.begin(),
+            [scale](const float gain) noexcept -> float { return gain * scale; });
+    };
+    const float dryScale{(key.Gains[0][0] > 0.0f) ? DryGain.Base / key.Gains[0][0] : 0.0f};
+    for(auto &chandata : voice->mChans)
+    {
+        chandata.mDryParams.Hrtf.Target.Gain *= dryScale;
+        rescale(chandata.mDryParams.Gains.Target, dryScale);
+    }
+    key.Gains[0] = {DryGain.Base, DryGain.HF, DryGain.LF};
+    for(uint i{0};i < NumSends;++i)
+    {
+        const float wetScale{(key.Gains[i+1][0] > 0.0f) ? WetGain[i].Base/key.Gains[i+1][0]
+            : 0.0f};
+        for(auto &chandata : voice->mChans)
+            rescale(chandata.mWetParams[i].Gains.Target, wetScale);
+        key.Gains[i+1] = {WetGain[i].Base, WetGain[i].HF, WetGain[i].LF};
+    }
+
+    CalcVoiceFilters(voice, props, DryGain, WetGain, Device);
+}
+
+/* Checks if the properties the panning depends on are the same, aside from
+ * the source position, orientation, and gains which are checked separately.
+ */
+bool SamePanningProps(const VoiceProps &lhs, const VoiceProps &rhs) noexcept
+{
+    if(lhs.DirectChannels != rhs.DirectChannels || lhs.mSpatializeMode != rhs.mSpatializeMode
+        || lhs.StereoPan != rhs.StereoPan || lhs.EnhWidth != rhs.EnhWidth
+        || lhs.Direct.HFReference != rhs.Direct.HFReference
+        || lhs.Direct.LFReference != rhs.Direct.LFReference)
+        return false;
+    for(size_t i{0};i < MAX_SENDS;++i)
+    {
+        if(lhs.Send[i].HFReference != rhs.Send[i].HFReference
+            || lhs.Send[i].LFReference != rhs.Send[i].LFReference)
+            return false;
+    }
+    return true;
 }
 
-void CalcSourceParams(Voice *voice, ContextBase *context, bool force)
+/* Applies a voice's pending property update, if any. Returns false if the
+ * voice's parameters don't need to be recalculated.
+ */
+bool UpdateVoiceProps(Voice *voice, ContextBase *context, bool force)
 {
     VoicePropsItem *props{voice->mUpdate.exchange(nullptr, std::memory_order_acq_rel)};
-    if(!props && !force) return;
+    if(!props && !force) return false;
 
     if(props)
     {
+        if(!SamePanningProps(voice->mProps, *props))
+            voice->mPanningKey.Valid = false;
         voice->mProps = *props;
 
         AtomicReplaceHead(context->mFreeVoiceProps, props);
     }
+    return true;
+}
 
+/* Checks if the voice is positioned and attenuated relative to the listener. */
+bool IsAttnVoice(const Voice *voice) noexcept
+{
     if((voice->mProps.DirectChannels != DirectMode::Off && voice->mFmtChannels != FmtMono
             && !IsAmbisonic(voice->mFmtChannels))
         || voice->mProps.mSpatializeMode == SpatializeMode::Off
         || (voice->mProps.mSpatializeMode==SpatializeMode::Auto && voice->mFmtChannels != FmtMono))
-        CalcNonAttnSourceParams(voice, &voice->mProps, context);
-    else
-        CalcAttnSourceParams(voice, &voice->mProps, context);
+        return false;
+    return true;
 }
 
 
@@ -1634,6 +2438,7 @@ void SendSourceStateEvent(ContextBase *context, uint id, VChangeState state)
         break;
     /* Shouldn't happen. */
     case VChangeState::Restart:
+    case VChangeState::StopAt:
         ASSUME(0);
     }
 
@@ -1699,7 +2504,10 @@ void ProcessVoiceChanges(ContextBase *ctx)
             else
                 sendevt = true;
 
+            /* Playing a voice clears any scheduled stop. */
             Voice *voice{cur->mVoice};
+            voice->mStartTime = cur->mTime;
+            voice->mStopTime = std::chrono::nanoseconds::max();
             voice->mPlayState.store(Voice::Playing, std::memory_order_release);
         }
         else if(cur->mState == VChangeState::Restart)
@@ -1721,12 +2529,24 @@ void ProcessVoiceChanges(ContextBase *ctx)
                 oldvoice->mPlayState.compare_exchange_strong(oldvstate, Voice::Stopping,
                     std::memory_order_relaxed, std::memory_order_acquire);
 
+                /* The new voice keeps any scheduled start and stop. */
                 Voice *voice{cur->mVoice};
+                voice->mStartTime = oldvoice->mStartTime;
+                voice->mStopTime = oldvoice->mStopTime;
                 voice->mPlayState.store((oldvstate == Voice::Playing) ? Voice::Playing
                     : Voice::Stopped, std::memory_order_release);
             }
             oldvoice->mPendingChange.store(false, std::memory_order_release);
         }
+        else if(cur->mState == VChangeState::StopAt)
+        {
+            /* Only schedule the stop if the voice is still playing the source.
+             * It may have ended or been stopped since the change was sent.
+             */
+            Voice *voice{cur->mVoice};
+            if(voice->mSourceID.load(std::memory_order_relaxed) == cur->mSourceID)
+                voice->mStopTime = cur->mTime;
+        }
         if(sendevt && (enabledevt&AsyncEvent::SourceStateChange))
             SendSourceStateEvent(ctx, cur->mSourceID, cur->mState);
 
@@ -1748,20 +2568,250 @@ void ProcessParamUpdates(ContextBase *ctx, const EffectSlotArray &slots,
         for(EffectSlot *slot : slots)
             force |= CalcEffectSlotParams(slot, sorted_slots, ctx);
 
-        for(Voice *voice : voices)
+        /* With a limit on how many voices can have their panning recalculated
+         * per update, start from the first voice that was deferred last time
+         * so each gets its turn.
+         */
+        uint panBudget{ctx->mPanningUpdateLimit ? ctx->mPanningUpdateLimit
+            : std::numeric_limits<uint>::max()};
+        const size_t start{(ctx->mPanningUpdateOffset < voices.size())
+            ? ctx->mPanningUpdateOffset : 0};
+        bool anyDeferred{false};
+
+        /* Positional voices have their attenuation calculated in batches, then
+         * the rest of their parameters are calculated individually.
+         */
+        AttnBatch batch;
+        auto calc_attn_batch = [ctx,&batch,&panBudget,&anyDeferred]()
         {
+            CalcAttnBatch(batch, ctx);
+            for(size_t i{0};i < batch.Count;++i)
+            {
+                Voice *voice{batch.Voices[i]};
+                CalcAttnSourceParams(voice, &voice->mProps, ctx, batch, i, panBudget);
+                if(voice->mFlags.test(VoicePanningDeferred) && !anyDeferred)
+                {
+                    ctx->mPanningUpdateOffset = batch.Indices[i];
+                    anyDeferred = true;
+                }
+            }
+            batch.Count = 0;
+        };
+
+        for(size_t i{0};i < voices.size();++i)
+        {
+            const size_t idx{(i < voices.size()-start) ? start+i : i-(voices.size()-start)};
+            Voice *voice{voices[idx]};
+
             /* Only update voices that have a source. */
-            if(voice->mSourceID.load(std::memory_order_relaxed) != 0)
-                CalcSourceParams(voice, ctx, force);
+            if(voice->mSourceID.load(std::memory_order_relaxed) == 0)
+                continue;
+
+            if(!UpdateVoiceProps(voice, ctx, force || voice->mFlags.test(VoicePanningDeferred)))
+                continue;
+            if(!IsAttnVoice(voice))
+            {
+                CalcNonAttnSourceParams(voice, &voice->mProps, ctx);
+                continue;
+            }
+
+            AddAttnVoice(batch, voice, idx, ctx);
+            if(batch.Count == AttnBatch::MaxVoices)
+                calc_attn_batch();
         }
+        if(batch.Count > 0)
+            calc_attn_batch();
     }
     IncrementRef(ctx->mUpdateCount);
 }
 
+/* A group of effect slots processed together, either a single slot or a
+ * batch of slots with the same batch key.
+ */
+struct EffectJob {
+    EffectSlot *const *Slots;
+    size_t Count;
+};
+
+struct EffectJobList {
+    DeviceBase *Device;
+    EffectThreadPool *Pool;
+    size_t SamplesToDo;
+    size_t NumJobs;
+    std::array<EffectJob,64> Jobs;
+};
+
+inline bool IsDryOutput(const DeviceBase *device, const al::span<FloatBufferLine> output)
+{ return output.data() == device->Dry.Buffer.data() && output.size() == device->Dry.Buffer.size(); }
+
+void ProcessEffectJob(const EffectJob &job, DeviceBase *device, EffectThreadPool *pool,
+    const size_t thread, const size_t SamplesToDo)
+{
+    /* Effects run by a worker thread mix to the main output through the
+     * thread's private dry buffer.
+     */
+    al::span<FloatBufferLine> drybuffer;
+    auto get_output = [device,pool,thread,&drybuffer](EffectState *state)
+    {
+        const al::span<FloatBufferLine> output{state->mOutTarget};
+        if(thread == 0 || !IsDryOutput(device, output))
+            return output;
+        if(drybuffer.empty())
+            drybuffer = pool->getDryBuffer(thread);
+        return drybuffer;
+    };
+
+    EffectState *state{job.Slots[0]->mEffectState.get()};
+    if(job.Count == 1)
+    {
+        state->process(SamplesToDo, job.Slots[0]->Wet.Buffer, get_output(state));
+        return;
+    }
+
+    std::array<EffectBatchItem,MaxEffectBatchSize> batch;
+    std::transform(job.Slots, job.Slots+job.Count, batch.begin(),
+        [get_output](const EffectSlot *slot) -> EffectBatchItem
+        {
+            EffectState *slotstate{slot->mEffectState.get()};
+            return EffectBatchItem{slotstate, slot->Wet.Buffer, get_output(slotstate)};
+        });
+    state->processBatch(SamplesToDo, {batch.data(), job.Count});
+}
+
+void RunEffectJob(void *userdata, const size_t job, const size_t thread)
+{
+    auto *jobs = static_cast<EffectJobList*>(userdata);
+    ProcessEffectJob(jobs->Jobs[job], jobs->Device, jobs->Pool, thread, jobs->SamplesToDo);
+}
+
+/* Returns true if the job mixes to an output another job in the list also
+ * mixes to, other than the main output (which worker threads mix to through
+ * their own buffers).
+ */
+bool HasSharedOutput(const EffectJobList &jobs, const size_t idx)
+{
+    auto get_output = [](const EffectSlot *slot) noexcept -> const FloatBufferLine*
+    { return slot->mEffectState->mOutTarget.data(); };
+
+    const EffectJob &job = jobs.Jobs[idx];
+    for(size_t i{0};i < job.Count;++i)
+    {
+        const EffectState *state{job.Slots[i]->mEffectState.get()};
+        if(IsDryOutput(jobs.Device, state->mOutTarget)) continue;
+
+        const FloatBufferLine *output{state->mOutTarget.data()};
+        for(size_t j{0};j < jobs.NumJobs;++j)
+        {
+            if(j == idx) continue;
+            const EffectJob &other = jobs.Jobs[j];
+            if(std::any_of(other.Slots, other.Slots+other.Count,
+                [output,get_output](const EffectSlot *slot) noexcept -> bool
+                { return get_output(slot) == output; }))
+                return true;
+        }
+    }
+    return false;
+}
+
+void ProcessEffectJobs(EffectJobList &jobs)
+{
+    EffectThreadPool *pool{jobs.Pool};
+    if(!pool || jobs.NumJobs == 1)
+    {
+        for(size_t i{0};i < jobs.NumJobs;++i)
+            ProcessEffectJob(jobs.Jobs[i], jobs.Device, nullptr, 0, jobs.SamplesToDo);
+        return;
+    }
+
+    /* Jobs that share an output with another job can't run concurrently, so
+     * process them here first and run the rest in parallel.
+     */
+    size_t numparallel{0};
+    for(size_t i{0};i < jobs.NumJobs;++i)
+    {
+        if(HasSharedOutput(jobs, i))
+            ProcessEffectJob(jobs.Jobs[i], jobs.Device, nullptr, 0, jobs.SamplesToDo);
+        else
+            jobs.Jobs[numparallel++] = jobs.Jobs[i];
+    }
+    jobs.NumJobs = numparallel;
+
+    pool->execute(RunEffectJob, &jobs, jobs.NumJobs);
+    pool->mergeDryBuffers(jobs.Device->Dry.Buffer, jobs.SamplesToDo);
+}
+
+/* Checks if the slot's effect needs processing, which it does when it has
+ * input, or when its input went silent within the effect's tail length. A
+ * processed slot provides input for its target slot.
+ */
+bool UpdateSlotActivity(EffectSlot *slot, const size_t SamplesToDo)
+{
+    if(slot->mHasInput)
+        slot->mIdleSamples = 0;
+    else
+    {
+        const size_t tail{slot->mEffectState->getTailLength()};
+        if(slot->mIdleSamples >= tail)
+            return false;
+        slot->mIdleSamples += minz(SamplesToDo, tail-slot->mIdleSamples);
+    }
+
+    if(EffectSlot *target{slot->Target})
+    {
+        target->mWetDirty = true;
+        target->mHasInput = true;
+    }
+    return true;
+}
+
+/* Processes a set of effect slots that don't target each other. Runs of slots
+ * with the same batch key are processed together, and with worker threads,
+ * the resulting jobs are processed in parallel.
+ */
+void ProcessEffectLevel(DeviceBase *device, const al::span<EffectSlot*> slots,
+    const size_t SamplesToDo)
+{
+    EffectJobList jobs;
+    jobs.Device = device;
+    jobs.Pool = device->mEffectThreads.get();
+    jobs.SamplesToDo = SamplesToDo;
+    jobs.NumJobs = 0;
+
+    auto slot_iter = slots.begin();
+    while(slot_iter != slots.end())
+    {
+        const void *batchkey{(*slot_iter)->mEffectState->getBatchKey()};
+
+        auto group_end = slot_iter + 1;
+        while(batchkey && group_end != slots.end()
+            && static_cast<size_t>(group_end-slot_iter) < MaxEffectBatchSize
+            && (*group_end)->mEffectState->getBatchKey() == batchkey)
+            ++group_end;
+
+        jobs.Jobs[jobs.NumJobs++] = EffectJob{slot_iter,
+            static_cast<size_t>(group_end - slot_iter)};
+        if(jobs.NumJobs == jobs.Jobs.size())
+        {
+            ProcessEffectJobs(jobs);
+            jobs.NumJobs = 0;
+        }
+        slot_iter = group_end;
+    }
+    if(jobs.NumJobs > 0)
+        ProcessEffectJobs(jobs);
+}
+
 void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
 {
     ASSUME(SamplesToDo > 0);
 
+    /* The device clock time at the start of this update, for voices scheduled
+     * to start or stop.
+     */
+    using std::chrono::nanoseconds;
+    const nanoseconds curtime{device->ClockBase +
+        nanoseconds{std::chrono::seconds{device->SamplesDone}}/device->Frequency};
+
     for(ContextBase *ctx : *device->mContexts.load(std::memory_order_acquire))
     {
         const EffectSlotArray &auxslots = *ctx->mActiveAuxSlots.load(std::memory_order_acquire);
@@ -1770,11 +2820,16 @@ void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
         /* Process pending propery updates for objects on the context. */
         ProcessParamUpdates(ctx, auxslots, voices);
 
-        /* Clear auxiliary effect slot mixing buffers. */
+        /* Clear auxiliary effect slot mixing buffers that were mixed into. */
         for(EffectSlot *slot : auxslots)
         {
-            for(auto &buffer : slot->Wet.Buffer)
-                buffer.fill(0.0f);
+            if(slot->mWetDirty)
+            {
+                for(auto &buffer : slot->Wet.Buffer)
+                    buffer.fill(0.0f);
+                slot->mWetDirty = false;
+            }
+            slot->mHasInput = false;
         }
 
         /* Process voices that have a playing source. */
@@ -1782,7 +2837,7 @@ void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
         {
             const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
             if(vstate != Voice::Stopped && vstate != Voice::Pending)
-                voice->mix(vstate, ctx, SamplesToDo);
+                voice->mix(vstate, ctx, curtime, SamplesToDo);
         }
 
         /* Process effects. */
@@ -1839,12 +2894,44 @@ void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
                             { return slot->Target != *next_target; });
                     } while(split_point - sorted_slots.begin() > 1);
                 }
+
+                /* Place each slot one level past the highest level of the
+                 * slots targeting it, then order the list by level. Slots on
+                 * the same level don't depend on each other.
+                 */
+                for(EffectSlot *slot : sorted_slots)
+                    slot->mGraphLevel = 0;
+                for(EffectSlot *slot : sorted_slots)
+                {
+                    if(EffectSlot *target{slot->Target})
+                        target->mGraphLevel = maxu(target->mGraphLevel, slot->mGraphLevel+1);
+                }
+                std::stable_sort(sorted_slots.begin(), sorted_slots.end(),
+                    [](const EffectSlot *lhs, const EffectSlot *rhs) noexcept -> bool
+                    { return lhs->mGraphLevel < rhs->mGraphLevel; });
             }
 
-            for(const EffectSlot *slot : sorted_slots)
+            /* Process the slots one level at a time. Slots on the same level
+             * don't target each other, so they can be processed in parallel.
+             */
+            auto level_iter = sorted_slots.begin();
+            while(level_iter != sorted_slots.end())
             {
-                EffectState *state{slot->mEffectState.get()};
-                state->process(SamplesToDo, slot->Wet.Buffer, state->mOutTarget);
+                const uint level{(*level_iter)->mGraphLevel};
+                auto level_end = std::find_if(level_iter+1, sorted_slots.end(),
+                    [level](const EffectSlot *slot) noexcept -> bool
+                    { return slot->mGraphLevel != level; });
+
+                /* Move the slots that need processing to the front. */
+                auto active_end = level_iter;
+                for(auto iter = level_iter;iter != level_end;++iter)
+                {
+                    if(UpdateSlotActivity(*iter, SamplesToDo))
+                        std::swap(*active_end++, *iter);
+                }
+                if(active_end != level_iter)
+                    ProcessEffectLevel(device, {level_iter, active_end}, SamplesToDo);
+                level_iter = level_end;
             }
         }
 
@@ -1996,6 +3083,8 @@ uint DeviceBase::renderSamples(const uint numSamples)
     SamplesDone += samplesToDo;
     ClockBase += std::chrono::seconds{SamplesDone / Frequency};
     SamplesDone %= Frequency;
+    mMixClockTime.store(ClockBase + std::chrono::nanoseconds{std::chrono::seconds{SamplesDone}}
+        / Frequency, std::memory_order_release);
 
     /* Increment the mix count at the end (lsb should now be 0). */
     IncrementRef(MixCount);
@@ -428,6 +428,14 @@ struct AlsaPlayback final : public BackendBase {
     void stop() override;
 
     ClockLatency getClockLatency() override;
+    LatencyStats getLatencyStats() override;
+
+    /* Waits until the queued sample frames drop below the adaptive target,
+     * and returns the number of sample frames to render (0 if it should
+     * check the device state again first).
+     */
+    snd_pcm_uframes_t adaptiveWait(int state, snd_pcm_uframes_t avail,
+        snd_pcm_uframes_t buffer_size);
 
     snd_pcm_t *mPcmHandle{nullptr};
 
@@ -436,6 +444,9 @@ struct AlsaPlayback final : public BackendBase {
     uint mFrameStep{};
     al::vector<al::byte> mBuffer;
 
+    bool mAdaptive{false};
+    AdaptiveLatency mLatency;
+
     std::atomic<bool> mKillNow{true};
     std::thread mThread;
 
@@ -450,6 +461,43 @@ AlsaPlayback::~AlsaPlayback()
 }
 
 
+snd_pcm_uframes_t AlsaPlayback::adaptiveWait(int state, snd_pcm_uframes_t avail,
+    snd_pcm_uframes_t buffer_size)
+{
+    const snd_pcm_uframes_t queued{buffer_size - avail};
+    const snd_pcm_uframes_t target{mLatency.target()};
+    const snd_pcm_uframes_t step{mLatency.step()};
+
+    if(queued+step <= target)
+    {
+        /* Fill up to the target, in whole steps. */
+        snd_pcm_uframes_t todo{target - queued};
+        todo -= todo%step;
+        mLatency.update(static_cast<uint>(queued), static_cast<uint>(todo));
+        return todo;
+    }
+
+    if(state != SND_PCM_STATE_RUNNING)
+    {
+        int err{snd_pcm_start(mPcmHandle)};
+        if(err < 0)
+        {
+            ERR("start failed: %s\n", snd_strerror(err));
+            return 0;
+        }
+    }
+
+    /* Sleep until the queued samples drop a step below the target, rather than
+     * waiting on the device's period wakeups.
+     */
+    const snd_pcm_uframes_t towait{queued+step - target};
+    const auto waketime = std::chrono::steady_clock::now() +
+        std::chrono::nanoseconds{std::chrono::seconds{towait}} / mDevice->Frequency;
+    std::this_thread::sleep_until(waketime);
+    mLatency.wakeup(std::chrono::steady_clock::now() - waketime);
+    return 0;
+}
+
 int AlsaPlayback::mixerProc()
 {
     SetRTPriority();
@@ -466,6 +514,8 @@ int AlsaPlayback::mixerProc()
             mDevice->handleDisconnect("Bad state: %s", snd_strerror(state));
             break;
         }
+        if(state == SND_PCM_STATE_XRUN)
+            mLatency.underrun();
 
         snd_pcm_sframes_t avails{snd_pcm_avail_update(mPcmHandle)};
         if(avails < 0)
@@ -482,8 +532,13 @@ int AlsaPlayback::mixerProc()
             continue;
         }
 
+        if(mAdaptive)
+        {
+            avail = adaptiveWait(state, avail, buffer_size);
+            if(!avail) continue;
+        }
         // make sure there's frames to process
-        if(avail < update_size)
+        else if(avail < update_size)
         {
             if(state != SND_PCM_STATE_RUNNING)
             {
@@ -498,7 +553,8 @@ int AlsaPlayback::mixerProc()
                 ERR("Wait timeout... buffer size too low?\n");
             continue;
         }
-        avail -= avail%update_size;
+        else
+            avail -= avail%update_size;
 
         // it is possible that contiguous areas are smaller, thus we use a loop
         std::lock_guard<std::mutex> _{mMutex};
@@ -549,6 +605,8 @@ int AlsaPlayback::mixerNoMMapProc()
             mDevice->handleDisconnect("Bad state: %s", snd_strerror(state));
             break;
         }
+        if(state == SND_PCM_STATE_XRUN)
+            mLatency.underrun();
 
         snd_pcm_sframes_t avail{snd_pcm_avail_update(mPcmHandle)};
         if(avail < 0)
@@ -564,7 +622,15 @@ int AlsaPlayback::mixerNoMMapProc()
             continue;
         }
 
-        if(static_cast<snd_pcm_uframes_t>(avail) < update_size)
+        al::byte *WritePtr{mBuffer.data()};
+        if(mAdaptive)
+        {
+            const snd_pcm_uframes_t todo{adaptiveWait(state,
+                static_cast<snd_pcm_uframes_t>(avail), buffer_size)};
+            if(!todo) continue;
+            avail = static_cast<snd_pcm_sframes_t>(std::min(todo, update_size));
+        }
+        else if(static_cast<snd_pcm_uframes_t>(avail) < update_size)
         {
             if(state != SND_PCM_STATE_RUNNING)
             {
@@ -579,9 +645,9 @@ int AlsaPlayback::mixerNoMMapProc()
                 ERR("Wait timeout... buffer size too low?\n");
             continue;
         }
+        else
+            avail = snd_pcm_bytes_to_frames(mPcmHandle, static_cast<ssize_t>(mBuffer.size()));
 
-        al::byte *WritePtr{mBuffer.data()};
-        avail = snd_pcm_bytes_to_frames(mPcmHandle, static_cast<ssize_t>(mBuffer.size()));
         std::lock_guard<std::mutex> _{mMutex};
         mDevice->renderSamples(WritePtr, static_cast<uint>(avail), mFrameStep);
         while(avail > 0)
@@ -597,6 +663,8 @@ int AlsaPlayback::mixerNoMMapProc()
 #endif
             case -EPIPE:
             case -EINTR:
+                if(ret == -EPIPE)
+                    mLatency.underrun();
                 ret = snd_pcm_recover(mPcmHandle, static_cast<int>(ret), 1);
                 if(ret < 0)
                     avail = 0;
@@ -786,6 +854,18 @@ bool AlsaPlayback::reset()
     mDevice->UpdateSize = static_cast<uint>(periodSizeInFrames);
     mDevice->Frequency = rate;
 
+    /* With adaptive latency, the mixer keeps as little of the buffer filled as
+     * it safely can, in steps of about 2ms, starting at what it would normally
+     * keep filled.
+     */
+    mAdaptive = GetConfigValueBool(mDevice->DeviceName.c_str(), "alsa", "adaptive-latency", 0);
+    const uint step{clampu(rate/500, 16, mDevice->UpdateSize)};
+    mLatency.reset(rate, step*2, mDevice->BufferSize, step,
+        mDevice->BufferSize - mDevice->UpdateSize);
+    if(mAdaptive)
+        TRACE("Adaptive latency enabled, %u-%u samples in steps of %u\n", step*2,
+            mDevice->BufferSize, step);
+
     setDefaultChannelOrder();
 
     return true;
@@ -861,6 +941,18 @@ ClockLatency AlsaPlayback::getClockLatency()
     return ret;
 }
 
+LatencyStats AlsaPlayback::getLatencyStats()
+{
+    if(!mAdaptive)
+    {
+        /* Still report any underruns, even though the target is fixed. */
+        LatencyStats ret{BackendBase::getLatencyStats()};
+        ret.Underruns = mLatency.getStats().Underruns;
+        return ret;
+    }
+    return mLatency.getStats();
+}
+
 
 struct AlsaCapture final : public BackendBase {
     AlsaCapture(DeviceBase *device) noexcept : BackendBase{device} { }
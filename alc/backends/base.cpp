@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <stdint.h>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -17,6 +18,7 @@
 #include "aloptional.h"
 #endif
 
+#include "alnumeric.h"
 #include "atomic.h"
 #include "core/devformat.h"
 
@@ -52,6 +54,142 @@ ClockLatency BackendBase::getClockLatency()
     return ret;
 }
 
+LatencyStats BackendBase::getLatencyStats()
+{
+    /* Without adaptive control, the backend effectively aims to keep all but
+     * one period filled.
+     */
+    LatencyStats ret{};
+    const int64_t padding{static_cast<int64_t>(mDevice->BufferSize) - mDevice->UpdateSize};
+    ret.TargetLatency = std::chrono::seconds{std::max(padding, int64_t{0})};
+    ret.TargetLatency /= mDevice->Frequency;
+    return ret;
+}
+
+
+void AdaptiveLatency::reset(uint frequency, uint minsize, uint maxsize, uint step, uint initial)
+    noexcept
+{
+    mFrequency = frequency;
+    mStep = std::max(step, 1u);
+    mMaxSize = std::max(maxsize, mStep);
+    mMinSize = clampu(minsize, mStep, mMaxSize);
+
+    mWindowFrames = 0;
+    mWindowMinHeadroom = ~0u;
+    mWindowJitter = std::chrono::nanoseconds::zero();
+    mWindowUnderruns = 0;
+    mHoldWindows = 0;
+
+    mTarget.store(clampu(initial, mMinSize, mMaxSize), std::memory_order_relaxed);
+    mUnderruns.store(0u, std::memory_order_relaxed);
+    mMaxJitter.store(0, std::memory_order_relaxed);
+    for(auto &lat : mHistLatency)
+        lat.store(0, std::memory_order_relaxed);
+    for(auto &xruns : mHistUnderruns)
+        xruns.store(0u, std::memory_order_relaxed);
+    mHistoryPos.store(0u, std::memory_order_release);
+}
+
+void AdaptiveLatency::pushHistory(uint target) noexcept
+{
+    using std::chrono::seconds;
+    using std::chrono::nanoseconds;
+
+    const size_t pos{mHistoryPos.load(std::memory_order_relaxed)};
+    const size_t idx{pos % LatencyHistoryLength};
+    const nanoseconds latency{nanoseconds{seconds{target}} / mFrequency};
+    mHistLatency[idx].store(latency.count(), std::memory_order_relaxed);
+    mHistUnderruns[idx].store(mWindowUnderruns, std::memory_order_relaxed);
+    mHistoryPos.store(pos+1, std::memory_order_release);
+}
+
+void AdaptiveLatency::update(uint headroom, uint rendered) noexcept
+{
+    mWindowMinHeadroom = std::min(mWindowMinHeadroom, headroom);
+    mWindowFrames += rendered;
+
+    /* Adapt about twice a second. */
+    if(mWindowFrames < mFrequency/2)
+        return;
+
+    uint target{mTarget.load(std::memory_order_relaxed)};
+    if(mHoldWindows > 0)
+        --mHoldWindows;
+    else if(mWindowMinHeadroom > mStep*2)
+    {
+        /* There was always more than two steps of audio left when the mixer
+         * woke up, so it's safe to try a bit less.
+         */
+        target = std::max(target - std::min(target, mStep), mMinSize);
+    }
+    else if(mWindowMinHeadroom < mStep)
+        target = std::min(target + mStep, mMaxSize);
+
+    /* Make sure the target covers the worst observed wakeup jitter. */
+    const auto jitter = std::chrono::duration_cast<std::chrono::seconds>(mWindowJitter *
+        mFrequency);
+    const uint needed{static_cast<uint>(std::min<std::chrono::seconds::rep>(jitter.count(),
+        mMaxSize)) + mStep};
+    target = clampu(std::max(target, needed), mMinSize, mMaxSize);
+
+    mTarget.store(target, std::memory_order_relaxed);
+    pushHistory(target);
+
+    mWindowFrames = 0;
+    mWindowMinHeadroom = ~0u;
+    mWindowJitter = std::chrono::nanoseconds::zero();
+    mWindowUnderruns = 0;
+}
+
+void AdaptiveLatency::wakeup(std::chrono::nanoseconds jitter) noexcept
+{
+    if(jitter <= std::chrono::nanoseconds::zero())
+        return;
+    mWindowJitter = std::max(mWindowJitter, jitter);
+    if(jitter.count() > mMaxJitter.load(std::memory_order_relaxed))
+        mMaxJitter.store(jitter.count(), std::memory_order_relaxed);
+}
+
+void AdaptiveLatency::underrun() noexcept
+{
+    mUnderruns.fetch_add(1u, std::memory_order_relaxed);
+    ++mWindowUnderruns;
+
+    /* Back off quickly, and wait a couple seconds before trying to lower the
+     * latency again.
+     */
+    const uint target{mTarget.load(std::memory_order_relaxed)};
+    mTarget.store(std::min(target + std::max(target/2, mStep), mMaxSize),
+        std::memory_order_relaxed);
+    mHoldWindows = 4;
+}
+
+LatencyStats AdaptiveLatency::getStats() const noexcept
+{
+    using std::chrono::seconds;
+    using std::chrono::nanoseconds;
+
+    LatencyStats ret{};
+    if(!mFrequency)
+        return ret;
+
+    ret.Underruns = mUnderruns.load(std::memory_order_relaxed);
+    ret.TargetLatency = nanoseconds{seconds{target()}} / mFrequency;
+    ret.MaxJitter = nanoseconds{mMaxJitter.load(std::memory_order_relaxed)};
+
+    const size_t pos{mHistoryPos.load(std::memory_order_acquire)};
+    ret.HistoryCount = std::min(pos, LatencyHistoryLength);
+    for(size_t i{0};i < ret.HistoryCount;++i)
+    {
+        const size_t idx{(pos-1-i) % LatencyHistoryLength};
+        ret.History[i].Latency = nanoseconds{mHistLatency[idx].load(std::memory_order_relaxed)};
+        ret.History[i].Underruns = mHistUnderruns[idx].load(std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+
 void BackendBase::setDefaultWFXChannelOrder()
 {
     mDevice->RealOut.ChannelIndex.fill(INVALID_CHANNEL_INDEX);
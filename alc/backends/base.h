@@ -1,6 +1,8 @@
 #ifndef ALC_BACKENDS_BASE_H
 #define ALC_BACKENDS_BASE_H
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdarg>
 #include <memory>
@@ -19,6 +21,85 @@ struct ClockLatency {
     std::chrono::nanoseconds Latency;
 };
 
+/* Number of adaptation windows kept in the latency history. */
+constexpr size_t LatencyHistoryLength{16};
+
+struct LatencyStats {
+    struct HistoryEntry {
+        std::chrono::nanoseconds Latency;
+        uint Underruns;
+    };
+
+    /* Total number of underruns detected since the device was (re)set. */
+    uint Underruns{0u};
+    /* The latency the backend is currently aiming to keep buffered. */
+    std::chrono::nanoseconds TargetLatency{};
+    /* The largest scheduling jitter observed since the device was (re)set. */
+    std::chrono::nanoseconds MaxJitter{};
+
+    /* The target latency and underruns for recent adaptation windows, newest
+     * first.
+     */
+    std::array<HistoryEntry,LatencyHistoryLength> History{};
+    size_t HistoryCount{0u};
+};
+
+/* Controls how much audio a backend keeps queued ahead of the device. The
+ * mixer thread reports how much was still queued when it woke up to render,
+ * along with how late it woke up and any underruns. Over time, the target is
+ * reduced while there's safe headroom, and quickly increased again when the
+ * device underruns or scheduling jitter requires it. This allows backends
+ * with a large device buffer to run at a lower latency without resetting.
+ */
+class AdaptiveLatency {
+    uint mFrequency{};
+    uint mMinSize{};
+    uint mMaxSize{};
+    uint mStep{};
+
+    /* Current adaptation window state. Only accessed by the mixer thread. */
+    uint mWindowFrames{0u};
+    uint mWindowMinHeadroom{~0u};
+    std::chrono::nanoseconds mWindowJitter{};
+    uint mWindowUnderruns{0u};
+    uint mHoldWindows{0u};
+
+    std::atomic<uint> mTarget{0u};
+    std::atomic<uint> mUnderruns{0u};
+    std::atomic<std::chrono::nanoseconds::rep> mMaxJitter{0};
+
+    std::array<std::atomic<std::chrono::nanoseconds::rep>,LatencyHistoryLength> mHistLatency{};
+    std::array<std::atomic<uint>,LatencyHistoryLength> mHistUnderruns{};
+    std::atomic<size_t> mHistoryPos{0u};
+
+    void pushHistory(uint target) noexcept;
+
+public:
+    /**
+     * Resets the controller for a new device configuration. The target will
+     * start at initial, and adapt between minsize and maxsize (in sample
+     * frames) in increments of step.
+     */
+    void reset(uint frequency, uint minsize, uint maxsize, uint step, uint initial) noexcept;
+
+    /** Returns the number of sample frames that should be kept queued. */
+    uint target() const noexcept { return mTarget.load(std::memory_order_relaxed); }
+    uint step() const noexcept { return mStep; }
+
+    /**
+     * Reports a render update, with the number of sample frames that were
+     * still queued (the headroom before an underrun), and the number of
+     * sample frames being rendered.
+     */
+    void update(uint headroom, uint rendered) noexcept;
+    /** Reports how late the mixer thread woke up compared to when it asked. */
+    void wakeup(std::chrono::nanoseconds jitter) noexcept;
+    /** Reports a device underrun. */
+    void underrun() noexcept;
+
+    LatencyStats getStats() const noexcept;
+};
+
 struct BackendBase {
     virtual void open(const char *name) = 0;
 
@@ -31,6 +112,8 @@ struct BackendBase {
 
     virtual ClockLatency getClockLatency();
 
+    virtual LatencyStats getLatencyStats();
+
     DeviceBase *const mDevice;
 
     BackendBase(DeviceBase *device) noexcept : mDevice{device} { }
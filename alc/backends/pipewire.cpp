@@ -32,6 +32,7 @@
 #include <memory>
 #include <mutex>
 #include <stdint.h>
+#include <string>
 #include <type_traits>
 #include <utility>
 
@@ -94,6 +95,9 @@ auto ppw_node_subscribe_params(pw_node *node, Args&& ...args)
 template<typename ...Args>
 auto ppw_metadata_add_listener(pw_metadata *mdata, Args&& ...args)
 { return pw_metadata_add_listener(mdata, std::forward<Args>(args)...); }
+template<typename ...Args>
+auto ppw_loop_invoke(pw_loop *loop, Args&& ...args)
+{ return pw_loop_invoke(loop, std::forward<Args>(args)...); }
 
 
 constexpr auto get_pod_type(const spa_pod *pod) noexcept
@@ -169,6 +173,7 @@ bool check_version(const char *version)
     MAGIC(pw_stream_new)                                                      \
     MAGIC(pw_stream_queue_buffer)                                             \
     MAGIC(pw_stream_set_active)                                               \
+    MAGIC(pw_stream_update_properties)                                        \
     MAGIC(pw_thread_loop_new)                                                 \
     MAGIC(pw_thread_loop_destroy)                                             \
     MAGIC(pw_thread_loop_get_loop)                                            \
@@ -248,6 +253,7 @@ bool pwire_load()
 #define pw_stream_new ppw_stream_new
 #define pw_stream_queue_buffer ppw_stream_queue_buffer
 #define pw_stream_set_active ppw_stream_set_active
+#define pw_stream_update_properties ppw_stream_update_properties
 #define pw_thread_loop_destroy ppw_thread_loop_destroy
 #define pw_thread_loop_get_loop ppw_thread_loop_get_loop
 #define pw_thread_loop_lock ppw_thread_loop_lock
@@ -1261,11 +1267,16 @@ class PipeWirePlayback final : public BackendBase {
     static void outputCallbackC(void *data)
     { static_cast<PipeWirePlayback*>(data)->outputCallback(); }
 
+    void updateLatency();
+    static int updateLatencyC(spa_loop*, bool, uint32_t, const void*, size_t, void *data)
+    { static_cast<PipeWirePlayback*>(data)->updateLatency(); return 0; }
+
     void open(const char *name) override;
     bool reset() override;
     void start() override;
     void stop() override;
     ClockLatency getClockLatency() override;
+    LatencyStats getLatencyStats() override;
 
     uint32_t mTargetId{PwIdAny};
     nanoseconds mTimeBase{0};
@@ -1278,6 +1289,15 @@ class PipeWirePlayback final : public BackendBase {
     std::unique_ptr<float*[]> mChannelPtrs;
     uint mNumChannels{};
 
+    /* Adaptive latency control. The requested node latency is only updated
+     * from the mainloop thread, since the process callback is real-time.
+     */
+    bool mAdaptive{false};
+    AdaptiveLatency mLatency;
+    std::atomic<uint> mRequestedLatency{0u};
+    std::chrono::steady_clock::time_point mLastUpdate{};
+    uint mLastLength{0u};
+
     static constexpr pw_stream_events CreateEvents()
     {
         pw_stream_events ret{};
@@ -1348,6 +1368,7 @@ void PipeWirePlayback::outputCallback()
         ++chanptr_end;
     }
 
+    const auto starttime = std::chrono::steady_clock::now();
     mDevice->renderSamples({mChannelPtrs.get(), chanptr_end}, length);
 
     for(const auto &data : datas)
@@ -1358,6 +1379,52 @@ void PipeWirePlayback::outputCallback()
     }
     pw_buf->size = length;
     pw_stream_queue_buffer(mStream.get(), pw_buf);
+
+    if(!mAdaptive) return;
+
+    /* The graph drives the timing here, so the jitter is how much later than
+     * expected this update came, relative to the last one. Taking longer than
+     * the update itself to render means the graph most likely skipped us.
+     */
+    const auto endtime = std::chrono::steady_clock::now();
+    const auto period = nanoseconds{seconds{length}} / mDevice->Frequency;
+    if(mLastLength > 0)
+    {
+        const auto expected = nanoseconds{seconds{mLastLength}} / mDevice->Frequency;
+        const auto interval = starttime - mLastUpdate;
+        mLatency.wakeup(interval - expected);
+        if(interval >= expected*2)
+            mLatency.underrun();
+    }
+    mLastUpdate = starttime;
+    mLastLength = length;
+
+    const auto rendertime = endtime - starttime;
+    if(rendertime >= period)
+        mLatency.underrun();
+    else
+    {
+        const auto slack = std::chrono::duration_cast<seconds>((period-rendertime) *
+            mDevice->Frequency);
+        mLatency.update(static_cast<uint>(slack.count()), length);
+    }
+
+    const uint target{mLatency.target()};
+    if(mRequestedLatency.exchange(target, std::memory_order_relaxed) != target)
+        ppw_loop_invoke(mLoop.getLoop(), &PipeWirePlayback::updateLatencyC, 0, nullptr, 0,
+            false, this);
+}
+
+void PipeWirePlayback::updateLatency()
+{
+    if(!mStream) return;
+
+    const std::string latency{std::to_string(mRequestedLatency.load(std::memory_order_relaxed))
+        + "/" + std::to_string(mDevice->Frequency)};
+    const spa_dict_item item{PW_KEY_NODE_LATENCY, latency.c_str()};
+    const spa_dict dict{0, 1, &item};
+    if(int res{pw_stream_update_properties(mStream.get(), &dict)})
+        ERR("Failed to update PipeWire node latency to %s (res: %d)\n", latency.c_str(), res);
 }
 
 
@@ -1560,6 +1627,16 @@ bool PipeWirePlayback::reset()
     mDevice->BufferSize = mDevice->UpdateSize * 2;
     plock.unlock();
 
+    /* With adaptive latency, the requested node latency (the graph quantum)
+     * adapts between about 2ms and the update size. The stream is inactive
+     * until started, so the process callback can't be using it yet.
+     */
+    mAdaptive = GetConfigValueBool(mDevice->DeviceName.c_str(), "pipewire", "adaptive-latency",
+        false);
+    const uint step{clampu(mDevice->Frequency/500, 16, mDevice->UpdateSize)};
+    mLatency.reset(mDevice->Frequency, step, mDevice->UpdateSize, step, mDevice->UpdateSize);
+    mRequestedLatency.store(mDevice->UpdateSize, std::memory_order_relaxed);
+
     mNumChannels = mDevice->channelsFromFmt();
     mChannelPtrs = std::make_unique<float*[]>(mNumChannels);
 
@@ -1570,6 +1647,8 @@ bool PipeWirePlayback::reset()
 
 void PipeWirePlayback::start()
 {
+    mLastLength = 0;
+
     MainloopUniqueLock plock{mLoop};
     if(int res{pw_stream_set_active(mStream.get(), true)})
         throw al::backend_exception{al::backend_error::DeviceError,
@@ -1691,6 +1770,13 @@ ClockLatency PipeWirePlayback::getClockLatency()
     return ret;
 }
 
+LatencyStats PipeWirePlayback::getLatencyStats()
+{
+    if(!mAdaptive)
+        return BackendBase::getLatencyStats();
+    return mLatency.getStats();
+}
+
 
 class PipeWireCapture final : public BackendBase {
     void stateChangedCallback(pw_stream_state old, pw_stream_state state, const char *error);
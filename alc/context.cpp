@@ -74,11 +74,13 @@ constexpr ALchar alExtList[] =
     "AL_SOFT_loop_points "
     "AL_SOFTX_map_buffer "
     "AL_SOFT_MSADPCM "
+    "AL_SOFTX_scheduled_playback "
     "AL_SOFT_source_latency "
     "AL_SOFT_source_length "
     "AL_SOFT_source_resampler "
     "AL_SOFT_source_spatialize "
-    "AL_SOFT_UHJ";
+    "AL_SOFT_UHJ "
+    "AL_SOFTX_voice_lod";
 
 } // namespace
 
@@ -157,7 +159,7 @@ void ALCcontext::init()
     }
     mActiveAuxSlots.store(auxslots, std::memory_order_relaxed);
 
-    allocVoiceChanges();
+    allocVoiceChanges(mPreallocVoices);
     {
         VoiceChange *cur{mVoiceChangeTail};
         while(VoiceChange *next{cur->mNext.load(std::memory_order_relaxed)})
@@ -177,6 +179,8 @@ void ALCcontext::init()
     mParams.Gain = mListener.Gain;
     mParams.MetersPerUnit = mListener.mMetersPerUnit;
     mParams.AirAbsorptionGainHF = mAirAbsorptionGainHF;
+    mParams.LodDistance = mListener.mLodDistance;
+    mParams.LodGain = mListener.mLodGain;
     mParams.DopplerFactor = mDopplerFactor;
     mParams.SpeedOfSound = mSpeedOfSound * mDopplerVelocity;
     mParams.SourceDistanceModel = mSourceDistanceModel;
@@ -187,8 +191,13 @@ void ALCcontext::init()
     StartEventThrd(this);
 
 
-    allocVoices(256);
+    allocVoices(std::max<size_t>(256, mPreallocVoices));
     mActiveVoiceCount.store(64, std::memory_order_relaxed);
+    if(mPreallocVoices > 0)
+    {
+        allocVoiceProps(mPreallocVoices);
+        TRACE("Preallocated %zu voices\n", mPreallocVoices);
+    }
 }
 
 bool ALCcontext::deinit()
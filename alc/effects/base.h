@@ -1,7 +1,18 @@
 #ifndef EFFECTS_BASE_H
 #define EFFECTS_BASE_H
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stddef.h>
+
+#include "alspan.h"
+#include "core/bufferline.h"
 #include "core/effects/base.h"
+#include "core/mixer.h"
+#include "opthelpers.h"
 
 
 EffectStateFactory *NullStateFactory_getFactory(void);
@@ -23,4 +34,140 @@ EffectStateFactory *DedicatedStateFactory_getFactory(void);
 
 EffectStateFactory *ConvolutionStateFactory_getFactory(void);
 
+
+enum class PshifterMode : unsigned char {
+    Stft,
+    Psola
+};
+
+/* User config options for the pitch shifter. The FFT size and overlap are
+ * powers of two.
+ */
+extern PshifterMode PshifterProcessMode;
+extern unsigned int PshifterFftSize;
+extern unsigned int PshifterOverlap;
+
+/* User config options for the convolution effect. Whether impulse responses
+ * are prepared on a background thread, and how many bytes of prepared filters
+ * to keep cached while unused.
+ */
+extern bool ConvolutionAsyncLoad;
+extern size_t ConvolutionCacheSize;
+
+
+/**
+ * Calculates how long a signal keeps recirculating through a feedback loop of
+ * the given length (in samples) and gain, before decaying below
+ * EffectTailSilenceGain.
+ */
+inline size_t CalcFeedbackTail(const size_t loopLength, const float feedback)
+{
+    const float fbgain{std::abs(feedback)};
+    if(!(fbgain > EffectTailSilenceGain))
+        return 0;
+    if(!(fbgain < 1.0f))
+        return InfiniteEffectTail;
+    const float repeats{std::ceil(std::log(EffectTailSilenceGain) / std::log(fbgain))};
+    return loopLength * static_cast<size_t>(repeats);
+}
+
+
+/**
+ * Mixes the output of a batch of two-tap effect states. The states keep their
+ * panning gains (mGains[2]) separate from the slot gain (mSlotGain), so states
+ * mixing to the same output with the same panning can have their slot gains
+ * applied to their taps (mTemps[2]), be summed together, then be panned once
+ * for the whole group, instead of once for each state.
+ */
+template<typename T>
+void MixBatchedTaps(const al::span<const EffectBatchItem> items, const size_t todo,
+    const size_t counter, const size_t outPos)
+{
+    ASSUME(todo > 0);
+    ASSUME(counter >= todo);
+
+    std::array<bool,MaxEffectBatchSize> mixed{};
+    for(size_t i{0};i < items.size();++i)
+    {
+        if(mixed[i]) continue;
+
+        T *leader{static_cast<T*>(items[i].State)};
+        const al::span<FloatBufferLine> output{items[i].SamplesOut};
+        auto same_panning = [leader,output](const EffectBatchItem &item) -> bool
+        {
+            if(item.SamplesOut.data() != output.data())
+                return false;
+            const T *state{static_cast<const T*>(item.State)};
+            for(size_t c{0};c < 2;++c)
+            {
+                const auto &gains0 = leader->mGains[c];
+                const auto &gains1 = state->mGains[c];
+                if(!std::equal(gains0.Current, gains0.Current+output.size(), gains1.Current)
+                    || !std::equal(gains0.Target, gains0.Target+output.size(), gains1.Target))
+                    return false;
+            }
+            return true;
+        };
+
+        std::array<T*,MaxEffectBatchSize> group;
+        size_t groupsize{0};
+        for(size_t j{i};j < items.size();++j)
+        {
+            if(!mixed[j] && same_panning(items[j]))
+            {
+                mixed[j] = true;
+                group[groupsize++] = static_cast<T*>(items[j].State);
+            }
+        }
+
+        for(size_t j{0};j < groupsize;++j)
+        {
+            T *state{group[j]};
+            const float gain{state->mSlotGain.Current};
+            const float target{state->mSlotGain.Target};
+            const float step{(target-gain) / static_cast<float>(counter)};
+            if(!(std::abs(step) > std::numeric_limits<float>::epsilon()))
+            {
+                state->mSlotGain.Current = target;
+                if(target != 1.0f)
+                {
+                    for(auto &temp : state->mTemps)
+                        std::transform(temp, temp+todo, temp,
+                            [target](const float s) noexcept { return s*target; });
+                }
+            }
+            else
+            {
+                for(auto &temp : state->mTemps)
+                {
+                    float step_count{0.0f};
+                    for(size_t k{0};k < todo;++k)
+                    {
+                        temp[k] *= gain + step*step_count;
+                        step_count += 1.0f;
+                    }
+                }
+                state->mSlotGain.Current = (todo == counter) ? target
+                    : gain + step*static_cast<float>(todo);
+            }
+
+            /* Sum the other states' taps into the leader's. */
+            if(j > 0)
+            {
+                for(size_t c{0};c < 2;++c)
+                    std::transform(state->mTemps[c], state->mTemps[c]+todo, leader->mTemps[c],
+                        leader->mTemps[c], std::plus<float>{});
+            }
+        }
+
+        for(size_t c{0};c < 2;++c)
+        {
+            MixSamples({leader->mTemps[c], todo}, output, leader->mGains[c].Current,
+                leader->mGains[c].Target, counter, outPos);
+            for(size_t j{1};j < groupsize;++j)
+                std::copy_n(leader->mGains[c].Current, output.size(), group[j]->mGains[c].Current);
+        }
+    }
+}
+
 #endif /* EFFECTS_BASE_H */
@@ -23,9 +23,16 @@
 #include <algorithm>
 #include <array>
 #include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <iterator>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "alc/effects/base.h"
 #include "almalloc.h"
 #include "alnumbers.h"
@@ -50,6 +57,100 @@ using uint = unsigned int;
 
 #define MAX_UPDATE_SAMPLES 256
 
+/* Chorus and flanger states share this key, so they can be batched together. */
+constexpr char ChorusBatchKey{};
+
+
+/* Calculates the sinusoid LFO for the given offsets in-place. The sine is
+ * approximated with a polynomial, after folding the phase into -pi/2...+pi/2,
+ * so it can be calculated four samples at a time. The count must be a
+ * multiple of 4.
+ */
+void CalcSinusoidLfo(float *RESTRICT values, const size_t count, const float scale,
+    const float depth)
+{
+    constexpr float pi{al::numbers::pi_v<float>};
+    /* Taylor series coefficients up to x^11, which is accurate to within
+     * 6e-8 over the folded range.
+     */
+    constexpr float c3{-1.0f/6.0f}, c5{1.0f/120.0f}, c7{-1.0f/5040.0f};
+    constexpr float c9{1.0f/362880.0f}, c11{-1.0f/39916800.0f};
+
+    ASSUME(count > 0);
+    ASSUME((count&3) == 0);
+
+    /* sin(x) = -sin(x - pi), where x - pi is within -pi...+pi, so the depth is
+     * negated to compensate.
+     */
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 scale4{_mm_set1_ps(scale)}, depth4{_mm_set1_ps(-depth)};
+    const __m128 pi4{_mm_set1_ps(pi)}, halfpi4{_mm_set1_ps(pi*0.5f)};
+    const __m128 signmask4{_mm_set1_ps(-0.0f)};
+    for(size_t i{0};i < count;i+=4)
+    {
+        __m128 x{_mm_sub_ps(_mm_mul_ps(_mm_load_ps(&values[i]), scale4), pi4)};
+        const __m128 folded{_mm_sub_ps(_mm_or_ps(pi4, _mm_and_ps(x, signmask4)), x)};
+        const __m128 fold_mask{_mm_cmpgt_ps(_mm_andnot_ps(signmask4, x), halfpi4)};
+        x = _mm_or_ps(_mm_and_ps(fold_mask, folded), _mm_andnot_ps(fold_mask, x));
+
+        const __m128 x2{_mm_mul_ps(x, x)};
+        __m128 r{_mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(c11)), _mm_set1_ps(c9))};
+        r = _mm_add_ps(_mm_mul_ps(x2, r), _mm_set1_ps(c7));
+        r = _mm_add_ps(_mm_mul_ps(x2, r), _mm_set1_ps(c5));
+        r = _mm_add_ps(_mm_mul_ps(x2, r), _mm_set1_ps(c3));
+        r = _mm_add_ps(_mm_mul_ps(x2, r), _mm_set1_ps(1.0f));
+        _mm_store_ps(&values[i], _mm_mul_ps(_mm_mul_ps(x, r), depth4));
+    }
+
+#elif defined(HAVE_NEON)
+
+    const float32x4_t scale4{vdupq_n_f32(scale)}, depth4{vdupq_n_f32(-depth)};
+    const float32x4_t pi4{vdupq_n_f32(pi)}, halfpi4{vdupq_n_f32(pi*0.5f)};
+    const uint32x4_t signmask4{vdupq_n_u32(0x80000000u)};
+    for(size_t i{0};i < count;i+=4)
+    {
+        float32x4_t x{vsubq_f32(vmulq_f32(vld1q_f32(&values[i]), scale4), pi4)};
+        const uint32x4_t sign{vandq_u32(vreinterpretq_u32_f32(x), signmask4)};
+        const float32x4_t folded{vsubq_f32(vreinterpretq_f32_u32(
+            vorrq_u32(vreinterpretq_u32_f32(pi4), sign)), x)};
+        x = vbslq_f32(vcgtq_f32(vabsq_f32(x), halfpi4), folded, x);
+
+        const float32x4_t x2{vmulq_f32(x, x)};
+        float32x4_t r{vmlaq_f32(vdupq_n_f32(c9), x2, vdupq_n_f32(c11))};
+        r = vmlaq_f32(vdupq_n_f32(c7), x2, r);
+        r = vmlaq_f32(vdupq_n_f32(c5), x2, r);
+        r = vmlaq_f32(vdupq_n_f32(c3), x2, r);
+        r = vmlaq_f32(vdupq_n_f32(1.0f), x2, r);
+        vst1q_f32(&values[i], vmulq_f32(vmulq_f32(x, r), depth4));
+    }
+
+#else
+
+    for(size_t i{0};i < count;++i)
+    {
+        float x{values[i]*scale - pi};
+        if(x > pi*0.5f) x = pi - x;
+        else if(x < -pi*0.5f) x = -pi - x;
+
+        const float x2{x*x};
+        const float r{((((c11*x2 + c9)*x2 + c7)*x2 + c5)*x2 + c3)*x2 + 1.0f};
+        values[i] = x*r * -depth;
+    }
+#endif
+}
+
+/* Calculates the triangle LFO for the given offsets in-place. */
+void CalcTriangleLfo(float *RESTRICT values, const size_t count, const float scale,
+    const float depth)
+{
+    ASSUME(count > 0);
+
+    std::transform(values, values+count, values,
+        [scale,depth](const float offset) noexcept -> float
+        { return (1.0f - std::abs(2.0f - offset*scale)) * depth; });
+}
+
+
 struct ChorusState final : public EffectState {
     al::vector<float,16> mSampleBuffer;
     uint mOffset{0};
@@ -59,20 +160,31 @@ struct ChorusState final : public EffectState {
     float mLfoScale{0.0f};
     uint mLfoDisp{0};
 
-    /* Gains for left and right sides */
+    /* Panning gains for left and right sides */
     struct {
         float Current[MAX_OUTPUT_CHANNELS]{};
         float Target[MAX_OUTPUT_CHANNELS]{};
     } mGains[2];
 
+    /* The slot gain is applied separately from the panning gains, so batched
+     * states with the same panning can be mixed together.
+     */
+    struct {
+        float Current{0.0f};
+        float Target{0.0f};
+    } mSlotGain;
+
     /* effect parameters */
     ChorusWaveform mWaveform{};
     int mDelay{0};
     float mDepth{0.0f};
     float mFeedback{0.0f};
 
-    void getTriangleDelays(uint (*delays)[MAX_UPDATE_SAMPLES], const size_t todo);
-    void getSinusoidDelays(uint (*delays)[MAX_UPDATE_SAMPLES], const size_t todo);
+    alignas(16) float mTemps[2][MAX_UPDATE_SAMPLES];
+
+    void getDelays(uint (*delays)[MAX_UPDATE_SAMPLES], const size_t todo);
+    void processTaps(const uint (*delays)[MAX_UPDATE_SAMPLES], const float *RESTRICT input,
+        const size_t todo);
 
     void deviceUpdate(const DeviceBase *device, const Buffer &buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
@@ -80,6 +192,12 @@ struct ChorusState final : public EffectState {
     void process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn,
         const al::span<FloatBufferLine> samplesOut) override;
 
+    size_t getTailLength() const noexcept override;
+
+    const void *getBatchKey() const noexcept override { return &ChorusBatchKey; }
+    void processBatch(const size_t samplesToDo, const al::span<const EffectBatchItem> items)
+        override;
+
     DEF_NEWDEL(ChorusState)
 };
 
@@ -98,6 +216,8 @@ void ChorusState::deviceUpdate(const DeviceBase *Device, const Buffer&)
         std::fill(std::begin(e.Current), std::end(e.Current), 0.0f);
         std::fill(std::begin(e.Target), std::end(e.Target), 0.0f);
     }
+    mSlotGain.Current = 0.0f;
+    mSlotGain.Target = 0.0f;
 }
 
 void ChorusState::update(const ContextBase *Context, const EffectSlot *Slot,
@@ -124,8 +244,9 @@ void ChorusState::update(const ContextBase *Context, const EffectSlot *Slot,
     const auto rcoeffs = CalcDirectionCoeffs({ 1.0f, 0.0f, 0.0f}, 0.0f);
 
     mOutTarget = target.Main->Buffer;
-    ComputePanGains(target.Main, lcoeffs.data(), Slot->Gain, mGains[0].Target);
-    ComputePanGains(target.Main, rcoeffs.data(), Slot->Gain, mGains[1].Target);
+    ComputePanGains(target.Main, lcoeffs.data(), 1.0f, mGains[0].Target);
+    ComputePanGains(target.Main, rcoeffs.data(), 1.0f, mGains[1].Target);
+    mSlotGain.Target = Slot->Gain;
 
     float rate{props->Chorus.Rate};
     if(!(rate > 0.0f))
@@ -162,105 +283,121 @@ void ChorusState::update(const ContextBase *Context, const EffectSlot *Slot,
 }
 
 
-void ChorusState::getTriangleDelays(uint (*delays)[MAX_UPDATE_SAMPLES], const size_t todo)
+void ChorusState::getDelays(uint (*delays)[MAX_UPDATE_SAMPLES], const size_t todo)
 {
     const uint lfo_range{mLfoRange};
-    const float lfo_scale{mLfoScale};
-    const float depth{mDepth};
     const int delay{mDelay};
 
     ASSUME(lfo_range > 0);
     ASSUME(todo > 0);
 
-    uint offset{mLfoOffset};
-    auto gen_lfo = [&offset,lfo_range,lfo_scale,depth,delay]() -> uint
+    /* Step the LFO offsets for the tap first, then calculate the waveform for
+     * them all at once. The offsets are padded to a multiple of 4 for the
+     * vectorised sinusoid.
+     */
+    const size_t todo4{(todo+3) & ~size_t{3}};
+    auto gen_delays = [this,lfo_range,delay,todo,todo4](uint offset, uint *RESTRICT output)
     {
-        offset = (offset+1)%lfo_range;
-        const float offset_norm{static_cast<float>(offset) * lfo_scale};
-        return static_cast<uint>(fastf2i((1.0f-std::abs(2.0f-offset_norm)) * depth) + delay);
-    };
-    std::generate_n(delays[0], todo, gen_lfo);
+        alignas(16) float lfo[MAX_UPDATE_SAMPLES];
+        for(size_t i{0};i < todo;++i)
+        {
+            if(++offset == lfo_range) offset = 0;
+            lfo[i] = static_cast<float>(offset);
+        }
+        std::fill(lfo+todo, lfo+todo4, 0.0f);
 
-    offset = (mLfoOffset+mLfoDisp) % lfo_range;
-    std::generate_n(delays[1], todo, gen_lfo);
+        if(mWaveform == ChorusWaveform::Sinusoid)
+            CalcSinusoidLfo(lfo, todo4, mLfoScale, mDepth);
+        else /*if(mWaveform == ChorusWaveform::Triangle)*/
+            CalcTriangleLfo(lfo, todo, mLfoScale, mDepth);
+
+        std::transform(lfo, lfo+todo, output,
+            [delay](const float value) noexcept -> uint
+            { return static_cast<uint>(fastf2i(value) + delay); });
+    };
+    gen_delays(mLfoOffset, delays[0]);
+    gen_delays((mLfoOffset+mLfoDisp) % lfo_range, delays[1]);
 
     mLfoOffset = static_cast<uint>(mLfoOffset+todo) % lfo_range;
 }
 
-void ChorusState::getSinusoidDelays(uint (*delays)[MAX_UPDATE_SAMPLES], const size_t todo)
+void ChorusState::processTaps(const uint (*delays)[MAX_UPDATE_SAMPLES],
+    const float *RESTRICT input, const size_t todo)
 {
-    const uint lfo_range{mLfoRange};
-    const float lfo_scale{mLfoScale};
-    const float depth{mDepth};
-    const int delay{mDelay};
-
-    ASSUME(lfo_range > 0);
-    ASSUME(todo > 0);
+    const size_t bufmask{mSampleBuffer.size()-1};
+    const float feedback{mFeedback};
+    const uint avgdelay{(static_cast<uint>(mDelay) + (MixerFracOne>>1)) >> MixerFracBits};
+    float *RESTRICT delaybuf{mSampleBuffer.data()};
+    uint offset{mOffset};
 
-    uint offset{mLfoOffset};
-    auto gen_lfo = [&offset,lfo_range,lfo_scale,depth,delay]() -> uint
+    for(size_t i{0u};i < todo;++i)
     {
-        offset = (offset+1)%lfo_range;
-        const float offset_norm{static_cast<float>(offset) * lfo_scale};
-        return static_cast<uint>(fastf2i(std::sin(offset_norm)*depth) + delay);
-    };
-    std::generate_n(delays[0], todo, gen_lfo);
+        // Feed the buffer's input first (necessary for delays < 1).
+        delaybuf[offset&bufmask] = input[i];
+
+        // Tap for the left output.
+        uint delay{offset - (delays[0][i]>>MixerFracBits)};
+        float mu{static_cast<float>(delays[0][i]&MixerFracMask) * (1.0f/MixerFracOne)};
+        mTemps[0][i] = cubic(delaybuf[(delay+1) & bufmask], delaybuf[(delay  ) & bufmask],
+            delaybuf[(delay-1) & bufmask], delaybuf[(delay-2) & bufmask], mu);
+
+        // Tap for the right output.
+        delay = offset - (delays[1][i]>>MixerFracBits);
+        mu = static_cast<float>(delays[1][i]&MixerFracMask) * (1.0f/MixerFracOne);
+        mTemps[1][i] = cubic(delaybuf[(delay+1) & bufmask], delaybuf[(delay  ) & bufmask],
+            delaybuf[(delay-1) & bufmask], delaybuf[(delay-2) & bufmask], mu);
+
+        // Accumulate feedback from the average delay of the taps.
+        delaybuf[offset&bufmask] += delaybuf[(offset-avgdelay) & bufmask] * feedback;
+        ++offset;
+    }
 
-    offset = (mLfoOffset+mLfoDisp) % lfo_range;
-    std::generate_n(delays[1], todo, gen_lfo);
+    mOffset = offset;
+}
 
-    mLfoOffset = static_cast<uint>(mLfoOffset+todo) % lfo_range;
+size_t ChorusState::getTailLength() const noexcept
+{
+    /* The feedback comes from the average delay, and the taps read up to the
+     * delay plus the LFO depth (plus the cubic interpolation edge).
+     */
+    const uint avgdelay{(static_cast<uint>(mDelay) + (MixerFracOne>>1)) >> MixerFracBits};
+    const uint maxdelay{((static_cast<uint>(mDelay) + float2uint(mDepth)) >> MixerFracBits) + 2};
+    const size_t feedtail{CalcFeedbackTail(avgdelay, mFeedback)};
+    if(feedtail == InfiniteEffectTail)
+        return InfiniteEffectTail;
+    return feedtail + maxdelay;
 }
 
 void ChorusState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
 {
-    const size_t bufmask{mSampleBuffer.size()-1};
-    const float feedback{mFeedback};
-    const uint avgdelay{(static_cast<uint>(mDelay) + (MixerFracOne>>1)) >> MixerFracBits};
-    float *RESTRICT delaybuf{mSampleBuffer.data()};
-    uint offset{mOffset};
+    const EffectBatchItem item{this, samplesIn, samplesOut};
+    processBatch(samplesToDo, {&item, 1});
+}
+
+void ChorusState::processBatch(const size_t samplesToDo,
+    const al::span<const EffectBatchItem> items)
+{
+    ASSUME(items.size() <= MaxEffectBatchSize);
 
     for(size_t base{0u};base < samplesToDo;)
     {
         const size_t todo{minz(MAX_UPDATE_SAMPLES, samplesToDo-base)};
 
-        uint moddelays[2][MAX_UPDATE_SAMPLES];
-        if(mWaveform == ChorusWaveform::Sinusoid)
-            getSinusoidDelays(moddelays, todo);
-        else /*if(mWaveform == ChorusWaveform::Triangle)*/
-            getTriangleDelays(moddelays, todo);
+        /* Generate the LFO delays for every state in one pass, then run each
+         * state's delay line, and finally mix them all together.
+         */
+        uint moddelays[MaxEffectBatchSize][2][MAX_UPDATE_SAMPLES];
+        for(size_t i{0};i < items.size();++i)
+            static_cast<ChorusState*>(items[i].State)->getDelays(moddelays[i], todo);
 
-        alignas(16) float temps[2][MAX_UPDATE_SAMPLES];
-        for(size_t i{0u};i < todo;++i)
-        {
-            // Feed the buffer's input first (necessary for delays < 1).
-            delaybuf[offset&bufmask] = samplesIn[0][base+i];
-
-            // Tap for the left output.
-            uint delay{offset - (moddelays[0][i]>>MixerFracBits)};
-            float mu{static_cast<float>(moddelays[0][i]&MixerFracMask) * (1.0f/MixerFracOne)};
-            temps[0][i] = cubic(delaybuf[(delay+1) & bufmask], delaybuf[(delay  ) & bufmask],
-                delaybuf[(delay-1) & bufmask], delaybuf[(delay-2) & bufmask], mu);
-
-            // Tap for the right output.
-            delay = offset - (moddelays[1][i]>>MixerFracBits);
-            mu = static_cast<float>(moddelays[1][i]&MixerFracMask) * (1.0f/MixerFracOne);
-            temps[1][i] = cubic(delaybuf[(delay+1) & bufmask], delaybuf[(delay  ) & bufmask],
-                delaybuf[(delay-1) & bufmask], delaybuf[(delay-2) & bufmask], mu);
-
-            // Accumulate feedback from the average delay of the taps.
-            delaybuf[offset&bufmask] += delaybuf[(offset-avgdelay) & bufmask] * feedback;
-            ++offset;
-        }
+        for(size_t i{0};i < items.size();++i)
+            static_cast<ChorusState*>(items[i].State)->processTaps(moddelays[i],
+                items[i].SamplesIn[0].data()+base, todo);
 
-        for(size_t c{0};c < 2;++c)
-            MixSamples({temps[c], todo}, samplesOut, mGains[c].Current, mGains[c].Target,
-                samplesToDo-base, base);
+        MixBatchedTaps<ChorusState>(items, todo, samplesToDo-base, base);
 
         base += todo;
     }
-
-    mOffset = offset;
 }
 
 
@@ -3,13 +3,20 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <complex>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <stdint.h>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #ifdef HAVE_SSE_INTRINSICS
 #include <xmmintrin.h>
@@ -33,9 +40,12 @@
 #include "core/effectslot.h"
 #include "core/filters/splitter.h"
 #include "core/fmt_traits.h"
+#include "core/fpu_ctrl.h"
+#include "core/logging.h"
 #include "core/mixer.h"
 #include "intrusive_ptr.h"
 #include "polyphase_resampler.h"
+#include "threads.h"
 #include "vector.h"
 
 
@@ -45,19 +55,24 @@ namespace {
  * impulse response is broken up into multiple segments of 128 samples, and
  * each segment has an FFT applied with a 256-sample buffer (the latter half
  * left silent) to get its frequency-domain response. The resulting response
- * has its positive/non-mirrored frequencies saved (129 bins) in each segment.
+ * has its positive/non-mirrored frequencies saved (129 bins) in each segment,
+ * as 128 real and 128 imaginary values, with the (real) Nyquist bin in place
+ * of the (always 0) imaginary part of the DC bin.
  *
- * Input samples are similarly broken up into 128-sample segments, with an FFT
- * applied to each new incoming segment to get its 129 bins. A history of FFT'd
- * input segments is maintained, equal to the length of the impulse response.
+ * Input samples are similarly broken up into 128-sample segments, with a real
+ * FFT applied to each new incoming segment to get its 129 bins. A history of
+ * FFT'd input segments is maintained, equal to the length of the impulse
+ * response.
  *
  * To apply the reverberation, each impulse response segment is convolved with
  * its paired input segment (using complex multiplies, far cheaper than FIRs),
- * accumulating into a 256-bin FFT buffer. The input history is then shifted to
- * align with later impulse response segments for next time.
+ * accumulating into the output's frequency bins. All channels of the impulse
+ * response are handled for each input segment before moving on to the next,
+ * so the input history is only read through once. The input history is then
+ * shifted to align with later impulse response segments for next time.
  *
- * An inverse FFT is then applied to the accumulated FFT buffer to get a 256-
- * sample time-domain response for output, which is split in two halves. The
+ * An inverse FFT is then applied to the accumulated bins to get a 256-sample
+ * time-domain response for output, which is split in two halves. The
  * first half is the 128-sample output, and the second half is a 128-sample
  * (really, 127) delayed extension, which gets added to the output next time.
  * Convolving two time-domain responses of lengths N and M results in a time-
@@ -69,6 +84,16 @@ namespace {
  * the first segment is applied directly in the time-domain as the samples come
  * in. Once enough have been retrieved, the FFT is applied on the input and
  * it's paired with the remaining (FFT'd) filter segments for processing.
+ *
+ * A "true stereo" impulse response has four channels, for the left input to
+ * the left and right outputs, and the right input to the left and right
+ * outputs. The inputs are derived from the effect's B-Format input as virtual
+ * cardioids facing left and right.
+ *
+ * Preparing the filter segments can take a while for long impulse responses,
+ * so the prepared filters are cached and shared between the effect states
+ * using the same buffer data at the same sample rate, and can optionally be
+ * prepared on a background thread.
  */
 
 
@@ -129,6 +154,15 @@ using complex_d = std::complex<double>;
 constexpr size_t ConvolveUpdateSize{256};
 constexpr size_t ConvolveUpdateSamples{ConvolveUpdateSize / 2};
 
+/* The number of complex values (bins) of each segment's frequency response,
+ * stored as separate real and imaginary arrays.
+ */
+constexpr size_t ConvolveBins{ConvolveUpdateSize / 2};
+
+constexpr uint MaxConvolveAmbiOrder{1u};
+
+/* True stereo impulse responses have two inputs. */
+constexpr size_t MaxConvolveInputs{2};
 
 void apply_fir(al::span<float> dst, const float *RESTRICT src, const float *RESTRICT filter)
 {
@@ -145,7 +179,7 @@ void apply_fir(al::span<float> dst, const float *RESTRICT src, const float *REST
         }
         r4 = _mm_add_ps(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 1, 2, 3)));
         r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
-        output = _mm_cvtss_f32(r4);
+        output += _mm_cvtss_f32(r4);
 
         ++src;
     }
@@ -158,7 +192,7 @@ void apply_fir(al::span<float> dst, const float *RESTRICT src, const float *REST
         for(size_t j{0};j < ConvolveUpdateSamples;j+=4)
             r4 = vmlaq_f32(r4, vld1q_f32(&src[j]), vld1q_f32(&filter[j]));
         r4 = vaddq_f32(r4, vrev64q_f32(r4));
-        output = vget_lane_f32(vadd_f32(vget_low_f32(r4), vget_high_f32(r4)), 0);
+        output += vget_lane_f32(vadd_f32(vget_low_f32(r4), vget_high_f32(r4)), 0);
 
         ++src;
     }
@@ -170,24 +204,396 @@ void apply_fir(al::span<float> dst, const float *RESTRICT src, const float *REST
         float ret{0.0f};
         for(size_t j{0};j < ConvolveUpdateSamples;++j)
             ret += src[j] * filter[j];
-        output = ret;
+        output += ret;
         ++src;
     }
 #endif
 }
 
+/* Multiplies the input segment's bins with the filter segment's, adding them
+ * to the accumulated bins. The real and imaginary parts of each are separate
+ * arrays of ConvolveBins values, one after the other, and the DC and Nyquist
+ * bins are handled separately since they're packed together.
+ */
+void apply_mac(float *RESTRICT acc, const float *RESTRICT input, const float *RESTRICT filter)
+{
+    const float dc{acc[0] + input[0]*filter[0]};
+    const float nyq{acc[ConvolveBins] + input[ConvolveBins]*filter[ConvolveBins]};
+
+#ifdef HAVE_SSE_INTRINSICS
+    for(size_t i{0};i < ConvolveBins;i+=4)
+    {
+        const __m128 in_r{_mm_load_ps(&input[i])};
+        const __m128 in_i{_mm_load_ps(&input[ConvolveBins+i])};
+        const __m128 f_r{_mm_load_ps(&filter[i])};
+        const __m128 f_i{_mm_load_ps(&filter[ConvolveBins+i])};
+
+        __m128 r4{_mm_load_ps(&acc[i])};
+        __m128 i4{_mm_load_ps(&acc[ConvolveBins+i])};
+        r4 = _mm_add_ps(r4, _mm_sub_ps(_mm_mul_ps(in_r, f_r), _mm_mul_ps(in_i, f_i)));
+        i4 = _mm_add_ps(i4, _mm_add_ps(_mm_mul_ps(in_r, f_i), _mm_mul_ps(in_i, f_r)));
+        _mm_store_ps(&acc[i], r4);
+        _mm_store_ps(&acc[ConvolveBins+i], i4);
+    }
+
+#elif defined(HAVE_NEON)
+
+    for(size_t i{0};i < ConvolveBins;i+=4)
+    {
+        const float32x4_t in_r{vld1q_f32(&input[i])};
+        const float32x4_t in_i{vld1q_f32(&input[ConvolveBins+i])};
+        const float32x4_t f_r{vld1q_f32(&filter[i])};
+        const float32x4_t f_i{vld1q_f32(&filter[ConvolveBins+i])};
+
+        float32x4_t r4{vld1q_f32(&acc[i])};
+        float32x4_t i4{vld1q_f32(&acc[ConvolveBins+i])};
+        r4 = vmlsq_f32(vmlaq_f32(r4, in_r, f_r), in_i, f_i);
+        i4 = vmlaq_f32(vmlaq_f32(i4, in_r, f_i), in_i, f_r);
+        vst1q_f32(&acc[i], r4);
+        vst1q_f32(&acc[ConvolveBins+i], i4);
+    }
+
+#else
+
+    for(size_t i{0};i < ConvolveBins;++i)
+    {
+        const float in_r{input[i]}, in_i{input[ConvolveBins+i]};
+        const float f_r{filter[i]}, f_i{filter[ConvolveBins+i]};
+        acc[i] += in_r*f_r - in_i*f_i;
+        acc[ConvolveBins+i] += in_r*f_i + in_i*f_r;
+    }
+#endif
+
+    acc[0] = dc;
+    acc[ConvolveBins] = nyq;
+}
+
+/* The filter prepared from an impulse response buffer, for the given device
+ * sample rate. It's read-only once prepared.
+ */
+struct ConvolutionFilter final : public al::intrusive_ref<ConvolutionFilter> {
+    /* The cache key. */
+    const uint64_t mGeneration;
+    const uint mDeviceRate;
+    const uint mSegmentSize;
+
+    /* A copy of the buffer's format, and of its samples when prepared on the
+     * worker thread (the buffer may be changed or deleted in the mean time).
+     */
+    const BufferStorage mSource;
+    al::vector<al::byte,16> mSamples;
+
+    size_t mNumChannels{};
+    size_t mNumConvolveSegs{};
+    uint mResampledCount{};
+    size_t mSize{};
+
+    /* The first segment of each channel, reversed to apply as a FIR filter,
+     * and the remaining segments' frequency responses. The responses are
+     * stored segment by segment, with each segment holding all channels (as
+     * ConvolveBins real values followed by ConvolveBins imaginary values), so
+     * they're read in order while processing.
+     */
+    al::vector<std::array<float,ConvolveUpdateSamples>,16> mFilter;
+    al::vector<float,16> mComplexData;
+
+    /* Whether the filter is prepared, or failed to be. States sharing a filter
+     * that failed stop using it, and get a new one on the next device update.
+     */
+    enum class Status : unsigned char { Pending, Ready, Failed };
+    std::atomic<Status> mStatus{Status::Pending};
+    uint64_t mLastUse{};
+
+    ConvolutionFilter(const BufferStorage &storage, const uint devrate);
+
+    void prepare(const al::byte *samples);
+};
+
+ConvolutionFilter::ConvolutionFilter(const BufferStorage &storage, const uint devrate)
+    : mGeneration{storage.mGeneration}, mDeviceRate{devrate}
+    , mSegmentSize{ConvolveUpdateSamples}, mSource{storage}
+{
+    mNumChannels = ChannelsFromFmt(mSource.mChannels,
+        minu(mSource.mAmbiOrder, MaxConvolveAmbiOrder));
+    mResampledCount = static_cast<uint>(
+        (uint64_t{mSource.mSampleLen}*devrate + (mSource.mSampleRate-1)) / mSource.mSampleRate);
+
+    /* Calculate the number of segments needed to hold the impulse response
+     * (rounded up). Exclude one segment which gets applied as a time-domain
+     * FIR filter. Make sure at least one segment is allocated to simplify
+     * handling.
+     */
+    mNumConvolveSegs = (mResampledCount+(ConvolveUpdateSamples-1)) / ConvolveUpdateSamples;
+    mNumConvolveSegs = maxz(mNumConvolveSegs, 2) - 1;
+
+    mFilter.resize(mNumChannels, {});
+    mComplexData.resize(mNumConvolveSegs * mNumChannels * ConvolveUpdateSize, 0.0f);
+    mSize = mNumChannels * (sizeof(mFilter[0]) + mNumConvolveSegs*ConvolveUpdateSize*sizeof(float));
+}
+
+void ConvolutionFilter::prepare(const al::byte *samples)
+{
+    const auto bytesPerSample = BytesFromFmt(mSource.mType);
+    const auto realChannels = mSource.channelsFromFmt();
+
+    /* The impulse response needs to have the same sample rate as the input and
+     * output. The bsinc24 resampler is decent, but there is high-frequency
+     * attenation that some people may be able to pick up on. Since this is
+     * called very infrequently, go ahead and use the polyphase resampler.
+     */
+    PPhaseResampler resampler;
+    if(mDeviceRate != mSource.mSampleRate)
+        resampler.init(mSource.mSampleRate, mDeviceRate);
+
+    alignas(16) std::array<complex_d,ConvolveUpdateSize> fftbuffer{};
+    auto srcsamples = std::make_unique<double[]>(maxz(mSource.mSampleLen, mResampledCount));
+    for(size_t c{0};c < mNumChannels;++c)
+    {
+        /* Load the samples from the buffer, and resample to match the device. */
+        LoadSamples(srcsamples.get(), samples + bytesPerSample*c, realChannels, mSource.mType,
+            mSource.mSampleLen);
+        if(mDeviceRate != mSource.mSampleRate)
+            resampler.process(mSource.mSampleLen, srcsamples.get(), mResampledCount,
+                srcsamples.get());
+
+        /* Store the first segment's samples in reverse in the time-domain, to
+         * apply as a FIR filter.
+         */
+        const size_t first_size{minz(mResampledCount, ConvolveUpdateSamples)};
+        std::transform(srcsamples.get(), srcsamples.get()+first_size, mFilter[c].rbegin(),
+            [](const double d) noexcept -> float { return static_cast<float>(d); });
+
+        size_t done{first_size};
+        for(size_t s{0};s < mNumConvolveSegs;++s)
+        {
+            const size_t todo{minz(mResampledCount-done, ConvolveUpdateSamples)};
+
+            auto iter = std::copy_n(&srcsamples[done], todo, fftbuffer.begin());
+            done += todo;
+            std::fill(iter, fftbuffer.end(), complex_d{});
+
+            forward_fft(fftbuffer);
+
+            /* Store the bins as separate real and imaginary parts, with the
+             * Nyquist bin in place of the DC bin's imaginary part. Also apply
+             * the normalization for the inverse (real) FFT, which is scaled
+             * up by half the FFT size.
+             */
+            constexpr double scale{1.0 / double{ConvolveBins}};
+            float *RESTRICT filter{&mComplexData[(s*mNumChannels + c) * ConvolveUpdateSize]};
+            for(size_t i{0};i < ConvolveBins;++i)
+            {
+                filter[i] = static_cast<float>(fftbuffer[i].real() * scale);
+                filter[ConvolveBins+i] = static_cast<float>(fftbuffer[i].imag() * scale);
+            }
+            filter[ConvolveBins] = static_cast<float>(fftbuffer[ConvolveBins].real() * scale);
+        }
+    }
+}
+
+
+/* Filters are cached by the buffer data generation, device sample rate, and
+ * segment size. Filters in use are always kept, while unused ones are kept up
+ * to ConvolutionCacheSize bytes, dropping the least recently used first.
+ */
+class FilterCache {
+    std::mutex mLock;
+    std::vector<al::intrusive_ptr<ConvolutionFilter>> mFilters;
+    uint64_t mUseCount{0u};
+
+    void prune();
+
+public:
+    /* Returns the filter for the buffer, and whether it was newly created and
+     * needs to be prepared.
+     */
+    std::pair<al::intrusive_ptr<ConvolutionFilter>,bool> get(const BufferStorage &storage,
+        const uint devrate);
+
+    /* Releases a reference to a filter, which may leave it unused. */
+    void release(al::intrusive_ptr<ConvolutionFilter> &filter);
+
+    /* Removes a filter that failed to be prepared. */
+    void remove(const ConvolutionFilter *filter);
+};
+
+void FilterCache::prune()
+{
+    auto is_unused = [](const al::intrusive_ptr<ConvolutionFilter> &filter) noexcept -> bool
+    { return filter->ref_count() == 1; };
+
+    size_t unused_size{0u};
+    for(const auto &filter : mFilters)
+    {
+        if(is_unused(filter))
+            unused_size += filter->mSize;
+    }
+    while(unused_size > ConvolutionCacheSize)
+    {
+        auto oldest = mFilters.end();
+        for(auto iter = mFilters.begin();iter != mFilters.end();++iter)
+        {
+            if(is_unused(*iter) && (oldest == mFilters.end()
+                || (*iter)->mLastUse < (*oldest)->mLastUse))
+                oldest = iter;
+        }
+        unused_size -= (*oldest)->mSize;
+        mFilters.erase(oldest);
+    }
+}
+
+std::pair<al::intrusive_ptr<ConvolutionFilter>,bool> FilterCache::get(
+    const BufferStorage &storage, const uint devrate)
+{
+    std::lock_guard<std::mutex> _{mLock};
+    auto iter = std::find_if(mFilters.begin(), mFilters.end(),
+        [&storage,devrate](const al::intrusive_ptr<ConvolutionFilter> &filter) noexcept -> bool
+        {
+            return filter->mGeneration == storage.mGeneration && filter->mDeviceRate == devrate
+                && filter->mSegmentSize == ConvolveUpdateSamples;
+        });
+    if(iter != mFilters.end())
+    {
+        (*iter)->mLastUse = ++mUseCount;
+        return {*iter, false};
+    }
+
+    al::intrusive_ptr<ConvolutionFilter> filter{new ConvolutionFilter{storage, devrate}};
+    filter->mLastUse = ++mUseCount;
+    mFilters.emplace_back(filter);
+    prune();
+    return {std::move(filter), true};
+}
+
+void FilterCache::release(al::intrusive_ptr<ConvolutionFilter> &filter)
+{
+    std::lock_guard<std::mutex> _{mLock};
+    filter = nullptr;
+    prune();
+}
+
+void FilterCache::remove(const ConvolutionFilter *filter)
+{
+    std::lock_guard<std::mutex> _{mLock};
+    auto iter = std::find_if(mFilters.begin(), mFilters.end(),
+        [filter](const al::intrusive_ptr<ConvolutionFilter> &f) noexcept -> bool
+        { return f.get() == filter; });
+    if(iter != mFilters.end())
+        mFilters.erase(iter);
+}
+
+FilterCache &GetFilterCache()
+{
+    static FilterCache cache{};
+    return cache;
+}
+
+
+/* Prepares filters on a background thread, so setting a long impulse response
+ * doesn't stall the app. Effect states stay silent until their filter is
+ * ready.
+ */
+class FilterWorker {
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::deque<al::intrusive_ptr<ConvolutionFilter>> mQueue;
+    bool mQuit{false};
+    std::thread mThread;
+
+    void run();
+
+public:
+    ~FilterWorker();
+
+    /* Returns false if the worker thread can't be started. */
+    bool push(al::intrusive_ptr<ConvolutionFilter> filter);
+};
+
+void FilterWorker::run()
+{
+    althrd_setname("alsoft-convolve");
+
+    FPUCtl mixer_mode{};
+    std::unique_lock<std::mutex> lock{mLock};
+    while(1)
+    {
+        mCond.wait(lock, [this]() noexcept { return mQuit || !mQueue.empty(); });
+        if(mQuit) break;
+
+        al::intrusive_ptr<ConvolutionFilter> filter{std::move(mQueue.front())};
+        mQueue.pop_front();
+        lock.unlock();
+
+        try {
+            filter->prepare(filter->mSamples.data());
+            decltype(filter->mSamples){}.swap(filter->mSamples);
+            filter->mStatus.store(ConvolutionFilter::Status::Ready, std::memory_order_release);
+        }
+        catch(std::exception &e) {
+            ERR("Failed to prepare convolution filter: %s\n", e.what());
+            filter->mStatus.store(ConvolutionFilter::Status::Failed, std::memory_order_release);
+            GetFilterCache().remove(filter.get());
+        }
+        GetFilterCache().release(filter);
+
+        lock.lock();
+    }
+}
+
+FilterWorker::~FilterWorker()
+{
+    {
+        std::lock_guard<std::mutex> _{mLock};
+        mQuit = true;
+    }
+    mCond.notify_all();
+    if(mThread.joinable())
+        mThread.join();
+}
+
+bool FilterWorker::push(al::intrusive_ptr<ConvolutionFilter> filter)
+{
+    {
+        std::lock_guard<std::mutex> _{mLock};
+        if(!mThread.joinable())
+        {
+            try {
+                mThread = std::thread{std::mem_fn(&FilterWorker::run), this};
+            }
+            catch(std::exception &e) {
+                ERR("Failed to start convolution worker thread: %s\n", e.what());
+                return false;
+            }
+        }
+        mQueue.emplace_back(std::move(filter));
+    }
+    mCond.notify_one();
+    return true;
+}
+
+FilterWorker &GetFilterWorker()
+{
+    static FilterWorker worker{};
+    return worker;
+}
+
+
 struct ConvolutionState final : public EffectState {
     FmtChannels mChannels{};
     AmbiLayout mAmbiLayout{};
     AmbiScaling mAmbiScaling{};
     uint mAmbiOrder{};
 
+    /* True stereo processing uses two inputs, and mixes two outputs. */
+    bool mTrueStereo{false};
+    size_t mNumInputs{1};
+    size_t mNumOutputs{0};
+
     size_t mFifoPos{0};
-    std::array<float,ConvolveUpdateSamples*2> mInput{};
-    al::vector<std::array<float,ConvolveUpdateSamples>,16> mFilter;
+    alignas(16) std::array<std::array<float,ConvolveUpdateSamples*2>,MaxConvolveInputs> mInput{};
     al::vector<std::array<float,ConvolveUpdateSamples*2>,16> mOutput;
 
-    alignas(16) std::array<complex_d,ConvolveUpdateSize> mFftBuffer{};
+    alignas(16) std::array<std::complex<float>,ConvolveBins> mFftBuffer{};
 
     size_t mCurrentSegment{0};
     size_t mNumConvolveSegs{0};
@@ -201,11 +607,23 @@ struct ConvolutionState final : public EffectState {
     };
     using ChannelDataArray = al::FlexArray<ChannelData>;
     std::unique_ptr<ChannelDataArray> mChans;
-    std::unique_ptr<complex_d[]> mComplexData;
+
+    /* The FFT'd input segments, with each segment holding the bins of each
+     * input. And the accumulated bins of each output.
+     */
+    al::vector<float,16> mInputHistory;
+    al::vector<float,16> mAccumBins;
+
+    al::intrusive_ptr<ConvolutionFilter> mFilterData;
+    bool mFilterReady{false};
 
 
     ConvolutionState() = default;
-    ~ConvolutionState() override = default;
+    ~ConvolutionState() override
+    {
+        if(mFilterData)
+            GetFilterCache().release(mFilterData);
+    }
 
     void NormalMix(const al::span<FloatBufferLine> samplesOut, const size_t samplesToDo);
     void UpsampleMix(const al::span<FloatBufferLine> samplesOut, const size_t samplesToDo);
@@ -218,22 +636,32 @@ struct ConvolutionState final : public EffectState {
     void process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn,
         const al::span<FloatBufferLine> samplesOut) override;
 
+    /* The response is the first segment and the convolved segments, plus a
+     * segment of latency for the input FIFO.
+     */
+    size_t getTailLength() const noexcept override
+    { return mNumConvolveSegs ? (mNumConvolveSegs+2) * ConvolveUpdateSamples : 0; }
+
     DEF_NEWDEL(ConvolutionState)
 };
 
 void ConvolutionState::NormalMix(const al::span<FloatBufferLine> samplesOut,
     const size_t samplesToDo)
 {
-    for(auto &chan : *mChans)
+    for(size_t c{0};c < mNumOutputs;++c)
+    {
+        auto &chan = (*mChans)[c];
         MixSamples({chan.mBuffer.data(), samplesToDo}, samplesOut, chan.Current, chan.Target,
             samplesToDo, 0);
+    }
 }
 
 void ConvolutionState::UpsampleMix(const al::span<FloatBufferLine> samplesOut,
     const size_t samplesToDo)
 {
-    for(auto &chan : *mChans)
+    for(size_t c{0};c < mNumOutputs;++c)
     {
+        auto &chan = (*mChans)[c];
         const al::span<float> src{chan.mBuffer.data(), samplesToDo};
         chan.mFilter.processHfScale(src, chan.mHfScale);
         MixSamples(src, samplesOut, chan.Current, chan.Target, samplesToDo, 0);
@@ -243,103 +671,103 @@ void ConvolutionState::UpsampleMix(const al::span<FloatBufferLine> samplesOut,
 
 void ConvolutionState::deviceUpdate(const DeviceBase *device, const Buffer &buffer)
 {
-    constexpr uint MaxConvolveAmbiOrder{1u};
+    mTrueStereo = false;
+    mNumInputs = 1;
+    mNumOutputs = 0;
 
     mFifoPos = 0;
-    mInput.fill(0.0f);
-    decltype(mFilter){}.swap(mFilter);
+    for(auto &input : mInput)
+        input.fill(0.0f);
     decltype(mOutput){}.swap(mOutput);
-    mFftBuffer.fill(complex_d{});
+    mFftBuffer.fill(std::complex<float>{});
 
     mCurrentSegment = 0;
     mNumConvolveSegs = 0;
 
     mChans = nullptr;
-    mComplexData = nullptr;
+    decltype(mInputHistory){}.swap(mInputHistory);
+    decltype(mAccumBins){}.swap(mAccumBins);
+
+    if(mFilterData)
+        GetFilterCache().release(mFilterData);
+    mFilterReady = false;
 
     /* An empty buffer doesn't need a convolution filter. */
     if(!buffer.storage || buffer.storage->mSampleLen < 1) return;
 
-    constexpr size_t m{ConvolveUpdateSize/2 + 1};
-    auto bytesPerSample = BytesFromFmt(buffer.storage->mType);
-    auto realChannels = ChannelsFromFmt(buffer.storage->mChannels, buffer.storage->mAmbiOrder);
-    auto numChannels = ChannelsFromFmt(buffer.storage->mChannels,
-        minu(buffer.storage->mAmbiOrder, MaxConvolveAmbiOrder));
+    /* Get the shared filter for this buffer, preparing it if it's new. */
+    auto cached = GetFilterCache().get(*buffer.storage, device->Frequency);
+    mFilterData = std::move(cached.first);
+    if(cached.second)
+    {
+        bool queued{false};
+        if(ConvolutionAsyncLoad)
+        {
+            const size_t datalen{size_t{buffer.storage->mSampleLen} *
+                buffer.storage->frameSizeFromFmt()};
+            mFilterData->mSamples.assign(buffer.samples.begin(),
+                buffer.samples.begin()+static_cast<ptrdiff_t>(datalen));
+            queued = GetFilterWorker().push(mFilterData);
+        }
+        if(!queued)
+        {
+            try {
+                mFilterData->prepare(buffer.samples.data());
+            }
+            catch(std::exception &e) {
+                /* Like on the worker thread, mark the filter as failed so any
+                 * other state that already got it stops waiting on it, and
+                 * bypass the effect.
+                 */
+                ERR("Failed to prepare convolution filter: %s\n", e.what());
+                mFilterData->mStatus.store(ConvolutionFilter::Status::Failed,
+                    std::memory_order_release);
+                GetFilterCache().remove(mFilterData.get());
+                GetFilterCache().release(mFilterData);
+                return;
+            }
+            mFilterData->mStatus.store(ConvolutionFilter::Status::Ready,
+                std::memory_order_release);
+        }
+    }
+    else if(mFilterData->mStatus.load(std::memory_order_acquire)
+        == ConvolutionFilter::Status::Failed)
+    {
+        /* The filter failed to prepare after being found, so bypass it. */
+        GetFilterCache().release(mFilterData);
+        return;
+    }
+
+    const size_t numChannels{mFilterData->mNumChannels};
 
     mChans = ChannelDataArray::Create(numChannels);
 
-    /* The impulse response needs to have the same sample rate as the input and
-     * output. The bsinc24 resampler is decent, but there is high-frequency
-     * attenation that some people may be able to pick up on. Since this is
-     * called very infrequently, go ahead and use the polyphase resampler.
-     */
-    PPhaseResampler resampler;
-    if(device->Frequency != buffer.storage->mSampleRate)
-        resampler.init(buffer.storage->mSampleRate, device->Frequency);
-    const auto resampledCount = static_cast<uint>(
-        (uint64_t{buffer.storage->mSampleLen}*device->Frequency+(buffer.storage->mSampleRate-1)) /
-        buffer.storage->mSampleRate);
-
     const BandSplitter splitter{device->mXOverFreq / static_cast<float>(device->Frequency)};
     for(auto &e : *mChans)
         e.mFilter = splitter;
 
-    mFilter.resize(numChannels, {});
+    mNumOutputs = numChannels;
     mOutput.resize(numChannels, {});
+    mAccumBins.resize(numChannels * ConvolveUpdateSize, 0.0f);
 
-    /* Calculate the number of segments needed to hold the impulse response and
-     * the input history (rounded up), and allocate them. Exclude one segment
-     * which gets applied as a time-domain FIR filter. Make sure at least one
-     * segment is allocated to simplify handling.
+    /* The input history holds as many segments as the filter. Four-channel
+     * impulse responses may be used as true stereo, which needs a second
+     * input.
      */
-    mNumConvolveSegs = (resampledCount+(ConvolveUpdateSamples-1)) / ConvolveUpdateSamples;
-    mNumConvolveSegs = maxz(mNumConvolveSegs, 2) - 1;
-
-    const size_t complex_length{mNumConvolveSegs * m * (numChannels+1)};
-    mComplexData = std::make_unique<complex_d[]>(complex_length);
-    std::fill_n(mComplexData.get(), complex_length, complex_d{});
+    if(buffer.storage->mChannels == FmtQuad)
+        mNumInputs = 2;
+    mNumConvolveSegs = mFilterData->mNumConvolveSegs;
+    mInputHistory.resize(mNumConvolveSegs * mNumInputs * ConvolveUpdateSize, 0.0f);
 
     mChannels = buffer.storage->mChannels;
     mAmbiLayout = buffer.storage->mAmbiLayout;
     mAmbiScaling = buffer.storage->mAmbiScaling;
     mAmbiOrder = minu(buffer.storage->mAmbiOrder, MaxConvolveAmbiOrder);
-
-    auto srcsamples = std::make_unique<double[]>(maxz(buffer.storage->mSampleLen, resampledCount));
-    complex_d *filteriter = mComplexData.get() + mNumConvolveSegs*m;
-    for(size_t c{0};c < numChannels;++c)
-    {
-        /* Load the samples from the buffer, and resample to match the device. */
-        LoadSamples(srcsamples.get(), buffer.samples.data() + bytesPerSample*c, realChannels,
-            buffer.storage->mType, buffer.storage->mSampleLen);
-        if(device->Frequency != buffer.storage->mSampleRate)
-            resampler.process(buffer.storage->mSampleLen, srcsamples.get(), resampledCount,
-                srcsamples.get());
-
-        /* Store the first segment's samples in reverse in the time-domain, to
-         * apply as a FIR filter.
-         */
-        const size_t first_size{minz(resampledCount, ConvolveUpdateSamples)};
-        std::transform(srcsamples.get(), srcsamples.get()+first_size, mFilter[c].rbegin(),
-            [](const double d) noexcept -> float { return static_cast<float>(d); });
-
-        size_t done{first_size};
-        for(size_t s{0};s < mNumConvolveSegs;++s)
-        {
-            const size_t todo{minz(resampledCount-done, ConvolveUpdateSamples)};
-
-            auto iter = std::copy_n(&srcsamples[done], todo, mFftBuffer.begin());
-            done += todo;
-            std::fill(iter, mFftBuffer.end(), complex_d{});
-
-            forward_fft(mFftBuffer);
-            filteriter = std::copy_n(mFftBuffer.cbegin(), m, filteriter);
-        }
-    }
 }
 
 
 void ConvolutionState::update(const ContextBase *context, const EffectSlot *slot,
-    const EffectProps* /*props*/, const EffectTarget target)
+    const EffectProps *props, const EffectTarget target)
 {
     /* NOTE: Stereo and Rear are slightly different from normal mixing (as
      * defined in alu.cpp). These are 45 degrees from center, rather than the
@@ -391,6 +819,21 @@ void ConvolutionState::update(const ContextBase *context, const EffectSlot *slot
     if(mNumConvolveSegs < 1)
         return;
 
+    const bool truestereo{props->Convolution.TrueStereo && mChannels == FmtQuad};
+    if(truestereo != mTrueStereo)
+    {
+        /* Clear the inputs and history when switching, since the second input
+         * isn't kept otherwise.
+         */
+        mTrueStereo = truestereo;
+        mNumOutputs = mTrueStereo ? 2 : mChans->size();
+        for(auto &input : mInput)
+            input.fill(0.0f);
+        std::fill(mInputHistory.begin(), mInputHistory.end(), 0.0f);
+        for(auto &output : mOutput)
+            output.fill(0.0f);
+    }
+
     mMix = &ConvolutionState::NormalMix;
 
     for(auto &chan : *mChans)
@@ -463,6 +906,10 @@ void ConvolutionState::update(const ContextBase *context, const EffectSlot *slot
             break;
         }
 
+        /* True stereo only has left and right outputs. */
+        if(mTrueStereo)
+            chanmap = StereoMap;
+
         mOutTarget = target.Main->Buffer;
         if(device->mRenderMode == RenderMode::Pairwise)
         {
@@ -497,29 +944,72 @@ void ConvolutionState::process(const size_t samplesToDo,
 {
     if(mNumConvolveSegs < 1)
         return;
+    if(!mFilterReady)
+    {
+        /* Stay silent until the filter is prepared. If it failed, bypass the
+         * effect until the next device update tries again. The reference is
+         * released then, since that can't be done here.
+         */
+        const auto status = mFilterData->mStatus.load(std::memory_order_acquire);
+        if(status != ConvolutionFilter::Status::Ready)
+        {
+            if(status == ConvolutionFilter::Status::Failed)
+                mNumConvolveSegs = 0;
+            return;
+        }
+        mFilterReady = true;
+    }
 
-    constexpr size_t m{ConvolveUpdateSize/2 + 1};
     size_t curseg{mCurrentSegment};
     auto &chans = *mChans;
+    const ConvolutionFilter &filterdata = *mFilterData;
+    const size_t numChannels{filterdata.mNumChannels};
+
+    /* With true stereo, the four impulse response channels are the left input
+     * to the left and right outputs, then the right input to the left and
+     * right outputs. Otherwise, each channel is the single input to its own
+     * output.
+     */
+    auto input_index = [this](const size_t c) noexcept -> size_t
+    { return mTrueStereo ? c>>1 : 0; };
+    auto output_index = [this](const size_t c) noexcept -> size_t
+    { return mTrueStereo ? c&1 : c; };
 
     for(size_t base{0u};base < samplesToDo;)
     {
         const size_t todo{minz(ConvolveUpdateSamples-mFifoPos, samplesToDo-base)};
 
-        std::copy_n(samplesIn[0].begin() + base, todo,
-            mInput.begin()+ConvolveUpdateSamples+mFifoPos);
+        if(!mTrueStereo)
+            std::copy_n(samplesIn[0].begin() + base, todo,
+                mInput[0].begin()+ConvolveUpdateSamples+mFifoPos);
+        else
+        {
+            /* Virtual cardioids facing left and right, from the first-order
+             * (N3D-scaled) W and Y channels.
+             */
+            constexpr float ygain{1.0f / al::numbers::sqrt3_v<float>};
+            const float *RESTRICT w{samplesIn[0].data() + base};
+            const float *RESTRICT y{samplesIn[1].data() + base};
+            float *RESTRICT left{mInput[0].data() + ConvolveUpdateSamples+mFifoPos};
+            float *RESTRICT right{mInput[1].data() + ConvolveUpdateSamples+mFifoPos};
+            for(size_t i{0};i < todo;++i)
+            {
+                left[i] = w[i] + y[i]*ygain;
+                right[i] = w[i] - y[i]*ygain;
+            }
+        }
 
-        /* Apply the FIR for the newly retrieved input samples, and combine it
-         * with the inverse FFT'd output samples.
+        /* Combine the inverse FFT'd output samples with the FIR applied to the
+         * newly retrieved input samples.
          */
-        for(size_t c{0};c < chans.size();++c)
+        for(size_t c{0};c < mNumOutputs;++c)
+            std::copy_n(mOutput[c].begin()+mFifoPos, todo, chans[c].mBuffer.begin()+base);
+        for(size_t c{0};c < numChannels;++c)
         {
-            auto buf_iter = chans[c].mBuffer.begin() + base;
-            apply_fir({std::addressof(*buf_iter), todo}, mInput.data()+1 + mFifoPos,
-                mFilter[c].data());
-
-            auto fifo_iter = mOutput[c].begin() + mFifoPos;
-            std::transform(fifo_iter, fifo_iter+todo, buf_iter, buf_iter, std::plus<>{});
+            const size_t in{input_index(c)};
+            const size_t out{output_index(c)};
+            apply_fir({chans[out].mBuffer.data()+base, todo}, mInput[in].data()+1 + mFifoPos,
+                filterdata.mFilter[c].data());
         }
 
         mFifoPos += todo;
@@ -529,63 +1019,78 @@ void ConvolutionState::process(const size_t samplesToDo,
         if(mFifoPos < ConvolveUpdateSamples) break;
         mFifoPos = 0;
 
-        /* Move the newest input to the front for the next iteration's history. */
-        std::copy(mInput.cbegin()+ConvolveUpdateSamples, mInput.cend(), mInput.begin());
-
-        /* Calculate the frequency domain response and add the relevant
-         * frequency bins to the FFT history.
-         */
-        auto fftiter = std::copy_n(mInput.cbegin(), ConvolveUpdateSamples, mFftBuffer.begin());
-        std::fill(fftiter, mFftBuffer.end(), complex_d{});
-        forward_fft(mFftBuffer);
-
-        std::copy_n(mFftBuffer.cbegin(), m, &mComplexData[curseg*m]);
-
-        const complex_d *RESTRICT filter{mComplexData.get() + mNumConvolveSegs*m};
-        for(size_t c{0};c < chans.size();++c)
+        const size_t numInputs{mTrueStereo ? 2u : 1u};
+        for(size_t i{0};i < numInputs;++i)
         {
-            std::fill_n(mFftBuffer.begin(), m, complex_d{});
+            auto &input = mInput[i];
 
-            /* Convolve each input segment with its IR filter counterpart
-             * (aligned in time).
+            /* Move the newest input to the front for the next iteration's
+             * history.
              */
-            const complex_d *RESTRICT input{&mComplexData[curseg*m]};
-            for(size_t s{curseg};s < mNumConvolveSegs;++s)
+            std::copy(input.cbegin()+ConvolveUpdateSamples, input.cend(), input.begin());
+
+            /* Calculate the frequency domain response (with a real FFT, packing
+             * even and odd samples into the real and imaginary parts), and add
+             * the bins to the FFT history.
+             */
+            for(size_t j{0};j < ConvolveUpdateSamples/2;++j)
+                mFftBuffer[j] = std::complex<float>{input[j*2], input[j*2 + 1]};
+            std::fill(mFftBuffer.begin()+ConvolveUpdateSamples/2, mFftBuffer.end(),
+                std::complex<float>{});
+            forward_real_fft(mFftBuffer);
+
+            float *RESTRICT history{&mInputHistory[(curseg*mNumInputs + i) * ConvolveUpdateSize]};
+            for(size_t j{0};j < ConvolveBins;++j)
             {
-                for(size_t i{0};i < m;++i,++input,++filter)
-                    mFftBuffer[i] += *input * *filter;
+                history[j] = mFftBuffer[j].real();
+                history[ConvolveBins+j] = mFftBuffer[j].imag();
             }
-            input = mComplexData.get();
-            for(size_t s{0};s < curseg;++s)
+        }
+
+        /* Convolve each input segment with its IR filter counterpart (aligned
+         * in time), for all channels of the filter together.
+         */
+        std::fill_n(mAccumBins.begin(), mNumOutputs*ConvolveUpdateSize, 0.0f);
+        const float *RESTRICT filter{filterdata.mComplexData.data()};
+        size_t seg{curseg};
+        for(size_t s{0};s < mNumConvolveSegs;++s)
+        {
+            const float *RESTRICT input{&mInputHistory[seg*mNumInputs * ConvolveUpdateSize]};
+            for(size_t c{0};c < numChannels;++c)
             {
-                for(size_t i{0};i < m;++i,++input,++filter)
-                    mFftBuffer[i] += *input * *filter;
+                apply_mac(&mAccumBins[output_index(c) * ConvolveUpdateSize],
+                    input + input_index(c)*ConvolveUpdateSize, filter);
+                filter += ConvolveUpdateSize;
             }
+            if(++seg == mNumConvolveSegs)
+                seg = 0;
+        }
 
-            /* Reconstruct the mirrored/negative frequencies to do a proper
-             * inverse FFT.
-             */
-            for(size_t i{m};i < ConvolveUpdateSize;++i)
-                mFftBuffer[i] = std::conj(mFftBuffer[ConvolveUpdateSize-i]);
-
+        for(size_t c{0};c < mNumOutputs;++c)
+        {
             /* Apply iFFT to get the 256 (really 255) samples for output. The
              * 128 output samples are combined with the last output's 127
              * second-half samples (and this output's second half is
-             * subsequently saved for next time).
+             * subsequently saved for next time). The filter is pre-scaled to
+             * normalize the output.
              */
-            inverse_fft(mFftBuffer);
+            const float *RESTRICT accum{&mAccumBins[c * ConvolveUpdateSize]};
+            for(size_t i{0};i < ConvolveBins;++i)
+                mFftBuffer[i] = std::complex<float>{accum[i], accum[ConvolveBins+i]};
+            inverse_real_fft(mFftBuffer);
 
-            /* The iFFT'd response is scaled up by the number of bins, so apply
-             * the inverse to normalize the output.
-             */
-            for(size_t i{0};i < ConvolveUpdateSamples;++i)
-                mOutput[c][i] =
-                    static_cast<float>(mFftBuffer[i].real() * (1.0/double{ConvolveUpdateSize})) +
-                    mOutput[c][ConvolveUpdateSamples+i];
-            for(size_t i{0};i < ConvolveUpdateSamples;++i)
-                mOutput[c][ConvolveUpdateSamples+i] =
-                    static_cast<float>(mFftBuffer[ConvolveUpdateSamples+i].real() *
-                        (1.0/double{ConvolveUpdateSize}));
+            auto &output = mOutput[c];
+            for(size_t i{0};i < ConvolveUpdateSamples/2;++i)
+            {
+                output[i*2] = mFftBuffer[i].real() + output[ConvolveUpdateSamples + i*2];
+                output[i*2 + 1] = mFftBuffer[i].imag() + output[ConvolveUpdateSamples + i*2+1];
+            }
+            for(size_t i{0};i < ConvolveUpdateSamples/2;++i)
+            {
+                const auto &val = mFftBuffer[ConvolveUpdateSamples/2 + i];
+                output[ConvolveUpdateSamples + i*2] = val.real();
+                output[ConvolveUpdateSamples + i*2 + 1] = val.imag();
+            }
         }
 
         /* Shift the input history. */
@@ -605,6 +1110,9 @@ struct ConvolutionStateFactory final : public EffectStateFactory {
 
 } // namespace
 
+bool ConvolutionAsyncLoad{false};
+size_t ConvolutionCacheSize{64u * 1024u * 1024u};
+
 EffectStateFactory *ConvolutionStateFactory_getFactory()
 {
     static ConvolutionStateFactory ConvolutionFactory{};
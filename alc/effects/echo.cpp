@@ -48,6 +48,8 @@ using uint = unsigned int;
 
 constexpr float LowpassFreqRef{5000.0f};
 
+constexpr char EchoBatchKey{};
+
 struct EchoState final : public EffectState {
     al::vector<float,16> mSampleBuffer;
 
@@ -64,10 +66,18 @@ struct EchoState final : public EffectState {
         float Target[MAX_OUTPUT_CHANNELS]{};
     } mGains[2];
 
+    /* The slot gain, applied separately from the panning gains. */
+    struct {
+        float Current{0.0f};
+        float Target{0.0f};
+    } mSlotGain;
+
     BiquadFilter mFilter;
     float mFeedGain{0.0f};
 
-    alignas(16) float mTempBuffer[2][BufferLineSize];
+    alignas(16) float mTemps[2][BufferLineSize];
+
+    void processTaps(const float *RESTRICT input, const size_t samplesToDo);
 
     void deviceUpdate(const DeviceBase *device, const Buffer &buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
@@ -75,6 +85,12 @@ struct EchoState final : public EffectState {
     void process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn,
         const al::span<FloatBufferLine> samplesOut) override;
 
+    size_t getTailLength() const noexcept override;
+
+    const void *getBatchKey() const noexcept override { return &EchoBatchKey; }
+    void processBatch(const size_t samplesToDo, const al::span<const EffectBatchItem> items)
+        override;
+
     DEF_NEWDEL(EchoState)
 };
 
@@ -95,6 +111,8 @@ void EchoState::deviceUpdate(const DeviceBase *Device, const Buffer&)
         std::fill(std::begin(e.Current), std::end(e.Current), 0.0f);
         std::fill(std::begin(e.Target), std::end(e.Target), 0.0f);
     }
+    mSlotGain.Current = 0.0f;
+    mSlotGain.Target = 0.0f;
 }
 
 void EchoState::update(const ContextBase *context, const EffectSlot *slot,
@@ -118,11 +136,21 @@ void EchoState::update(const ContextBase *context, const EffectSlot *slot,
     const auto coeffs1 = CalcAngleCoeffs( angle, 0.0f, 0.0f);
 
     mOutTarget = target.Main->Buffer;
-    ComputePanGains(target.Main, coeffs0.data(), slot->Gain, mGains[0].Target);
-    ComputePanGains(target.Main, coeffs1.data(), slot->Gain, mGains[1].Target);
+    ComputePanGains(target.Main, coeffs0.data(), 1.0f, mGains[0].Target);
+    ComputePanGains(target.Main, coeffs1.data(), 1.0f, mGains[1].Target);
+    mSlotGain.Target = slot->Gain;
 }
 
-void EchoState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
+size_t EchoState::getTailLength() const noexcept
+{
+    /* The second tap feeds back into the delay line. */
+    const size_t feedtail{CalcFeedbackTail(mTap[1].delay, mFeedGain)};
+    if(feedtail == InfiniteEffectTail)
+        return InfiniteEffectTail;
+    return feedtail + mTap[1].delay;
+}
+
+void EchoState::processTaps(const float *RESTRICT input, const size_t samplesToDo)
 {
     const size_t mask{mSampleBuffer.size()-1};
     float *RESTRICT delaybuf{mSampleBuffer.data()};
@@ -144,14 +172,14 @@ void EchoState::process(const size_t samplesToDo, const al::span<const FloatBuff
         size_t td{minz(mask+1 - maxz(offset, maxz(tap1, tap2)), samplesToDo-i)};
         do {
             /* Feed the delay buffer's input first. */
-            delaybuf[offset] = samplesIn[0][i];
+            delaybuf[offset] = input[i];
 
             /* Get delayed output from the first and second taps. Use the
              * second tap for feedback.
              */
-            mTempBuffer[0][i] = delaybuf[tap1++];
-            mTempBuffer[1][i] = delaybuf[tap2++];
-            const float feedb{mTempBuffer[1][i++]};
+            mTemps[0][i] = delaybuf[tap1++];
+            mTemps[1][i] = delaybuf[tap2++];
+            const float feedb{mTemps[1][i++]};
 
             /* Add feedback to the delay buffer with damping and attenuation. */
             delaybuf[offset++] += filter.processOne(feedb, z1, z2) * mFeedGain;
@@ -159,10 +187,20 @@ void EchoState::process(const size_t samplesToDo, const al::span<const FloatBuff
     }
     mFilter.setComponents(z1, z2);
     mOffset = offset;
+}
+
+void EchoState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
+{
+    const EffectBatchItem item{this, samplesIn, samplesOut};
+    processBatch(samplesToDo, {&item, 1});
+}
+
+void EchoState::processBatch(const size_t samplesToDo, const al::span<const EffectBatchItem> items)
+{
+    for(const EffectBatchItem &item : items)
+        static_cast<EchoState*>(item.State)->processTaps(item.SamplesIn[0].data(), samplesToDo);
 
-    for(size_t c{0};c < 2;c++)
-        MixSamples({mTempBuffer[c], samplesToDo}, samplesOut, mGains[c].Current, mGains[c].Target,
-            samplesToDo, 0);
+    MixBatchedTaps<EchoState>(items, samplesToDo, samplesToDo, 0);
 }
 
 
@@ -26,6 +26,8 @@ struct NullState final : public EffectState {
     void process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn,
         const al::span<FloatBufferLine> samplesOut) override;
 
+    size_t getTailLength() const noexcept override;
+
     DEF_NEWDEL(NullState)
 };
 
@@ -66,6 +68,13 @@ void NullState::process(const size_t/*samplesToDo*/,
 {
 }
 
+/* This returns how many samples the effect keeps producing output for after
+ * its input goes silent. The slot stops processing the effect once its input
+ * has been silent for longer.
+ */
+size_t NullState::getTailLength() const noexcept
+{ return 0; }
+
 
 struct NullStateFactory final : public EffectStateFactory {
     al::intrusive_ptr<EffectState> create() override;
@@ -26,6 +26,13 @@
 #include <complex>
 #include <cstdlib>
 #include <iterator>
+#include <limits>
+
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "alc/effects/base.h"
 #include "alcomplex.h"
@@ -40,61 +47,407 @@
 #include "core/mixer.h"
 #include "core/mixer/defs.h"
 #include "intrusive_ptr.h"
+#include "vector.h"
 
 struct ContextBase;
 
 
+/* These are user config options for selecting the pitch shifter's processing
+ * mode, and the STFT mode's transform size and overlap.
+ */
+PshifterMode PshifterProcessMode{PshifterMode::Stft};
+unsigned int PshifterFftSize{1024};
+unsigned int PshifterOverlap{4};
+
 namespace {
 
 using uint = unsigned int;
-using complex_d = std::complex<double>;
+using complex_f = std::complex<float>;
+
+constexpr float Pi{al::numbers::pi_v<float>};
+constexpr float HalfPi{al::numbers::pi_v<float> * 0.5f};
+constexpr float TwoPi{al::numbers::pi_v<float> * 2.0f};
+constexpr float InvTwoPi{al::numbers::inv_pi_v<float> * 0.5f};
+
+/* Time-domain mode timing, in milliseconds. Splices are crossfaded over the
+ * fade length, and jump between JumpMin and JumpMax (searched for the best
+ * match, covering a pitch period down to about 80hz).
+ */
+constexpr float PsolaFadeMs{5.0f};
+constexpr float PsolaJumpMinMs{6.0f};
+constexpr float PsolaJumpMaxMs{18.0f};
+constexpr size_t PsolaMinDelay{2};
+
+/* The STFT mode's overlapping windows sum to a gain of 1.5, so match it. */
+constexpr float PsolaGain{1.5f};
+
 
-#define STFT_SIZE      1024
-#define STFT_HALF_SIZE (STFT_SIZE>>1)
-#define OVERSAMP       (1<<2)
+/* The phase vocoder's per-bin math, using approximations accurate enough for
+ * the phase tracking. atan2 has an error under 1e-5 radians (from Abramowitz
+ * and Stegun, 4.4.47), and sin/cos take an input wrapped to +/-pi and are
+ * accurate to within a few ulp.
+ */
+inline float approx_atan2(const float y, const float x) noexcept
+{
+    const float ax{std::abs(x)}, ay{std::abs(y)};
+    const float a{std::min(ax, ay) / std::max(std::max(ax, ay),
+        std::numeric_limits<float>::min())};
+    const float s{a * a};
+    float r{((((0.0208351f*s - 0.0851330f)*s + 0.1801410f)*s - 0.3302995f)*s + 0.9998660f) * a};
+    if(ay > ax) r = HalfPi - r;
+    if(x < 0.0f) r = Pi - r;
+    return std::copysign(r, y);
+}
+
+inline float wrap_phase(const float x) noexcept
+{ return x - TwoPi*std::round(x * InvTwoPi); }
 
-#define STFT_STEP    (STFT_SIZE / OVERSAMP)
-#define FIFO_LATENCY (STFT_STEP * (OVERSAMP-1))
+inline void approx_sincos(float x, float *sn, float *cs) noexcept
+{
+    /* Reflect into +/-pi/2, where cos flips sign. */
+    float sign{1.0f};
+    if(x > HalfPi) { x = Pi - x; sign = -1.0f; }
+    else if(x < -HalfPi) { x = -Pi - x; sign = -1.0f; }
+    const float s{x * x};
+    *sn = x + x*s*(-1.66666667e-1f + s*(8.33333333e-3f + s*(-1.98412698e-4f +
+        s*(2.75573192e-6f + s*-2.50521084e-8f))));
+    *cs = sign * (1.0f + s*(-0.5f + s*(4.16666667e-2f + s*(-1.38888889e-3f +
+        s*(2.48015873e-5f + s*(-2.75573192e-7f + s*2.08767570e-9f))))));
+}
 
-/* Define a Hann window, used to filter the STFT input and output. */
-std::array<double,STFT_SIZE> InitHannWindow()
+
+/* Converts each bin from real and imaginary parts to amplitude and frequency
+ * (in bins), in place. count must be a multiple of 4.
+ */
+void AnalyzeBins(float *RESTRICT re_amp, float *RESTRICT im_freq, float *RESTRICT lastPhase,
+    const float *RESTRICT binPhase, const size_t count, const float expected)
 {
-    std::array<double,STFT_SIZE> ret;
-    /* Create lookup table of the Hann window for the desired size, i.e. STFT_SIZE */
-    for(size_t i{0};i < STFT_SIZE>>1;i++)
+    const float invexpected{1.0f / expected};
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 signmask{_mm_set1_ps(-0.0f)};
+    const __m128 fltmin4{_mm_set1_ps(std::numeric_limits<float>::min())};
+    const __m128 halfpi4{_mm_set1_ps(HalfPi)};
+    const __m128 pi4{_mm_set1_ps(Pi)};
+    const __m128 twopi4{_mm_set1_ps(TwoPi)};
+    const __m128 invtwopi4{_mm_set1_ps(InvTwoPi)};
+    /* Adding and subtracting 1.5*2^23 rounds to the nearest integer. */
+    const __m128 round4{_mm_set1_ps(12582912.0f)};
+    const __m128 invexpected4{_mm_set1_ps(invexpected)};
+    __m128 bin4{_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)};
+    for(size_t k{0};k < count;k+=4)
     {
-        constexpr double scale{al::numbers::pi / double{STFT_SIZE}};
-        const double val{std::sin(static_cast<double>(i+1) * scale)};
-        ret[i] = ret[STFT_SIZE-1-i] = val * val;
+        const __m128 re{_mm_load_ps(&re_amp[k])};
+        const __m128 im{_mm_load_ps(&im_freq[k])};
+
+        const __m128 amp{_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)))};
+
+        const __m128 ax{_mm_andnot_ps(signmask, re)};
+        const __m128 ay{_mm_andnot_ps(signmask, im)};
+        const __m128 a{_mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), fltmin4))};
+        const __m128 s{_mm_mul_ps(a, a)};
+        __m128 r{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.0208351f), s), _mm_set1_ps(-0.0851330f))};
+        r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.1801410f));
+        r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(-0.3302995f));
+        r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.9998660f));
+        r = _mm_mul_ps(r, a);
+        __m128 mask{_mm_cmpgt_ps(ay, ax)};
+        r = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(halfpi4, r)), _mm_andnot_ps(mask, r));
+        mask = _mm_cmplt_ps(re, _mm_setzero_ps());
+        r = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(pi4, r)), _mm_andnot_ps(mask, r));
+        const __m128 phase{_mm_or_ps(r, _mm_and_ps(signmask, im))};
+
+        __m128 tmp{_mm_sub_ps(_mm_sub_ps(phase, _mm_load_ps(&lastPhase[k])),
+            _mm_load_ps(&binPhase[k]))};
+        __m128 wraps{_mm_mul_ps(tmp, invtwopi4)};
+        wraps = _mm_sub_ps(_mm_add_ps(wraps, round4), round4);
+        tmp = _mm_sub_ps(tmp, _mm_mul_ps(wraps, twopi4));
+
+        _mm_store_ps(&lastPhase[k], phase);
+        _mm_store_ps(&re_amp[k], amp);
+        _mm_store_ps(&im_freq[k], _mm_add_ps(bin4, _mm_mul_ps(tmp, invexpected4)));
+        bin4 = _mm_add_ps(bin4, _mm_set1_ps(4.0f));
     }
-    return ret;
+
+#elif defined(HAVE_NEON)
+
+    const uint32x4_t signmask{vdupq_n_u32(0x80000000u)};
+    const float32x4_t fltmin4{vdupq_n_f32(std::numeric_limits<float>::min())};
+    const float32x4_t halfpi4{vdupq_n_f32(HalfPi)};
+    const float32x4_t pi4{vdupq_n_f32(Pi)};
+    const float32x4_t twopi4{vdupq_n_f32(TwoPi)};
+    const float32x4_t invtwopi4{vdupq_n_f32(InvTwoPi)};
+    const float32x4_t round4{vdupq_n_f32(12582912.0f)};
+    const float32x4_t invexpected4{vdupq_n_f32(invexpected)};
+    alignas(16) static constexpr float bins[4]{0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t bin4{vld1q_f32(bins)};
+    for(size_t k{0};k < count;k+=4)
+    {
+        const float32x4_t re{vld1q_f32(&re_amp[k])};
+        const float32x4_t im{vld1q_f32(&im_freq[k])};
+
+        /* No vector sqrt or divide on 32-bit NEON, so refine the reciprocal
+         * estimates instead.
+         */
+        const float32x4_t mag2{vmlaq_f32(vmulq_f32(re, re), im, im)};
+        float32x4_t rsqrt{vrsqrteq_f32(vmaxq_f32(mag2, fltmin4))};
+        rsqrt = vmulq_f32(rsqrt, vrsqrtsq_f32(vmulq_f32(mag2, rsqrt), rsqrt));
+        rsqrt = vmulq_f32(rsqrt, vrsqrtsq_f32(vmulq_f32(mag2, rsqrt), rsqrt));
+        const float32x4_t amp{vmulq_f32(mag2, rsqrt)};
+
+        const float32x4_t ax{vabsq_f32(re)};
+        const float32x4_t ay{vabsq_f32(im)};
+        const float32x4_t den{vmaxq_f32(vmaxq_f32(ax, ay), fltmin4)};
+        float32x4_t recip{vrecpeq_f32(den)};
+        recip = vmulq_f32(recip, vrecpsq_f32(den, recip));
+        recip = vmulq_f32(recip, vrecpsq_f32(den, recip));
+        const float32x4_t a{vmulq_f32(vminq_f32(ax, ay), recip)};
+        const float32x4_t s{vmulq_f32(a, a)};
+        float32x4_t r{vmlaq_f32(vdupq_n_f32(-0.0851330f), vdupq_n_f32(0.0208351f), s)};
+        r = vmlaq_f32(vdupq_n_f32(0.1801410f), r, s);
+        r = vmlaq_f32(vdupq_n_f32(-0.3302995f), r, s);
+        r = vmlaq_f32(vdupq_n_f32(0.9998660f), r, s);
+        r = vmulq_f32(r, a);
+        r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(halfpi4, r), r);
+        r = vbslq_f32(vcltq_f32(re, vdupq_n_f32(0.0f)), vsubq_f32(pi4, r), r);
+        const float32x4_t phase{vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(r),
+            vandq_u32(signmask, vreinterpretq_u32_f32(im))))};
+
+        float32x4_t tmp{vsubq_f32(vsubq_f32(phase, vld1q_f32(&lastPhase[k])),
+            vld1q_f32(&binPhase[k]))};
+        float32x4_t wraps{vmulq_f32(tmp, invtwopi4)};
+        wraps = vsubq_f32(vaddq_f32(wraps, round4), round4);
+        tmp = vmlsq_f32(tmp, wraps, twopi4);
+
+        vst1q_f32(&lastPhase[k], phase);
+        vst1q_f32(&re_amp[k], amp);
+        vst1q_f32(&im_freq[k], vmlaq_f32(bin4, tmp, invexpected4));
+        bin4 = vaddq_f32(bin4, vdupq_n_f32(4.0f));
+    }
+
+#else
+
+    for(size_t k{0};k < count;++k)
+    {
+        const float re{re_amp[k]}, im{im_freq[k]};
+        const float phase{approx_atan2(im, re)};
+        const float tmp{wrap_phase(phase - lastPhase[k] - binPhase[k])};
+
+        lastPhase[k] = phase;
+        re_amp[k] = std::sqrt(re*re + im*im);
+        im_freq[k] = static_cast<float>(k) + tmp*invexpected;
+    }
+#endif
 }
-alignas(16) const std::array<double,STFT_SIZE> HannWindow = InitHannWindow();
 
+/* Converts each bin from amplitude and frequency (in bins) to real and
+ * imaginary parts, in place, accumulating the phase. count must be a multiple
+ * of 4.
+ */
+void SynthesizeBins(float *RESTRICT amp_re, float *RESTRICT freq_im, float *RESTRICT sumPhase,
+    const size_t count, const float expected)
+{
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 signmask{_mm_set1_ps(-0.0f)};
+    const __m128 halfpi4{_mm_set1_ps(HalfPi)};
+    const __m128 pi4{_mm_set1_ps(Pi)};
+    const __m128 twopi4{_mm_set1_ps(TwoPi)};
+    const __m128 invtwopi4{_mm_set1_ps(InvTwoPi)};
+    const __m128 round4{_mm_set1_ps(12582912.0f)};
+    const __m128 expected4{_mm_set1_ps(expected)};
+    for(size_t k{0};k < count;k+=4)
+    {
+        __m128 x{_mm_add_ps(_mm_load_ps(&sumPhase[k]),
+            _mm_mul_ps(_mm_load_ps(&freq_im[k]), expected4))};
+        __m128 wraps{_mm_mul_ps(x, invtwopi4)};
+        wraps = _mm_sub_ps(_mm_add_ps(wraps, round4), round4);
+        x = _mm_sub_ps(x, _mm_mul_ps(wraps, twopi4));
+        _mm_store_ps(&sumPhase[k], x);
+
+        /* Reflect into +/-pi/2, noting where cos needs to flip sign. */
+        const __m128 hi{_mm_cmpgt_ps(x, halfpi4)};
+        const __m128 lo{_mm_cmplt_ps(x, _mm_xor_ps(halfpi4, signmask))};
+        const __m128 flip{_mm_or_ps(hi, lo)};
+        const __m128 edge{_mm_or_ps(_mm_and_ps(hi, pi4),
+            _mm_and_ps(lo, _mm_xor_ps(pi4, signmask)))};
+        x = _mm_or_ps(_mm_and_ps(flip, _mm_sub_ps(edge, x)), _mm_andnot_ps(flip, x));
+
+        const __m128 s{_mm_mul_ps(x, x)};
+        __m128 sn{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(-2.50521084e-8f), s),
+            _mm_set1_ps(2.75573192e-6f))};
+        sn = _mm_add_ps(_mm_mul_ps(sn, s), _mm_set1_ps(-1.98412698e-4f));
+        sn = _mm_add_ps(_mm_mul_ps(sn, s), _mm_set1_ps(8.33333333e-3f));
+        sn = _mm_add_ps(_mm_mul_ps(sn, s), _mm_set1_ps(-1.66666667e-1f));
+        sn = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sn, s), x), x);
+        __m128 cs{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.08767570e-9f), s),
+            _mm_set1_ps(-2.75573192e-7f))};
+        cs = _mm_add_ps(_mm_mul_ps(cs, s), _mm_set1_ps(2.48015873e-5f));
+        cs = _mm_add_ps(_mm_mul_ps(cs, s), _mm_set1_ps(-1.38888889e-3f));
+        cs = _mm_add_ps(_mm_mul_ps(cs, s), _mm_set1_ps(4.16666667e-2f));
+        cs = _mm_add_ps(_mm_mul_ps(cs, s), _mm_set1_ps(-0.5f));
+        cs = _mm_add_ps(_mm_mul_ps(cs, s), _mm_set1_ps(1.0f));
+        cs = _mm_xor_ps(cs, _mm_and_ps(flip, signmask));
+
+        const __m128 amp{_mm_load_ps(&amp_re[k])};
+        _mm_store_ps(&amp_re[k], _mm_mul_ps(amp, cs));
+        _mm_store_ps(&freq_im[k], _mm_mul_ps(amp, sn));
+    }
 
-struct FrequencyBin {
-    double Amplitude;
-    double FreqBin;
-};
+#elif defined(HAVE_NEON)
+
+    const uint32x4_t signmask{vdupq_n_u32(0x80000000u)};
+    const float32x4_t halfpi4{vdupq_n_f32(HalfPi)};
+    const float32x4_t pi4{vdupq_n_f32(Pi)};
+    const float32x4_t twopi4{vdupq_n_f32(TwoPi)};
+    const float32x4_t invtwopi4{vdupq_n_f32(InvTwoPi)};
+    const float32x4_t round4{vdupq_n_f32(12582912.0f)};
+    const float32x4_t expected4{vdupq_n_f32(expected)};
+    for(size_t k{0};k < count;k+=4)
+    {
+        float32x4_t x{vmlaq_f32(vld1q_f32(&sumPhase[k]), vld1q_f32(&freq_im[k]), expected4)};
+        float32x4_t wraps{vmulq_f32(x, invtwopi4)};
+        wraps = vsubq_f32(vaddq_f32(wraps, round4), round4);
+        x = vmlsq_f32(x, wraps, twopi4);
+        vst1q_f32(&sumPhase[k], x);
+
+        const uint32x4_t hi{vcgtq_f32(x, halfpi4)};
+        const uint32x4_t lo{vcltq_f32(x, vnegq_f32(halfpi4))};
+        const uint32x4_t flip{vorrq_u32(hi, lo)};
+        x = vbslq_f32(hi, vsubq_f32(pi4, x), x);
+        x = vbslq_f32(lo, vsubq_f32(vnegq_f32(pi4), x), x);
+
+        const float32x4_t s{vmulq_f32(x, x)};
+        float32x4_t sn{vmlaq_f32(vdupq_n_f32(2.75573192e-6f), vdupq_n_f32(-2.50521084e-8f), s)};
+        sn = vmlaq_f32(vdupq_n_f32(-1.98412698e-4f), sn, s);
+        sn = vmlaq_f32(vdupq_n_f32(8.33333333e-3f), sn, s);
+        sn = vmlaq_f32(vdupq_n_f32(-1.66666667e-1f), sn, s);
+        sn = vmlaq_f32(x, vmulq_f32(sn, s), x);
+        float32x4_t cs{vmlaq_f32(vdupq_n_f32(-2.75573192e-7f), vdupq_n_f32(2.08767570e-9f), s)};
+        cs = vmlaq_f32(vdupq_n_f32(2.48015873e-5f), cs, s);
+        cs = vmlaq_f32(vdupq_n_f32(-1.38888889e-3f), cs, s);
+        cs = vmlaq_f32(vdupq_n_f32(4.16666667e-2f), cs, s);
+        cs = vmlaq_f32(vdupq_n_f32(-0.5f), cs, s);
+        cs = vmlaq_f32(vdupq_n_f32(1.0f), cs, s);
+        cs = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(cs),
+            vandq_u32(flip, signmask)));
+
+        const float32x4_t amp{vld1q_f32(&amp_re[k])};
+        vst1q_f32(&amp_re[k], vmulq_f32(amp, cs));
+        vst1q_f32(&freq_im[k], vmulq_f32(amp, sn));
+    }
+
+#else
+
+    for(size_t k{0};k < count;++k)
+    {
+        const float phase{wrap_phase(sumPhase[k] + freq_im[k]*expected)};
+        sumPhase[k] = phase;
+
+        float sn, cs;
+        approx_sincos(phase, &sn, &cs);
+        const float amp{amp_re[k]};
+        amp_re[k] = amp * cs;
+        freq_im[k] = amp * sn;
+    }
+#endif
+}
+
+/* Returns the correlation between two signal windows, normalized by the
+ * energy of the second. len must be a multiple of 4.
+ */
+float CorrelateWindows(const float *RESTRICT a, const float *RESTRICT b, const size_t len)
+{
+    float corr, energy;
+#ifdef HAVE_SSE_INTRINSICS
+    __m128 corr4{_mm_setzero_ps()}, energy4{_mm_setzero_ps()};
+    for(size_t i{0};i < len;i+=4)
+    {
+        const __m128 a4{_mm_loadu_ps(&a[i])};
+        const __m128 b4{_mm_loadu_ps(&b[i])};
+        corr4 = _mm_add_ps(corr4, _mm_mul_ps(a4, b4));
+        energy4 = _mm_add_ps(energy4, _mm_mul_ps(b4, b4));
+    }
+    corr4 = _mm_add_ps(corr4, _mm_shuffle_ps(corr4, corr4, _MM_SHUFFLE(0, 1, 2, 3)));
+    corr4 = _mm_add_ps(corr4, _mm_movehl_ps(corr4, corr4));
+    corr = _mm_cvtss_f32(corr4);
+    energy4 = _mm_add_ps(energy4, _mm_shuffle_ps(energy4, energy4, _MM_SHUFFLE(0, 1, 2, 3)));
+    energy4 = _mm_add_ps(energy4, _mm_movehl_ps(energy4, energy4));
+    energy = _mm_cvtss_f32(energy4);
+
+#elif defined(HAVE_NEON)
+
+    float32x4_t corr4{vdupq_n_f32(0.0f)}, energy4{vdupq_n_f32(0.0f)};
+    for(size_t i{0};i < len;i+=4)
+    {
+        const float32x4_t b4{vld1q_f32(&b[i])};
+        corr4 = vmlaq_f32(corr4, vld1q_f32(&a[i]), b4);
+        energy4 = vmlaq_f32(energy4, b4, b4);
+    }
+    corr4 = vaddq_f32(corr4, vrev64q_f32(corr4));
+    corr = vget_lane_f32(vadd_f32(vget_low_f32(corr4), vget_high_f32(corr4)), 0);
+    energy4 = vaddq_f32(energy4, vrev64q_f32(energy4));
+    energy = vget_lane_f32(vadd_f32(vget_low_f32(energy4), vget_high_f32(energy4)), 0);
+
+#else
+
+    corr = 0.0f;
+    energy = 0.0f;
+    for(size_t i{0};i < len;++i)
+    {
+        corr += a[i] * b[i];
+        energy += b[i] * b[i];
+    }
+#endif
+    return corr / std::sqrt(energy + 1e-9f);
+}
 
 
 struct PshifterState final : public EffectState {
+    PshifterMode mMode;
+
     /* Effect parameters */
-    size_t mCount;
-    size_t mPos;
     uint mPitchShiftI;
-    double mPitchShift;
+    float mPitchShift;
 
-    /* Effects buffers */
-    std::array<double,STFT_SIZE> mFIFO;
-    std::array<double,STFT_HALF_SIZE+1> mLastPhase;
-    std::array<double,STFT_HALF_SIZE+1> mSumPhase;
-    std::array<double,STFT_SIZE> mOutputAccum;
+    /* STFT mode. The FFT size and overlap are powers of two. */
+    size_t mFftSize{0u};
+    size_t mOversamp{0u};
+    size_t mStep;
+    size_t mCount;
+    size_t mPos;
 
-    std::array<complex_d,STFT_SIZE> mFftBuffer;
+    al::vector<float,16> mWindow;
+    al::vector<float,16> mFIFO;
+    al::vector<float,16> mOutputAccum;
+    al::vector<complex_f,16> mFftBuffer;
 
-    std::array<FrequencyBin,STFT_HALF_SIZE+1> mAnalysisBuffer;
-    std::array<FrequencyBin,STFT_HALF_SIZE+1> mSynthesisBuffer;
+    /* The per-bin buffers are padded to a multiple of 4. BinPhase is each
+     * bin's expected phase advance per step, mod 2pi. The analysis and
+     * synthesis buffers hold the real and imaginary parts of the bins going
+     * into and out of the FFT, converted in place to and from amplitude and
+     * frequency.
+     */
+    al::vector<float,16> mBinPhase;
+    al::vector<float,16> mLastPhase;
+    al::vector<float,16> mSumPhase;
+    al::vector<float,16> mAnalysisAmp;
+    al::vector<float,16> mAnalysisFreq;
+    al::vector<float,16> mSynthesisAmp;
+    al::vector<float,16> mSynthesisFreq;
+
+    /* Time-domain (PSOLA-style) mode. The history is stored twice in a row,
+     * so windows ending at any delay up to the history size can be read
+     * without wrapping.
+     */
+    size_t mHistorySize{0u};
+    size_t mWritePos;
+    size_t mFadeLength;
+    size_t mFadePos;
+    size_t mJumpMin;
+    size_t mJumpMax;
+    double mDelay;
+    double mFadeDelay;
+    al::vector<float,16> mHistory;
+    al::vector<float,16> mFadeWindow;
 
     alignas(16) FloatBufferLine mBufferOut;
 
@@ -103,6 +456,10 @@ struct PshifterState final : public EffectState {
     float mTargetGains[MAX_OUTPUT_CHANNELS];
 
 
+    void processStft(const size_t samplesToDo, const float *RESTRICT input);
+    void processPsola(const size_t samplesToDo, const float *RESTRICT input);
+    size_t findSplice(const size_t base, const size_t delay, const bool forward);
+
     void deviceUpdate(const DeviceBase *device, const Buffer &buffer) override;
     void update(const ContextBase *context, const EffectSlot *slot, const EffectProps *props,
         const EffectTarget target) override;
@@ -112,21 +469,98 @@ struct PshifterState final : public EffectState {
     DEF_NEWDEL(PshifterState)
 };
 
-void PshifterState::deviceUpdate(const DeviceBase*, const Buffer&)
+void PshifterState::deviceUpdate(const DeviceBase *device, const Buffer&)
 {
     /* (Re-)initializing parameters and clear the buffers. */
-    mCount       = 0;
-    mPos         = FIFO_LATENCY;
+    mMode        = PshifterProcessMode;
     mPitchShiftI = MixerFracOne;
-    mPitchShift  = 1.0;
+    mPitchShift  = 1.0f;
 
-    std::fill(mFIFO.begin(),            mFIFO.end(),            0.0);
-    std::fill(mLastPhase.begin(),       mLastPhase.end(),       0.0);
-    std::fill(mSumPhase.begin(),        mSumPhase.end(),        0.0);
-    std::fill(mOutputAccum.begin(),     mOutputAccum.end(),     0.0);
-    std::fill(mFftBuffer.begin(),       mFftBuffer.end(),       complex_d{});
-    std::fill(mAnalysisBuffer.begin(),  mAnalysisBuffer.end(),  FrequencyBin{});
-    std::fill(mSynthesisBuffer.begin(), mSynthesisBuffer.end(), FrequencyBin{});
+    if(mMode == PshifterMode::Stft)
+    {
+        const size_t fftsize{PshifterFftSize};
+        const size_t oversamp{PshifterOverlap};
+        const size_t bincount{RoundUp(fftsize/2 + 1, 4)};
+        if(mFftSize != fftsize || mOversamp != oversamp)
+        {
+            mFftSize = fftsize;
+            mOversamp = oversamp;
+            mWindow.resize(fftsize);
+            mFIFO.resize(fftsize);
+            mOutputAccum.resize(fftsize);
+            mFftBuffer.resize(fftsize / 2);
+            mBinPhase.resize(bincount);
+            mLastPhase.resize(bincount);
+            mSumPhase.resize(bincount);
+            mAnalysisAmp.resize(bincount);
+            mAnalysisFreq.resize(bincount);
+            mSynthesisAmp.resize(bincount);
+            mSynthesisFreq.resize(bincount);
+
+            /* Create lookup table of the Hann window for the FFT size. */
+            const double scale{al::numbers::pi / static_cast<double>(fftsize)};
+            for(size_t i{0};i < fftsize>>1;i++)
+            {
+                const double val{std::sin(static_cast<double>(i+1) * scale)};
+                mWindow[i] = mWindow[fftsize-1-i] = static_cast<float>(val * val);
+            }
+
+            /* Bin k is expected to advance by k*2pi/oversamp each step, which
+             * repeats every oversamp bins.
+             */
+            const double expected{al::numbers::pi*2.0 / static_cast<double>(oversamp)};
+            for(size_t k{0};k < bincount;++k)
+                mBinPhase[k] = static_cast<float>(static_cast<double>(k%oversamp) * expected);
+        }
+        mStep  = fftsize / oversamp;
+        mCount = 0;
+        mPos   = mStep * (oversamp-1);
+
+        std::fill(mFIFO.begin(),          mFIFO.end(),          0.0f);
+        std::fill(mOutputAccum.begin(),   mOutputAccum.end(),   0.0f);
+        std::fill(mLastPhase.begin(),     mLastPhase.end(),     0.0f);
+        std::fill(mSumPhase.begin(),      mSumPhase.end(),      0.0f);
+        std::fill(mAnalysisAmp.begin(),   mAnalysisAmp.end(),   0.0f);
+        std::fill(mAnalysisFreq.begin(),  mAnalysisFreq.end(),  0.0f);
+        std::fill(mSynthesisAmp.begin(),  mSynthesisAmp.end(),  0.0f);
+        std::fill(mSynthesisFreq.begin(), mSynthesisFreq.end(), 0.0f);
+    }
+    else
+    {
+        const float frequency{static_cast<float>(device->Frequency)};
+        mFadeLength = RoundUp(float2uint(frequency*PsolaFadeMs/1000.0f), 4);
+        mJumpMin = maxz(float2uint(frequency*PsolaJumpMinMs/1000.0f), mFadeLength);
+        mJumpMax = maxz(float2uint(frequency*PsolaJumpMaxMs/1000.0f), mJumpMin+1);
+
+        /* The delay reaches up to the max jump past the min delay (plus the
+         * fade length when pitching up), and the correlation window takes
+         * another fade length behind that. Add some room for the fade to
+         * continue on the old delay.
+         */
+        const size_t histsize{NextPowerOf2(static_cast<uint>(PsolaMinDelay + mJumpMax +
+            mFadeLength*3 + 4))};
+        if(mHistorySize != histsize)
+        {
+            mHistorySize = histsize;
+            mHistory.resize(histsize * 2);
+        }
+        if(mFadeWindow.size() != mFadeLength)
+        {
+            mFadeWindow.resize(mFadeLength);
+            const double scale{al::numbers::pi*0.5 / static_cast<double>(mFadeLength)};
+            for(size_t i{0};i < mFadeLength;++i)
+            {
+                const double val{std::sin((static_cast<double>(i)+0.5) * scale)};
+                mFadeWindow[i] = static_cast<float>(val * val);
+            }
+        }
+        mWritePos = 0;
+        mFadePos = mFadeLength;
+        mDelay = static_cast<double>(PsolaMinDelay + mJumpMax/2);
+        mFadeDelay = mDelay;
+
+        std::fill(mHistory.begin(), mHistory.end(), 0.0f);
+    }
 
     std::fill(std::begin(mCurrentGains), std::end(mCurrentGains), 0.0f);
     std::fill(std::begin(mTargetGains),  std::end(mTargetGains),  0.0f);
@@ -138,7 +572,7 @@ void PshifterState::update(const ContextBase*, const EffectSlot *slot,
     const int tune{props->Pshifter.CoarseTune*100 + props->Pshifter.FineTune};
     const float pitch{std::pow(2.0f, static_cast<float>(tune) / 1200.0f)};
     mPitchShiftI = fastf2u(pitch*MixerFracOne);
-    mPitchShift  = mPitchShiftI * double{1.0/MixerFracOne};
+    mPitchShift  = static_cast<float>(mPitchShiftI) * (1.0f/MixerFracOne);
 
     const auto coeffs = CalcDirectionCoeffs({0.0f, 0.0f, -1.0f}, 0.0f);
 
@@ -146,113 +580,209 @@ void PshifterState::update(const ContextBase*, const EffectSlot *slot,
     ComputePanGains(target.Main, coeffs.data(), slot->Gain, mTargetGains);
 }
 
-void PshifterState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
+void PshifterState::processStft(const size_t samplesToDo, const float *RESTRICT input)
 {
     /* Pitch shifter engine based on the work of Stephan Bernsee.
      * http://blogs.zynaptiq.com/bernsee/pitch-shifting-using-the-ft/
      */
+    const size_t fftsize{mFftSize};
+    const size_t halfsize{fftsize >> 1};
+    const size_t fftmask{fftsize - 1};
+    const size_t bincount{mBinPhase.size()};
 
     /* Cycle offset per update expected of each frequency bin (bin 0 is none,
      * bin 1 is x1, bin 2 is x2, etc).
      */
-    constexpr double expected_cycles{al::numbers::pi*2.0 / OVERSAMP};
+    const float expected_cycles{TwoPi / static_cast<float>(mOversamp)};
 
     for(size_t base{0u};base < samplesToDo;)
     {
-        const size_t todo{minz(STFT_STEP-mCount, samplesToDo-base)};
+        const size_t todo{minz(mStep-mCount, samplesToDo-base)};
 
         /* Retrieve the output samples from the FIFO and fill in the new input
          * samples.
          */
         auto fifo_iter = mFIFO.begin()+mPos + mCount;
-        std::transform(fifo_iter, fifo_iter+todo, mBufferOut.begin()+base,
-            [](double d) noexcept -> float { return static_cast<float>(d); });
+        std::copy_n(fifo_iter, todo, mBufferOut.begin()+base);
 
-        std::copy_n(samplesIn[0].begin()+base, todo, fifo_iter);
+        std::copy_n(input+base, todo, fifo_iter);
         mCount += todo;
         base += todo;
 
         /* Check whether FIFO buffer is filled with new samples. */
-        if(mCount < STFT_STEP) break;
+        if(mCount < mStep) break;
         mCount = 0;
-        mPos = (mPos+STFT_STEP) & (mFIFO.size()-1);
+        mPos = (mPos+mStep) & fftmask;
 
-        /* Time-domain signal windowing, store in FftBuffer, and apply a
-         * forward FFT to get the frequency-domain signal.
+        /* Time-domain signal windowing, packed in pairs into FftBuffer, and
+         * apply a forward real FFT to get the frequency-domain signal.
          */
-        for(size_t src{mPos}, k{0u};src < STFT_SIZE;++src,++k)
-            mFftBuffer[k] = mFIFO[src] * HannWindow[k];
-        for(size_t src{0u}, k{STFT_SIZE-mPos};src < mPos;++src,++k)
-            mFftBuffer[k] = mFIFO[src] * HannWindow[k];
-        forward_fft(mFftBuffer);
+        for(size_t k{0u};k < halfsize;++k)
+        {
+            const size_t src{(mPos + k*2) & fftmask};
+            mFftBuffer[k] = complex_f{mFIFO[src] * mWindow[k*2],
+                mFIFO[src+1] * mWindow[k*2 + 1]};
+        }
+        forward_real_fft(mFftBuffer);
 
         /* Analyze the obtained data. Since the real FFT is symmetric, only
-         * STFT_HALF_SIZE+1 samples are needed.
+         * halfsize+1 bins are needed.
          */
-        for(size_t k{0u};k < STFT_HALF_SIZE+1;k++)
+        mAnalysisAmp[0] = mFftBuffer[0].real();
+        mAnalysisFreq[0] = 0.0f;
+        for(size_t k{1u};k < halfsize;++k)
         {
-            const double amplitude{std::abs(mFftBuffer[k])};
-            const double phase{std::arg(mFftBuffer[k])};
-
-            /* Compute phase difference and subtract expected phase difference */
-            double tmp{(phase - mLastPhase[k]) - static_cast<double>(k)*expected_cycles};
-
-            /* Map delta phase into +/- Pi interval */
-            int qpd{double2int(tmp / al::numbers::pi)};
-            tmp -= al::numbers::pi * (qpd + (qpd%2));
-
-            /* Get deviation from bin frequency from the +/- Pi interval */
-            tmp /= expected_cycles;
-
-            /* Compute the k-th partials' true frequency and store the
-             * amplitude and frequency bin in the analysis buffer.
-             */
-            mAnalysisBuffer[k].Amplitude = amplitude;
-            mAnalysisBuffer[k].FreqBin = static_cast<double>(k) + tmp;
-
-            /* Store the actual phase[k] for the next frame. */
-            mLastPhase[k] = phase;
+            mAnalysisAmp[k] = mFftBuffer[k].real();
+            mAnalysisFreq[k] = mFftBuffer[k].imag();
         }
+        mAnalysisAmp[halfsize] = mFftBuffer[0].imag();
+        mAnalysisFreq[halfsize] = 0.0f;
+        AnalyzeBins(mAnalysisAmp.data(), mAnalysisFreq.data(), mLastPhase.data(),
+            mBinPhase.data(), bincount, expected_cycles);
 
         /* Shift the frequency bins according to the pitch adjustment,
          * accumulating the amplitudes of overlapping frequency bins.
          */
-        std::fill(mSynthesisBuffer.begin(), mSynthesisBuffer.end(), FrequencyBin{});
-        const size_t bin_count{minz(STFT_HALF_SIZE+1,
-            (((STFT_HALF_SIZE+1)<<MixerFracBits) - (MixerFracOne>>1) - 1)/mPitchShiftI + 1)};
+        std::fill(mSynthesisAmp.begin(), mSynthesisAmp.end(), 0.0f);
+        std::fill(mSynthesisFreq.begin(), mSynthesisFreq.end(), 0.0f);
+        const size_t bin_count{minz(halfsize+1,
+            (((halfsize+1)<<MixerFracBits) - (MixerFracOne>>1) - 1)/mPitchShiftI + 1)};
         for(size_t k{0u};k < bin_count;k++)
         {
             const size_t j{(k*mPitchShiftI + (MixerFracOne>>1)) >> MixerFracBits};
-            mSynthesisBuffer[j].Amplitude += mAnalysisBuffer[k].Amplitude;
-            mSynthesisBuffer[j].FreqBin    = mAnalysisBuffer[k].FreqBin * mPitchShift;
+            mSynthesisAmp[j] += mAnalysisAmp[k];
+            mSynthesisFreq[j] = mAnalysisFreq[k] * mPitchShift;
         }
 
         /* Reconstruct the frequency-domain signal from the adjusted frequency
-         * bins.
+         * bins, packing the real DC and Nyquist bins together.
          */
-        for(size_t k{0u};k < STFT_HALF_SIZE+1;k++)
-        {
-            /* Calculate actual delta phase and accumulate it to get bin phase */
-            mSumPhase[k] += mSynthesisBuffer[k].FreqBin * expected_cycles;
-
-            mFftBuffer[k] = std::polar(mSynthesisBuffer[k].Amplitude, mSumPhase[k]);
-        }
-        for(size_t k{STFT_HALF_SIZE+1};k < STFT_SIZE;++k)
-            mFftBuffer[k] = std::conj(mFftBuffer[STFT_SIZE-k]);
+        SynthesizeBins(mSynthesisAmp.data(), mSynthesisFreq.data(), mSumPhase.data(), bincount,
+            expected_cycles);
+        mFftBuffer[0] = complex_f{mSynthesisAmp[0], mSynthesisAmp[halfsize]};
+        for(size_t k{1u};k < halfsize;++k)
+            mFftBuffer[k] = complex_f{mSynthesisAmp[k], mSynthesisFreq[k]};
 
         /* Apply an inverse FFT to get the time-domain siganl, and accumulate
          * for the output with windowing.
          */
-        inverse_fft(mFftBuffer);
-        for(size_t dst{mPos}, k{0u};dst < STFT_SIZE;++dst,++k)
-            mOutputAccum[dst] += HannWindow[k]*mFftBuffer[k].real() * (4.0/OVERSAMP/STFT_SIZE);
-        for(size_t dst{0u}, k{STFT_SIZE-mPos};dst < mPos;++dst,++k)
-            mOutputAccum[dst] += HannWindow[k]*mFftBuffer[k].real() * (4.0/OVERSAMP/STFT_SIZE);
+        inverse_real_fft(mFftBuffer);
+        const float scale{8.0f / static_cast<float>(mOversamp) / static_cast<float>(fftsize)};
+        for(size_t k{0u};k < halfsize;++k)
+        {
+            const size_t dst{(mPos + k*2) & fftmask};
+            mOutputAccum[dst] += mWindow[k*2]*mFftBuffer[k].real() * scale;
+            mOutputAccum[dst+1] += mWindow[k*2 + 1]*mFftBuffer[k].imag() * scale;
+        }
 
         /* Copy out the accumulated result, then clear for the next iteration. */
-        std::copy_n(mOutputAccum.begin() + mPos, STFT_STEP, mFIFO.begin() + mPos);
-        std::fill_n(mOutputAccum.begin() + mPos, STFT_STEP, 0.0);
+        std::copy_n(mOutputAccum.begin() + mPos, mStep, mFIFO.begin() + mPos);
+        std::fill_n(mOutputAccum.begin() + mPos, mStep, 0.0f);
     }
+}
+
+/* Finds how far to jump from the given delay, for the window leading up to
+ * the new delay to best match the one leading up to the current delay.
+ * Forward jumps go further back in the history (for pitching up, where the
+ * delay shrinks), otherwise it jumps toward the present.
+ */
+size_t PshifterState::findSplice(const size_t base, const size_t delay, const bool forward)
+{
+    const float *hist{mHistory.data()};
+    const float *current{hist + base - delay - mFadeLength};
+    auto correlate = [this,hist,base,delay,forward,current](const size_t jump) -> float
+    {
+        const size_t newdelay{forward ? delay+jump : delay-jump};
+        return CorrelateWindows(current, hist + base - newdelay - mFadeLength, mFadeLength);
+    };
+
+    /* Do a coarse search over the jump range, then refine around the best. */
+    size_t best{mJumpMin};
+    float bestcorr{-std::numeric_limits<float>::infinity()};
+    for(size_t jump{mJumpMin};jump <= mJumpMax;jump+=4)
+    {
+        const float corr{correlate(jump)};
+        if(corr > bestcorr)
+        {
+            bestcorr = corr;
+            best = jump;
+        }
+    }
+    const size_t start{maxz(best, mJumpMin+3) - 3}, end{minz(best+3, mJumpMax)};
+    for(size_t jump{start};jump <= end;++jump)
+    {
+        if(jump == best) continue;
+        const float corr{correlate(jump)};
+        if(corr > bestcorr)
+        {
+            bestcorr = corr;
+            best = jump;
+        }
+    }
+    return best;
+}
+
+void PshifterState::processPsola(const size_t samplesToDo, const float *RESTRICT input)
+{
+    /* A time-domain shifter, reading the history at the pitch rate. The read
+     * delay drifts until it runs out of range, then jumps by about a pitch
+     * period to the point where the waveform best matches, crossfading
+     * between the old and new reads.
+     */
+    const size_t histsize{mHistorySize};
+    const size_t histmask{histsize - 1};
+    float *RESTRICT hist{mHistory.data()};
+    const double delta{1.0 - static_cast<double>(mPitchShift)};
+
+    auto tap = [hist](const size_t base, const double delay) noexcept -> float
+    {
+        const double pos{static_cast<double>(base) - delay};
+        const auto ipos = static_cast<size_t>(pos);
+        const auto frac = static_cast<float>(pos - static_cast<double>(ipos));
+        return lerpf(hist[ipos], hist[ipos+1], frac);
+    };
+
+    for(size_t i{0u};i < samplesToDo;++i)
+    {
+        hist[mWritePos] = hist[mWritePos + histsize] = input[i];
+        const size_t base{mWritePos + histsize};
+        mWritePos = (mWritePos+1) & histmask;
+
+        float output{tap(base, mDelay)};
+        if(mFadePos < mFadeLength)
+        {
+            const float gain{mFadeWindow[mFadePos++]};
+            output = output*gain + tap(base, mFadeDelay)*(1.0f-gain);
+            /* Don't let the old read pass the present if the pitch changed. */
+            mFadeDelay = std::max(mFadeDelay+delta, double{PsolaMinDelay});
+        }
+        else if(delta > 0.0 && mDelay >= static_cast<double>(PsolaMinDelay + mJumpMax))
+        {
+            const auto delay = static_cast<size_t>(mDelay + 0.5);
+            mFadeDelay = mDelay;
+            mDelay -= static_cast<double>(findSplice(base, delay, false));
+            mFadePos = 0;
+        }
+        else if(delta < 0.0
+            && mDelay <= static_cast<double>(PsolaMinDelay) - delta*static_cast<double>(mFadeLength))
+        {
+            const auto delay = static_cast<size_t>(mDelay + 0.5);
+            mFadeDelay = mDelay;
+            mDelay += static_cast<double>(findSplice(base, delay, true));
+            mFadePos = 0;
+        }
+        mDelay += delta;
+
+        mBufferOut[i] = output * PsolaGain;
+    }
+}
+
+void PshifterState::process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn, const al::span<FloatBufferLine> samplesOut)
+{
+    if(mMode == PshifterMode::Stft)
+        processStft(samplesToDo, samplesIn[0].data());
+    else
+        processPsola(samplesToDo, samplesIn[0].data());
 
     /* Now, mix the processed sound data to the output. */
     MixSamples({mBufferOut.data(), samplesToDo}, samplesOut, mCurrentGains, mTargetGains,
@@ -440,6 +440,9 @@ struct ReverbState final : public EffectState {
 
     bool mDoFading{};
 
+    /* How long the reverb takes to decay below EffectTailSilenceGain. */
+    size_t mTailLength{0};
+
     /* Maximum number of samples to process at once. */
     size_t mMaxUpdate[2]{MAX_UPDATE_SAMPLES, MAX_UPDATE_SAMPLES};
 
@@ -563,6 +566,8 @@ struct ReverbState final : public EffectState {
     void process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn,
         const al::span<FloatBufferLine> samplesOut) override;
 
+    size_t getTailLength() const noexcept override { return mTailLength; }
+
     DEF_NEWDEL(ReverbState)
 };
 
@@ -1068,6 +1073,16 @@ void ReverbState::update(const ContextBase *Context, const EffectSlot *Slot,
     update3DPanning(props->Reverb.ReflectionsPan, props->Reverb.LateReverbPan,
         props->Reverb.ReflectionsGain*gain, props->Reverb.LateReverbGain*gain, target);
 
+    /* The decay times are how long the late reverb takes to fall to
+     * ReverbDecayGain. Scale the longest one for EffectTailSilenceGain, and
+     * add the initial delays and the longest early and late lines.
+     */
+    const float maxDecayTime{maxf(props->Reverb.DecayTime, maxf(lfDecayTime, hfDecayTime))};
+    const float tailScale{std::log(EffectTailSilenceGain) / std::log(ReverbDecayGain)};
+    const float lineLength{(EARLY_LINE_LENGTHS.back() + LATE_LINE_LENGTHS.back()) * density_mult};
+    mTailLength = float2uint((maxDecayTime*tailScale + props->Reverb.ReflectionsDelay
+        + props->Reverb.LateReverbDelay + lineLength) * frequency);
+
     /* Calculate the max update size from the smallest relevant delay. */
     mMaxUpdate[1] = minz(MAX_UPDATE_SAMPLES, minz(mEarly.Offset[0][1], mLate.Offset[0][1]));
 
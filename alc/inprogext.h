@@ -37,6 +37,7 @@ AL_API void AL_APIENTRY alFlushMappedBufferSOFT(ALuint buffer, ALsizei offset, A
 #define AL_SOFT_convolution_reverb
 #define AL_EFFECT_CONVOLUTION_REVERB_SOFT        0xA000
 #define AL_EFFECTSLOT_STATE_SOFT                 0x199D
+#define AL_CONVOLUTION_TRUE_STEREO_SOFT          0x0001
 typedef void (AL_APIENTRY*LPALAUXILIARYEFFECTSLOTPLAYSOFT)(ALuint slotid);
 typedef void (AL_APIENTRY*LPALAUXILIARYEFFECTSLOTPLAYVSOFT)(ALsizei n, const ALuint *slotids);
 typedef void (AL_APIENTRY*LPALAUXILIARYEFFECTSLOTSTOPSOFT)(ALuint slotid);
@@ -54,6 +55,49 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotStopvSOFT(ALsizei n, const ALuint *
 #define AL_STOP_SOURCES_ON_DISCONNECT_SOFT       0x19AB
 #endif
 
+#ifndef ALC_SOFT_device_latency_stats
+#define ALC_SOFT_device_latency_stats
+#define ALC_DEVICE_UNDERRUN_COUNT_SOFT           0x19B3
+#define ALC_DEVICE_TARGET_LATENCY_SOFT           0x19B4
+#define ALC_DEVICE_MAX_JITTER_SOFT               0x19B5
+#define ALC_DEVICE_LATENCY_HISTORY_SIZE_SOFT     0x19B6
+#define ALC_DEVICE_LATENCY_HISTORY_SOFT          0x19B7
+#endif
+
+#ifndef ALC_SOFT_voice_prealloc
+#define ALC_SOFT_voice_prealloc
+#define ALC_PREALLOC_VOICES_SOFT                 0x19B8
+#define ALC_VOICE_ALLOC_FALLBACKS_SOFT           0x19B9
+#endif
+
+#ifndef AL_SOFT_scheduled_playback
+#define AL_SOFT_scheduled_playback
+typedef void (AL_APIENTRY*LPALSOURCEPLAYATTIMESOFT)(ALuint source, ALint64SOFT start_time);
+typedef void (AL_APIENTRY*LPALSOURCEPLAYATTIMEVSOFT)(ALsizei n, const ALuint *sources, ALint64SOFT start_time);
+typedef void (AL_APIENTRY*LPALSOURCESTOPATTIMESOFT)(ALuint source, ALint64SOFT stop_time);
+typedef void (AL_APIENTRY*LPALSOURCESTOPATTIMEVSOFT)(ALsizei n, const ALuint *sources, ALint64SOFT stop_time);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alSourcePlayAtTimeSOFT(ALuint source, ALint64SOFT start_time);
+AL_API void AL_APIENTRY alSourcePlayAtTimevSOFT(ALsizei n, const ALuint *sources, ALint64SOFT start_time);
+AL_API void AL_APIENTRY alSourceStopAtTimeSOFT(ALuint source, ALint64SOFT stop_time);
+AL_API void AL_APIENTRY alSourceStopAtTimevSOFT(ALsizei n, const ALuint *sources, ALint64SOFT stop_time);
+#endif
+#endif
+
+#ifndef AL_SOFT_voice_lod
+#define AL_SOFT_voice_lod
+#define AL_VOICE_LOD_DISTANCE_SOFT               0x19BA
+#define AL_VOICE_LOD_GAIN_SOFT                   0x19BB
+#endif
+
+#ifndef ALC_SOFT_reload_config
+#define ALC_SOFT_reload_config
+typedef void (ALC_APIENTRY*LPALCRELOADCONFIGSOFT)(void);
+#ifdef AL_ALEXT_PROTOTYPES
+ALC_API void ALC_APIENTRY alcReloadConfigSOFT(void);
+#endif
+#endif
+
 
 /* Non-standard export. Not part of any extension. */
 AL_API const ALchar* AL_APIENTRY alsoft_get_version(void);
@@ -56,6 +56,7 @@
 #include "core/front_stablizer.h"
 #include "core/hrtf.h"
 #include "core/logging.h"
+#include "core/mixer.h"
 #include "core/uhjfilter.h"
 #include "device.h"
 #include "opthelpers.h"
@@ -112,9 +113,10 @@ inline const char *GetLabelFromChannel(Channel channel)
 }
 
 
-std::unique_ptr<FrontStablizer> CreateStablizer(const size_t outchans, const uint srate)
+al::arena_ptr<FrontStablizer> CreateStablizer(ALCdevice *device, const size_t outchans,
+    const uint srate)
 {
-    auto stablizer = FrontStablizer::Create(outchans);
+    auto stablizer = FrontStablizer::Create(device->mArena, outchans);
     for(auto &buf : stablizer->DelayBuf)
         std::fill(buf.begin(), buf.end(), 0.0f);
 
@@ -135,7 +137,8 @@ void AllocChannels(ALCdevice *device, const size_t main_chans, const size_t real
 
     TRACE("Allocating %zu channels, %zu bytes\n", num_chans,
         num_chans*sizeof(device->MixBuffer[0]));
-    device->MixBuffer.resize(num_chans);
+    device->MixBuffer = {static_cast<FloatBufferLine*>(device->mArena.allocate(16,
+        num_chans*sizeof(FloatBufferLine))), num_chans};
     al::span<FloatBufferLine> buffer{device->MixBuffer};
 
     device->Dry.Buffer = buffer.first(main_chans);
@@ -227,8 +230,8 @@ using DecoderView = DecoderConfig<DualBand, 0>;
 
 void InitNearFieldCtrl(ALCdevice *device, float ctrl_dist, uint order, bool is3d)
 {
-    static const uint chans_per_order2d[MaxAmbiOrder+1]{ 1, 2, 2, 2 };
-    static const uint chans_per_order3d[MaxAmbiOrder+1]{ 1, 3, 5, 7 };
+    static const uint chans_per_order2d[MaxAmbiOrder+1]{ 1, 2, 2, 2, 2, 2, 2, 2 };
+    static const uint chans_per_order3d[MaxAmbiOrder+1]{ 1, 3, 5, 7, 9, 11, 13, 15 };
 
     /* NFC is only used when AvgSpeakerDist is greater than 0. */
     if(!device->getConfigValueBool("decoder", "nfc", 0) || !(ctrl_dist > 0.0f))
@@ -295,7 +298,7 @@ void InitDistanceComp(ALCdevice *device, const al::span<const Channel> channels,
 
     if(total > 0)
     {
-        auto chandelays = DistanceComp::Create(total);
+        auto chandelays = DistanceComp::Create(device->mArena, total);
 
         ChanDelay[0].Buffer = chandelays->mSamples.data();
         auto set_bufptr = [](const DistanceComp::ChanData &last, const DistanceComp::ChanData &cur)
@@ -677,7 +680,7 @@ void InitPanning(ALCdevice *device, const bool hqdec=false, const bool stablize=
         { return BFChannelConfig{1.0f/coeffscale[acn], acn}; });
     AllocChannels(device, ambicount, device->channelsFromFmt());
 
-    std::unique_ptr<FrontStablizer> stablizer;
+    al::arena_ptr<FrontStablizer> stablizer;
     if(stablize)
     {
         /* Only enable the stablizer if the decoder does not output to the
@@ -697,7 +700,7 @@ void InitPanning(ALCdevice *device, const bool hqdec=false, const bool stablize=
         }
         if(!hasfc)
         {
-            stablizer = CreateStablizer(device->channelsFromFmt(), device->Frequency);
+            stablizer = CreateStablizer(device, device->channelsFromFmt(), device->Frequency);
             TRACE("Front stablizer enabled\n");
         }
     }
@@ -707,10 +710,114 @@ void InitPanning(ALCdevice *device, const bool hqdec=false, const bool stablize=
         (decoder.mOrder > 2) ? "third" :
         (decoder.mOrder > 1) ? "second" : "first",
         decoder.mIs3D ? " periphonic" : "");
-    device->AmbiDecoder = BFormatDec::Create(ambicount, chancoeffs, chancoeffslf,
+    device->AmbiDecoder = BFormatDec::Create(device->mArena, ambicount, chancoeffs, chancoeffslf,
         device->mXOverFreq/static_cast<float>(device->Frequency), std::move(stablizer));
 }
 
+/* Generates virtual HRTF points for decoding ambisonics of the given order,
+ * for orders without a hand-made layout. The points are spread evenly over
+ * the sphere on a spherical Fibonacci lattice, with a mode-matching decoder
+ * matrix and max-rE weighted HF gains.
+ */
+void MakeHrtfAmbiDecoder(const uint order, al::vector<AngularPoint> &points,
+    std::unique_ptr<float[][MaxAmbiChannels]> &matrix,
+    std::array<float,MaxAmbiOrder+1> &hfgains)
+{
+    const size_t count{AmbiChannelsFromOrder(order)};
+    const size_t numpoints{count * 2};
+
+    /* Place the points, and get their (N3D) ambisonic responses. */
+    points.resize(numpoints);
+    auto ycoeffs = al::vector<std::array<double,MaxAmbiChannels>>(numpoints);
+    const double golden_angle{al::numbers::pi * (3.0 - std::sqrt(5.0))};
+    for(size_t k{0};k < numpoints;++k)
+    {
+        const double z{1.0 - (2.0*static_cast<double>(k) + 1.0)/static_cast<double>(numpoints)};
+        const double az{std::remainder(golden_angle*static_cast<double>(k),
+            al::numbers::pi*2.0)};
+        points[k] = AngularPoint{EvRadians{static_cast<float>(std::asin(z))},
+            AzRadians{static_cast<float>(az)}};
+
+        const auto coeffs = CalcAngleCoeffs(points[k].Azim.value, points[k].Elev.value, 0.0f);
+        std::copy_n(coeffs.cbegin(), count, ycoeffs[k].begin());
+    }
+
+    /* The mode-matching decoder is the pseudo-inverse of the point responses,
+     * Y * (Y^T * Y)^-1. Calculate Y^T * Y and invert it with Gauss-Jordan
+     * elimination (it's symmetric and well-conditioned with evenly spread
+     * points).
+     */
+    auto gram = al::vector<double>(count*count*2);
+    auto at = [&gram,count](size_t r, size_t c) noexcept -> double& { return gram[r*count*2 + c]; };
+    for(size_t r{0};r < count;++r)
+    {
+        for(size_t c{0};c < count;++c)
+        {
+            double sum{0.0};
+            for(const auto &y : ycoeffs)
+                sum += y[r] * y[c];
+            at(r, c) = sum;
+        }
+        at(r, count+r) = 1.0;
+    }
+    for(size_t c{0};c < count;++c)
+    {
+        size_t pivot{c};
+        for(size_t r{c+1};r < count;++r)
+        {
+            if(std::abs(at(r, c)) > std::abs(at(pivot, c)))
+                pivot = r;
+        }
+        if(pivot != c)
+        {
+            for(size_t k{0};k < count*2;++k)
+                std::swap(at(c, k), at(pivot, k));
+        }
+
+        const double scale{1.0 / at(c, c)};
+        for(size_t k{0};k < count*2;++k)
+            at(c, k) *= scale;
+        for(size_t r{0};r < count;++r)
+        {
+            if(r == c) continue;
+            const double factor{at(r, c)};
+            for(size_t k{0};k < count*2;++k)
+                at(r, k) -= factor * at(c, k);
+        }
+    }
+
+    matrix = std::make_unique<float[][MaxAmbiChannels]>(numpoints);
+    for(size_t k{0};k < numpoints;++k)
+    {
+        for(size_t i{0};i < count;++i)
+        {
+            double sum{0.0};
+            for(size_t j{0};j < count;++j)
+                sum += ycoeffs[k][j] * at(j, count+i);
+            matrix[k][i] = static_cast<float>(sum);
+        }
+    }
+
+    /* The max-rE gains are the Legendre polynomials evaluated at the rE for
+     * the order, scaled to preserve the RMS level.
+     */
+    const double rE{std::cos(137.9 / (order + 1.51) * al::numbers::pi / 180.0)};
+    std::array<double,MaxAmbiOrder+2> legendre{};
+    legendre[0] = 1.0;
+    legendre[1] = rE;
+    for(size_t n{2};n <= order;++n)
+        legendre[n] = ((2.0*static_cast<double>(n) - 1.0)*rE*legendre[n-1]
+            - (static_cast<double>(n) - 1.0)*legendre[n-2]) / static_cast<double>(n);
+
+    double energy{0.0};
+    for(size_t n{0};n <= order;++n)
+        energy += (2.0*static_cast<double>(n) + 1.0) * legendre[n] * legendre[n];
+    const double norm{1.0 / std::sqrt(energy / (order + 1.0))};
+    std::fill(hfgains.begin(), hfgains.end(), 0.0f);
+    for(size_t n{0};n <= order;++n)
+        hfgains[n] = static_cast<float>(legendre[n] * norm);
+}
+
 void InitHrtfPanning(ALCdevice *device)
 {
     constexpr float Deg180{al::numbers::pi_v<float>};
@@ -859,6 +966,8 @@ void InitHrtfPanning(ALCdevice *device)
             { "ambi1", RenderMode::Normal, 1 },
             { "ambi2", RenderMode::Normal, 2 },
             { "ambi3", RenderMode::Normal, 3 },
+            { "ambi4", RenderMode::Normal, 4 },
+            { "ambi5", RenderMode::Normal, 5 },
         };
 
         const char *mode{modeopt->c_str()};
@@ -877,6 +986,12 @@ void InitHrtfPanning(ALCdevice *device)
         {
             device->mRenderMode = iter->mode;
             ambi_order = iter->order;
+            if(ambi_order > MaxAmbiOrder)
+            {
+                WARN("HRTF mode \"%s\" exceeds the max ambisonic order, limiting to %u\n",
+                    mode, MaxAmbiOrder);
+                ambi_order = MaxAmbiOrder;
+            }
         }
     }
     TRACE("%u%s order %sHRTF rendering enabled, using \"%s\"\n", ambi_order,
@@ -890,7 +1005,17 @@ void InitHrtfPanning(ALCdevice *device)
     al::span<const AngularPoint> AmbiPoints{AmbiPoints1O};
     const float (*AmbiMatrix)[MaxAmbiChannels]{AmbiMatrix1O};
     al::span<const float,MaxAmbiOrder+1> AmbiOrderHFGain{AmbiOrderHFGain1O};
-    if(ambi_order >= 3)
+    al::vector<AngularPoint> genPoints;
+    std::unique_ptr<float[][MaxAmbiChannels]> genMatrix;
+    std::array<float,MaxAmbiOrder+1> genHFGain{};
+    if(ambi_order > 3)
+    {
+        MakeHrtfAmbiDecoder(ambi_order, genPoints, genMatrix, genHFGain);
+        AmbiPoints = genPoints;
+        AmbiMatrix = genMatrix.get();
+        AmbiOrderHFGain = genHFGain;
+    }
+    else if(ambi_order == 3)
     {
         AmbiPoints = AmbiPoints3O;
         AmbiMatrix = AmbiMatrix3O;
@@ -912,7 +1037,7 @@ void InitHrtfPanning(ALCdevice *device)
     AllocChannels(device, count, device->channelsFromFmt());
 
     HrtfStore *Hrtf{device->mHrtf.get()};
-    auto hrtfstate = DirectHrtfState::Create(count);
+    auto hrtfstate = DirectHrtfState::Create(device->mArena, count);
     hrtfstate->build(Hrtf, device->mIrSize, AmbiPoints, AmbiMatrix, device->mXOverFreq,
         AmbiOrderHFGain);
     device->mHrtfState = std::move(hrtfstate);
@@ -1048,10 +1173,16 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, al::optional<StereoEncoding
         if(device->mHrtfList.empty())
             device->enumerateHrtfs();
 
+        const float hrtf_error{device->configValue<float>(nullptr, "hrtf-max-error")
+            .value_or(0.0f)};
+        const uint hrtf_grid{device->configValue<uint>(nullptr, "hrtf-grid-memory")
+            .value_or(0u)};
+
         if(hrtf_id >= 0 && static_cast<uint>(hrtf_id) < device->mHrtfList.size())
         {
             const std::string &hrtfname = device->mHrtfList[static_cast<uint>(hrtf_id)];
-            if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency)})
+            if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency, hrtf_error,
+                hrtf_grid)})
             {
                 device->mHrtf = std::move(hrtf);
                 device->mHrtfName = hrtfname;
@@ -1062,7 +1193,8 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, al::optional<StereoEncoding
         {
             for(const auto &hrtfname : device->mHrtfList)
             {
-                if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency)})
+                if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency, hrtf_error,
+                    hrtf_grid)})
                 {
                     device->mHrtf = std::move(hrtf);
                     device->mHrtfName = hrtfname;
@@ -1093,8 +1225,12 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, al::optional<StereoEncoding
 
     if(stereomode.value_or(StereoEncoding::Default) == StereoEncoding::Uhj)
     {
-        device->mUhjEncoder = std::make_unique<UhjEncoder>();
-        TRACE("UHJ enabled\n");
+        if(UhjEncodeQuality == UhjQualityType::IIR)
+            device->mUhjEncoder = al::make_arena<UhjEncoderIIR>(device->mArena);
+        else
+            device->mUhjEncoder = al::make_arena<UhjEncoder>(device->mArena);
+        TRACE("UHJ enabled (%s encoder)\n",
+            (UhjEncodeQuality == UhjQualityType::IIR) ? "IIR" : "FIR");
         InitUhjPanning(device);
         device->PostProcess = &ALCdevice::ProcessUhj;
         return;
@@ -1107,7 +1243,7 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, al::optional<StereoEncoding
         {
             if(*cflevopt > 0 && *cflevopt <= 6)
             {
-                device->Bs2b = std::make_unique<bs2b>();
+                device->Bs2b = al::make_arena<bs2b>(device->mArena);
                 bs2b_set_params(device->Bs2b.get(), *cflevopt,
                     static_cast<int>(device->Frequency));
                 TRACE("BS2B enabled\n");
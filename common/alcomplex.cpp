@@ -4,11 +4,18 @@
 #include "alcomplex.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
 #include <utility>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "albit.h"
 #include "alnumbers.h"
 #include "alnumeric.h"
@@ -91,9 +98,37 @@ constexpr al::span<const ushort2> gBitReverses[11]{
     BitReverser10.mData
 };
 
-} // namespace
+/* Twiddle factors for float FFTs, being e^(-i*pi*j/1024) for j in [0...1024).
+ * A stage with a half-size of n uses every (1024/n)th entry.
+ */
+constexpr size_t MaxFloatTwiddles{1024};
+auto InitFloatTwiddles()
+{
+    std::array<std::complex<float>,MaxFloatTwiddles> ret{};
+    for(size_t j{0};j < MaxFloatTwiddles;++j)
+    {
+        const double arg{-al::numbers::pi * static_cast<double>(j) / double{MaxFloatTwiddles}};
+        ret[j] = std::complex<float>{static_cast<float>(std::cos(arg)),
+            static_cast<float>(std::sin(arg))};
+    }
+    return ret;
+}
+alignas(16) const auto gFloatTwiddles = InitFloatTwiddles();
 
-void complex_fft(const al::span<std::complex<double>> buffer, const double sign)
+/* Gets e^(-i*pi*k/n), from the table with the given stride if n is small
+ * enough for it (stride is 0 otherwise).
+ */
+inline std::complex<float> GetFloatTwiddle(const size_t k, const size_t n, const size_t stride)
+{
+    if(likely(stride != 0))
+        return gFloatTwiddles[k * stride];
+    const double arg{-al::numbers::pi * static_cast<double>(k) / static_cast<double>(n)};
+    return std::complex<float>{static_cast<float>(std::cos(arg)),
+        static_cast<float>(std::sin(arg))};
+}
+
+template<typename Real>
+void complex_fft_impl(const al::span<std::complex<Real>> buffer, const double sign)
 {
     const size_t fftsize{buffer.size()};
     /* Get the number of bits used for indexing. Simplifies bit-reversal and
@@ -127,14 +162,18 @@ void complex_fft(const al::span<std::complex<double>> buffer, const double sign)
         const double arg{pi / static_cast<double>(step2)};
 
         /* TODO: Would std::polar(1.0, arg) be any better? */
+        /* The twiddle factor is accumulated in double precision, so a float
+         * transform doesn't lose accuracy with larger sizes.
+         */
         const std::complex<double> w{std::cos(arg), std::sin(arg)};
         std::complex<double> u{1.0, 0.0};
         const size_t step{step2 << 1};
         for(size_t j{0};j < step2;j++)
         {
+            const std::complex<Real> ur{static_cast<Real>(u.real()), static_cast<Real>(u.imag())};
             for(size_t k{j};k < fftsize;k+=step)
             {
-                std::complex<double> temp{buffer[k+step2] * u};
+                std::complex<Real> temp{buffer[k+step2] * ur};
                 buffer[k+step2] = buffer[k] - temp;
                 buffer[k] += temp;
             }
@@ -146,6 +185,179 @@ void complex_fft(const al::span<std::complex<double>> buffer, const double sign)
     }
 }
 
+} // namespace
+
+void complex_fft(const al::span<std::complex<double>> buffer, const double sign)
+{ complex_fft_impl(buffer, sign); }
+
+void complex_fft(const al::span<std::complex<float>> buffer, const float sign)
+{
+    const size_t fftsize{buffer.size()};
+    const size_t log2_size{static_cast<size_t>(al::countr_zero(fftsize))};
+    if(unlikely(log2_size >= al::size(gBitReverses)) || fftsize < 2)
+        return complex_fft_impl(buffer, sign);
+
+    for(auto &rev : gBitReverses[log2_size])
+        std::swap(buffer[rev.first], buffer[rev.second]);
+
+    /* The first stage has no twiddle, combining adjacent pairs. */
+    for(size_t k{0};k < fftsize;k+=2)
+    {
+        const std::complex<float> temp{buffer[k+1]};
+        buffer[k+1] = buffer[k] - temp;
+        buffer[k] += temp;
+    }
+
+    /* The remaining stages handle two butterflies at a time, taking the
+     * twiddles from the table (conjugated for the inverse).
+     */
+    float *data{reinterpret_cast<float*>(buffer.data())};
+    const std::complex<float> *twiddles{gFloatTwiddles.data()};
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 twsign{(sign > 0.0f) ? _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f) : _mm_setzero_ps()};
+    const __m128 mulsign{_mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f)};
+#elif defined(HAVE_NEON)
+    alignas(16) static constexpr float conj_signs[4]{1.0f, -1.0f, 1.0f, -1.0f};
+    alignas(16) static constexpr float mul_signs[4]{-1.0f, 1.0f, -1.0f, 1.0f};
+    const float32x4_t twsign{(sign > 0.0f) ? vld1q_f32(conj_signs) : vdupq_n_f32(1.0f)};
+    const float32x4_t mulsign{vld1q_f32(mul_signs)};
+#else
+    const float twsign{(sign > 0.0f) ? -1.0f : 1.0f};
+#endif
+    for(size_t step2{2};step2 < fftsize;step2<<=1)
+    {
+        const size_t twstride{MaxFloatTwiddles / step2};
+        const size_t step{step2 << 1};
+        for(size_t k{0};k < fftsize;k+=step)
+        {
+            float *RESTRICT a{data + k*2};
+            float *RESTRICT b{data + (k+step2)*2};
+            for(size_t j{0};j < step2;j+=2)
+            {
+#ifdef HAVE_SSE_INTRINSICS
+                __m128 w{_mm_loadl_pi(_mm_setzero_ps(),
+                    reinterpret_cast<const __m64*>(&twiddles[j*twstride]))};
+                w = _mm_loadh_pi(w, reinterpret_cast<const __m64*>(&twiddles[(j+1)*twstride]));
+                w = _mm_xor_ps(w, twsign);
+                const __m128 wr{_mm_shuffle_ps(w, w, _MM_SHUFFLE(2,2,0,0))};
+                const __m128 wi{_mm_shuffle_ps(w, w, _MM_SHUFFLE(3,3,1,1))};
+
+                const __m128 b4{_mm_loadu_ps(&b[j*2])};
+                const __m128 bswap{_mm_shuffle_ps(b4, b4, _MM_SHUFFLE(2,3,0,1))};
+                const __m128 temp{_mm_add_ps(_mm_mul_ps(b4, wr),
+                    _mm_xor_ps(_mm_mul_ps(bswap, wi), mulsign))};
+
+                const __m128 a4{_mm_loadu_ps(&a[j*2])};
+                _mm_storeu_ps(&b[j*2], _mm_sub_ps(a4, temp));
+                _mm_storeu_ps(&a[j*2], _mm_add_ps(a4, temp));
+#elif defined(HAVE_NEON)
+                float32x4_t w{vcombine_f32(
+                    vld1_f32(reinterpret_cast<const float*>(&twiddles[j*twstride])),
+                    vld1_f32(reinterpret_cast<const float*>(&twiddles[(j+1)*twstride])))};
+                w = vmulq_f32(w, twsign);
+                const float32x4x2_t wri{vtrnq_f32(w, w)};
+
+                const float32x4_t b4{vld1q_f32(&b[j*2])};
+                const float32x4_t bswap{vrev64q_f32(b4)};
+                const float32x4_t temp{vmlaq_f32(vmulq_f32(b4, wri.val[0]),
+                    vmulq_f32(bswap, mulsign), wri.val[1])};
+
+                const float32x4_t a4{vld1q_f32(&a[j*2])};
+                vst1q_f32(&b[j*2], vsubq_f32(a4, temp));
+                vst1q_f32(&a[j*2], vaddq_f32(a4, temp));
+#else
+                for(size_t i{0};i < 2;++i)
+                {
+                    const std::complex<float> &w = twiddles[(j+i)*twstride];
+                    const float wr{w.real()}, wi{w.imag() * twsign};
+                    const float br{b[(j+i)*2]}, bi{b[(j+i)*2 + 1]};
+                    const float tr{br*wr - bi*wi}, ti{br*wi + bi*wr};
+                    const float ar{a[(j+i)*2]}, ai{a[(j+i)*2 + 1]};
+                    b[(j+i)*2] = ar - tr;
+                    b[(j+i)*2 + 1] = ai - ti;
+                    a[(j+i)*2] = ar + tr;
+                    a[(j+i)*2 + 1] = ai + ti;
+                }
+#endif
+            }
+        }
+    }
+}
+
+void forward_real_fft(const al::span<std::complex<float>> buffer)
+{
+    const size_t halfsize{buffer.size()};
+    const size_t twstride{(halfsize <= MaxFloatTwiddles) ? MaxFloatTwiddles/halfsize : 0};
+    forward_fft(buffer);
+
+    /* The even samples' response is (Z[k] + conj(Z[N/2-k]))/2, and the odd
+     * samples' response is (Z[k] - conj(Z[N/2-k]))/2i, which combine as
+     * X[k] = E[k] + W^k*O[k] and X[N/2-k] = conj(E[k] - W^k*O[k]).
+     */
+    float *data{reinterpret_cast<float*>(buffer.data())};
+    for(size_t k{1};k < halfsize/2;++k)
+    {
+        float *z0{data + k*2};
+        float *z1{data + (halfsize-k)*2};
+        const float evenr{(z0[0] + z1[0]) * 0.5f};
+        const float eveni{(z0[1] - z1[1]) * 0.5f};
+        const float oddr{(z0[1] + z1[1]) * 0.5f};
+        const float oddi{(z1[0] - z0[0]) * 0.5f};
+
+        const std::complex<float> w{GetFloatTwiddle(k, halfsize, twstride)};
+        const float woddr{oddr*w.real() - oddi*w.imag()};
+        const float woddi{oddr*w.imag() + oddi*w.real()};
+
+        z0[0] = evenr + woddr;
+        z0[1] = eveni + woddi;
+        z1[0] = evenr - woddr;
+        z1[1] = woddi - eveni;
+    }
+    if(halfsize > 1)
+        buffer[halfsize/2] = std::conj(buffer[halfsize/2]);
+
+    /* DC and Nyquist are both real, so pack them into the first bin. */
+    const float z0r{buffer[0].real()}, z0i{buffer[0].imag()};
+    buffer[0] = std::complex<float>{z0r + z0i, z0r - z0i};
+}
+
+void inverse_real_fft(const al::span<std::complex<float>> buffer)
+{
+    const size_t halfsize{buffer.size()};
+    const size_t twstride{(halfsize <= MaxFloatTwiddles) ? MaxFloatTwiddles/halfsize : 0};
+
+    /* Reverse of the above, rebuilding the N/2-point response of the packed
+     * even and odd samples, Z[k] = E[k] + i*O[k].
+     */
+    const float dc{buffer[0].real()}, nyq{buffer[0].imag()};
+    buffer[0] = std::complex<float>{(dc + nyq) * 0.5f, (dc - nyq) * 0.5f};
+
+    float *data{reinterpret_cast<float*>(buffer.data())};
+    for(size_t k{1};k < halfsize/2;++k)
+    {
+        float *x0{data + k*2};
+        float *x1{data + (halfsize-k)*2};
+        const float evenr{(x0[0] + x1[0]) * 0.5f};
+        const float eveni{(x0[1] - x1[1]) * 0.5f};
+        const float dr{(x0[0] - x1[0]) * 0.5f};
+        const float di{(x0[1] + x1[1]) * 0.5f};
+
+        /* Multiply by the conjugate twiddle, W^-k. */
+        const std::complex<float> w{GetFloatTwiddle(k, halfsize, twstride)};
+        const float oddr{dr*w.real() + di*w.imag()};
+        const float oddi{di*w.real() - dr*w.imag()};
+
+        x0[0] = evenr - oddi;
+        x0[1] = eveni + oddr;
+        x1[0] = evenr + oddi;
+        x1[1] = oddr - eveni;
+    }
+    if(halfsize > 1)
+        buffer[halfsize/2] = std::conj(buffer[halfsize/2]);
+
+    inverse_fft(buffer);
+}
+
 void complex_hilbert(const al::span<std::complex<double>> buffer)
 {
     inverse_fft(buffer);
@@ -11,6 +11,7 @@
  * the data supplied in the buffer, which MUST BE power of two.
  */
 void complex_fft(const al::span<std::complex<double>> buffer, const double sign);
+void complex_fft(const al::span<std::complex<float>> buffer, const float sign);
 
 /**
  * Calculate the frequency-domain response of the time-domain signal in the
@@ -26,6 +27,27 @@ inline void forward_fft(const al::span<std::complex<double>> buffer)
 inline void inverse_fft(const al::span<std::complex<double>> buffer)
 { complex_fft(buffer, 1.0); }
 
+inline void forward_fft(const al::span<std::complex<float>> buffer)
+{ complex_fft(buffer, -1.0f); }
+inline void inverse_fft(const al::span<std::complex<float>> buffer)
+{ complex_fft(buffer, 1.0f); }
+
+/**
+ * Calculate the frequency-domain response of a real time-domain signal of N
+ * samples, packed into the N/2 complex values of the buffer (even samples in
+ * the real parts, odd samples in the imaginary parts). N MUST BE power of two.
+ * The buffer is replaced with the first N/2 frequency bins, with the (real)
+ * Nyquist bin stored in the imaginary part of the (real) DC bin.
+ */
+void forward_real_fft(const al::span<std::complex<float>> buffer);
+
+/**
+ * Calculate the real time-domain signal of the packed frequency-domain
+ * response in the buffer, as given by forward_real_fft. The resulting samples
+ * are packed the same way, and scaled by N/2.
+ */
+void inverse_real_fft(const al::span<std::complex<float>> buffer);
+
 /**
  * Calculate the complex helical sequence (discrete-time analytical signal) of
  * the given input using the discrete Hilbert transform (In-place algorithm).
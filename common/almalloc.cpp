@@ -5,12 +5,29 @@
 
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
 #endif
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+
+namespace {
+
+/* Arena blocks are at least this big, so small setups fit in one block. */
+constexpr size_t ArenaMinBlockSize{64 * 1024};
+
+/* Size of a (transparent) huge page, which blocks are rounded up to and
+ * aligned to when requesting them.
+ */
+constexpr size_t HugePageSize{2 * 1024 * 1024};
+
+} // namespace
 
 
 void *al_malloc(size_t alignment, size_t size)
@@ -59,3 +76,77 @@ void al_free(void *ptr) noexcept
         std::free(*(static_cast<void**>(ptr) - 1));
 #endif
 }
+
+
+bool al::arena::addBlock(size_t minsize) noexcept
+{
+    size_t total{std::max(minsize+sHeaderSize, ArenaMinBlockSize)};
+    size_t alignment{sHeaderSize};
+    if(mHugePages)
+    {
+        total = (total+HugePageSize-1) & ~(HugePageSize-1);
+        alignment = HugePageSize;
+    }
+
+    void *mem{al_malloc(alignment, total)};
+    if(!mem) return false;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if(mHugePages)
+        madvise(mem, total, MADV_HUGEPAGE);
+#endif
+
+    mHead = ::new(mem) Block{mHead, total, mHugePages};
+    mCurrent = static_cast<char*>(mem) + sHeaderSize;
+    mEnd = static_cast<char*>(mem) + total;
+    return true;
+}
+
+void al::arena::releaseBlocks() noexcept
+{
+    while(Block *block{mHead})
+    {
+        mHead = block->mNext;
+        al_free(block);
+    }
+    mCurrent = nullptr;
+    mEnd = nullptr;
+}
+
+void *al::arena::allocate(size_t alignment, size_t size)
+{
+    assert((alignment & (alignment-1)) == 0);
+
+    auto offset = reinterpret_cast<uintptr_t>(mCurrent) & (alignment-1);
+    size_t padding{offset ? alignment-offset : 0};
+    if(!mHead || size+padding > static_cast<size_t>(mEnd-mCurrent))
+    {
+        /* Any remaining space in the current block is left unused. */
+        if(!addBlock(size + std::max(alignment, sHeaderSize) - sHeaderSize))
+            throw std::bad_alloc();
+        offset = reinterpret_cast<uintptr_t>(mCurrent) & (alignment-1);
+        padding = offset ? alignment-offset : 0;
+    }
+
+    void *ret{mCurrent + padding};
+    std::memset(ret, 0, size);
+    mCurrent += padding + size;
+    mUsed += padding + size;
+    return ret;
+}
+
+void al::arena::reset() noexcept
+{
+    if(mHead && !mHead->mNext && mHead->mHugePages == mHugePages)
+    {
+        mCurrent = reinterpret_cast<char*>(mHead) + sHeaderSize;
+        mUsed = 0;
+        return;
+    }
+
+    const size_t needed{mUsed};
+    releaseBlocks();
+    mUsed = 0;
+    /* If this fails, a block will be allocated as needed later. */
+    if(needed > 0)
+        addBlock(needed);
+}
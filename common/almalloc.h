@@ -106,6 +106,72 @@ template<typename T, std::size_t N, typename U, std::size_t M>
 constexpr bool operator!=(const allocator<T,N>&, const allocator<U,M>&) noexcept { return false; }
 
 
+/* A memory arena, for objects that share a lifetime. Memory is handed out
+ * sequentially from large blocks and released all together with reset(), so
+ * objects are never freed individually. Their destructors must be run before
+ * the arena is reset or destroyed, which arena_ptr does.
+ */
+class arena {
+    struct Block {
+        Block *mNext;
+        size_t mSize;
+        bool mHugePages;
+    };
+    /* Space reserved at the start of each block for its header, keeping the
+     * allocations cache-line aligned.
+     */
+    static constexpr size_t sHeaderSize{64};
+    static_assert(sizeof(Block) <= sHeaderSize, "Arena block header is too large");
+
+    Block *mHead{nullptr};
+    char *mCurrent{nullptr};
+    char *mEnd{nullptr};
+    size_t mUsed{0u};
+    bool mHugePages{false};
+
+    bool addBlock(size_t minsize) noexcept;
+    void releaseBlocks() noexcept;
+
+public:
+    arena() = default;
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+    ~arena() { releaseBlocks(); }
+
+    /**
+     * Sets whether to request huge pages for the arena's memory, where
+     * supported. Takes effect when the arena next allocates a block.
+     */
+    void setHugePages(bool enable) noexcept { mHugePages = enable; }
+
+    /**
+     * Allocates zero-filled memory that stays valid until the arena is reset.
+     * Throws std::bad_alloc on failure.
+     */
+    [[gnu::alloc_align(2), gnu::alloc_size(3), gnu::malloc]]
+    void *allocate(size_t alignment, size_t size);
+
+    /**
+     * Releases all allocations at once. If more than one block was needed,
+     * they're replaced with a single block large enough to hold everything,
+     * so the next round of allocations is contiguous.
+     */
+    void reset() noexcept;
+
+    /** Returns the number of bytes allocated since the last reset. */
+    size_t used() const noexcept { return mUsed; }
+};
+
+/* Deleter for objects created in an arena, which only calls the destructor. */
+struct arena_delete {
+    template<typename T>
+    void operator()(T *ptr) const noexcept { ptr->~T(); }
+};
+
+template<typename T>
+using arena_ptr = std::unique_ptr<T,arena_delete>;
+
+
 template<typename T, typename ...Args>
 constexpr T* construct_at(T *ptr, Args&& ...args)
     noexcept(std::is_nothrow_constructible<T, Args...>::value)
@@ -177,6 +243,17 @@ T> uninitialized_default_construct_n(T first, N count)
 }
 
 
+/* Creates an object of type T in the arena, with the given constructor
+ * arguments.
+ */
+template<typename T, typename ...Args>
+arena_ptr<T> make_arena(arena &mem, Args&& ...args)
+{
+    void *ptr{mem.allocate(alignof(T), sizeof(T))};
+    return arena_ptr<T>{al::construct_at(static_cast<T*>(ptr), std::forward<Args>(args)...)};
+}
+
+
 /* Storage for flexible array data. This is trivially destructible if type T is
  * trivially destructible.
  */
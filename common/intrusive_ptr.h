@@ -23,6 +23,13 @@ public:
         return ref;
     }
 
+    /**
+     * Returns the current number of references. Other threads may change it at
+     * any time, so the result is only a hint unless the caller controls how
+     * new references are made.
+     */
+    unsigned int ref_count() const noexcept { return mRef.load(std::memory_order_acquire); }
+
     /**
      * Release only if doing so would not bring the object to 0 references and
      * delete it. Returns false if the object could not be released.
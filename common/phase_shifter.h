@@ -68,6 +68,11 @@ struct PhaseShifterT {
         }
     }
 
+    /* Uses precalculated coefficients, e.g. ones generated at build time. */
+    constexpr explicit PhaseShifterT(const std::array<float,FilterSize/2> &coeffs) noexcept
+        : mCoeffs{coeffs}
+    { }
+
     void process(al::span<float> dst, const float *RESTRICT src) const;
     void processAccum(al::span<float> dst, const float *RESTRICT src) const;
 
@@ -239,7 +244,7 @@ inline void PhaseShifterT<S>::processAccum(al::span<float> dst, const float *RES
             __m128 r4{_mm_add_ps(_mm_unpackhi_ps(r04, r14), _mm_unpacklo_ps(r04, r14))};
             r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
 
-            _mm_storel_pi(out, _mm_add_ps(_mm_loadl_pi(_mm_undefined_ps(), out), r4));
+            _mm_storel_pi(out, _mm_add_ps(_mm_loadl_pi(_mm_setzero_ps(), out), r4));
             ++out;
         } while(--todo);
     }
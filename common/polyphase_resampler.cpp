@@ -1,9 +1,17 @@
 
+#include "config.h"
+
 #include "polyphase_resampler.h"
 
 #include <algorithm>
 #include <cmath>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "alnumbers.h"
 #include "opthelpers.h"
 
@@ -165,6 +173,9 @@ void PPhaseResampler::init(const uint srcRate, const uint dstRate)
     mF.resize(mM);
     for(uint i{0};i < mM;i++)
         mF[i] = SincFilter(l, beta, mP, cutoff, i);
+    mFloatF.resize(mM);
+    std::transform(mF.cbegin(), mF.cend(), mFloatF.begin(),
+        [](const double f) noexcept { return static_cast<float>(f); });
 }
 
 // Perform the upsample-filter-downsample resampling operation using a
@@ -220,3 +231,59 @@ void PPhaseResampler::process(const uint inN, const double *in, const uint outN,
     if(work != out)
         std::copy_n(work, outN, out);
 }
+
+// Perform the same resampling operation for a batch of interleaved signals.
+// The filter taps are the same for every signal, so each tap is applied to a
+// whole input frame at once.
+void PPhaseResampler::processBatch(const uint inN, const float *in, const uint outN, float *out,
+    const size_t count) const
+{
+    if UNLIKELY(outN == 0 || count == 0)
+        return;
+
+    const uint p{mP}, q{mQ}, m{mM}, l{mL};
+    const float *f{mFloatF.data()};
+    for(uint i{0};i < outN;i++)
+    {
+        float *RESTRICT dst{out + i*count};
+        std::fill_n(dst, count, 0.0f);
+
+        size_t j_f{(l + q*i) % p};
+        size_t j_s{(l + q*i) / p};
+        if UNLIKELY(j_f >= m)
+            continue;
+
+        size_t filt_len{(m-j_f+p-1) / p};
+        if LIKELY(j_s+1 > inN)
+        {
+            size_t skip{std::min<size_t>(j_s+1 - inN, filt_len)};
+            j_f += p*skip;
+            j_s -= skip;
+            filt_len -= skip;
+        }
+        size_t todo{std::min<size_t>(j_s+1, filt_len)};
+        for(;todo;--todo)
+        {
+            const float *RESTRICT src{in + j_s*count};
+            const float coeff{f[j_f]};
+            size_t n{0};
+#ifdef HAVE_SSE_INTRINSICS
+            const __m128 coeff4{_mm_set1_ps(coeff)};
+            for(;count-n >= 4;n+=4)
+            {
+                const __m128 r4{_mm_mul_ps(_mm_loadu_ps(&src[n]), coeff4)};
+                _mm_storeu_ps(&dst[n], _mm_add_ps(_mm_loadu_ps(&dst[n]), r4));
+            }
+#elif defined(HAVE_NEON)
+            const float32x4_t coeff4{vdupq_n_f32(coeff)};
+            for(;count-n >= 4;n+=4)
+                vst1q_f32(&dst[n], vmlaq_f32(vld1q_f32(&dst[n]), vld1q_f32(&src[n]), coeff4));
+#endif
+            for(;n < count;++n)
+                dst[n] += src[n] * coeff;
+
+            j_f += p;
+            --j_s;
+        }
+    }
+}
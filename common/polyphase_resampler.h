@@ -1,6 +1,7 @@
 #ifndef POLYPHASE_RESAMPLER_H
 #define POLYPHASE_RESAMPLER_H
 
+#include <stddef.h>
 #include <vector>
 
 
@@ -37,9 +38,19 @@ struct PPhaseResampler {
     void init(const uint srcRate, const uint dstRate);
     void process(const uint inN, const double *in, const uint outN, double *out);
 
+    /* Resamples a batch of signals with the same length at once, using single
+     * precision. The signals are interleaved, so each input and output frame
+     * has count samples (one per signal). This is much faster for many short
+     * signals, such as a set of HRIRs. The output must not overlap the input, and
+     * separate threads may process separate batches with the same resampler.
+     */
+    void processBatch(const uint inN, const float *in, const uint outN, float *out,
+        const size_t count) const;
+
 private:
     uint mP, mQ, mM, mL;
     std::vector<double> mF;
+    std::vector<float> mFloatF;
 };
 
 #endif /* POLYPHASE_RESAMPLER_H */
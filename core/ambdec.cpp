@@ -110,7 +110,7 @@ al::optional<std::string> load_ambdec_speakers(AmbDecConf::SpeakerConf *spkrs,
     return al::nullopt;
 }
 
-al::optional<std::string> load_ambdec_matrix(float (&gains)[MaxAmbiOrder+1],
+al::optional<std::string> load_ambdec_matrix(float (&gains)[AmbDecConf::MaxOrder+1],
     AmbDecConf::CoeffArray *matrix, const std::size_t maxrow, std::istream &f, std::string &buffer)
 {
     bool gotgains{false};
@@ -36,14 +36,17 @@ struct AmbDecConf {
     size_t NumSpeakers{0};
     std::unique_ptr<SpeakerConf[]> Speakers;
 
-    using CoeffArray = std::array<float,MaxAmbiChannels>;
+    /* AmbDec files only describe decoders up to third-order. */
+    static constexpr uint MaxOrder{3};
+
+    using CoeffArray = std::array<float,AmbiChannelsFromOrder(MaxOrder)>;
     std::unique_ptr<CoeffArray[]> Matrix;
 
     /* Unused when FreqBands == 1 */
-    float LFOrderGain[MaxAmbiOrder+1]{};
+    float LFOrderGain[MaxOrder+1]{};
     CoeffArray *LFMatrix;
 
-    float HFOrderGain[MaxAmbiOrder+1]{};
+    float HFOrderGain[MaxOrder+1]{};
     CoeffArray *HFMatrix;
 
     ~AmbDecConf();
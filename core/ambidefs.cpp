@@ -17,10 +17,33 @@ constexpr std::array<float,MaxAmbiOrder+1> Ambi3DDecoderHFScale2O{{
 constexpr std::array<float,MaxAmbiOrder+1> Ambi3DDecoderHFScale3O{{
     5.89792205e-01f, 8.79693856e-01f, 1.00000000e+00f, 1.00000000e+00f
 }};
+/* The fourth- to seventh-order scales follow from the energy-normalized max-rE
+ * gains of each order's decoder, relative to the max-rE decoder of the
+ * channel's own order.
+ */
+constexpr std::array<float,MaxAmbiOrder+1> Ambi3DDecoderHFScale4O{{
+    4.86751359e-01f, 7.63980368e-01f, 1.19465343e+00f, 1.35685510e+00f, 1.00000000e+00f
+}};
+constexpr std::array<float,MaxAmbiOrder+1> Ambi3DDecoderHFScale5O{{
+    4.13913629e-01f, 6.68505518e-01f, 1.11654586e+00f, 1.44678410e+00f, 1.46033445e+00f,
+    1.00000000e+00f
+}};
+constexpr std::array<float,MaxAmbiOrder+1> Ambi3DDecoderHFScale6O{{
+    3.59840195e-01f, 5.91542422e-01f, 1.02735848e+00f, 1.42893699e+00f, 1.64582267e+00f,
+    1.53673053e+00f, 1.00000000e+00f
+}};
+constexpr std::array<float,MaxAmbiOrder+1> Ambi3DDecoderHFScale7O{{
+    3.18164323e-01f, 5.29193435e-01f, 9.42549066e-01f, 1.36905983e+00f, 1.69518128e+00f,
+    1.80423257e+00f, 1.59503939e+00f, 1.00000000e+00f
+}};
 
 inline auto& GetDecoderHFScales(uint order) noexcept
 {
-    if(order >= 3) return Ambi3DDecoderHFScale3O;
+    if(order >= 7) return Ambi3DDecoderHFScale7O;
+    if(order == 6) return Ambi3DDecoderHFScale6O;
+    if(order == 5) return Ambi3DDecoderHFScale5O;
+    if(order == 4) return Ambi3DDecoderHFScale4O;
+    if(order == 3) return Ambi3DDecoderHFScale3O;
     if(order == 2) return Ambi3DDecoderHFScale2O;
     return Ambi3DDecoderHFScale;
 }
@@ -9,9 +9,10 @@ using uint = unsigned int;
 
 /* The maximum number of Ambisonics channels. For a given order (o), the size
  * needed will be (o+1)**2, thus zero-order has 1, first-order has 4, second-
- * order has 9, third-order has 16, and fourth-order has 25.
+ * order has 9, third-order has 16, fourth-order has 25, and so on up to
+ * seventh-order with 64.
  */
-constexpr uint8_t MaxAmbiOrder{3};
+constexpr uint8_t MaxAmbiOrder{7};
 constexpr inline size_t AmbiChannelsFromOrder(size_t order) noexcept
 { return (order+1) * (order+1); }
 constexpr size_t MaxAmbiChannels{AmbiChannelsFromOrder(MaxAmbiOrder)};
@@ -48,6 +49,12 @@ struct AmbiScale {
     static auto& FromN3D() noexcept
     {
         static constexpr const std::array<float,MaxAmbiChannels> ret{{
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
             1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
             1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f
         }};
@@ -72,6 +79,54 @@ struct AmbiScale {
             2.645751311f, /* ACN 13, sqrt(7) */
             2.645751311f, /* ACN 14, sqrt(7) */
             2.645751311f, /* ACN 15, sqrt(7) */
+            3.000000000f, /* ACN 16, sqrt(9) */
+            3.000000000f, /* ACN 17, sqrt(9) */
+            3.000000000f, /* ACN 18, sqrt(9) */
+            3.000000000f, /* ACN 19, sqrt(9) */
+            3.000000000f, /* ACN 20, sqrt(9) */
+            3.000000000f, /* ACN 21, sqrt(9) */
+            3.000000000f, /* ACN 22, sqrt(9) */
+            3.000000000f, /* ACN 23, sqrt(9) */
+            3.000000000f, /* ACN 24, sqrt(9) */
+            3.316624790f, /* ACN 25, sqrt(11) */
+            3.316624790f, /* ACN 26, sqrt(11) */
+            3.316624790f, /* ACN 27, sqrt(11) */
+            3.316624790f, /* ACN 28, sqrt(11) */
+            3.316624790f, /* ACN 29, sqrt(11) */
+            3.316624790f, /* ACN 30, sqrt(11) */
+            3.316624790f, /* ACN 31, sqrt(11) */
+            3.316624790f, /* ACN 32, sqrt(11) */
+            3.316624790f, /* ACN 33, sqrt(11) */
+            3.316624790f, /* ACN 34, sqrt(11) */
+            3.316624790f, /* ACN 35, sqrt(11) */
+            3.605551275f, /* ACN 36, sqrt(13) */
+            3.605551275f, /* ACN 37, sqrt(13) */
+            3.605551275f, /* ACN 38, sqrt(13) */
+            3.605551275f, /* ACN 39, sqrt(13) */
+            3.605551275f, /* ACN 40, sqrt(13) */
+            3.605551275f, /* ACN 41, sqrt(13) */
+            3.605551275f, /* ACN 42, sqrt(13) */
+            3.605551275f, /* ACN 43, sqrt(13) */
+            3.605551275f, /* ACN 44, sqrt(13) */
+            3.605551275f, /* ACN 45, sqrt(13) */
+            3.605551275f, /* ACN 46, sqrt(13) */
+            3.605551275f, /* ACN 47, sqrt(13) */
+            3.605551275f, /* ACN 48, sqrt(13) */
+            3.872983346f, /* ACN 49, sqrt(15) */
+            3.872983346f, /* ACN 50, sqrt(15) */
+            3.872983346f, /* ACN 51, sqrt(15) */
+            3.872983346f, /* ACN 52, sqrt(15) */
+            3.872983346f, /* ACN 53, sqrt(15) */
+            3.872983346f, /* ACN 54, sqrt(15) */
+            3.872983346f, /* ACN 55, sqrt(15) */
+            3.872983346f, /* ACN 56, sqrt(15) */
+            3.872983346f, /* ACN 57, sqrt(15) */
+            3.872983346f, /* ACN 58, sqrt(15) */
+            3.872983346f, /* ACN 59, sqrt(15) */
+            3.872983346f, /* ACN 60, sqrt(15) */
+            3.872983346f, /* ACN 61, sqrt(15) */
+            3.872983346f, /* ACN 62, sqrt(15) */
+            3.872983346f, /* ACN 63, sqrt(15) */
         }};
         return ret;
     }
@@ -94,6 +149,7 @@ struct AmbiScale {
             2.231093404f, /* ACN 13 (L), sqrt(224/45) */
             1.972026594f, /* ACN 14 (N), sqrt(35)/3 */
             2.091650066f, /* ACN 15 (P), sqrt(35/8) */
+            /* FuMa is only defined up to third-order. */
         }};
         return ret;
     }
@@ -106,6 +162,10 @@ struct AmbiScale {
             1.224744871f, /* ACN  3 (X), sqrt(3/2) */
             /* Higher orders not relevant for UHJ. */
             1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
         }};
         return ret;
     }
@@ -135,6 +195,7 @@ struct AmbiIndex {
             10, /* O */
             15, /* P */
             9,  /* Q */
+            /* FuMa is only defined up to third-order. */
         }};
         return ret;
     }
@@ -155,15 +216,17 @@ struct AmbiIndex {
     static auto& FromACN() noexcept
     {
         static constexpr const std::array<uint8_t,MaxAmbiChannels> ret{{
-            0,  1,  2,  3,  4,  5,  6,  7,
-            8,  9, 10, 11, 12, 13, 14, 15
+             0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+            16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+            32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+            48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63
         }};
         return ret;
     }
     static auto& FromACN2D() noexcept
     {
         static constexpr const std::array<uint8_t,MaxAmbi2DChannels> ret{{
-            0, 1,3, 4,8, 9,15
+            0, 1,3, 4,8, 9,15, 16,24, 25,35, 36,48, 49,63
         }};
         return ret;
     }
@@ -172,13 +235,15 @@ struct AmbiIndex {
     {
         static constexpr const std::array<uint8_t,MaxAmbiChannels> ret{{
             0, 1,1,1, 2,2,2,2,2, 3,3,3,3,3,3,3,
+            4,4,4,4,4,4,4,4,4, 5,5,5,5,5,5,5,5,5,5,5,
+            6,6,6,6,6,6,6,6,6,6,6,6,6, 7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
         }};
         return ret;
     }
     static auto& OrderFrom2DChannel() noexcept
     {
         static constexpr const std::array<uint8_t,MaxAmbi2DChannels> ret{{
-            0, 1,1, 2,2, 3,3,
+            0, 1,1, 2,2, 3,3, 4,4, 5,5, 6,6, 7,7,
         }};
         return ret;
     }
@@ -16,10 +16,10 @@
 #include "opthelpers.h"
 
 
-BFormatDec::BFormatDec(const size_t inchans, const al::span<const ChannelDec> coeffs,
-    const al::span<const ChannelDec> coeffslf, const float xover_f0norm,
-    std::unique_ptr<FrontStablizer> stablizer)
-    : mStablizer{std::move(stablizer)}, mDualBand{!coeffslf.empty()}, mChannelDec{inchans}
+BFormatDec::BFormatDec(const al::span<ChannelDecoder> chandec,
+    const al::span<const ChannelDec> coeffs, const al::span<const ChannelDec> coeffslf,
+    const float xover_f0norm, al::arena_ptr<FrontStablizer> stablizer)
+    : mStablizer{std::move(stablizer)}, mDualBand{!coeffslf.empty()}, mChannelDec{chandec}
 {
     if(!mDualBand)
     {
@@ -183,10 +183,19 @@ void BFormatDec::processStablize(const al::span<FloatBufferLine> OutBuffer,
 }
 
 
-std::unique_ptr<BFormatDec> BFormatDec::Create(const size_t inchans,
+al::arena_ptr<BFormatDec> BFormatDec::Create(al::arena &mem, const size_t inchans,
     const al::span<const ChannelDec> coeffs, const al::span<const ChannelDec> coeffslf,
-    const float xover_f0norm, std::unique_ptr<FrontStablizer> stablizer)
+    const float xover_f0norm, al::arena_ptr<FrontStablizer> stablizer)
 {
-    return std::make_unique<BFormatDec>(inchans, coeffs, coeffslf, xover_f0norm,
-        std::move(stablizer));
+    /* ChannelDecoder is trivially destructible, so the decoder doesn't need to
+     * destroy them.
+     */
+    static_assert(std::is_trivially_destructible<ChannelDecoder>::value,
+        "ChannelDecoder is not trivially destructible");
+    auto *chandec = static_cast<ChannelDecoder*>(mem.allocate(alignof(ChannelDecoder),
+        sizeof(ChannelDecoder)*inchans));
+    al::uninitialized_default_construct_n(chandec, inchans);
+
+    return al::make_arena<BFormatDec>(mem, al::span<ChannelDecoder>{chandec, inchans}, coeffs,
+        coeffslf, xover_f0norm, std::move(stablizer));
 }
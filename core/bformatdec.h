@@ -11,7 +11,6 @@
 #include "bufferline.h"
 #include "devformat.h"
 #include "filters/splitter.h"
-#include "vector.h"
 
 struct FrontStablizer;
 
@@ -35,20 +34,16 @@ class BFormatDec {
 
     alignas(16) std::array<FloatBufferLine,2> mSamples;
 
-    const std::unique_ptr<FrontStablizer> mStablizer;
+    const al::arena_ptr<FrontStablizer> mStablizer;
     const bool mDualBand{false};
 
-    /* TODO: This should ideally be a FlexArray, since ChannelDecoder is rather
-     * small and only a few are needed (3, 4, 5, 7, typically). But that can
-     * only be used in a standard layout struct, and a std::unique_ptr member
-     * (mStablizer) causes GCC and Clang to warn it's not.
-     */
-    al::vector<ChannelDecoder> mChannelDec;
+    /* The channel decoders, allocated from the same arena as the decoder. */
+    const al::span<ChannelDecoder> mChannelDec;
 
 public:
-    BFormatDec(const size_t inchans, const al::span<const ChannelDec> coeffs,
+    BFormatDec(const al::span<ChannelDecoder> chandec, const al::span<const ChannelDec> coeffs,
         const al::span<const ChannelDec> coeffslf, const float xover_f0norm,
-        std::unique_ptr<FrontStablizer> stablizer);
+        al::arena_ptr<FrontStablizer> stablizer);
 
     bool hasStablizer() const noexcept { return mStablizer != nullptr; }
 
@@ -61,9 +56,9 @@ public:
         const FloatBufferLine *InSamples, const size_t lidx, const size_t ridx, const size_t cidx,
         const size_t SamplesToDo);
 
-    static std::unique_ptr<BFormatDec> Create(const size_t inchans,
+    static al::arena_ptr<BFormatDec> Create(al::arena &mem, const size_t inchans,
         const al::span<const ChannelDec> coeffs, const al::span<const ChannelDec> coeffslf,
-        const float xover_f0norm, std::unique_ptr<FrontStablizer> stablizer);
+        const float xover_f0norm, al::arena_ptr<FrontStablizer> stablizer);
 
     DEF_NEWDEL(BFormatDec)
 };
@@ -10,6 +10,7 @@
 #include <stdexcept>
 
 #include "alnumbers.h"
+#include "alspan.h"
 #include "core/mixer/defs.h"
 
 
@@ -142,6 +143,30 @@ constexpr BSincHeader bsinc12_hdr{60, 11};
 constexpr BSincHeader bsinc24_hdr{60, 23};
 
 
+#ifdef ALSOFT_GENERATED_TABLES
+
+/* The tables were calculated at build time, using the same code as below. */
+#include "bsinc_inc.h"
+
+static_assert(((bsinc24_hdr.a[0]*2 + 3) & ~3u) <= MaxResamplerPadding,
+    "MaxResamplerPadding is too small");
+
+struct BSincFilterTable {
+    const BSincHeader &hdr;
+    const float *mTable;
+
+    constexpr const BSincHeader &getHeader() const noexcept { return hdr; }
+    constexpr const float *getTable() const noexcept { return mTable; }
+};
+
+static_assert(al::size(bsinc12_table) == bsinc12_hdr.total_size, "bsinc12 table size mismatch");
+static_assert(al::size(bsinc24_table) == bsinc24_hdr.total_size, "bsinc24 table size mismatch");
+
+constexpr BSincFilterTable bsinc12_filter{bsinc12_hdr, bsinc12_table};
+constexpr BSincFilterTable bsinc24_filter{bsinc24_hdr, bsinc24_table};
+
+#else
+
 /* NOTE: GCC 5 has an issue with BSincHeader objects being in an anonymous
  * namespace while also being used as non-type template parameters.
  */
@@ -273,6 +298,8 @@ const BSincFilterArray<bsinc12_hdr> bsinc12_filter{};
 const BSincFilterArray<bsinc24_hdr> bsinc24_filter{};
 #endif
 
+#endif /* ALSOFT_GENERATED_TABLES */
+
 template<typename T>
 constexpr BSincTable GenerateBSincTable(const T &filter)
 {
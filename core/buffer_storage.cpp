@@ -40,3 +40,9 @@ uint ChannelsFromFmt(FmtChannels chans, uint ambiorder) noexcept
     }
     return 0;
 }
+
+uint64_t NextBufferGeneration() noexcept
+{
+    static std::atomic<uint64_t> generation{0u};
+    return generation.fetch_add(1u, std::memory_order_relaxed) + 1u;
+}
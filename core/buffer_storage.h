@@ -2,6 +2,7 @@
 #define CORE_BUFFER_STORAGE_H
 
 #include <atomic>
+#include <stdint.h>
 
 #include "albyte.h"
 #include "alnumeric.h"
@@ -73,6 +74,9 @@ constexpr bool Is2DAmbisonic(FmtChannels chans) noexcept
 }
 
 
+/** Returns a new, unique buffer data generation (never 0). */
+uint64_t NextBufferGeneration() noexcept;
+
 using CallbackType = int(*)(void*, void*, int);
 
 struct BufferStorage {
@@ -88,6 +92,12 @@ struct BufferStorage {
     AmbiScaling mAmbiScaling{AmbiScaling::FuMa};
     uint mAmbiOrder{0u};
 
+    /* Identifies the current sample data. It changes whenever the samples are
+     * (re)written and is unique across buffers, so data derived from the
+     * samples can be cached by it.
+     */
+    uint64_t mGeneration{0u};
+
     inline uint bytesFromFmt() const noexcept { return BytesFromFmt(mType); }
     inline uint channelsFromFmt() const noexcept
     { return ChannelsFromFmt(mChannels, mAmbiOrder); }
@@ -1,6 +1,7 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "async_event.h"
@@ -73,34 +74,38 @@ ContextBase::~ContextBase()
 }
 
 
-void ContextBase::allocVoiceChanges()
+void ContextBase::allocVoiceChanges(size_t addcount)
 {
     constexpr size_t clustersize{128};
+    /* Round the element count up to a whole number of clusters, which are
+     * allocated together.
+     */
+    addcount = (std::max<size_t>(addcount, 1)+(clustersize-1)) / clustersize * clustersize;
 
-    VoiceChangeCluster cluster{std::make_unique<VoiceChange[]>(clustersize)};
-    for(size_t i{1};i < clustersize;++i)
+    VoiceChangeCluster cluster{std::make_unique<VoiceChange[]>(addcount)};
+    for(size_t i{1};i < addcount;++i)
         cluster[i-1].mNext.store(std::addressof(cluster[i]), std::memory_order_relaxed);
-    cluster[clustersize-1].mNext.store(mVoiceChangeTail, std::memory_order_relaxed);
+    cluster[addcount-1].mNext.store(mVoiceChangeTail, std::memory_order_relaxed);
 
     mVoiceChangeClusters.emplace_back(std::move(cluster));
     mVoiceChangeTail = mVoiceChangeClusters.back().get();
 }
 
-void ContextBase::allocVoiceProps()
+void ContextBase::allocVoiceProps(size_t addcount)
 {
     constexpr size_t clustersize{32};
+    addcount = (std::max<size_t>(addcount, 1)+(clustersize-1)) / clustersize * clustersize;
 
-    TRACE("Increasing allocated voice properties to %zu\n",
-        (mVoicePropClusters.size()+1) * clustersize);
+    TRACE("Allocating %zu more voice properties\n", addcount);
 
-    VoicePropsCluster cluster{std::make_unique<VoicePropsItem[]>(clustersize)};
-    for(size_t i{1};i < clustersize;++i)
+    VoicePropsCluster cluster{std::make_unique<VoicePropsItem[]>(addcount)};
+    for(size_t i{1};i < addcount;++i)
         cluster[i-1].next.store(std::addressof(cluster[i]), std::memory_order_relaxed);
     mVoicePropClusters.emplace_back(std::move(cluster));
 
     VoicePropsItem *oldhead{mFreeVoiceProps.load(std::memory_order_acquire)};
     do {
-        mVoicePropClusters.back()[clustersize-1].next.store(oldhead, std::memory_order_relaxed);
+        mVoicePropClusters.back()[addcount-1].next.store(oldhead, std::memory_order_relaxed);
     } while(mFreeVoiceProps.compare_exchange_weak(oldhead, mVoicePropClusters.back().get(),
         std::memory_order_acq_rel, std::memory_order_acquire) == false);
 }
@@ -120,6 +125,14 @@ void ContextBase::allocVoices(size_t addcount)
     while(addcount)
     {
         mVoiceClusters.emplace_back(std::make_unique<Voice[]>(clustersize));
+        /* With preallocated voices, also reserve their storage so playing
+         * them doesn't allocate.
+         */
+        if(mPreallocVoices > 0)
+        {
+            for(size_t i{0};i < clustersize;++i)
+                mVoiceClusters.back()[i].reserve(mDevice);
+        }
         --addcount;
     }
 
@@ -4,6 +4,7 @@
 #include <array>
 #include <atomic>
 #include <cstddef>
+#include <limits>
 #include <memory>
 #include <thread>
 
@@ -48,6 +49,8 @@ struct ContextProps {
     float Gain;
     float MetersPerUnit;
     float AirAbsorptionGainHF;
+    float LodDistance;
+    float LodGain;
 
     float DopplerFactor;
     float DopplerVelocity;
@@ -72,6 +75,10 @@ struct ContextParams {
     float MetersPerUnit{1.0f};
     float AirAbsorptionGainHF{AirAbsorbGainHF};
 
+    /* Voices past these limits are mixed with reduced detail. */
+    float LodDistance{std::numeric_limits<float>::infinity()};
+    float LodGain{0.0f};
+
     float DopplerFactor{1.0f};
     float SpeedOfSound{SpeedOfSoundMetersPerSec}; /* in units per sec! */
 
@@ -91,6 +98,21 @@ struct ContextBase {
 
     float mGainBoost{1.0f};
 
+    /* How far a voice's listener-relative distance, direction (in radians,
+     * and as a cosine), and gains (as a ratio) can change before its panning
+     * is recalculated, and how many voices can have it recalculated per
+     * update (0 for no limit).
+     */
+    float mPanningDistanceLimit{0.0f};
+    float mPanningAngleLimit{0.0f};
+    float mPanningCosAngleLimit{1.0f};
+    float mPanningGainRatioLimit{1.0f};
+    uint mPanningUpdateLimit{0u};
+    /* The voice to start recalculating from next update. Only used by the
+     * mixer.
+     */
+    size_t mPanningUpdateOffset{0u};
+
     /* Linked lists of unused property containers, free to use for future
      * updates.
      */
@@ -106,8 +128,11 @@ struct ContextBase {
     VoiceChange *mVoiceChangeTail{};
     std::atomic<VoiceChange*> mCurrentVoiceChange{};
 
-    void allocVoiceChanges();
-    void allocVoiceProps();
+    /* Allocates at least the given number of voice changes or voice property
+     * items, rounded up to the cluster size.
+     */
+    void allocVoiceChanges(size_t addcount);
+    void allocVoiceProps(size_t addcount);
 
 
     ContextParams mParams;
@@ -117,6 +142,15 @@ struct ContextBase {
     std::atomic<size_t> mActiveVoiceCount{};
 
     void allocVoices(size_t addcount);
+
+    /* The number of voices, voice property items, and voice changes to have
+     * allocated up front, as requested when creating the context. Once these
+     * are allocated, any further allocations for playing, stopping, or
+     * updating sources are counted as fallbacks.
+     */
+    size_t mPreallocVoices{0u};
+    std::atomic<uint> mVoiceAllocFallbacks{0u};
+
     al::span<Voice*> getVoicesSpan() const noexcept
     {
         return {mVoices.load(std::memory_order_relaxed)->data(),
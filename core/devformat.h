@@ -70,7 +70,7 @@ enum DevFmtChannels : unsigned char {
 
     DevFmtChannelsDefault = DevFmtStereo
 };
-#define MAX_OUTPUT_CHANNELS  16
+#define MAX_OUTPUT_CHANNELS  64
 
 /* DevFmtType traits, providing the type, etc given a DevFmtType. */
 template<DevFmtType T>
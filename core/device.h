@@ -26,6 +26,7 @@
 #include "vector.h"
 
 class BFormatDec;
+class EffectThreadPool;
 struct bs2b;
 struct Compressor;
 struct ContextBase;
@@ -88,8 +89,12 @@ struct DistanceComp {
 
     DistanceComp(size_t count) : mSamples{count} { }
 
-    static std::unique_ptr<DistanceComp> Create(size_t numsamples)
-    { return std::unique_ptr<DistanceComp>{new(FamCount(numsamples)) DistanceComp{numsamples}}; }
+    static al::arena_ptr<DistanceComp> Create(al::arena &mem, size_t numsamples)
+    {
+        void *ptr{mem.allocate(alignof(DistanceComp), Sizeof(numsamples))};
+        return al::arena_ptr<DistanceComp>{al::construct_at(static_cast<DistanceComp*>(ptr),
+            numsamples)};
+    }
 
     DEF_FAM_NEWDEL(DistanceComp, mSamples)
 };
@@ -181,6 +186,10 @@ struct DeviceBase {
 
     uint SamplesDone{0u};
     std::chrono::nanoseconds ClockBase{0};
+    /* The clock time at the end of the last update, for queries that don't
+     * wait on the mixer.
+     */
+    std::atomic<std::chrono::nanoseconds> mMixClockTime{std::chrono::nanoseconds{}};
     std::chrono::nanoseconds FixedLatency{0};
 
     AmbiRotateMatrix mAmbiRotateMatrix{};
@@ -188,7 +197,7 @@ struct DeviceBase {
     /* Temp storage used for mixer processing. */
     static constexpr size_t MixerLineSize{BufferLineSize + MaxResamplerPadding +
         UhjDecoder::sFilterDelay};
-    static constexpr size_t MixerChannelsMax{16};
+    static constexpr size_t MixerChannelsMax{MaxAmbiChannels};
     using MixerBufferLine = std::array<float,MixerLineSize>;
     alignas(16) std::array<MixerBufferLine,MixerChannelsMax> mSampleData;
 
@@ -202,8 +211,14 @@ struct DeviceBase {
     /* Persistent storage for HRTF mixing. */
     alignas(16) float2 HrtfAccumData[BufferLineSize + HrirLength];
 
+    /* Storage for the mixer state that gets rebuilt when the device is
+     * (re)configured, kept together in memory. It's reset along with the
+     * objects it holds, which must be cleared first.
+     */
+    al::arena mArena;
+
     /* Mixing buffer used by the Dry mix and Real output. */
-    al::vector<FloatBufferLine, 16> MixBuffer;
+    al::span<FloatBufferLine> MixBuffer;
 
     /* The "dry" path corresponds to the main output. */
     MixParams Dry;
@@ -215,26 +230,29 @@ struct DeviceBase {
     RealMixParams RealOut;
 
     /* HRTF state and info */
-    std::unique_ptr<DirectHrtfState> mHrtfState;
+    al::arena_ptr<DirectHrtfState> mHrtfState;
     al::intrusive_ptr<HrtfStore> mHrtf;
     uint mIrSize{0};
 
     /* Ambisonic-to-UHJ encoder */
-    std::unique_ptr<UhjEncoder> mUhjEncoder;
+    al::arena_ptr<UhjEncoderBase> mUhjEncoder;
 
     /* Ambisonic decoder for speakers */
-    std::unique_ptr<BFormatDec> AmbiDecoder;
+    al::arena_ptr<BFormatDec> AmbiDecoder;
 
     /* Stereo-to-binaural filter */
-    std::unique_ptr<bs2b> Bs2b;
+    al::arena_ptr<bs2b> Bs2b;
 
     using PostProc = void(DeviceBase::*)(const size_t SamplesToDo);
     PostProc PostProcess{nullptr};
 
-    std::unique_ptr<Compressor> Limiter;
+    al::arena_ptr<Compressor> Limiter;
+
+    /* Worker threads for processing effect slots in parallel. */
+    std::unique_ptr<EffectThreadPool> mEffectThreads;
 
     /* Delay buffers used to compensate for speaker distances. */
-    std::unique_ptr<DistanceComp> ChannelDelays;
+    al::arena_ptr<DistanceComp> ChannelDelays;
 
     /* Dithering control. */
     float DitherDepth{0.0f};
@@ -308,6 +326,8 @@ private:
 
 #define RECORD_THREAD_NAME "alsoft-record"
 
+#define EFFECT_THREAD_NAME "alsoft-effect"
+
 #define INVALID_CHANNEL_INDEX ~0u
 
 #endif /* CORE_DEVICE_H */
@@ -0,0 +1,125 @@
+
+#include "config.h"
+
+#include "effect_threads.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "alnumeric.h"
+#include "device.h"
+#include "fpu_ctrl.h"
+#include "helpers.h"
+#include "opthelpers.h"
+
+
+EffectThreadPool::EffectThreadPool(const size_t numWorkers, const size_t numChannels)
+    : mWorkers{std::make_unique<Worker[]>(numWorkers)}, mNumWorkers{numWorkers}
+    , mBuffers(numWorkers*numChannels), mNumChannels{numChannels}
+    , mBufferUsed{std::make_unique<bool[]>(numWorkers)}
+{
+    std::fill_n(mBufferUsed.get(), mNumWorkers, false);
+    for(size_t i{0};i < mNumWorkers;++i)
+        mWorkers[i].mThread = std::thread{std::mem_fn(&EffectThreadPool::workerProc), this, i};
+}
+
+EffectThreadPool::~EffectThreadPool()
+{
+    mQuit.store(true, std::memory_order_release);
+    for(size_t i{0};i < mNumWorkers;++i)
+    {
+        mWorkers[i].mSem.post();
+        mWorkers[i].mThread.join();
+    }
+}
+
+
+void EffectThreadPool::workerProc(const size_t index)
+{
+    SetRTPriority();
+    althrd_setname(EFFECT_THREAD_NAME);
+
+    Worker &worker = mWorkers[index];
+    while(1)
+    {
+        worker.mSem.wait();
+        if UNLIKELY(mQuit.load(std::memory_order_acquire))
+            break;
+
+        {
+            FPUCtl mixer_mode{};
+            runJobs(index+1);
+        }
+
+        if(mRunningWorkers.fetch_sub(1u, std::memory_order_acq_rel) == 1)
+            mDoneSem.post();
+    }
+}
+
+void EffectThreadPool::runJobs(const size_t thread)
+{
+    size_t job{mNextJob.fetch_add(1u, std::memory_order_relaxed)};
+    while(job < mJobCount)
+    {
+        mFunc(mUserData, job, thread);
+        job = mNextJob.fetch_add(1u, std::memory_order_relaxed);
+    }
+}
+
+void EffectThreadPool::execute(JobFunc func, void *userdata, const size_t count)
+{
+    if(count == 0) return;
+
+    mFunc = func;
+    mUserData = userdata;
+    mJobCount = count;
+    mNextJob.store(0u, std::memory_order_relaxed);
+
+    /* Wake up to one worker less than the number of jobs, since this thread
+     * takes a job too.
+     */
+    const size_t numwake{minz(mNumWorkers, count-1)};
+    mRunningWorkers.store(numwake, std::memory_order_release);
+    for(size_t i{0};i < numwake;++i)
+        mWorkers[i].mSem.post();
+
+    runJobs(0);
+
+    if(numwake > 0)
+        mDoneSem.wait();
+}
+
+
+al::span<FloatBufferLine> EffectThreadPool::getDryBuffer(const size_t thread)
+{
+    if(thread == 0) return {};
+
+    const al::span<FloatBufferLine> buffer{&mBuffers[(thread-1)*mNumChannels], mNumChannels};
+    if(!mBufferUsed[thread-1])
+    {
+        std::for_each(buffer.begin(), buffer.end(),
+            [](FloatBufferLine &line) noexcept { line.fill(0.0f); });
+        mBufferUsed[thread-1] = true;
+    }
+    return buffer;
+}
+
+void EffectThreadPool::mergeDryBuffers(const al::span<FloatBufferLine> dryBuffer,
+    const size_t samplesToDo)
+{
+    ASSUME(samplesToDo > 0);
+
+    for(size_t i{0};i < mNumWorkers;++i)
+    {
+        if(!mBufferUsed[i]) continue;
+        mBufferUsed[i] = false;
+
+        auto src = mBuffers.cbegin() + static_cast<ptrdiff_t>(i*mNumChannels);
+        for(FloatBufferLine &dst : dryBuffer)
+        {
+            std::transform(src->cbegin(), src->cbegin()+samplesToDo, dst.cbegin(), dst.begin(),
+                std::plus<float>{});
+            ++src;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef CORE_EFFECT_THREADS_H
+#define CORE_EFFECT_THREADS_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <thread>
+
+#include "almalloc.h"
+#include "alspan.h"
+#include "bufferline.h"
+#include "threads.h"
+#include "vector.h"
+
+
+/**
+ * A pool of worker threads the mixer uses to process independent effect slots
+ * in parallel. The mixer thread takes part in the processing, so a pool with
+ * N workers processes up to N+1 jobs at once.
+ *
+ * Each thread has a private mixing buffer that mirrors the device's dry
+ * buffer, so jobs running concurrently can mix to the main output without
+ * stepping on each other. The private buffers are summed into the dry buffer
+ * after the jobs complete.
+ */
+class EffectThreadPool {
+public:
+    /* Called for each job, with the job index and the index of the thread
+     * running it (0 for the calling thread).
+     */
+    using JobFunc = void(*)(void *userdata, const size_t job, const size_t thread);
+
+private:
+    struct Worker {
+        std::thread mThread;
+        al::semaphore mSem;
+    };
+
+    std::unique_ptr<Worker[]> mWorkers;
+    size_t mNumWorkers{0};
+
+    /* The private dry mixing buffers for each worker thread. The caller has
+     * none, and mixes directly into the shared dry buffer.
+     */
+    al::vector<FloatBufferLine,16> mBuffers;
+    size_t mNumChannels{0};
+    std::unique_ptr<bool[]> mBufferUsed;
+
+    JobFunc mFunc{nullptr};
+    void *mUserData{nullptr};
+    size_t mJobCount{0};
+    std::atomic<size_t> mNextJob{0u};
+    std::atomic<size_t> mRunningWorkers{0u};
+    al::semaphore mDoneSem;
+
+    std::atomic<bool> mQuit{false};
+
+    void workerProc(const size_t index);
+    void runJobs(const size_t thread);
+
+public:
+    EffectThreadPool(const size_t numWorkers, const size_t numChannels);
+    EffectThreadPool(const EffectThreadPool&) = delete;
+    EffectThreadPool& operator=(const EffectThreadPool&) = delete;
+    ~EffectThreadPool();
+
+    size_t numWorkers() const noexcept { return mNumWorkers; }
+
+    /**
+     * Runs the given number of jobs across the worker threads and the calling
+     * thread, returning once they all complete. This must only be called from
+     * the mixer thread.
+     */
+    void execute(JobFunc func, void *userdata, const size_t count);
+
+    /**
+     * Gets the private dry mixing buffer for the given thread, clearing it the
+     * first time it's requested after a merge. The calling thread (0) gets an
+     * empty span, as it can mix to the dry buffer directly.
+     */
+    al::span<FloatBufferLine> getDryBuffer(const size_t thread);
+
+    /**
+     * Adds the private dry mixing buffers that were used into the given dry
+     * buffer.
+     */
+    void mergeDryBuffers(const al::span<FloatBufferLine> dryBuffer, const size_t samplesToDo);
+
+    DEF_NEWDEL(EffectThreadPool)
+};
+
+#endif /* CORE_EFFECT_THREADS_H */
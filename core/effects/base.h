@@ -1,6 +1,7 @@
 #ifndef CORE_EFFECTS_BASE_H
 #define CORE_EFFECTS_BASE_H
 
+#include <limits>
 #include <stddef.h>
 
 #include "albyte.h"
@@ -21,6 +22,12 @@ struct RealMixParams;
 /** Target gain for the reverb decay feedback reaching the decay time. */
 constexpr float ReverbDecayGain{0.001f}; /* -60 dB */
 
+/** Level an effect's tail must decay to before its slot can stop processing. */
+constexpr float EffectTailSilenceGain{0.00003162f}; /* -90 dB */
+
+/** Tail length for effects that may keep producing output indefinitely. */
+constexpr size_t InfiniteEffectTail{std::numeric_limits<size_t>::max()};
+
 constexpr float ReverbMaxReflectionsDelay{0.3f};
 constexpr float ReverbMaxLateReverbDelay{0.1f};
 
@@ -169,6 +176,10 @@ union EffectProps {
     struct {
         float Gain;
     } Dedicated;
+
+    struct {
+        bool TrueStereo;
+    } Convolution;
 };
 
 
@@ -177,6 +188,19 @@ struct EffectTarget {
     RealMixParams *RealOut;
 };
 
+struct EffectState;
+
+/* The most effect states that will be given to EffectState::processBatch at
+ * once.
+ */
+constexpr size_t MaxEffectBatchSize{8};
+
+struct EffectBatchItem {
+    EffectState *State;
+    al::span<const FloatBufferLine> SamplesIn;
+    al::span<FloatBufferLine> SamplesOut;
+};
+
 struct EffectState : public al::intrusive_ref<EffectState> {
     struct Buffer {
         const BufferStorage *storage;
@@ -193,6 +217,31 @@ struct EffectState : public al::intrusive_ref<EffectState> {
         const EffectProps *props, const EffectTarget target) = 0;
     virtual void process(const size_t samplesToDo, const al::span<const FloatBufferLine> samplesIn,
         const al::span<FloatBufferLine> samplesOut) = 0;
+
+    /**
+     * Returns the number of samples the effect keeps producing output for
+     * after its input goes silent, until it decays below
+     * EffectTailSilenceGain. Slots whose input has been silent for longer
+     * than this skip processing. The default is unbounded, so the effect is
+     * always processed.
+     */
+    virtual size_t getTailLength() const noexcept { return InfiniteEffectTail; }
+
+    /**
+     * Returns a key shared by all effect states that can be processed together
+     * with processBatch, or nullptr if this state is always processed alone.
+     */
+    virtual const void *getBatchKey() const noexcept { return nullptr; }
+    /**
+     * Processes a group of effect states with the same batch key in one pass.
+     * This state is the first item. The default just processes each state in
+     * turn.
+     */
+    virtual void processBatch(const size_t samplesToDo, const al::span<const EffectBatchItem> items)
+    {
+        for(const EffectBatchItem &item : items)
+            item.State->process(samplesToDo, item.SamplesIn, item.SamplesOut);
+    }
 };
 
 
@@ -66,6 +66,19 @@ struct EffectSlot {
     bool  AuxSendAuto{true};
     EffectSlot *Target{nullptr};
 
+    /* The slot's processing level, set by the mixer when sorting the slots.
+     * Slots on the same level don't target each other.
+     */
+    unsigned int mGraphLevel{0};
+
+    /* Activity tracking, set by the mixer. The wet buffer is only cleared if
+     * something was mixed into it, and the effect is only processed if it
+     * received non-silent input, or its tail hasn't decayed since.
+     */
+    bool mWetDirty{true};
+    bool mHasInput{false};
+    size_t mIdleSamples{0};
+
     EffectSlotType EffectType{EffectSlotType::None};
     EffectProps mEffectProps{};
     al::intrusive_ptr<EffectState> mEffectState;
@@ -27,8 +27,12 @@ struct FrontStablizer {
     using DelayLine = std::array<float,DelayLength>;
     al::FlexArray<DelayLine,16> DelayBuf;
 
-    static std::unique_ptr<FrontStablizer> Create(size_t numchans)
-    { return std::unique_ptr<FrontStablizer>{new(FamCount(numchans)) FrontStablizer{numchans}}; }
+    static al::arena_ptr<FrontStablizer> Create(al::arena &mem, size_t numchans)
+    {
+        void *ptr{mem.allocate(alignof(FrontStablizer), Sizeof(numchans))};
+        return al::arena_ptr<FrontStablizer>{al::construct_at(static_cast<FrontStablizer*>(ptr),
+            numchans)};
+    }
 
     DEF_FAM_NEWDEL(FrontStablizer, DelayBuf)
 };
@@ -170,6 +170,28 @@ al::vector<std::string> SearchDataFiles(const char *ext, const char *subdir)
     return results;
 }
 
+std::string GetUserCachePath(const char *subdir)
+{
+    WCHAR buffer[MAX_PATH];
+    if(SHGetSpecialFolderPathW(nullptr, buffer, CSIDL_LOCAL_APPDATA, FALSE) == FALSE)
+        return std::string{};
+
+    std::wstring path{buffer};
+    if(path.back() != '\\' && path.back() != '/')
+        path += L'\\';
+    path += L"openal";
+    CreateDirectoryW(path.c_str(), nullptr);
+    path += L'\\';
+    path += utf8_to_wstr(subdir);
+    std::replace(path.begin(), path.end(), L'/', L'\\');
+    if(!CreateDirectoryW(path.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        WARN("Failed to create cache directory %s\n", wstr_to_utf8(path.c_str()).c_str());
+        return std::string{};
+    }
+    return wstr_to_utf8(path.c_str());
+}
+
 void SetRTPriority(void)
 {
     if(RTPrioLevel > 0)
@@ -182,6 +204,7 @@ void SetRTPriority(void)
 #else
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <dirent.h>
 #ifdef __FreeBSD__
@@ -425,6 +448,47 @@ al::vector<std::string> SearchDataFiles(const char *ext, const char *subdir)
     return results;
 }
 
+std::string GetUserCachePath(const char *subdir)
+{
+    std::string path;
+    if(auto cachepath = al::getenv("XDG_CACHE_HOME"))
+        path = std::move(*cachepath);
+    else if(auto homepath = al::getenv("HOME"))
+    {
+        path = std::move(*homepath);
+        if(!path.empty() && path.back() == '/')
+            path.pop_back();
+        path += "/.cache";
+    }
+    if(path.empty() || path[0] != '/')
+        return std::string{};
+
+    if(path.back() != '/')
+        path += '/';
+    path += "openal/";
+    path += subdir;
+
+    /* Create each missing directory along the path. */
+    size_t curpos{1};
+    do {
+        const size_t nextpos{path.find('/', curpos)};
+        const std::string dirname{path.substr(0, nextpos)};
+        struct stat st{};
+        if(stat(dirname.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            if(mkdir(dirname.c_str(), 0755) != 0 && errno != EEXIST)
+            {
+                WARN("Failed to create cache directory %s: %s\n", dirname.c_str(),
+                    strerror(errno));
+                return std::string{};
+            }
+        }
+        curpos = (nextpos != std::string::npos) ? nextpos+1 : nextpos;
+    } while(curpos < path.size());
+
+    return path;
+}
+
 namespace {
 
 bool SetRTPriorityPthread(int prio)
@@ -15,4 +15,9 @@ void SetRTPriority(void);
 
 al::vector<std::string> SearchDataFiles(const char *match, const char *subdir);
 
+/* Returns the path to the named subdirectory of the user's cache directory,
+ * creating it as needed. An empty string is returned if it's unavailable.
+ */
+std::string GetUserCachePath(const char *subdir);
+
 #endif /* CORE_HELPERS_H */
@@ -7,20 +7,31 @@
 #include <array>
 #include <cassert>
 #include <cctype>
+#include <cinttypes>
 #include <cmath>
+#include <complex>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <exception>
 #include <fstream>
 #include <iterator>
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "albit.h"
 #include "albyte.h"
+#include "alcomplex.h"
 #include "alfstream.h"
 #include "almalloc.h"
 #include "alnumbers.h"
@@ -36,6 +47,10 @@
 #include "polyphase_resampler.h"
 #include "vector.h"
 
+#ifdef _WIN32
+#include "strutils.h"
+#endif
+
 
 namespace {
 
@@ -50,8 +65,21 @@ HrtfEntry::~HrtfEntry() = default;
 
 struct LoadedHrtf {
     std::string mFilename;
+    /* The spectral error target the IRs were reduced with, in 1/100th dB (0
+     * if unprocessed).
+     */
+    uint mErrorTarget;
+    /* The memory size of the pre-blended response grid, in KB (0 if none). */
+    uint mGridMemory;
     std::unique_ptr<HrtfStore> mEntry;
+
+    LoadedHrtf(LoadedHrtf&&) = default;
+    LoadedHrtf& operator=(LoadedHrtf&&) = default;
+
+    /* GCC warns when it tries to inline this. */
+    ~LoadedHrtf();
 };
+LoadedHrtf::~LoadedHrtf() = default;
 
 /* Data set limits must be the same as or more flexible than those defined in
  * the makemhr utility.
@@ -207,6 +235,44 @@ void GetHrtfCoeffs(const HrtfStore *Hrtf, float elevation, float azimuth, float
         ++field;
     }
 
+    if(!Hrtf->gridCoeffs.empty())
+    {
+        /* Fetch the nearest pre-blended response from the grid. */
+        const uint evcount{Hrtf->gridEvCount};
+        const uint azcount{Hrtf->gridAzCount};
+        const float ev{(al::numbers::pi_v<float>*0.5f + elevation) * static_cast<float>(evcount-1)
+            / al::numbers::pi_v<float>};
+        const float az{(al::numbers::pi_v<float>*2.0f + azimuth) * static_cast<float>(azcount)
+            / (al::numbers::pi_v<float>*2.0f)};
+        const size_t fidx{static_cast<size_t>(field - Hrtf->field)};
+        const size_t gidx{(fidx*evcount + minu(float2uint(ev + 0.5f), evcount-1))*azcount
+            + float2uint(az + 0.5f)%azcount};
+
+        const ubyte2 &srcdelays = Hrtf->gridDelays[gidx];
+        delays[0] = srcdelays[0];
+        delays[1] = srcdelays[1];
+
+        const size_t irsize{Hrtf->gridIrSize};
+        const float *srccoeffs{al::assume_aligned<16>(Hrtf->gridCoeffs[gidx*irsize].data())};
+        float *coeffout{al::assume_aligned<16>(&coeffs[0][0])};
+#ifdef HAVE_SSE_INTRINSICS
+        const __m128 gain4{_mm_set1_ps(dirfact)};
+        for(size_t i{0};i < irsize*2;i += 4)
+            _mm_store_ps(coeffout+i, _mm_mul_ps(_mm_load_ps(srccoeffs+i), gain4));
+#elif defined(HAVE_NEON)
+        const float32x4_t gain4{vdupq_n_f32(dirfact)};
+        for(size_t i{0};i < irsize*2;i += 4)
+            vst1q_f32(coeffout+i, vmulq_f32(vld1q_f32(srccoeffs+i), gain4));
+#else
+        std::transform(srccoeffs, srccoeffs + irsize*2, coeffout,
+            [dirfact](const float src) noexcept -> float { return src * dirfact; });
+#endif
+        std::fill(coeffout + irsize*2, coeffout + size_t{HrirLength}*2, 0.0f);
+        coeffout[0] += PassthruCoeff * (1.0f-dirfact);
+        coeffout[1] += PassthruCoeff * (1.0f-dirfact);
+        return;
+    }
+
     /* Calculate the elevation indices. */
     const auto elev0 = CalcEvIndex(field->evCount, elevation);
     const size_t elev1_idx{minu(elev0.idx+1, field->evCount-1)};
@@ -259,8 +325,12 @@ void GetHrtfCoeffs(const HrtfStore *Hrtf, float elevation, float azimuth, float
 }
 
 
-std::unique_ptr<DirectHrtfState> DirectHrtfState::Create(size_t num_chans)
-{ return std::unique_ptr<DirectHrtfState>{new(FamCount(num_chans)) DirectHrtfState{num_chans}}; }
+al::arena_ptr<DirectHrtfState> DirectHrtfState::Create(al::arena &mem, size_t num_chans)
+{
+    void *ptr{mem.allocate(alignof(DirectHrtfState), Sizeof(num_chans))};
+    return al::arena_ptr<DirectHrtfState>{al::construct_at(static_cast<DirectHrtfState*>(ptr),
+        num_chans)};
+}
 
 void DirectHrtfState::build(const HrtfStore *Hrtf, const uint irSize,
     const al::span<const AngularPoint> AmbiPoints, const float (*AmbiMatrix)[MaxAmbiChannels],
@@ -1109,6 +1179,314 @@ std::unique_ptr<HrtfStore> LoadHrtf03(std::istream &data, const char *filename)
 }
 
 
+std::unique_ptr<HrtfStore> LoadHrtf(std::istream &data, const char *name)
+{
+    char magic[sizeof(magicMarker03)];
+    data.read(magic, sizeof(magic));
+    if(data.gcount() < static_cast<std::streamsize>(sizeof(magicMarker03)))
+        ERR("%s data is too short (%zu bytes)\n", name, data.gcount());
+    else if(memcmp(magic, magicMarker03, sizeof(magicMarker03)) == 0)
+    {
+        TRACE("Detected data set format v3\n");
+        return LoadHrtf03(data, name);
+    }
+    else if(memcmp(magic, magicMarker02, sizeof(magicMarker02)) == 0)
+    {
+        TRACE("Detected data set format v2\n");
+        return LoadHrtf02(data, name);
+    }
+    else if(memcmp(magic, magicMarker01, sizeof(magicMarker01)) == 0)
+    {
+        TRACE("Detected data set format v1\n");
+        return LoadHrtf01(data, name);
+    }
+    else if(memcmp(magic, magicMarker00, sizeof(magicMarker00)) == 0)
+    {
+        TRACE("Detected data set format v0\n");
+        return LoadHrtf00(data, name);
+    }
+    else
+        ERR("Invalid header in %s: \"%.8s\"\n", name, magic);
+    return nullptr;
+}
+
+
+/* The version of the processing applied to cached data sets. This must be
+ * bumped whenever the resampling, MinimumPhaseHrirs, or ReduceHrirSize change
+ * their output, so stale cache files aren't loaded.
+ */
+constexpr uint HrtfCacheVersion{1};
+
+/* The FFT size used for minimum-phase reconstruction, large enough to avoid
+ * significant time-aliasing of the reconstructed responses.
+ */
+constexpr size_t MinPhaseFftSize{HrirLength * 4};
+/* The FFT size used to measure the spectral error of shortened responses. */
+constexpr size_t ErrorFftSize{HrirLength * 2};
+
+/* Converts the first irSize coefficients of each HRIR to minimum phase. The
+ * data sets are expected to already be minimum phase with separate delays,
+ * but resampling and truncation can spread the energy out again.
+ */
+void MinimumPhaseHrirs(const al::span<HrirArray> coeffs, const uint irSize)
+{
+    auto fftbuf = al::vector<std::complex<double>>(MinPhaseFftSize);
+    auto mags = al::vector<double>(MinPhaseFftSize);
+    for(HrirArray &hrir : coeffs)
+    {
+        for(size_t j{0};j < 2;++j)
+        {
+            auto fftiter = std::transform(hrir.cbegin(), hrir.cbegin()+irSize, fftbuf.begin(),
+                [j](const float2 &in) noexcept -> std::complex<double> { return in[j]; });
+            std::fill(fftiter, fftbuf.end(), std::complex<double>{});
+            forward_fft(fftbuf);
+
+            double maxmag{0.0};
+            for(size_t i{0};i < MinPhaseFftSize;++i)
+            {
+                mags[i] = std::abs(fftbuf[i]);
+                maxmag = std::max(maxmag, mags[i]);
+            }
+            if(!(maxmag > 0.0))
+                continue;
+
+            /* Limit the depth of any nulls (-100dB) so the log magnitude stays
+             * finite, then use the Hilbert transform of the log magnitude to
+             * get the minimum-phase angles.
+             */
+            const double magfloor{maxmag * 0.00001};
+            for(size_t i{0};i < MinPhaseFftSize;++i)
+            {
+                mags[i] = std::max(mags[i], magfloor);
+                fftbuf[i] = std::log(mags[i]);
+            }
+            complex_hilbert(fftbuf);
+            for(size_t i{0};i < MinPhaseFftSize;++i)
+                fftbuf[i] = std::polar(mags[i], fftbuf[i].imag());
+            inverse_fft(fftbuf);
+
+            const double scale{1.0 / double{MinPhaseFftSize}};
+            for(size_t k{0};k < HrirLength;++k)
+                hrir[k][j] = static_cast<float>(fftbuf[k].real() * scale);
+        }
+    }
+}
+
+/* Finds the shortest IR length, no greater than irSize, for which the
+ * magnitude response of every (minimum-phase) HRIR stays within maxErrorDb
+ * RMS of its irSize-length response.
+ */
+uint ReduceHrirSize(const al::span<const HrirArray> coeffs, const uint irSize,
+    const float maxErrorDb)
+{
+    constexpr size_t NumBins{ErrorFftSize/2 + 1};
+
+    auto fftbuf = al::vector<std::complex<double>>(ErrorFftSize);
+    auto calc_response = [&fftbuf](const HrirArray &hrir, const size_t j, const uint size)
+    {
+        auto fftiter = std::transform(hrir.cbegin(), hrir.cbegin()+size, fftbuf.begin(),
+            [j](const float2 &in) noexcept -> std::complex<double> { return in[j]; });
+        std::fill(fftiter, fftbuf.end(), std::complex<double>{});
+        forward_fft(fftbuf);
+    };
+
+    /* Get the reference responses in dB, ignoring anything more than 40dB
+     * below the louder ear's peak (the quieter ear's response is masked by the
+     * other at that point).
+     */
+    auto refs = al::vector<double>(coeffs.size() * 2 * NumBins);
+    auto floors = al::vector<double>(coeffs.size());
+    for(size_t i{0};i < coeffs.size();++i)
+    {
+        double maxmag{0.0};
+        for(size_t j{0};j < 2;++j)
+        {
+            calc_response(coeffs[i], j, irSize);
+            double *ref{&refs[(i*2 + j) * NumBins]};
+            for(size_t b{0};b < NumBins;++b)
+            {
+                ref[b] = std::abs(fftbuf[b]);
+                maxmag = std::max(maxmag, ref[b]);
+            }
+        }
+        const double magfloor{std::max(maxmag*0.01, 1e-9)};
+
+        for(double &ref : al::span<double>{&refs[i*2*NumBins], 2*NumBins})
+            ref = 20.0 * std::log10(std::max(ref, magfloor));
+        floors[i] = magfloor;
+    }
+
+    auto within_error = [&](const uint size) -> bool
+    {
+        for(size_t i{0};i < coeffs.size();++i)
+        {
+            for(size_t j{0};j < 2;++j)
+            {
+                calc_response(coeffs[i], j, size);
+
+                const double magfloor{floors[i]};
+                const double *ref{&refs[(i*2 + j) * NumBins]};
+                double sum{0.0};
+                for(size_t b{0};b < NumBins;++b)
+                {
+                    const double err{20.0*std::log10(std::max(std::abs(fftbuf[b]), magfloor))
+                        - ref[b]};
+                    sum += err * err;
+                }
+                if(std::sqrt(sum / double{NumBins}) > maxErrorDb)
+                    return false;
+            }
+        }
+        return true;
+    };
+
+    uint lo{MinIrLength}, hi{irSize};
+    while(lo < hi)
+    {
+        const uint mid{lo + (hi-lo)/2};
+        if(within_error(mid))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    /* Keep the size even for the SIMD mixers. */
+    return minu((hi+1) & ~1u, irSize);
+}
+
+/* Writes the HRTF as a v3 data set, with stereo responses. */
+bool SaveHrtf03(const HrtfStore *hrtf, const size_t irCount, const std::string &filename)
+{
+    al::vector<char> data;
+    auto writele = [&data](uint value, const size_t bytes) -> void
+    {
+        for(size_t i{0};i < bytes;++i)
+        {
+            data.push_back(static_cast<char>(value & 0xff));
+            value >>= 8;
+        }
+    };
+
+    data.insert(data.end(), std::begin(magicMarker03), std::end(magicMarker03));
+    writele(hrtf->sampleRate, 4);
+    writele(1/*ChanType_LeftRight*/, 1);
+    writele(hrtf->irSize, 1);
+    writele(hrtf->fdCount, 1);
+
+    size_t ebase{0};
+    for(const auto &field : al::span<const HrtfStore::Field>{hrtf->field, hrtf->fdCount})
+    {
+        writele(static_cast<uint>(float2int(field.distance*1000.0f + 0.5f)), 2);
+        writele(field.evCount, 1);
+        for(size_t e{0};e < field.evCount;++e)
+            writele(hrtf->elev[ebase+e].azCount, 1);
+        ebase += field.evCount;
+    }
+
+    for(const auto &hrir : al::span<const HrirArray>{hrtf->coeffs, irCount})
+    {
+        for(const auto &val : al::span<const float2>{hrir.data(), hrtf->irSize})
+        {
+            for(size_t j{0};j < 2;++j)
+            {
+                if(!(std::abs(val[j]) < 1.0f))
+                {
+                    WARN("Not caching %s, coefficient out of range (%f)\n", filename.c_str(),
+                        val[j]);
+                    return false;
+                }
+                writele(static_cast<uint>(mini(float2int(std::round(val[j] * 8388608.0f)), 8388607)),
+                    3);
+            }
+        }
+    }
+    for(const auto &delays : al::span<const ubyte2>{hrtf->delays, irCount})
+    {
+        writele(delays[0], 1);
+        writele(delays[1], 1);
+    }
+
+#ifdef _WIN32
+    FILE *file{_wfopen(utf8_to_wstr(filename.c_str()).c_str(), L"wb")};
+#else
+    FILE *file{fopen(filename.c_str(), "wb")};
+#endif
+    if(!file)
+    {
+        WARN("Failed to open %s for writing\n", filename.c_str());
+        return false;
+    }
+    const bool ok{fwrite(data.data(), 1, data.size(), file) == data.size()};
+    if(fclose(file) != 0 || !ok)
+    {
+        WARN("Failed to write %s\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+/* Builds the grid of pre-blended responses for the HRTF, choosing the finest
+ * resolution (up to 1 degree) that fits within the given memory size.
+ */
+void BuildHrtfGrid(HrtfStore *hrtf, const size_t memsize, const char *name)
+{
+    /* Keep the grid entries a multiple of 4 floats for SIMD. */
+    const size_t irsize{RoundUp(hrtf->irSize, 2)};
+    const size_t entrysize{irsize*sizeof(float2) + sizeof(ubyte2)};
+    const size_t maxentries{memsize / entrysize / hrtf->fdCount};
+
+    /* Each field has evcount elevations by (evcount-1)*2 azimuths, for the
+     * same angular step in both.
+     */
+    auto evcount = static_cast<uint>(std::sqrt(static_cast<double>(maxentries) / 2.0)) + 1u;
+    evcount = minu(evcount, 181);
+    while(evcount > 1 && size_t{evcount}*(evcount-1)*2 > maxentries)
+        --evcount;
+    if(evcount < 37)
+    {
+        WARN("Not enough memory for a usable %s grid (%zuKB, %u elevations)\n", name,
+            memsize/1024, evcount);
+        return;
+    }
+    const uint azcount{(evcount-1) * 2};
+
+    const size_t total{size_t{evcount} * azcount * hrtf->fdCount};
+    auto gridcoeffs = al::vector<float2,16>(total * irsize);
+    auto griddelays = al::vector<ubyte2>(total);
+
+    HrirArray coeffs{};
+    std::array<uint,2> delays{};
+    size_t gidx{0};
+    for(const auto &field : al::span<const HrtfStore::Field>{hrtf->field, hrtf->fdCount})
+    {
+        for(uint e{0};e < evcount;++e)
+        {
+            const float ev{static_cast<float>(e) * al::numbers::pi_v<float>
+                / static_cast<float>(evcount-1) - al::numbers::pi_v<float>*0.5f};
+            for(uint a{0};a < azcount;++a)
+            {
+                float az{static_cast<float>(a)*al::numbers::pi_v<float>*2.0f /
+                    static_cast<float>(azcount)};
+                if(az > al::numbers::pi_v<float>) az -= al::numbers::pi_v<float>*2.0f;
+
+                GetHrtfCoeffs(hrtf, ev, az, field.distance, 0.0f, coeffs, delays);
+                std::copy_n(coeffs.cbegin(), irsize, gridcoeffs.begin() + gidx*irsize);
+                griddelays[gidx] = ubyte2{{static_cast<ubyte>(delays[0]),
+                    static_cast<ubyte>(delays[1])}};
+                ++gidx;
+            }
+        }
+    }
+
+    hrtf->gridEvCount = evcount;
+    hrtf->gridAzCount = azcount;
+    hrtf->gridIrSize = static_cast<uint>(irsize);
+    hrtf->gridCoeffs = std::move(gridcoeffs);
+    hrtf->gridDelays = std::move(griddelays);
+    TRACE("Built %ux%u grid for %s (%.1f degree steps, %zuKB)\n", evcount, azcount, name,
+        180.0f/static_cast<float>(evcount-1), total*entrysize/1024);
+}
+
 bool checkName(const std::string &name)
 {
     auto match_name = [&name](const HrtfEntry &entry) -> bool { return name == entry.mDispName; };
@@ -1265,7 +1643,8 @@ al::vector<std::string> EnumerateHrtf(al::optional<std::string> pathopt)
     return list;
 }
 
-HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
+HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate, const float maxErrorDb,
+    const uint gridMemoryKb)
 {
     std::lock_guard<std::mutex> _{EnumeratedHrtfLock};
     auto entry_iter = std::find_if(EnumeratedHrtfs.cbegin(), EnumeratedHrtfs.cend(),
@@ -1274,6 +1653,9 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         return nullptr;
     const std::string &fname = entry_iter->mFilename;
 
+    const uint errorTarget{(maxErrorDb > 0.0f) ?
+        static_cast<uint>(float2int(minf(maxErrorDb, 100.0f)*100.0f + 0.5f)) : 0u};
+
     std::lock_guard<std::mutex> __{LoadedHrtfLock};
     auto hrtf_lt_fname = [](LoadedHrtf &hrtf, const std::string &filename) -> bool
     { return hrtf.mFilename < filename; };
@@ -1281,7 +1663,8 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
     while(handle != LoadedHrtfs.end() && handle->mFilename == fname)
     {
         HrtfStore *hrtf{handle->mEntry.get()};
-        if(hrtf && hrtf->sampleRate == devrate)
+        if(hrtf && hrtf->sampleRate == devrate && handle->mErrorTarget == errorTarget
+            && handle->mGridMemory == gridMemoryKb)
         {
             hrtf->add_ref();
             return HrtfStorePtr{hrtf};
@@ -1289,94 +1672,179 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         ++handle;
     }
 
-    std::unique_ptr<std::istream> stream;
+    al::span<const char> srcdata;
+    al::vector<char> filedata;
     int residx{};
     char ch{};
     if(sscanf(fname.c_str(), "!%d%c", &residx, &ch) == 2 && ch == '_')
     {
         TRACE("Loading %s...\n", fname.c_str());
-        al::span<const char> res{GetResource(residx)};
-        if(res.empty())
+        srcdata = GetResource(residx);
+        if(srcdata.empty())
         {
             ERR("Could not get resource %u, %s\n", residx, name.c_str());
             return nullptr;
         }
-        stream = std::make_unique<idstream>(res.begin(), res.end());
     }
     else
     {
         TRACE("Loading %s...\n", fname.c_str());
-        auto fstr = std::make_unique<al::ifstream>(fname.c_str(), std::ios::binary);
-        if(!fstr->is_open())
+        al::ifstream fstr{fname.c_str(), std::ios::binary};
+        if(!fstr.is_open())
         {
             ERR("Could not open %s\n", fname.c_str());
             return nullptr;
         }
-        stream = std::move(fstr);
+        filedata.assign(std::istreambuf_iterator<char>{fstr}, std::istreambuf_iterator<char>{});
+        srcdata = {filedata.data(), filedata.size()};
     }
 
-    std::unique_ptr<HrtfStore> hrtf;
-    char magic[sizeof(magicMarker03)];
-    stream->read(magic, sizeof(magic));
-    if(stream->gcount() < static_cast<std::streamsize>(sizeof(magicMarker03)))
-        ERR("%s data is too short (%zu bytes)\n", name.c_str(), stream->gcount());
-    else if(memcmp(magic, magicMarker03, sizeof(magicMarker03)) == 0)
-    {
-        TRACE("Detected data set format v3\n");
-        hrtf = LoadHrtf03(*stream, name.c_str());
-    }
-    else if(memcmp(magic, magicMarker02, sizeof(magicMarker02)) == 0)
+    /* Processed data sets are cached by the source data's hash, the sample
+     * rate, the error target, and the processing version.
+     */
+    std::string cachename;
+    if(errorTarget > 0)
     {
-        TRACE("Detected data set format v2\n");
-        hrtf = LoadHrtf02(*stream, name.c_str());
+        std::string cachepath{GetUserCachePath("hrtf")};
+        if(!cachepath.empty())
+        {
+            uint64_t hash{14695981039346656037u};
+            for(const char c : srcdata)
+                hash = (hash ^ static_cast<ubyte>(c)) * 1099511628211u;
+
+            char str[64];
+            snprintf(str, sizeof(str), "%016" PRIx64 "-%u-%u-v%u.mhr", hash, devrate,
+                errorTarget, HrtfCacheVersion);
+            cachename = cachepath + '/' + str;
+        }
     }
-    else if(memcmp(magic, magicMarker01, sizeof(magicMarker01)) == 0)
+
+    std::unique_ptr<HrtfStore> hrtf;
+    if(!cachename.empty())
     {
-        TRACE("Detected data set format v1\n");
-        hrtf = LoadHrtf01(*stream, name.c_str());
+        al::ifstream cachestr{cachename.c_str(), std::ios::binary};
+        if(cachestr.is_open())
+        {
+            TRACE("Loading cached %s...\n", cachename.c_str());
+            hrtf = LoadHrtf(cachestr, cachename.c_str());
+            if(hrtf && hrtf->sampleRate != devrate)
+                hrtf = nullptr;
+        }
     }
-    else if(memcmp(magic, magicMarker00, sizeof(magicMarker00)) == 0)
+    const bool cached{hrtf != nullptr};
+    if(!cached)
     {
-        TRACE("Detected data set format v0\n");
-        hrtf = LoadHrtf00(*stream, name.c_str());
-    }
-    else
-        ERR("Invalid header in %s: \"%.8s\"\n", name.c_str(), magic);
-    stream.reset();
+        std::unique_ptr<std::istream> stream{std::make_unique<idstream>(srcdata.begin(),
+            srcdata.end())};
+        hrtf = LoadHrtf(*stream, name.c_str());
+        stream = nullptr;
+        filedata.clear();
 
-    if(!hrtf)
-    {
-        ERR("Failed to load %s\n", name.c_str());
-        return nullptr;
+        if(!hrtf)
+        {
+            ERR("Failed to load %s\n", name.c_str());
+            return nullptr;
+        }
     }
 
+    /* Calculate the last elevation's index and get the total IR count. */
+    const size_t lastEv{std::accumulate(hrtf->field, hrtf->field+hrtf->fdCount, size_t{0},
+        [](const size_t curval, const HrtfStore::Field &field) noexcept -> size_t
+        { return curval + field.evCount; }
+    ) - 1};
+    const size_t irCount{size_t{hrtf->elev[lastEv].irOffset} + hrtf->elev[lastEv].azCount};
+
     if(hrtf->sampleRate != devrate)
     {
         TRACE("Resampling HRTF %s (%uhz -> %uhz)\n", name.c_str(), hrtf->sampleRate, devrate);
 
-        /* Calculate the last elevation's index and get the total IR count. */
-        const size_t lastEv{std::accumulate(hrtf->field, hrtf->field+hrtf->fdCount, size_t{0},
-            [](const size_t curval, const HrtfStore::Field &field) noexcept -> size_t
-            { return curval + field.evCount; }
-        ) - 1};
-        const size_t irCount{size_t{hrtf->elev[lastEv].irOffset} + hrtf->elev[lastEv].azCount};
-
-        /* Resample all the IRs. */
-        std::array<std::array<double,HrirLength>,2> inout;
+        /* Resample all the IRs. They're processed in batches, with the IRs of
+         * a batch interleaved so each filter tap is applied to all of them at
+         * once, and larger sets get the batches spread over multiple threads.
+         */
         PPhaseResampler rs;
         rs.init(hrtf->sampleRate, devrate);
-        for(size_t i{0};i < irCount;++i)
+        HrirArray *irs{const_cast<HrirArray*>(hrtf->coeffs)};
+        static constexpr size_t BatchSize{64};
+        static constexpr size_t BatchBufferSize{BatchSize*2 * HrirLength * 2};
+        auto resample_irs = [&rs,irs](float *in, const size_t start, const size_t end) noexcept
         {
-            HrirArray &coeffs = const_cast<HrirArray&>(hrtf->coeffs[i]);
-            for(size_t j{0};j < 2;++j)
+            float *out{in + BatchSize*2*HrirLength};
+            for(size_t base{start};base < end;base += BatchSize)
             {
-                std::transform(coeffs.cbegin(), coeffs.cend(), inout[0].begin(),
-                    [j](const float2 &in) noexcept -> double { return in[j]; });
-                rs.process(HrirLength, inout[0].data(), HrirLength, inout[1].data());
+                const size_t todo{minz(BatchSize, end-base)};
+                const size_t count{todo * 2};
+                HrirArray *coeffs{irs + base};
+                for(size_t k{0};k < HrirLength;++k)
+                {
+                    for(size_t i{0};i < todo;++i)
+                    {
+                        in[k*count + i*2 + 0] = coeffs[i][k][0];
+                        in[k*count + i*2 + 1] = coeffs[i][k][1];
+                    }
+                }
+                rs.processBatch(HrirLength, in, HrirLength, out, count);
                 for(size_t k{0};k < HrirLength;++k)
-                    coeffs[k][j] = static_cast<float>(inout[1][k]);
+                {
+                    for(size_t i{0};i < todo;++i)
+                    {
+                        coeffs[i][k][0] = out[k*count + i*2 + 0];
+                        coeffs[i][k][1] = out[k*count + i*2 + 1];
+                    }
+                }
+            }
+        };
+
+        static constexpr size_t MinIrsPerThread{256};
+        const size_t maxthreads{maxz(std::thread::hardware_concurrency(), 1)};
+        const size_t numthreads{clampz((irCount+MinIrsPerThread-1) / MinIrsPerThread, 1, maxthreads)};
+        const size_t irsPerThread{(irCount+numthreads-1) / numthreads};
+
+        /* Allocate each thread's batch buffer up front, so the threads can't
+         * fail once started.
+         */
+        al::vector<float,16> batchbuffers;
+        try {
+            batchbuffers.resize(numthreads * BatchBufferSize);
+        }
+        catch(std::exception &e) {
+            ERR("Failed to allocate HRTF resampling buffers: %s\n", e.what());
+            return nullptr;
+        }
+
+        /* Make sure the threads get joined even if something throws before
+         * they're done.
+         */
+        struct ThreadJoiner {
+            al::vector<std::thread> mThreads;
+            ~ThreadJoiner()
+            {
+                for(auto &thrd : mThreads)
+                {
+                    if(thrd.joinable())
+                        thrd.join();
+                }
+            }
+        } workers;
+        workers.mThreads.reserve(numthreads-1);
+        size_t start{irsPerThread};
+        try {
+            for(;start < irCount;start += irsPerThread)
+            {
+                float *buffer{batchbuffers.data() + (workers.mThreads.size()+1)*BatchBufferSize};
+                workers.mThreads.emplace_back(resample_irs, buffer, start,
+                    minz(start+irsPerThread, irCount));
             }
         }
+        catch(std::exception &e) {
+            WARN("Failed to start HRTF resampling thread: %s\n", e.what());
+        }
+        resample_irs(batchbuffers.data(), 0, minz(irsPerThread, irCount));
+        /* Do any IRs that weren't given to a thread. */
+        if(start < irCount)
+            resample_irs(batchbuffers.data(), start, irCount);
+        for(auto &thrd : workers.mThreads)
+            thrd.join();
         rs = {};
 
         /* Scale the delays for the new sample rate. */
@@ -1420,9 +1888,31 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         hrtf->sampleRate = devrate;
     }
 
+    if(errorTarget > 0 && !cached)
+    {
+        /* Rebuild the responses as minimum phase, and find the shortest length
+         * that meets the error target.
+         */
+        const al::span<HrirArray> coeffs{const_cast<HrirArray*>(hrtf->coeffs), irCount};
+        MinimumPhaseHrirs(coeffs, hrtf->irSize);
+
+        const uint oldIrSize{hrtf->irSize};
+        const float maxError{static_cast<float>(errorTarget) / 100.0f};
+        hrtf->irSize = ReduceHrirSize(coeffs, hrtf->irSize, maxError);
+        TRACE("Reduced HRTF %s from %u to %u samples (%.2fdB error target)\n", name.c_str(),
+            oldIrSize, hrtf->irSize, maxError);
+
+        if(!cachename.empty() && SaveHrtf03(hrtf.get(), irCount, cachename))
+            TRACE("Cached HRTF as %s\n", cachename.c_str());
+    }
+
+    if(gridMemoryKb > 0)
+        BuildHrtfGrid(hrtf.get(), size_t{gridMemoryKb}*1024, name.c_str());
+
     TRACE("Loaded HRTF %s for sample rate %uhz, %u-sample filter\n", name.c_str(),
         hrtf->sampleRate, hrtf->irSize);
-    handle = LoadedHrtfs.emplace(handle, LoadedHrtf{fname, std::move(hrtf)});
+    handle = LoadedHrtfs.emplace(handle, LoadedHrtf{fname, errorTarget, gridMemoryKb,
+        std::move(hrtf)});
 
     return HrtfStorePtr{handle->mEntry.get()};
 }
@@ -41,6 +41,17 @@ struct HrtfStore {
     const HrirArray *coeffs;
     const ubyte2 *delays;
 
+    /* Optional grid of pre-blended responses, for direct lookups. Each field
+     * has gridEvCount elevations (-90 to +90 degrees, inclusive) by
+     * gridAzCount azimuths, each entry holding gridIrSize coefficients and
+     * whole-sample delays.
+     */
+    uint gridEvCount;
+    uint gridAzCount;
+    uint gridIrSize;
+    al::vector<float2,16> gridCoeffs;
+    al::vector<ubyte2> gridDelays;
+
     void add_ref();
     void release();
 
@@ -75,14 +86,23 @@ struct DirectHrtfState {
         const al::span<const AngularPoint> AmbiPoints, const float (*AmbiMatrix)[MaxAmbiChannels],
         const float XOverFreq, const al::span<const float,MaxAmbiOrder+1> AmbiOrderHFGain);
 
-    static std::unique_ptr<DirectHrtfState> Create(size_t num_chans);
+    static al::arena_ptr<DirectHrtfState> Create(al::arena &mem, size_t num_chans);
 
     DEF_FAM_NEWDEL(DirectHrtfState, mChannels)
 };
 
 
 al::vector<std::string> EnumerateHrtf(al::optional<std::string> pathopt);
-HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate);
+/**
+ * Loads the named HRTF for the given sample rate. If maxErrorDb is greater
+ * than 0, the responses are converted to minimum phase and shortened to the
+ * smallest length that keeps the magnitude response within the given RMS
+ * error, with the processed data set cached for later loads. If gridMemoryKb
+ * is greater than 0, a grid of pre-blended responses using up to that much
+ * memory is built for quicker coefficient lookups.
+ */
+HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate, const float maxErrorDb,
+    const uint gridMemoryKb);
 
 void GetHrtfCoeffs(const HrtfStore *Hrtf, float elevation, float azimuth, float distance,
     float spread, HrirArray &coeffs, const al::span<uint,2> delays);
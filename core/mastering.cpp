@@ -6,114 +6,156 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
-#include <functional>
 #include <iterator>
-#include <limits>
 #include <new>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "almalloc.h"
 #include "alnumeric.h"
 #include "alspan.h"
 #include "opthelpers.h"
 
 
-/* These structures assume BufferLineSize is a power of 2. */
-static_assert((BufferLineSize & (BufferLineSize-1)) == 0, "BufferLineSize is not a power of 2");
-
 struct SlidingHold {
-    alignas(16) float mValues[BufferLineSize];
-    uint mExpiries[BufferLineSize];
-    uint mLowerIndex;
-    uint mUpperIndex;
+    /* The last mLength-1 input values, followed by the current input. */
+    alignas(16) float mValues[BufferLineSize*2];
     uint mLength;
 };
 
 
 namespace {
 
-using namespace std::placeholders;
-
 /* This sliding hold follows the input level with an instant attack and a
  * fixed duration hold before an instant release to the next highest level.
- * It is a sliding window maximum (descending maxima) implementation based on
- * Richard Harter's ascending minima algorithm available at:
- *
- *   http://www.richardhartersworld.com/cri/2001/slidingmin.html
+ * It is a sliding window maximum implementation based on the van Herk/Gil-
+ * Werman algorithm, which splits the input into blocks of the window length
+ * and combines a running maximum from the start of each block with a running
+ * maximum to the end of each block. Unlike a descending maxima deque, this
+ * makes a constant number of comparisons per sample without data-dependent
+ * branching.
  */
-float UpdateSlidingHold(SlidingHold *Hold, const uint i, const float in)
+void UpdateSlidingHold(SlidingHold *Hold, const uint SamplesToDo, float *RESTRICT inout)
 {
-    static constexpr uint mask{BufferLineSize - 1};
     const uint length{Hold->mLength};
-    float (&values)[BufferLineSize] = Hold->mValues;
-    uint (&expiries)[BufferLineSize] = Hold->mExpiries;
-    uint lowerIndex{Hold->mLowerIndex};
-    uint upperIndex{Hold->mUpperIndex};
-
-    if(i >= expiries[upperIndex])
-        upperIndex = (upperIndex + 1) & mask;
+    const uint histLen{length - 1};
+    const uint total{histLen + SamplesToDo};
+    float *RESTRICT values{al::assume_aligned<16>(Hold->mValues)};
 
-    if(in >= values[upperIndex])
+    /* Append the new input to the history, replacing it with the running
+     * maximum from the start of its block.
+     */
+    float prefix{0.0f};
+    uint blockpos{0};
+    for(uint i{0};i < histLen;++i)
     {
-        values[upperIndex] = in;
-        expiries[upperIndex] = i + length;
-        lowerIndex = upperIndex;
+        prefix = blockpos ? maxf(prefix, values[i]) : values[i];
+        blockpos = (blockpos+1 == length) ? 0 : blockpos+1;
     }
-    else
+    for(uint i{0};i < SamplesToDo;++i)
     {
-        do {
-            do {
-                if(!(in >= values[lowerIndex]))
-                    goto found_place;
-            } while(lowerIndex--);
-            lowerIndex = mask;
-        } while(1);
-    found_place:
-
-        lowerIndex = (lowerIndex + 1) & mask;
-        values[lowerIndex] = in;
-        expiries[lowerIndex] = i + length;
+        const float in{inout[i]};
+        values[histLen+i] = in;
+        prefix = blockpos ? maxf(prefix, in) : in;
+        blockpos = (blockpos+1 == length) ? 0 : blockpos+1;
+        inout[i] = prefix;
     }
 
-    Hold->mLowerIndex = lowerIndex;
-    Hold->mUpperIndex = upperIndex;
-
-    return values[upperIndex];
-}
-
-void ShiftSlidingHold(SlidingHold *Hold, const uint n)
-{
-    auto exp_begin = std::begin(Hold->mExpiries) + Hold->mUpperIndex;
-    auto exp_last = std::begin(Hold->mExpiries) + Hold->mLowerIndex;
-    if(exp_last-exp_begin < 0)
+    /* Combine the running maximum to the end of each block with the prefix
+     * maximum at the end of each output sample's window.
+     */
+    blockpos = (total-1) % length;
+    float suffix{values[total-1]};
+    for(uint i{total-1};i > SamplesToDo;)
     {
-        std::transform(exp_begin, std::end(Hold->mExpiries), exp_begin,
-            std::bind(std::minus<>{}, _1, n));
-        exp_begin = std::begin(Hold->mExpiries);
+        --i;
+        blockpos = blockpos ? blockpos-1 : length-1;
+        suffix = (blockpos == length-1) ? values[i] : maxf(suffix, values[i]);
     }
-    std::transform(exp_begin, exp_last+1, exp_begin, std::bind(std::minus<>{}, _1, n));
+    for(uint i{SamplesToDo};i > 0;)
+    {
+        --i;
+        blockpos = blockpos ? blockpos-1 : length-1;
+        suffix = (blockpos == length-1) ? values[i] : maxf(suffix, values[i]);
+        inout[i] = maxf(inout[i], suffix);
+    }
+
+    /* Keep the last length-1 inputs as history for the next update. */
+    std::copy_n(values+SamplesToDo, histLen, values);
 }
 
 
 /* Multichannel compression is linked via the absolute maximum of all
- * channels.
+ * channels. The pre-gain is applied to the linked level here, rather than to
+ * each channel's samples, and is instead applied to the output along with the
+ * compressor gain.
  */
 void LinkChannels(Compressor *Comp, const uint SamplesToDo, const FloatBufferLine *OutBuffer)
 {
     const size_t numChans{Comp->mNumChans};
+    const float preGain{Comp->mPreGain};
 
     ASSUME(SamplesToDo > 0);
     ASSUME(numChans > 0);
 
-    auto side_begin = std::begin(Comp->mSideChain) + Comp->mLookAhead;
-    std::fill(side_begin, side_begin+SamplesToDo, 0.0f);
+    float *RESTRICT side{Comp->mSideChain + Comp->mLookAhead};
 
-    auto fill_max = [SamplesToDo,side_begin](const FloatBufferLine &input) -> void
+    /* Fill the side-chain with the first channel's absolute level, then take
+     * the maximum with each following channel, four samples at a time where
+     * possible.
+     */
+    for(size_t c{0};c < numChans;++c)
     {
-        const float *RESTRICT buffer{al::assume_aligned<16>(input.data())};
-        auto max_abs = std::bind(maxf, _1, std::bind(static_cast<float(&)(float)>(std::fabs), _2));
-        std::transform(side_begin, side_begin+SamplesToDo, buffer, side_begin, max_abs);
-    };
-    std::for_each(OutBuffer, OutBuffer+numChans, fill_max);
+        const float *RESTRICT buffer{al::assume_aligned<16>(OutBuffer[c].data())};
+        uint i{0};
+#ifdef HAVE_SSE_INTRINSICS
+        const __m128 signmask{_mm_set1_ps(-0.0f)};
+        if(c == 0)
+        {
+            for(;SamplesToDo-i >= 4;i+=4)
+                _mm_storeu_ps(&side[i], _mm_andnot_ps(signmask, _mm_load_ps(&buffer[i])));
+        }
+        else
+        {
+            for(;SamplesToDo-i >= 4;i+=4)
+            {
+                const __m128 s{_mm_andnot_ps(signmask, _mm_load_ps(&buffer[i]))};
+                _mm_storeu_ps(&side[i], _mm_max_ps(_mm_loadu_ps(&side[i]), s));
+            }
+        }
+#elif defined(HAVE_NEON)
+        if(c == 0)
+        {
+            for(;SamplesToDo-i >= 4;i+=4)
+                vst1q_f32(&side[i], vabsq_f32(vld1q_f32(&buffer[i])));
+        }
+        else
+        {
+            for(;SamplesToDo-i >= 4;i+=4)
+                vst1q_f32(&side[i], vmaxq_f32(vld1q_f32(&side[i]), vabsq_f32(vld1q_f32(&buffer[i]))));
+        }
+#endif
+        if(c == 0)
+        {
+            for(;i < SamplesToDo;++i)
+                side[i] = std::fabs(buffer[i]);
+        }
+        else
+        {
+            for(;i < SamplesToDo;++i)
+                side[i] = maxf(side[i], std::fabs(buffer[i]));
+        }
+    }
+
+    if(preGain != 1.0f)
+    {
+        for(uint i{0};i < SamplesToDo;++i)
+            side[i] *= preGain;
+    }
 }
 
 /* This calculates the squared crest factor of the control signal for the
@@ -160,23 +202,17 @@ void PeakDetector(Compressor *Comp, const uint SamplesToDo)
 
 /* An optional hold can be used to extend the peak detector so it can more
  * solidly detect fast transients.  This is best used when operating as a
- * limiter.
+ * limiter. The hold is applied to the linear level, since the maximum is the
+ * same either way and this avoids holding in the log domain.
  */
 void PeakHoldDetector(Compressor *Comp, const uint SamplesToDo)
 {
     ASSUME(SamplesToDo > 0);
 
-    SlidingHold *hold{Comp->mHold};
-    uint i{0};
-    auto detect_peak = [&i,hold](const float x_abs) -> float
-    {
-        const float x_G{std::log(maxf(0.000001f, x_abs))};
-        return UpdateSlidingHold(hold, i++, x_G);
-    };
-    auto side_begin = std::begin(Comp->mSideChain) + Comp->mLookAhead;
-    std::transform(side_begin, side_begin+SamplesToDo, side_begin, detect_peak);
-
-    ShiftSlidingHold(hold, SamplesToDo);
+    float *side_begin{Comp->mSideChain + Comp->mLookAhead};
+    UpdateSlidingHold(Comp->mHold, SamplesToDo, side_begin);
+    std::transform(side_begin, side_begin+SamplesToDo, side_begin,
+        [](const float s) -> float { return std::log(maxf(0.000001f, s)); });
 }
 
 /* This is the heart of the feed-forward compressor.  It operates in the log
@@ -199,6 +235,7 @@ void GainCompressor(Compressor *Comp, const uint SamplesToDo)
     const float c_est{Comp->mGainEstimate};
     const float a_adp{Comp->mAdaptCoeff};
     const float *crestFactor{Comp->mCrestFactor};
+    const float preGain{Comp->mPreGain};
     float postGain{Comp->mPostGain};
     float knee{Comp->mKnee};
     float t_att{attack};
@@ -267,7 +304,10 @@ void GainCompressor(Compressor *Comp, const uint SamplesToDo)
             postGain = -(c_dev + c_est);
         }
 
-        sideChain = std::exp(postGain - y_L);
+        /* The pre-gain wasn't applied to the input signal, so include it
+         * with the output gain.
+         */
+        sideChain = std::exp(postGain - y_L) * preGain;
     }
 
     Comp->mLastRelease = y_1;
@@ -278,12 +318,14 @@ void GainCompressor(Compressor *Comp, const uint SamplesToDo)
 /* Combined with the hold time, a look-ahead delay can improve handling of
  * fast transients by allowing the envelope time to converge prior to
  * reaching the offending impulse.  This is best used when operating as a
- * limiter.
+ * limiter. The delay is applied along with the compressor gain, in one pass
+ * over each channel.
  */
-void SignalDelay(Compressor *Comp, const uint SamplesToDo, FloatBufferLine *OutBuffer)
+void SignalDelayGain(Compressor *Comp, const uint SamplesToDo, FloatBufferLine *OutBuffer)
 {
     const size_t numChans{Comp->mNumChans};
     const uint lookAhead{Comp->mLookAhead};
+    const float *RESTRICT gains{al::assume_aligned<16>(Comp->mSideChain)};
 
     ASSUME(SamplesToDo > 0);
     ASSUME(numChans > 0);
@@ -292,18 +334,44 @@ void SignalDelay(Compressor *Comp, const uint SamplesToDo, FloatBufferLine *OutB
     for(size_t c{0};c < numChans;c++)
     {
         float *inout{al::assume_aligned<16>(OutBuffer[c].data())};
-        float *delaybuf{al::assume_aligned<16>(Comp->mDelay[c].data())};
+        float *RESTRICT delaybuf{al::assume_aligned<16>(Comp->mDelay[c].data())};
 
-        auto inout_end = inout + SamplesToDo;
         if LIKELY(SamplesToDo >= lookAhead)
         {
-            auto delay_end = std::rotate(inout, inout_end - lookAhead, inout_end);
-            std::swap_ranges(inout, delay_end, delaybuf);
+            /* Save the end of the input for the next update, then work
+             * backwards to shift the rest of the input forward.
+             */
+            float *RESTRICT saved{Comp->mDelaySave};
+            std::copy_n(inout+SamplesToDo-lookAhead, lookAhead, saved);
+            uint i{SamplesToDo};
+#ifdef HAVE_SSE_INTRINSICS
+            for(;i-lookAhead >= 4;i-=4)
+            {
+                const __m128 s{_mm_loadu_ps(&inout[i-4-lookAhead])};
+                _mm_storeu_ps(&inout[i-4], _mm_mul_ps(s, _mm_loadu_ps(&gains[i-4])));
+            }
+#elif defined(HAVE_NEON)
+            for(;i-lookAhead >= 4;i-=4)
+            {
+                const float32x4_t s{vld1q_f32(&inout[i-4-lookAhead])};
+                vst1q_f32(&inout[i-4], vmulq_f32(s, vld1q_f32(&gains[i-4])));
+            }
+#endif
+            for(;i > lookAhead;--i)
+                inout[i-1] = inout[i-1-lookAhead] * gains[i-1];
+            for(i = 0;i < lookAhead;++i)
+                inout[i] = delaybuf[i] * gains[i];
+            std::copy_n(saved, lookAhead, delaybuf);
         }
         else
         {
-            auto delay_start = std::swap_ranges(inout, inout_end, delaybuf);
-            std::rotate(delaybuf, delay_start, delaybuf + lookAhead);
+            for(uint i{0};i < SamplesToDo;++i)
+            {
+                const float in{inout[i]};
+                inout[i] = delaybuf[i] * gains[i];
+                delaybuf[i] = in;
+            }
+            std::rotate(delaybuf, delaybuf+SamplesToDo, delaybuf+lookAhead);
         }
     }
 }
@@ -311,11 +379,11 @@ void SignalDelay(Compressor *Comp, const uint SamplesToDo, FloatBufferLine *OutB
 } // namespace
 
 
-std::unique_ptr<Compressor> Compressor::Create(const size_t NumChans, const float SampleRate,
-    const bool AutoKnee, const bool AutoAttack, const bool AutoRelease, const bool AutoPostGain,
-    const bool AutoDeclip, const float LookAheadTime, const float HoldTime, const float PreGainDb,
-    const float PostGainDb, const float ThresholdDb, const float Ratio, const float KneeDb,
-    const float AttackTime, const float ReleaseTime)
+al::arena_ptr<Compressor> Compressor::Create(al::arena &mem, const size_t NumChans,
+    const float SampleRate, const bool AutoKnee, const bool AutoAttack, const bool AutoRelease,
+    const bool AutoPostGain, const bool AutoDeclip, const float LookAheadTime,
+    const float HoldTime, const float PreGainDb, const float PostGainDb, const float ThresholdDb,
+    const float Ratio, const float KneeDb, const float AttackTime, const float ReleaseTime)
 {
     const auto lookAhead = static_cast<uint>(
         clampf(std::round(LookAheadTime*SampleRate), 0.0f, BufferLineSize-1));
@@ -334,7 +402,7 @@ std::unique_ptr<Compressor> Compressor::Create(const size_t NumChans, const floa
             size += sizeof(*Compressor::mHold);
     }
 
-    auto Comp = CompressorPtr{al::construct_at(static_cast<Compressor*>(al_calloc(16, size)))};
+    auto Comp = CompressorPtr{al::construct_at(static_cast<Compressor*>(mem.allocate(16, size)))};
     Comp->mNumChans = NumChans;
     Comp->mAuto.Knee = AutoKnee;
     Comp->mAuto.Attack = AutoAttack;
@@ -362,8 +430,7 @@ std::unique_ptr<Compressor> Compressor::Create(const size_t NumChans, const floa
         if(hold > 1)
         {
             Comp->mHold = al::construct_at(reinterpret_cast<SlidingHold*>(Comp.get() + 1));
-            Comp->mHold->mValues[0] = -std::numeric_limits<float>::infinity();
-            Comp->mHold->mExpiries[0] = hold;
+            std::fill_n(Comp->mHold->mValues, hold-1, 0.0f);
             Comp->mHold->mLength = hold;
             Comp->mDelay = reinterpret_cast<FloatBufferLine*>(Comp->mHold + 1);
         }
@@ -397,18 +464,6 @@ void Compressor::process(const uint SamplesToDo, FloatBufferLine *OutBuffer)
     ASSUME(SamplesToDo > 0);
     ASSUME(numChans > 0);
 
-    const float preGain{mPreGain};
-    if(preGain != 1.0f)
-    {
-        auto apply_gain = [SamplesToDo,preGain](FloatBufferLine &input) noexcept -> void
-        {
-            float *buffer{al::assume_aligned<16>(input.data())};
-            std::transform(buffer, buffer+SamplesToDo, buffer,
-                std::bind(std::multiplies<float>{}, _1, preGain));
-        };
-        std::for_each(OutBuffer, OutBuffer+numChans, apply_gain);
-    }
-
     LinkChannels(this, SamplesToDo, OutBuffer);
 
     if(mAuto.Attack || mAuto.Release)
@@ -422,17 +477,27 @@ void Compressor::process(const uint SamplesToDo, FloatBufferLine *OutBuffer)
     GainCompressor(this, SamplesToDo);
 
     if(mDelay)
-        SignalDelay(this, SamplesToDo, OutBuffer);
-
-    const float (&sideChain)[BufferLineSize*2] = mSideChain;
-    auto apply_comp = [SamplesToDo,&sideChain](FloatBufferLine &input) noexcept -> void
+        SignalDelayGain(this, SamplesToDo, OutBuffer);
+    else
     {
-        float *buffer{al::assume_aligned<16>(input.data())};
-        const float *gains{al::assume_aligned<16>(&sideChain[0])};
-        std::transform(gains, gains+SamplesToDo, buffer, buffer,
-            std::bind(std::multiplies<float>{}, _1, _2));
-    };
-    std::for_each(OutBuffer, OutBuffer+numChans, apply_comp);
+        const float *RESTRICT gains{al::assume_aligned<16>(mSideChain)};
+        auto apply_comp = [SamplesToDo,gains](FloatBufferLine &input) noexcept -> void
+        {
+            float *RESTRICT buffer{al::assume_aligned<16>(input.data())};
+            uint i{0};
+#ifdef HAVE_SSE_INTRINSICS
+            for(;SamplesToDo-i >= 4;i+=4)
+                _mm_store_ps(&buffer[i], _mm_mul_ps(_mm_load_ps(&buffer[i]),
+                    _mm_load_ps(&gains[i])));
+#elif defined(HAVE_NEON)
+            for(;SamplesToDo-i >= 4;i+=4)
+                vst1q_f32(&buffer[i], vmulq_f32(vld1q_f32(&buffer[i]), vld1q_f32(&gains[i])));
+#endif
+            for(;i < SamplesToDo;++i)
+                buffer[i] *= gains[i];
+        };
+        std::for_each(OutBuffer, OutBuffer+numChans, apply_comp);
+    }
 
     auto side_begin = std::begin(mSideChain) + SamplesToDo;
     std::copy(side_begin, side_begin+mLookAhead, std::begin(mSideChain));
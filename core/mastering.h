@@ -46,6 +46,7 @@ struct Compressor {
 
     alignas(16) float mSideChain[2*BufferLineSize]{};
     alignas(16) float mCrestFactor[BufferLineSize]{};
+    alignas(16) float mDelaySave[BufferLineSize]{};
 
     SlidingHold *mHold{nullptr};
     FloatBufferLine *mDelay{nullptr};
@@ -92,14 +93,16 @@ struct Compressor {
      *        automating attack time.
      * \param ReleaseTime   Release time (in seconds). Acts as a maximum when
      *        automating release time.
+     *
+     * The compressor's memory is taken from the given arena.
      */
-    static std::unique_ptr<Compressor> Create(const size_t NumChans, const float SampleRate,
+    static al::arena_ptr<Compressor> Create(al::arena &mem, const size_t NumChans, const float SampleRate,
         const bool AutoKnee, const bool AutoAttack, const bool AutoRelease,
         const bool AutoPostGain, const bool AutoDeclip, const float LookAheadTime,
         const float HoldTime, const float PreGainDb, const float PostGainDb,
         const float ThresholdDb, const float Ratio, const float KneeDb, const float AttackTime,
         const float ReleaseTime);
 };
-using CompressorPtr = std::unique_ptr<Compressor>;
+using CompressorPtr = al::arena_ptr<Compressor>;
 
 #endif /* CORE_MASTERING_H */
@@ -3,6 +3,8 @@
 
 #include "mixer.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 
 #include "alnumbers.h"
@@ -16,6 +18,80 @@ struct CTag;
 MixerFunc MixSamples{Mix_<CTag>};
 
 
+namespace {
+
+/* The first order that's calculated generically instead of explicitly. */
+constexpr uint GenericAmbiOrder{4};
+
+/* Normalization factors for the generically calculated orders, indexed by
+ * order (l) and degree (m). These are the N3D normalization terms
+ * sqrt((2l+1) * (2-d_m0) * (l-m)!/(l+m)!), without the Condon-Shortley phase.
+ */
+using AmbiNormTable = std::array<std::array<float,MaxAmbiOrder+1>,MaxAmbiOrder+1>;
+const AmbiNormTable &GetAmbiNorms()
+{
+    static const AmbiNormTable norms{[]
+    {
+        AmbiNormTable ret{};
+        for(uint l{GenericAmbiOrder};l <= MaxAmbiOrder;++l)
+        {
+            for(uint m{0};m <= l;++m)
+            {
+                double ratio{1.0};
+                for(uint i{l-m+1};i <= l+m;++i)
+                    ratio /= i;
+                ret[l][m] = static_cast<float>(std::sqrt((l*2.0 + 1.0) * (m ? 2.0 : 1.0) *
+                    ratio));
+            }
+        }
+        return ret;
+    }()};
+    return norms;
+}
+
+/**
+ * Fills in the coefficients for orders GenericAmbiOrder and up. The associated
+ * Legendre polynomials are built with the standard recurrences in the Z
+ * component (with the sin(theta)**m term factored out), and the azimuthal
+ * terms combined with it are the real and imaginary parts of (X + iY)**m.
+ */
+void CalcHigherOrderCoeffs(const float y, const float z, const float x,
+    const al::span<float,MaxAmbiChannels> coeffs)
+{
+    const AmbiNormTable &norms = GetAmbiNorms();
+
+    /* cos(m*phi)*sin(theta)**m, and sin(m*phi)*sin(theta)**m. */
+    float cosm{1.0f}, sinm{0.0f};
+    /* (2m-1)!!, the starting value of the recurrence for degree m. */
+    float pmm{1.0f};
+    for(uint m{0};m <= MaxAmbiOrder;++m)
+    {
+        float p0{pmm}, p1{pmm*z*static_cast<float>(m*2 + 1)};
+        for(uint l{m};l <= MaxAmbiOrder;++l)
+        {
+            if(l >= GenericAmbiOrder)
+            {
+                const float p{norms[l][m] * p0};
+                const size_t center{l*l + l};
+                coeffs[center + m] = p * cosm;
+                if(m > 0) coeffs[center - m] = p * sinm;
+            }
+            const float pn{(static_cast<float>(l*2 + 3)*z*p1 - static_cast<float>(l+m+1)*p0) /
+                static_cast<float>(l+2 - m)};
+            p0 = p1;
+            p1 = pn;
+        }
+
+        const float newcos{cosm*x - sinm*y};
+        sinm = sinm*x + cosm*y;
+        cosm = newcos;
+        pmm *= static_cast<float>(m*2 + 1);
+    }
+}
+
+} // namespace
+
+
 std::array<float,MaxAmbiChannels> CalcAmbiCoeffs(const float y, const float z, const float x,
     const float spread)
 {
@@ -42,16 +118,18 @@ std::array<float,MaxAmbiChannels> CalcAmbiCoeffs(const float y, const float z, c
     coeffs[13] =  1.620185175f * (x*(5.0f*zz - 1.0f)); /* ACN 13 = sqrt(21/8) * X * (5*Z*Z - 1) */
     coeffs[14] =  5.123475383f * (z*(xx - yy));        /* ACN 14 = sqrt(105)/2 * Z * (X*X - Y*Y) */
     coeffs[15] =  2.091650066f * (x*(xx - 3.0f*yy));   /* ACN 15 = sqrt(35/8) * X * (X*X - 3*Y*Y) */
-    /* Fourth-order */
-    /* ACN 16 = sqrt(35)*3/2 * X * Y * (X*X - Y*Y) */
-    /* ACN 17 = sqrt(35/2)*3/2 * (3*X*X - Y*Y) * Y * Z */
-    /* ACN 18 = sqrt(5)*3/2 * X * Y * (7*Z*Z - 1) */
-    /* ACN 19 = sqrt(5/2)*3/2 * Y * Z * (7*Z*Z - 3)  */
-    /* ACN 20 = 3/8 * (35*Z*Z*Z*Z - 30*Z*Z + 3) */
-    /* ACN 21 = sqrt(5/2)*3/2 * X * Z * (7*Z*Z - 3) */
-    /* ACN 22 = sqrt(5)*3/4 * (X*X - Y*Y) * (7*Z*Z - 1) */
-    /* ACN 23 = sqrt(35/2)*3/2 * (X*X - 3*Y*Y) * X * Z */
-    /* ACN 24 = sqrt(35)*3/8 * (X*X*X*X - 6*X*X*Y*Y + Y*Y*Y*Y) */
+    /* Fourth-order and up, e.g.
+     * ACN 16 = sqrt(35)*3/2 * X * Y * (X*X - Y*Y)
+     * ACN 17 = sqrt(35/2)*3/2 * (3*X*X - Y*Y) * Y * Z
+     * ACN 18 = sqrt(5)*3/2 * X * Y * (7*Z*Z - 1)
+     * ACN 19 = sqrt(5/2)*3/2 * Y * Z * (7*Z*Z - 3)
+     * ACN 20 = 3/8 * (35*Z*Z*Z*Z - 30*Z*Z + 3)
+     * ACN 21 = sqrt(5/2)*3/2 * X * Z * (7*Z*Z - 3)
+     * ACN 22 = sqrt(5)*3/4 * (X*X - Y*Y) * (7*Z*Z - 1)
+     * ACN 23 = sqrt(35/2)*3/2 * (X*X - 3*Y*Y) * X * Z
+     * ACN 24 = sqrt(35)*3/8 * (X*X*X*X - 6*X*X*Y*Y + Y*Y*Y*Y)
+     */
+    CalcHigherOrderCoeffs(y, z, x, coeffs);
 
     if(spread > 0.0f)
     {
@@ -108,15 +186,38 @@ std::array<float,MaxAmbiChannels> CalcAmbiCoeffs(const float y, const float z, c
         coeffs[13] *= ZH3_norm;
         coeffs[14] *= ZH3_norm;
         coeffs[15] *= ZH3_norm;
+
+        /* The higher orders use the general form of the above,
+         * ZHn = (ca+1) * Pn'(ca) / (n*(n+1)), with the derivatives of the
+         * Legendre polynomials from Pn+1' = Pn-1' + (2n+1)*Pn.
+         */
+        float pn0{1.0f}, pn1{ca};
+        float dpn0{0.0f}, dpn1{1.0f};
+        for(uint n{1};n <= MaxAmbiOrder;++n)
+        {
+            if(n >= GenericAmbiOrder)
+            {
+                const float zh_norm{scale * (ca+1.0f) * dpn1 / static_cast<float>(n*(n+1))};
+                auto iter = coeffs.begin() + n*n;
+                std::transform(iter, iter + n*2 + 1, iter,
+                    [zh_norm](const float coeff) noexcept { return coeff * zh_norm; });
+            }
+            const float dpn{dpn0 + static_cast<float>(n*2 + 1)*pn1};
+            const float pn{(static_cast<float>(n*2 + 1)*ca*pn1 - static_cast<float>(n)*pn0) /
+                static_cast<float>(n+1)};
+            dpn0 = dpn1; dpn1 = dpn;
+            pn0 = pn1; pn1 = pn;
+        }
     }
 
     return coeffs;
 }
 
 void ComputePanGains(const MixParams *mix, const float*RESTRICT coeffs, const float ingain,
-    const al::span<float,MAX_OUTPUT_CHANNELS> gains)
+    const al::span<float> gains)
 {
     auto ambimap = mix->AmbiMap.cbegin();
+    assert(gains.size() >= mix->Buffer.size());
 
     auto iter = std::transform(ambimap, ambimap+mix->Buffer.size(), gains.begin(),
         [coeffs,ingain](const BFChannelConfig &chanmap) noexcept -> float
@@ -75,10 +75,11 @@ inline std::array<float,MaxAmbiChannels> CalcAngleCoeffs(const float azimuth,
  * Computes panning gains using the given channel decoder coefficients and the
  * pre-calculated direction or angle coefficients. For B-Format sources, the
  * coeffs are a 'slice' of a transform matrix for the input channel, used to
- * scale and orient the sound samples.
+ * scale and orient the sound samples. Gains beyond the mix's channel count
+ * are cleared.
  */
 void ComputePanGains(const MixParams *mix, const float*RESTRICT coeffs, const float ingain,
-    const al::span<float,MAX_OUTPUT_CHANNELS> gains);
+    const al::span<float> gains);
 
 
 /** Helper to set an identity/pass-through panning for ambisonic mixing (3D input). */
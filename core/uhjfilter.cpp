@@ -3,7 +3,14 @@
 
 #include "uhjfilter.h"
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <algorithm>
+#include <array>
 #include <iterator>
 
 #include "alcomplex.h"
@@ -14,10 +21,184 @@
 
 namespace {
 
+#ifdef ALSOFT_GENERATED_TABLES
+#include "phase_shifter_inc.h"
+
+constexpr PhaseShifterT<UhjFilterBase::sFilterDelay*2> PShift{UhjPhaseShifterCoeffs};
+#else
 const PhaseShifterT<UhjFilterBase::sFilterDelay*2> PShift{};
+#endif
+
+/* Coefficients for a pair of 8th-order allpass filter chains, each made of
+ * four 2nd-order sections, with a phase difference of 90 degrees (+/-0.7)
+ * between them from around 20hz to 23.5khz at 48khz. The first chain's output
+ * is delayed by one sample to form the reference. These are the squared
+ * coefficients from Olli Niemitalo's "Hilbert transform" IIR design.
+ */
+constexpr std::array<float,4> Filter1Coeff{{
+    0.479400865589f, 0.876218493539f, 0.976597589508f, 0.997499255936f
+}};
+constexpr std::array<float,4> Filter2Coeff{{
+    0.161758498368f, 0.733028932341f, 0.945349700329f, 0.990599156685f
+}};
+
+} // namespace
+
+UhjQualityType UhjDecodeQuality{UhjQualityType::Default};
+UhjQualityType UhjEncodeQuality{UhjQualityType::Default};
+
+
+namespace {
+
+using LaneArray = std::array<float,4>;
+
+/* Applies the four allpass sections to each interleaved sample, with each
+ * lane using its own coefficients and state.
+ */
+void ProcessAllPassLanes(const al::span<const LaneArray,4> coeffs,
+    const al::span<LaneArray,4> z1, const al::span<LaneArray,4> z2,
+    const al::span<LaneArray> samples)
+{
+#ifdef HAVE_SSE_INTRINSICS
+    const __m128 c0{_mm_load_ps(coeffs[0].data())}, c1{_mm_load_ps(coeffs[1].data())};
+    const __m128 c2{_mm_load_ps(coeffs[2].data())}, c3{_mm_load_ps(coeffs[3].data())};
+    __m128 z01{_mm_load_ps(z1[0].data())}, z02{_mm_load_ps(z2[0].data())};
+    __m128 z11{_mm_load_ps(z1[1].data())}, z12{_mm_load_ps(z2[1].data())};
+    __m128 z21{_mm_load_ps(z1[2].data())}, z22{_mm_load_ps(z2[2].data())};
+    __m128 z31{_mm_load_ps(z1[3].data())}, z32{_mm_load_ps(z2[3].data())};
+    for(LaneArray &sample : samples)
+    {
+        const __m128 x0{_mm_load_ps(sample.data())};
+        const __m128 x1{_mm_add_ps(_mm_mul_ps(x0, c0), z01)};
+        z01 = z02;
+        z02 = _mm_sub_ps(_mm_mul_ps(x1, c0), x0);
+        const __m128 x2{_mm_add_ps(_mm_mul_ps(x1, c1), z11)};
+        z11 = z12;
+        z12 = _mm_sub_ps(_mm_mul_ps(x2, c1), x1);
+        const __m128 x3{_mm_add_ps(_mm_mul_ps(x2, c2), z21)};
+        z21 = z22;
+        z22 = _mm_sub_ps(_mm_mul_ps(x3, c2), x2);
+        const __m128 y{_mm_add_ps(_mm_mul_ps(x3, c3), z31)};
+        z31 = z32;
+        z32 = _mm_sub_ps(_mm_mul_ps(y, c3), x3);
+        _mm_store_ps(sample.data(), y);
+    }
+    _mm_store_ps(z1[0].data(), z01); _mm_store_ps(z2[0].data(), z02);
+    _mm_store_ps(z1[1].data(), z11); _mm_store_ps(z2[1].data(), z12);
+    _mm_store_ps(z1[2].data(), z21); _mm_store_ps(z2[2].data(), z22);
+    _mm_store_ps(z1[3].data(), z31); _mm_store_ps(z2[3].data(), z32);
+
+#elif defined(HAVE_NEON)
+
+    const float32x4_t c0{vld1q_f32(coeffs[0].data())}, c1{vld1q_f32(coeffs[1].data())};
+    const float32x4_t c2{vld1q_f32(coeffs[2].data())}, c3{vld1q_f32(coeffs[3].data())};
+    float32x4_t z01{vld1q_f32(z1[0].data())}, z02{vld1q_f32(z2[0].data())};
+    float32x4_t z11{vld1q_f32(z1[1].data())}, z12{vld1q_f32(z2[1].data())};
+    float32x4_t z21{vld1q_f32(z1[2].data())}, z22{vld1q_f32(z2[2].data())};
+    float32x4_t z31{vld1q_f32(z1[3].data())}, z32{vld1q_f32(z2[3].data())};
+    for(LaneArray &sample : samples)
+    {
+        const float32x4_t x0{vld1q_f32(sample.data())};
+        const float32x4_t x1{vmlaq_f32(z01, x0, c0)};
+        z01 = z02;
+        z02 = vsubq_f32(vmulq_f32(x1, c0), x0);
+        const float32x4_t x2{vmlaq_f32(z11, x1, c1)};
+        z11 = z12;
+        z12 = vsubq_f32(vmulq_f32(x2, c1), x1);
+        const float32x4_t x3{vmlaq_f32(z21, x2, c2)};
+        z21 = z22;
+        z22 = vsubq_f32(vmulq_f32(x3, c2), x2);
+        const float32x4_t y{vmlaq_f32(z31, x3, c3)};
+        z31 = z32;
+        z32 = vsubq_f32(vmulq_f32(y, c3), x3);
+        vst1q_f32(sample.data(), y);
+    }
+    vst1q_f32(z1[0].data(), z01); vst1q_f32(z2[0].data(), z02);
+    vst1q_f32(z1[1].data(), z11); vst1q_f32(z2[1].data(), z12);
+    vst1q_f32(z1[2].data(), z21); vst1q_f32(z2[2].data(), z22);
+    vst1q_f32(z1[3].data(), z31); vst1q_f32(z2[3].data(), z32);
+
+#else
+
+    for(LaneArray &sample : samples)
+    {
+        for(size_t s{0};s < 4;++s)
+        {
+            for(size_t l{0};l < 4;++l)
+            {
+                const float x{sample[l]};
+                const float y{x*coeffs[s][l] + z1[s][l]};
+                z1[s][l] = z2[s][l];
+                z2[s][l] = y*coeffs[s][l] - x;
+                sample[l] = y;
+            }
+        }
+    }
+#endif
+}
 
 } // namespace
 
+UhjAllPassFilter::UhjAllPassFilter(const std::array<bool,4> shifted) noexcept
+    : mIsShifted{shifted}
+{
+    for(size_t s{0};s < 4;++s)
+    {
+        for(size_t l{0};l < 4;++l)
+            mCoeffs[s][l] = mIsShifted[l] ? Filter2Coeff[s] : Filter1Coeff[s];
+    }
+}
+
+void UhjAllPassFilter::process(const al::span<const float*const,4> src,
+    const al::span<float*const,4> dst, const size_t todo, const size_t forwardSamples)
+{
+    ASSUME(todo > 0);
+    ASSUME(todo <= sMaxSamples);
+
+    for(size_t l{0};l < 4;++l)
+    {
+        if(const float *input{src[l]})
+        {
+            for(size_t i{0};i < todo;++i)
+                mSamples[i][l] = input[i];
+        }
+        else for(size_t i{0};i < todo;++i)
+            mSamples[i][l] = 0.0f;
+    }
+
+    /* Process up to the forward samples with the stored state, and continue
+     * with a copy for the rest.
+     */
+    const size_t fwdSamples{std::min(forwardSamples, todo)};
+    ProcessAllPassLanes(mCoeffs, mZ1, mZ2, {mSamples.data(), fwdSamples});
+    if(fwdSamples < todo)
+    {
+        auto z1 = mZ1;
+        auto z2 = mZ2;
+        ProcessAllPassLanes(mCoeffs, z1, z2, {mSamples.data()+fwdSamples, todo-fwdSamples});
+    }
+
+    for(size_t l{0};l < 4;++l)
+    {
+        float *RESTRICT output{dst[l]};
+        if(!output) continue;
+
+        if(mIsShifted[l])
+        {
+            for(size_t i{0};i < todo;++i)
+                output[i] = mSamples[i][l];
+        }
+        else
+        {
+            output[0] = mLastOut[l];
+            for(size_t i{1};i < todo;++i)
+                output[i] = mSamples[i-1][l];
+            if(fwdSamples > 0)
+                mLastOut[l] = mSamples[fwdSamples-1][l];
+        }
+    }
+}
+
 
 /* Encoding UHJ from B-Format is done as:
  *
@@ -87,6 +268,49 @@ void UhjEncoder::encode(float *LeftOut, float *RightOut,
     std::copy(mD.cbegin()+SamplesToDo, mD.cbegin()+SamplesToDo+sFilterDelay, mD.begin());
 }
 
+/* With the IIR filters, the "unshifted" signals pass through the first
+ * allpass chain and the shifted signals through the second, so the result has
+ * the same relative phases.
+ */
+void UhjEncoderIIR::encode(float *LeftOut, float *RightOut,
+    const al::span<const float*const,3> InSamples, const size_t SamplesToDo)
+{
+    ASSUME(SamplesToDo > 0);
+
+    float *RESTRICT left{al::assume_aligned<16>(LeftOut)};
+    float *RESTRICT right{al::assume_aligned<16>(RightOut)};
+
+    const float *RESTRICT winput{al::assume_aligned<16>(InSamples[0])};
+    const float *RESTRICT xinput{al::assume_aligned<16>(InSamples[1])};
+    const float *RESTRICT yinput{al::assume_aligned<16>(InSamples[2])};
+
+    /* S = 0.9396926*W + 0.1855740*X */
+    for(size_t i{0};i < SamplesToDo;++i)
+        mS[i] = 0.9396926f*winput[i] + 0.1855740f*xinput[i] + left[i] + right[i];
+
+    /* D = 0.6554516*Y */
+    for(size_t i{0};i < SamplesToDo;++i)
+        mD[i] = 0.6554516f*yinput[i] + left[i] - right[i];
+
+    /* j(-0.3420201*W + 0.5098604*X) */
+    for(size_t i{0};i < SamplesToDo;++i)
+        mWX[i] = -0.3420201f*winput[i] + 0.5098604f*xinput[i];
+
+    mFilter.process({{mS.data(), mD.data(), mWX.data(), nullptr}},
+        {{mS.data(), mD.data(), mWX.data(), nullptr}}, SamplesToDo, SamplesToDo);
+
+    /* D += j(-0.3420201*W + 0.5098604*X) */
+    for(size_t i{0};i < SamplesToDo;++i)
+        mD[i] += mWX[i];
+
+    /* Left = (S + D)/2.0 */
+    for(size_t i{0};i < SamplesToDo;i++)
+        left[i] = (mS[i] + mD[i]) * 0.5f;
+    /* Right = (S - D)/2.0 */
+    for(size_t i{0};i < SamplesToDo;i++)
+        right[i] = (mS[i] - mD[i]) * 0.5f;
+}
+
 
 /* Decoding UHJ is done as:
  *
@@ -161,6 +385,63 @@ void UhjDecoder::decode(const al::span<float*> samples, const size_t samplesToDo
     }
 }
 
+void UhjDecoderIIR::decode(const al::span<float*> samples, const size_t samplesToDo,
+    const size_t forwardSamples)
+{
+    ASSUME(samplesToDo > 0);
+
+    {
+        const float *RESTRICT left{al::assume_aligned<16>(samples[0])};
+        const float *RESTRICT right{al::assume_aligned<16>(samples[1])};
+
+        /* S = Left + Right */
+        for(size_t i{0};i < samplesToDo;++i)
+            mS[i] = left[i] + right[i];
+
+        /* D = Left - Right */
+        for(size_t i{0};i < samplesToDo;++i)
+            mD[i] = left[i] - right[i];
+    }
+
+    float *RESTRICT woutput{al::assume_aligned<16>(samples[0])};
+    float *RESTRICT xoutput{al::assume_aligned<16>(samples[1])};
+    float *RESTRICT youtput{al::assume_aligned<16>(samples[2])};
+
+    /* Precompute 0.828331*D + 0.767820*T in mTemp, and 0.795968*D - 0.676392*T
+     * in mD.
+     */
+    for(size_t i{0};i < samplesToDo;++i)
+        mTemp[i] = 0.828331f*mD[i] + 0.767820f*youtput[i];
+    for(size_t i{0};i < samplesToDo;++i)
+        mD[i] = 0.795968f*mD[i] - 0.676392f*youtput[i];
+
+    /* Filter S and mD in place, and store j*S in youtput and
+     * j(0.828331*D + 0.767820*T) in xoutput.
+     */
+    mFilter.process({{mS.data(), mS.data(), mD.data(), mTemp.data()}},
+        {{mS.data(), youtput, mD.data(), xoutput}}, samplesToDo, forwardSamples);
+
+    /* W = 0.981532*S + 0.197484*j(0.828331*D + 0.767820*T) */
+    for(size_t i{0};i < samplesToDo;++i)
+        woutput[i] = 0.981532f*mS[i] + 0.197484f*xoutput[i];
+    /* X = 0.418496*S - j(0.828331*D + 0.767820*T) */
+    for(size_t i{0};i < samplesToDo;++i)
+        xoutput[i] = 0.418496f*mS[i] - xoutput[i];
+    /* Y = 0.795968*D - 0.676392*T + j(0.186633*S) */
+    for(size_t i{0};i < samplesToDo;++i)
+        youtput[i] = mD[i] + 0.186633f*youtput[i];
+
+    if(samples.size() > 3)
+    {
+        float *RESTRICT zoutput{al::assume_aligned<16>(samples[3])};
+        /* Z = 1.023332*Q */
+        for(size_t i{0};i < samplesToDo;++i)
+            zoutput[i] = 1.023332f*zoutput[i];
+        mFilterQ.process({{zoutput, nullptr, nullptr, nullptr}},
+            {{zoutput, nullptr, nullptr, nullptr}}, samplesToDo, forwardSamples);
+    }
+}
+
 
 /* Super Stereo processing is done as:
  *
@@ -240,3 +521,62 @@ void UhjStereoDecoder::decode(const al::span<float*> samples, const size_t sampl
     for(size_t i{0};i < samplesToDo;++i)
         youtput[i] = 1.6822415f*mD[i] - 0.2156194f*youtput[i];
 }
+
+void UhjStereoDecoderIIR::decode(const al::span<float*> samples, const size_t samplesToDo,
+    const size_t forwardSamples)
+{
+    ASSUME(samplesToDo > 0);
+
+    {
+        const float *RESTRICT left{al::assume_aligned<16>(samples[0])};
+        const float *RESTRICT right{al::assume_aligned<16>(samples[1])};
+
+        for(size_t i{0};i < samplesToDo;++i)
+            mS[i] = left[i] + right[i];
+
+        /* Pre-apply the width factor to the difference signal D. Smoothly
+         * interpolate when it changes.
+         */
+        const float wtarget{mWidthControl};
+        const float wcurrent{unlikely(mCurrentWidth < 0.0f) ? wtarget : mCurrentWidth};
+        if(likely(wtarget == wcurrent) || unlikely(forwardSamples == 0))
+        {
+            for(size_t i{0};i < samplesToDo;++i)
+                mD[i] = (left[i] - right[i]) * wcurrent;
+            mCurrentWidth = wcurrent;
+        }
+        else
+        {
+            const size_t fwdSamples{std::min(forwardSamples, samplesToDo)};
+            const float wstep{(wtarget - wcurrent) / static_cast<float>(fwdSamples)};
+            float fi{0.0f};
+            size_t i{0};
+            for(;i < fwdSamples;++i)
+            {
+                mD[i] = (left[i] - right[i]) * (wcurrent + wstep*fi);
+                fi += 1.0f;
+            }
+            for(;i < samplesToDo;++i)
+                mD[i] = (left[i] - right[i]) * wtarget;
+            mCurrentWidth = wtarget;
+        }
+    }
+
+    float *RESTRICT woutput{al::assume_aligned<16>(samples[0])};
+    float *RESTRICT xoutput{al::assume_aligned<16>(samples[1])};
+    float *RESTRICT youtput{al::assume_aligned<16>(samples[2])};
+
+    /* Filter S and D in place, and store j*D in xoutput and j*S in youtput. */
+    mFilter.process({{mS.data(), mS.data(), mD.data(), mD.data()}},
+        {{mS.data(), youtput, mD.data(), xoutput}}, samplesToDo, forwardSamples);
+
+    /* W = 0.6098637*S - 0.6896511*j*w*D */
+    for(size_t i{0};i < samplesToDo;++i)
+        woutput[i] = 0.6098637f*mS[i] - 0.6896511f*xoutput[i];
+    /* X = 0.8624776*S + 0.7626955*j*w*D */
+    for(size_t i{0};i < samplesToDo;++i)
+        xoutput[i] = 0.8624776f*mS[i] + 0.7626955f*xoutput[i];
+    /* Y = 1.6822415*w*D - 0.2156194*j*S */
+    for(size_t i{0};i < samplesToDo;++i)
+        youtput[i] = 1.6822415f*mD[i] - 0.2156194f*youtput[i];
+}
@@ -25,6 +25,22 @@ struct DecoderBase {
 };
 
 
+/* The filter used to apply the wide-band +90 degree phase shift. The FIR
+ * filter is linear-phase, but needs a delay (or lookahead) and is relatively
+ * costly. The IIR filter is a pair of allpass filter chains with a +90 degree
+ * phase difference between them, which is much cheaper and has no delay, but
+ * leaves a (common) phase distortion on the output.
+ */
+enum class UhjQualityType : unsigned char {
+    IIR,
+    FIR256,
+    Default = FIR256
+};
+
+extern UhjQualityType UhjDecodeQuality;
+extern UhjQualityType UhjEncodeQuality;
+
+
 struct UhjFilterBase {
     /* The filter delay is half it's effective size, so a delay of 128 has a
      * FIR length of 256.
@@ -32,7 +48,55 @@ struct UhjFilterBase {
     static constexpr size_t sFilterDelay{128};
 };
 
-struct UhjEncoder : public UhjFilterBase {
+/* Runs up to four allpass filter chains at once, one per SIMD lane. Each lane
+ * applies either the first chain, delayed by one sample to be the unshifted
+ * reference, or the second chain, which is +90 degrees from the first.
+ */
+struct UhjAllPassFilter {
+    /* The most samples processed at once, which matches what the mixer may
+     * provide to a UHJ decoder.
+     */
+    static constexpr size_t sMaxSamples{BufferLineSize + MaxResamplerEdge +
+        UhjFilterBase::sFilterDelay};
+
+    /* Coefficients and transposed direct form II state, per section per lane. */
+    alignas(16) std::array<std::array<float,4>,4> mCoeffs{};
+    alignas(16) std::array<std::array<float,4>,4> mZ1{};
+    alignas(16) std::array<std::array<float,4>,4> mZ2{};
+
+    /* The last output sample of each lane, for the reference's delay. */
+    std::array<float,4> mLastOut{};
+    std::array<bool,4> mIsShifted{};
+
+    alignas(16) std::array<std::array<float,4>,sMaxSamples> mSamples{};
+
+    explicit UhjAllPassFilter(const std::array<bool,4> shifted) noexcept;
+
+    /**
+     * Filters todo samples from each src lane into the matching dst lane,
+     * which may be the same buffer. Null lanes are skipped. Only the first
+     * forwardSamples are used to update the filter state.
+     */
+    void process(const al::span<const float*const,4> src, const al::span<float*const,4> dst,
+        const size_t todo, const size_t forwardSamples);
+};
+
+struct UhjEncoderBase {
+    virtual ~UhjEncoderBase() = default;
+
+    /** Returns the delay, in samples, the encoder adds to the output. */
+    virtual size_t getDelay() const noexcept = 0;
+
+    /**
+     * Encodes a 2-channel UHJ (stereo-compatible) signal from a B-Format input
+     * signal. The input must use FuMa channel ordering and UHJ scaling (FuMa
+     * with an additional +3dB boost).
+     */
+    virtual void encode(float *LeftOut, float *RightOut,
+        const al::span<const float*const,3> InSamples, const size_t SamplesToDo) = 0;
+};
+
+struct UhjEncoder final : public UhjEncoderBase, public UhjFilterBase {
     /* Delays and processing storage for the unfiltered signal. */
     alignas(16) std::array<float,BufferLineSize+sFilterDelay> mS{};
     alignas(16) std::array<float,BufferLineSize+sFilterDelay> mD{};
@@ -42,17 +106,30 @@ struct UhjEncoder : public UhjFilterBase {
 
     alignas(16) std::array<float,BufferLineSize + sFilterDelay*2> mTemp{};
 
-    /**
-     * Encodes a 2-channel UHJ (stereo-compatible) signal from a B-Format input
-     * signal. The input must use FuMa channel ordering and UHJ scaling (FuMa
-     * with an additional +3dB boost).
-     */
+    size_t getDelay() const noexcept override { return sFilterDelay; }
+
     void encode(float *LeftOut, float *RightOut, const al::span<const float*const,3> InSamples,
-        const size_t SamplesToDo);
+        const size_t SamplesToDo) override;
 
     DEF_NEWDEL(UhjEncoder)
 };
 
+struct UhjEncoderIIR final : public UhjEncoderBase {
+    alignas(16) std::array<float,BufferLineSize> mS{};
+    alignas(16) std::array<float,BufferLineSize> mD{};
+    alignas(16) std::array<float,BufferLineSize> mWX{};
+
+    /* Filters S and the unshifted part of D, and shifts the W/X mix. */
+    UhjAllPassFilter mFilter{{false, false, true, false}};
+
+    size_t getDelay() const noexcept override { return 0; }
+
+    void encode(float *LeftOut, float *RightOut, const al::span<const float*const,3> InSamples,
+        const size_t SamplesToDo) override;
+
+    DEF_NEWDEL(UhjEncoderIIR)
+};
+
 
 struct UhjDecoder : public DecoderBase, public UhjFilterBase {
     /* For 2-channel UHJ, shelf filters should use these LF responses. */
@@ -95,4 +172,38 @@ struct UhjStereoDecoder : public UhjDecoder {
     DEF_NEWDEL(UhjStereoDecoder)
 };
 
+
+struct UhjDecoderIIR : public DecoderBase {
+    static constexpr size_t sMaxSamples{UhjAllPassFilter::sMaxSamples};
+
+    alignas(16) std::array<float,sMaxSamples> mS{};
+    alignas(16) std::array<float,sMaxSamples> mD{};
+    alignas(16) std::array<float,sMaxSamples> mTemp{};
+
+    /* Filters S and D (or a D/T mix), both unshifted and shifted. */
+    UhjAllPassFilter mFilter{{false, true, false, true}};
+    /* Filters Q, for 4-channel UHJ. */
+    UhjAllPassFilter mFilterQ{{false, false, false, false}};
+
+    /**
+     * Decodes a UHJ signal like UhjDecoder, using the IIR phase shift filter.
+     * This doesn't need any samples past samplesToDo.
+     */
+    void decode(const al::span<float*> samples, const size_t samplesToDo,
+        const size_t forwardSamples) override;
+
+    DEF_NEWDEL(UhjDecoderIIR)
+};
+
+struct UhjStereoDecoderIIR : public UhjDecoderIIR {
+    /**
+     * Applies Super Stereo processing like UhjStereoDecoder, using the IIR
+     * phase shift filter.
+     */
+    void decode(const al::span<float*> samples, const size_t samplesToDo,
+        const size_t forwardSamples) override;
+
+    DEF_NEWDEL(UhjStereoDecoderIIR)
+};
+
 #endif /* CORE_UHJFILTER_H */
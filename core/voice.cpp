@@ -7,8 +7,11 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <new>
 #include <stdlib.h>
@@ -27,6 +30,7 @@
 #include "cpu_caps.h"
 #include "devformat.h"
 #include "device.h"
+#include "effectslot.h"
 #include "filters/biquad.h"
 #include "filters/nfc.h"
 #include "filters/splitter.h"
@@ -109,6 +113,18 @@ inline HrtfMixerBlendFunc SelectHrtfBlendMixer()
     return MixHrtfBlend_<CTag>;
 }
 
+/* Gets the number of gains for each channel and output of a voice. The gain
+ * arrays are sized for the outputs a voice can actually mix to, rather than
+ * the maximum channel count. Effect slots' inputs are sized for the device's
+ * ambisonic order, and the dry path goes to either the dry or real output
+ * buffer.
+ */
+size_t GetGainCount(const DeviceBase *device) noexcept
+{
+    return RoundUp(maxz(AmbiChannelsFromOrder(device->mAmbiOrder),
+        maxz(device->Dry.Buffer.size(), device->RealOut.Buffer.size())), 4);
+}
+
 } // namespace
 
 void Voice::InitMixer(al::optional<std::string> resampler)
@@ -428,8 +444,13 @@ void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, D
     const float *TargetGains, const uint Counter, const uint OutPos, DeviceBase *Device)
 {
     using FilterProc = void (NfcFilter::*)(const al::span<const float>, float*);
+    /* The near-field filters only go up to fourth-order, so the higher orders
+     * reuse the fourth-order filter.
+     */
     static constexpr FilterProc NfcProcess[MaxAmbiOrder+1]{
-        nullptr, &NfcFilter::process1, &NfcFilter::process2, &NfcFilter::process3};
+        nullptr, &NfcFilter::process1, &NfcFilter::process2, &NfcFilter::process3,
+        &NfcFilter::process4, &NfcFilter::process4, &NfcFilter::process4,
+        &NfcFilter::process4};
 
     float *CurrentGains{parms.Gains.Current.data()};
     MixSamples(samples, {OutBuffer, 1u}, CurrentGains, TargetGains, Counter, OutPos);
@@ -451,9 +472,47 @@ void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, D
     }
 }
 
+
+/* The length of the fade-out leading up to a scheduled stop, in samples. */
+constexpr uint StopFadeLength{64};
+
+/* Converts a (positive) time offset to the nearest number of samples at the
+ * given rate. Offsets of a second or more are beyond any update, and are
+ * clamped to a second.
+ */
+inline uint TimeToSamples(const std::chrono::nanoseconds offset, const uint rate)
+{
+    using std::chrono::nanoseconds;
+    if(offset >= std::chrono::seconds{1})
+        return rate;
+    const auto samples = (offset.count()*rate + nanoseconds::period::den/2)
+        / nanoseconds::period::den;
+    return static_cast<uint>(samples);
+}
+
+/* Fades out the given samples, starting at output position pos, so they reach
+ * silence at stopPos.
+ */
+void ApplyStopFade(const al::span<float> samples, const uint pos, const uint stopPos)
+{
+    for(size_t i{0};i < samples.size();++i)
+    {
+        const size_t spos{pos + i};
+        if(spos >= stopPos)
+        {
+            std::fill(samples.begin()+static_cast<ptrdiff_t>(i), samples.end(), 0.0f);
+            break;
+        }
+        const size_t remaining{stopPos - spos};
+        if(remaining < StopFadeLength)
+            samples[i] *= static_cast<float>(remaining) * (1.0f/StopFadeLength);
+    }
+}
+
 } // namespace
 
-void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo)
+void Voice::mix(const State vstate, ContextBase *Context, const std::chrono::nanoseconds deviceTime,
+    const uint SamplesToDo)
 {
     static constexpr std::array<float,MAX_OUTPUT_CHANNELS> SilentTarget{};
 
@@ -478,10 +537,72 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     DeviceBase *Device{Context->mDevice};
     const uint NumSends{Device->NumAuxSends};
 
+    /* Check for a delayed start. The mixers need the output to start on a
+     * multiple of 4 samples, so the output position is rounded down and the
+     * remainder is made up by padding the first resampled samples with
+     * silence, keeping the start sample-accurate.
+     */
+    uint OutPos{0u};
+    uint StartPad{0u};
+    if(mStartTime > deviceTime)
+    {
+        /* A voice that stops before it starts just stops. */
+        if(vstate == Stopping)
+        {
+            mPlayState.store(Stopped, std::memory_order_release);
+            return;
+        }
+
+        const uint startOffset{TimeToSamples(mStartTime - deviceTime, Device->Frequency)};
+        if(startOffset >= SamplesToDo)
+            return;
+        OutPos = startOffset & ~3u;
+        StartPad = startOffset & 3u;
+    }
+
+    /* Check for a scheduled stop close enough to need fading out. */
+    uint StopPos{std::numeric_limits<uint>::max()};
+    if(mStopTime != std::chrono::nanoseconds::max() && vstate == Playing)
+    {
+        StopPos = (mStopTime > deviceTime) ?
+            TimeToSamples(mStopTime - deviceTime, Device->Frequency) : 0u;
+        if(StopPos >= SamplesToDo+StopFadeLength)
+            StopPos = std::numeric_limits<uint>::max();
+    }
+
     ResamplerFunc Resample{(increment == MixerFracOne && DataPosFrac == 0) ?
                            Resample_<CopyTag,CTag> : mResampler};
 
-    uint Counter{mFlags.test(VoiceIsFading) ? SamplesToDo : 0};
+    /* Mark the effect slots this voice sends to. Their wet buffers need to be
+     * cleared after this, and their effects need to process unless the send
+     * gains are silent. Silent sends (such as those dropped for reduced
+     * detail) aren't filtered or mixed either.
+     */
+    std::bitset<MAX_SENDS> activeSends{};
+    for(uint send{0};send < NumSends;++send)
+    {
+        EffectSlot *slot{mSend[send].Slot};
+        if(mSend[send].Buffer.empty() || !slot)
+            continue;
+
+        slot->mWetDirty = true;
+
+        auto is_audible = [](const float gain) noexcept -> bool
+        { return std::abs(gain) > GainSilenceThreshold; };
+        const bool audible{std::any_of(mChans.cbegin(), mChans.cend(),
+            [send,is_audible](const ChannelData &chandata) -> bool
+            {
+                const SendParams &parms = chandata.mWetParams[send];
+                return std::any_of(parms.Gains.Current.cbegin(), parms.Gains.Current.cend(),
+                        is_audible)
+                    || std::any_of(parms.Gains.Target.cbegin(), parms.Gains.Target.cend(),
+                        is_audible);
+            })};
+        activeSends.set(send, audible);
+        if(audible) slot->mHasInput = true;
+    }
+
+    uint Counter{mFlags.test(VoiceIsFading) ? SamplesToDo-OutPos : 0};
     if(!Counter)
     {
         /* No fading, just overwrite the old/current params. */
@@ -490,7 +611,8 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             {
                 DirectParams &parms = chandata.mDryParams;
                 if(!mFlags.test(VoiceHasHrtf))
-                    parms.Gains.Current = parms.Gains.Target;
+                    std::copy(parms.Gains.Target.begin(), parms.Gains.Target.end(),
+                        parms.Gains.Current.begin());
                 else
                     parms.Hrtf.Old = parms.Hrtf.Target;
             }
@@ -500,7 +622,8 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
                     continue;
 
                 SendParams &parms = chandata.mWetParams[send];
-                parms.Gains.Current = parms.Gains.Target;
+                std::copy(parms.Gains.Target.begin(), parms.Gains.Target.end(),
+                    parms.Gains.Current.begin());
             }
         }
     }
@@ -516,7 +639,6 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
 
     const uint PostPadding{MaxResamplerEdge + mDecoderPadding};
     uint buffers_done{0u};
-    uint OutPos{0u};
     do {
         /* Figure out how many buffer samples will be needed */
         uint DstBufferSize{SamplesToDo - OutPos};
@@ -570,9 +692,13 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             }
         }
 
+        /* The number of output samples that come from the source, excluding
+         * any start padding.
+         */
+        const uint SrcDstSize{DstBufferSize - StartPad};
         if(unlikely(!BufferListItem))
         {
-            const size_t srcOffset{(increment*DstBufferSize + DataPosFrac)>>MixerFracBits};
+            const size_t srcOffset{(increment*SrcDstSize + DataPosFrac)>>MixerFracBits};
             auto prevSamples = mPrevSamples.data();
             SrcBufferSize = SrcBufferSize - PostPadding + MaxResamplerEdge;
             for(auto *chanbuffer : MixingSamples)
@@ -632,7 +758,7 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
                 LoadBufferQueue(BufferListItem, BufferLoopItem, DataPosInt, mFmtType, mFmtChannels,
                     mFrameStep, SrcBufferSize, MixingSamples);
 
-            const size_t srcOffset{(increment*DstBufferSize + DataPosFrac)>>MixerFracBits};
+            const size_t srcOffset{(increment*SrcDstSize + DataPosFrac)>>MixerFracBits};
             if(mDecoder)
             {
                 SrcBufferSize = SrcBufferSize - PostPadding + MaxResamplerEdge;
@@ -661,6 +787,15 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
                 {Device->ResampledData, DstBufferSize})};
             ++voiceSamples;
 
+            if(unlikely(StartPad > 0))
+            {
+                std::copy_backward(ResampledData, ResampledData+SrcDstSize,
+                    ResampledData+DstBufferSize);
+                std::fill_n(ResampledData, StartPad, 0.0f);
+            }
+            if(unlikely(StopPos < OutPos+DstBufferSize+StopFadeLength))
+                ApplyStopFade({ResampledData, DstBufferSize}, OutPos, StopPos);
+
             if(mFlags.test(VoiceIsAmbisonic))
                 chandata.mAmbiSplitter.processScale({ResampledData, DstBufferSize},
                     chandata.mAmbiHFScale, chandata.mAmbiLFScale);
@@ -677,9 +812,21 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
                     const float TargetGain{parms.Hrtf.Target.Gain * likely(vstate == Playing)};
                     DoHrtfMix(samples, DstBufferSize, parms, TargetGain, Counter, OutPos,
                         (vstate == Playing), Device);
+
+                    /* Fade out the panned mix this is replacing. */
+                    if(unlikely(mFlags.test(VoiceHrtfChanged)))
+                        MixSamples({samples, DstBufferSize}, mPrevDirectBuffer,
+                            parms.Gains.Current.data(), SilentTarget.data(), Counter, OutPos);
                 }
                 else
                 {
+                    /* Fade out the HRTF mix this is replacing. Its target was
+                     * cleared, so it fades to silence.
+                     */
+                    if(unlikely(mFlags.test(VoiceHrtfChanged)))
+                        DoHrtfMix(samples, DstBufferSize, parms, 0.0f, Counter, OutPos,
+                            (vstate == Playing), Device);
+
                     const float *TargetGains{likely(vstate == Playing) ? parms.Gains.Target.data()
                         : SilentTarget.data()};
                     if(mFlags.test(VoiceHasNfc))
@@ -693,7 +840,7 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
 
             for(uint send{0};send < NumSends;++send)
             {
-                if(mSend[send].Buffer.empty())
+                if(!activeSends.test(send))
                     continue;
 
                 SendParams &parms = chandata.mWetParams[send];
@@ -710,14 +857,26 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
         if(unlikely(vstate == Stopping))
             break;
 
+        /* If a scheduled stop was reached, end the voice with silent history
+         * so it has nothing more to fade out.
+         */
+        if(unlikely(StopPos <= OutPos+DstBufferSize))
+        {
+            for(auto &prevSamples : mPrevSamples)
+                prevSamples.fill(0.0f);
+            BufferListItem = nullptr;
+            break;
+        }
+
         /* Update positions */
-        DataPosFrac += increment*DstBufferSize;
+        DataPosFrac += increment*SrcDstSize;
         const uint SrcSamplesDone{DataPosFrac>>MixerFracBits};
         DataPosInt  += SrcSamplesDone;
         DataPosFrac &= MixerFracMask;
 
         OutPos += DstBufferSize;
         Counter = maxu(DstBufferSize, Counter) - DstBufferSize;
+        StartPad = 0;
 
         if(unlikely(!BufferListItem))
         {
@@ -780,6 +939,7 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     } while(OutPos < SamplesToDo);
 
     mFlags.set(VoiceIsFading);
+    mFlags.reset(VoiceHrtfChanged);
 
     /* Don't update positions and buffers if we were stopping. */
     if(unlikely(vstate == Stopping))
@@ -802,6 +962,14 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     }
     std::atomic_thread_fence(std::memory_order_release);
 
+    /* Publish the new position as of the end of this update. This comes after
+     * clearing the source ID, so a snapshot showing the voice ended is never
+     * seen as belonging to the source.
+     */
+    publishPosition(Device->ClockBase +
+        std::chrono::nanoseconds{std::chrono::seconds{Device->SamplesDone + SamplesToDo}}
+        / Device->Frequency);
+
     /* Send any events now, after the position/buffer info was updated. */
     const uint enabledevt{Context->mEnabledEvts.load(std::memory_order_acquire)};
     if(buffers_done > 0 && (enabledevt&AsyncEvent::BufferCompleted))
@@ -829,8 +997,66 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     }
 }
 
-void Voice::prepare(DeviceBase *device)
+void Voice::publishPosition(const std::chrono::nanoseconds clockTime) noexcept
 {
+    const uint seq{mSnapshotSeq.load(std::memory_order_relaxed)};
+    mSnapshotSeq.store(seq+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mSnapshotPosition.store(mPosition.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    mSnapshotPositionFrac.store(mPositionFrac.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    if(VoiceBufferItem *buffer{mCurrentBuffer.load(std::memory_order_relaxed)})
+    {
+        mSnapshotHasBuffer.store(true, std::memory_order_relaxed);
+        mSnapshotQueueIndex.store(buffer->mQueueIndex, std::memory_order_relaxed);
+        mSnapshotQueueOffset.store(buffer->mQueueOffset, std::memory_order_relaxed);
+    }
+    else
+        mSnapshotHasBuffer.store(false, std::memory_order_relaxed);
+    mSnapshotClockTime.store(clockTime, std::memory_order_relaxed);
+
+    mSnapshotSeq.store(seq+2, std::memory_order_release);
+}
+
+Voice::PositionSnapshot Voice::getPositionSnapshot() const noexcept
+{
+    PositionSnapshot ret;
+    uint seq;
+    do {
+        /* The publisher only takes a few stores, so just retry if it's in the
+         * middle of one.
+         */
+        seq = mSnapshotSeq.load(std::memory_order_acquire);
+        ret.Position = mSnapshotPosition.load(std::memory_order_relaxed);
+        ret.PositionFrac = mSnapshotPositionFrac.load(std::memory_order_relaxed);
+        ret.HasBuffer = mSnapshotHasBuffer.load(std::memory_order_relaxed);
+        ret.QueueIndex = mSnapshotQueueIndex.load(std::memory_order_relaxed);
+        ret.QueueOffset = mSnapshotQueueOffset.load(std::memory_order_relaxed);
+        ret.ClockTime = mSnapshotClockTime.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while((seq&1) || seq != mSnapshotSeq.load(std::memory_order_relaxed));
+    return ret;
+}
+
+void Voice::reserve(DeviceBase *device)
+{
+    /* Ambisonic voices mix at most the device's order, and other formats have
+     * at most 8 channels.
+     */
+    const size_t num_channels{minz(device->mSampleData.size(),
+        maxz(8, AmbiChannelsFromOrder(device->mAmbiOrder)))};
+    mChans.reserve(num_channels);
+    mPrevSamples.reserve(num_channels);
+    mGainStore.reserve(num_channels * (device->NumAuxSends+1) * GetGainCount(device) * 2);
+    mStorageReserved = true;
+}
+
+bool Voice::prepare(DeviceBase *device)
+{
+    mPanningKey.Valid = false;
+
     /* Even if storing really high order ambisonics, we only mix channels for
      * orders up to the device order. The rest are simply dropped.
      */
@@ -842,11 +1068,14 @@ void Voice::prepare(DeviceBase *device)
             device->mSampleData.size(), mFmtChannels, mAmbiOrder);
         num_channels = static_cast<uint>(device->mSampleData.size());
     }
-    if(mChans.capacity() > 2 && num_channels < mChans.capacity())
+    bool allocated{false};
+    if(!mStorageReserved && mChans.capacity() > 2 && num_channels < mChans.capacity())
     {
         decltype(mChans){}.swap(mChans);
         decltype(mPrevSamples){}.swap(mPrevSamples);
     }
+    if(num_channels > mChans.capacity() || num_channels > mPrevSamples.capacity())
+        allocated = true;
     mChans.reserve(maxu(2, num_channels));
     mChans.resize(num_channels);
     mPrevSamples.reserve(maxu(2, num_channels));
@@ -854,13 +1083,33 @@ void Voice::prepare(DeviceBase *device)
 
     if(mFmtChannels == FmtSuperStereo)
     {
-        mDecoder = std::make_unique<UhjStereoDecoder>();
-        mDecoderPadding = UhjStereoDecoder::sFilterDelay;
+        if(UhjDecodeQuality == UhjQualityType::IIR)
+        {
+            mDecoder = std::make_unique<UhjStereoDecoderIIR>();
+            allocated = true;
+            mDecoderPadding = 0;
+        }
+        else
+        {
+            mDecoder = std::make_unique<UhjStereoDecoder>();
+            allocated = true;
+            mDecoderPadding = UhjStereoDecoder::sFilterDelay;
+        }
     }
     else if(IsUHJ(mFmtChannels))
     {
-        mDecoder = std::make_unique<UhjDecoder>();
-        mDecoderPadding = UhjDecoder::sFilterDelay;
+        if(UhjDecodeQuality == UhjQualityType::IIR)
+        {
+            mDecoder = std::make_unique<UhjDecoderIIR>();
+            allocated = true;
+            mDecoderPadding = 0;
+        }
+        else
+        {
+            mDecoder = std::make_unique<UhjDecoder>();
+            allocated = true;
+            mDecoderPadding = UhjDecoder::sFilterDelay;
+        }
     }
     else
     {
@@ -945,4 +1194,30 @@ void Voice::prepare(DeviceBase *device)
         }
         mFlags.reset(VoiceIsAmbisonic);
     }
+
+    const size_t gaincount{GetGainCount(device)};
+    const size_t gainsize{mChans.size() * (device->NumAuxSends+1) * gaincount * 2};
+    if(gainsize > mGainStore.capacity())
+        allocated = true;
+    mGainStore.assign(gainsize, 0.0f);
+
+    float *gains{mGainStore.data()};
+    auto next_gains = [&gains,gaincount]() noexcept -> al::span<float>
+    {
+        const al::span<float> ret{gains, gaincount};
+        gains += gaincount;
+        return ret;
+    };
+    for(auto &chandata : mChans)
+    {
+        chandata.mDryParams.Gains.Current = next_gains();
+        chandata.mDryParams.Gains.Target = next_gains();
+        for(uint i{0};i < device->NumAuxSends;++i)
+        {
+            chandata.mWetParams[i].Gains.Current = next_gains();
+            chandata.mWetParams[i].Gains.Target = next_gains();
+        }
+    }
+
+    return allocated;
 }
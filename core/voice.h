@@ -4,8 +4,10 @@
 #include <array>
 #include <atomic>
 #include <bitset>
+#include <chrono>
 #include <memory>
 #include <stddef.h>
+#include <stdint.h>
 #include <string>
 
 #include "albyte.h"
@@ -74,9 +76,12 @@ struct DirectParams {
         alignas(16) std::array<float,HrtfHistoryLength> History;
     } Hrtf;
 
+    /* Views into the owning voice's gain storage, sized for the outputs the
+     * voice can mix to.
+     */
     struct {
-        std::array<float,MAX_OUTPUT_CHANNELS> Current;
-        std::array<float,MAX_OUTPUT_CHANNELS> Target;
+        al::span<float> Current;
+        al::span<float> Target;
     } Gains;
 };
 
@@ -85,8 +90,8 @@ struct SendParams {
     BiquadFilter HighPass;
 
     struct {
-        std::array<float,MAX_OUTPUT_CHANNELS> Current;
-        std::array<float,MAX_OUTPUT_CHANNELS> Target;
+        al::span<float> Current;
+        al::span<float> Target;
     } Gains;
 };
 
@@ -102,6 +107,13 @@ struct VoiceBufferItem {
     uint mLoopEnd{0u};
 
     al::byte *mSamples{nullptr};
+
+    /* The number of items queued before this one, and their total length in
+     * samples. These keep counting across unqueued items, so only differences
+     * between items in the same queue are meaningful.
+     */
+    uint64_t mQueueIndex{0u};
+    uint64_t mQueueOffset{0u};
 };
 
 
@@ -173,6 +185,9 @@ enum : uint {
     VoiceIsFading,
     VoiceHasHrtf,
     VoiceHasNfc,
+    VoiceIsLowDetail,
+    VoiceHrtfChanged,
+    VoicePanningDeferred,
 
     VoiceFlagCount
 };
@@ -204,6 +219,28 @@ struct Voice {
     /* Current buffer queue item being played. */
     std::atomic<VoiceBufferItem*> mCurrentBuffer;
 
+    /* A snapshot of the voice's position, for the app to query without
+     * waiting on the mixer. The current buffer is given by its queue index and
+     * offset, since the item may be unqueued by the time the snapshot is read.
+     * ClockTime is the device clock time the position was reached at.
+     */
+    struct PositionSnapshot {
+        uint Position;
+        uint PositionFrac;
+        bool HasBuffer;
+        uint64_t QueueIndex;
+        uint64_t QueueOffset;
+        std::chrono::nanoseconds ClockTime;
+    };
+    /* Sequence count for the snapshot, which is odd while being written. */
+    std::atomic<uint> mSnapshotSeq{0u};
+    std::atomic<uint> mSnapshotPosition{0u};
+    std::atomic<uint> mSnapshotPositionFrac{0u};
+    std::atomic<bool> mSnapshotHasBuffer{false};
+    std::atomic<uint64_t> mSnapshotQueueIndex{0u};
+    std::atomic<uint64_t> mSnapshotQueueOffset{0u};
+    std::atomic<std::chrono::nanoseconds> mSnapshotClockTime{std::chrono::nanoseconds{}};
+
     /* Buffer queue item to loop to at end of queue (will be NULL for non-
      * looping voices).
      */
@@ -232,13 +269,43 @@ struct Voice {
     std::bitset<VoiceFlagCount> mFlags{};
     uint mNumCallbackSamples{0};
 
+    /* The device clock times to start and stop mixing at, for scheduled
+     * playback. Only used by the mixer.
+     */
+    std::chrono::nanoseconds mStartTime{};
+    std::chrono::nanoseconds mStopTime{std::chrono::nanoseconds::max()};
+
     struct TargetData {
         int FilterType;
         al::span<FloatBufferLine> Buffer;
+        /* The effect slot being sent to, for auxiliary sends. */
+        EffectSlot *Slot;
     };
     TargetData mDirect;
     std::array<TargetData,MAX_SENDS> mSend;
 
+    /* The buffer the panned direct path mixed to before switching to HRTF,
+     * for fading it out.
+     */
+    al::span<FloatBufferLine> mPrevDirectBuffer;
+
+    /* The inputs the current panning and filters were calculated with, so
+     * updates that barely change them can skip recalculating. Only used by the
+     * mixer.
+     */
+    struct PanningKey {
+        bool Valid;
+        std::array<float,3> Direction;
+        float Distance;
+        float Spread;
+        std::array<float,3> OrientAt;
+        std::array<float,3> OrientUp;
+        /* Base, HF, and LF gains for the direct path, then each send. */
+        std::array<std::array<float,3>,MAX_SENDS+1> Gains;
+        std::array<EffectSlot*,MAX_SENDS> Slots;
+    };
+    PanningKey mPanningKey{};
+
     /* The first MaxResamplerPadding/2 elements are the sample history from the
      * previous mix, with an additional MaxResamplerPadding/2 elements that are
      * now current (which may be overwritten if the buffer data is still
@@ -256,15 +323,43 @@ struct Voice {
     };
     al::vector<ChannelData> mChans{2};
 
+    /* Storage for the channels' current and target gains. */
+    al::vector<float,16> mGainStore;
+    /* Set when the storage was reserved, so it isn't freed for a voice with
+     * fewer channels.
+     */
+    bool mStorageReserved{false};
+
     Voice() = default;
     ~Voice() = default;
 
     Voice(const Voice&) = delete;
     Voice& operator=(const Voice&) = delete;
 
-    void mix(const State vstate, ContextBase *Context, const uint SamplesToDo);
+    void mix(const State vstate, ContextBase *Context, const std::chrono::nanoseconds deviceTime,
+        const uint SamplesToDo);
 
-    void prepare(DeviceBase *device);
+    /**
+     * Reserves channel and gain storage for the most channels and sends the
+     * device can mix a voice with, so preparing the voice won't need to
+     * allocate. Must not be called while the voice is being mixed.
+     */
+    void reserve(DeviceBase *device);
+    /**
+     * Prepares the voice to play on the device. Returns true if it had to
+     * allocate memory to do so.
+     */
+    bool prepare(DeviceBase *device);
+
+    /**
+     * Publishes the current position (mPosition, mPositionFrac, and
+     * mCurrentBuffer) as reached at the given clock time. Only one thread may
+     * publish at a time; the mixer while the voice plays, or the app while
+     * it's stopped.
+     */
+    void publishPosition(const std::chrono::nanoseconds clockTime) noexcept;
+    /** Gets the last published position, without blocking the publisher. */
+    PositionSnapshot getPositionSnapshot() const noexcept;
 
     static void InitMixer(al::optional<std::string> resampler);
 
@@ -2,6 +2,7 @@
 #define VOICE_CHANGE_H
 
 #include <atomic>
+#include <chrono>
 
 #include "almalloc.h"
 
@@ -15,13 +16,18 @@ enum class VChangeState {
     Stop,
     Play,
     Pause,
-    Restart
+    Restart,
+    StopAt
 };
 struct VoiceChange {
     Voice *mOldVoice{nullptr};
     Voice *mVoice{nullptr};
     uint mSourceID{0};
     VChangeState mState{};
+    /* The device clock time to start playing at for Play, or to stop at for
+     * StopAt.
+     */
+    std::chrono::nanoseconds mTime{};
 
     std::atomic<VoiceChange*> mNext{nullptr};
 
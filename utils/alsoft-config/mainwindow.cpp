@@ -91,6 +91,10 @@ static const struct NameValuePair {
     { "Ambisonic, 1st Order", "ambi1" },
     { "Ambisonic, 2nd Order", "ambi2" },
     { "Ambisonic, 3rd Order", "ambi3" },
+    { "Ambisonic, 4th Order", "ambi4" },
+    { "Ambisonic, 5th Order", "ambi5" },
+    { "Ambisonic, 6th Order", "ambi6" },
+    { "Ambisonic, 7th Order", "ambi7" },
 
     { "", "" }
 }, sampleTypeList[] = {
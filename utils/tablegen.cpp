@@ -0,0 +1,119 @@
+/*
+ * Filter Table Generator
+ *
+ * Copyright (c) Chris Robinson <chris.kcat@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* This is run at build time to write out the filter tables the library would
+ * otherwise calculate when it's loaded. It uses the same code the library
+ * does for the calculations, so the results are identical.
+ */
+
+#include "config.h"
+
+#include <cstdio>
+#include <string>
+
+#include "alspan.h"
+#include "core/bsinc_tables.h"
+#include "core/uhjfilter.h"
+#include "phase_shifter.h"
+
+
+namespace {
+
+/* 9 significant digits is enough to exactly reproduce any float. */
+void WriteFloats(FILE *f, const al::span<const float> values)
+{
+    size_t count{0};
+    for(const float value : values)
+    {
+        if((count%6) == 0) fputs("    ", f);
+        fprintf(f, "%.8ef,", static_cast<double>(value));
+        fputc((++count%6) == 0 || count == values.size() ? '\n' : ' ', f);
+    }
+}
+
+void WriteBSincTable(FILE *f, const char *name, const BSincTable &table)
+{
+    const size_t last{BSincScaleCount - 1};
+    const size_t total{table.filterOffset[last] + table.m[last]*4*BSincPhaseCount};
+
+    fprintf(f, "alignas(16) constexpr float %s[%zu]{\n", name, total);
+    WriteFloats(f, {table.Tab, total});
+    fputs("};\n\n", f);
+}
+
+FILE *OpenOutput(const std::string &fname)
+{
+    FILE *f{fopen(fname.c_str(), "wb")};
+    if(!f)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", fname.c_str());
+        return nullptr;
+    }
+    fputs("/* Generated by tablegen. Do not edit. */\n\n", f);
+    return f;
+}
+
+bool CloseOutput(FILE *f, const std::string &fname)
+{
+    const bool failed{ferror(f) != 0};
+    if(fclose(f) != 0 || failed)
+    {
+        fprintf(stderr, "Failed to write %s\n", fname.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if(argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <output directory>\n", argv[0]);
+        return 1;
+    }
+    const std::string outdir{argv[1]};
+
+    const std::string bsincname{outdir + "/bsinc_inc.h"};
+    FILE *f{OpenOutput(bsincname)};
+    if(!f) return 1;
+    WriteBSincTable(f, "bsinc12_table", bsinc12);
+    WriteBSincTable(f, "bsinc24_table", bsinc24);
+    if(!CloseOutput(f, bsincname)) return 1;
+
+    const std::string pshiftname{outdir + "/phase_shifter_inc.h"};
+    f = OpenOutput(pshiftname);
+    if(!f) return 1;
+    {
+        const PhaseShifterT<UhjFilterBase::sFilterDelay*2> pshift{};
+        fprintf(f, "constexpr std::array<float,%zu> UhjPhaseShifterCoeffs{{\n",
+            pshift.mCoeffs.size());
+        WriteFloats(f, pshift.mCoeffs);
+        fputs("}};\n", f);
+    }
+    if(!CloseOutput(f, pshiftname)) return 1;
+
+    return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * UHJ filter comparison
+ *
+ * Copyright (c) Chris Robinson <chris.kcat@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Compares the IIR UHJ encoder and decoders with the FIR256 ones. A sine tone
+ * is run through both filter types for a set of frequencies, and the relative
+ * level and phase between the output channels is compared. The IIR filters
+ * leave a phase distortion common to all channels, so only the ratios between
+ * channels are expected to match. Returns non-0 if the differences above the
+ * low frequency limit exceed the given tolerances.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stddef.h>
+#include <vector>
+
+#include "alnumbers.h"
+#include "alspan.h"
+#include "core/bufferline.h"
+#include "core/uhjfilter.h"
+#include "vector.h"
+
+#include "win_main_utf8.h"
+
+
+namespace {
+
+using complex_d = std::complex<double>;
+
+constexpr double SampleRate{48000.0};
+
+/* The number of samples to let the filters settle, and the number to analyze
+ * after that.
+ */
+constexpr size_t SettleLength{24576};
+constexpr size_t AnalyzeLength{32768};
+constexpr size_t TotalLength{SettleLength + AnalyzeLength};
+
+constexpr size_t BlockSize{BufferLineSize};
+constexpr size_t Lookahead{UhjFilterBase::sFilterDelay};
+
+/* The source direction for encoding, and the stereo pan for decoding. */
+constexpr double EncodeAzimuth{30.0};
+constexpr double DecodeRightGain{0.5};
+
+using SignalBuffer = al::vector<float,16>;
+
+bool Verbose{false};
+
+
+/* Returns the complex amplitude of the given frequency in the analyzed part
+ * of the signal, using a Hann window.
+ */
+complex_d Analyze(const SignalBuffer &signal, const double freq)
+{
+    const double w{2.0*al::numbers::pi * freq / SampleRate};
+    complex_d ret{};
+    for(size_t i{0};i < AnalyzeLength;++i)
+    {
+        const double win{0.5 - 0.5*std::cos(2.0*al::numbers::pi*static_cast<double>(i)
+            / static_cast<double>(AnalyzeLength))};
+        const size_t pos{SettleLength + i};
+        ret += std::polar(signal[pos]*win, -w*static_cast<double>(pos));
+    }
+    return ret;
+}
+
+SignalBuffer MakeSine(const double freq, const double gain)
+{
+    const double w{2.0*al::numbers::pi * freq / SampleRate};
+    SignalBuffer ret(TotalLength + Lookahead);
+    for(size_t i{0};i < ret.size();++i)
+        ret[i] = static_cast<float>(std::sin(w*static_cast<double>(i)) * gain);
+    return ret;
+}
+
+
+struct Result {
+    double maxDb{0.0};
+    double maxDeg{0.0};
+    double seconds{0.0};
+    size_t blocks{0};
+
+    void update(const char *name, const double freq, const complex_d fir, const complex_d iir)
+    {
+        const complex_d diff{iir / fir};
+        const double db{20.0*std::log10(std::abs(diff))};
+        const double deg{std::arg(diff) * 180.0/al::numbers::pi};
+        if(Verbose)
+            printf("%-14s %8.1fhz %10.4fdB %10.3fdeg\n", name, freq, db, deg);
+        maxDb = std::max(maxDb, std::abs(db));
+        maxDeg = std::max(maxDeg, std::abs(deg));
+    }
+};
+
+
+/* Encodes a B-Format signal with the given encoder, and returns the L/R
+ * ratio.
+ */
+complex_d Encode(UhjEncoderBase &encoder, const double freq, Result &result)
+{
+    const double azrad{EncodeAzimuth * al::numbers::pi/180.0};
+    const SignalBuffer w{MakeSine(freq, 0.5)};
+    const SignalBuffer x{MakeSine(freq, 0.5*std::cos(azrad))};
+    const SignalBuffer y{MakeSine(freq, 0.5*std::sin(azrad))};
+    SignalBuffer left(TotalLength), right(TotalLength);
+
+    const auto start = std::chrono::steady_clock::now();
+    for(size_t base{0};base < TotalLength;base += BlockSize)
+    {
+        const size_t todo{std::min(BlockSize, TotalLength-base)};
+        encoder.encode(left.data()+base, right.data()+base,
+            {{w.data()+base, x.data()+base, y.data()+base}}, todo);
+        ++result.blocks;
+    }
+    result.seconds += std::chrono::duration<double>{std::chrono::steady_clock::now()
+        - start}.count();
+
+    return Analyze(left, freq) / Analyze(right, freq);
+}
+
+/* Decodes a stereo signal with the given decoder, and returns the X/W and
+ * Y/W ratios. The decoders work in place, and the FIR decoders read past the
+ * samples they output, so the input is copied into working buffers with the
+ * lookahead each block.
+ */
+std::array<complex_d,2> Decode(DecoderBase &decoder, const size_t lookahead, const double freq,
+    Result &result)
+{
+    const SignalBuffer left{MakeSine(freq, 1.0)};
+    const SignalBuffer right{MakeSine(freq, DecodeRightGain)};
+    std::array<SignalBuffer,3> output{};
+    std::array<SignalBuffer,3> temp{};
+    for(auto &buf : output) buf.resize(TotalLength);
+    for(auto &buf : temp) buf.resize(BlockSize + Lookahead);
+    std::array<float*,3> samples{{temp[0].data(), temp[1].data(), temp[2].data()}};
+
+    for(size_t base{0};base < TotalLength;base += BlockSize)
+    {
+        const size_t todo{std::min(BlockSize, TotalLength-base)};
+        std::copy_n(left.cbegin()+static_cast<ptrdiff_t>(base), todo+lookahead, temp[0].begin());
+        std::copy_n(right.cbegin()+static_cast<ptrdiff_t>(base), todo+lookahead,
+            temp[1].begin());
+        std::fill_n(temp[2].begin(), todo+lookahead, 0.0f);
+
+        const auto start = std::chrono::steady_clock::now();
+        decoder.decode(samples, todo, todo);
+        result.seconds += std::chrono::duration<double>{std::chrono::steady_clock::now()
+            - start}.count();
+        ++result.blocks;
+
+        for(size_t c{0};c < output.size();++c)
+            std::copy_n(temp[c].cbegin(), todo, output[c].begin()+static_cast<ptrdiff_t>(base));
+    }
+
+    const complex_d wres{Analyze(output[0], freq)};
+    return {{Analyze(output[1], freq) / wres, Analyze(output[2], freq) / wres}};
+}
+
+
+void PrintResult(const char *name, const Result &fir, const Result &iir, const Result &err)
+{
+    printf("%-14s %9.2fus %9.2fus %10.4fdB %10.3fdeg\n", name,
+        fir.seconds * 1000000.0 / static_cast<double>(std::max(fir.blocks, size_t{1})),
+        iir.seconds * 1000000.0 / static_cast<double>(std::max(iir.blocks, size_t{1})),
+        err.maxDb, err.maxDeg);
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    double minFreq{200.0};
+    double encMaxDb{0.05}, encMaxDeg{1.0};
+    double decMaxDb{0.25}, decMaxDeg{2.5};
+    for(int i{1};i < argc;++i)
+    {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0)
+        {
+            printf("Usage: %s [-v] [-f <min freq>] [-e <max dB> <max degrees>]\n"
+                "       [-d <max dB> <max degrees>]\n\n"
+                "Compares the IIR UHJ filters with the FIR256 filters, from the minimum\n"
+                "frequency (default %.0fhz) up to 20khz. Fails if the level or phase\n"
+                "difference between channels exceeds the maximum for the encoder (-e,\n"
+                "default %gdB and %g degrees) or decoders (-d, default %gdB and %g\n"
+                "degrees). With -v, the differences for each frequency are printed.\n",
+                argv[0], minFreq, encMaxDb, encMaxDeg, decMaxDb, decMaxDeg);
+            return 1;
+        }
+        if(std::strcmp(argv[i], "-v") == 0)
+            Verbose = true;
+        else if(i+1 < argc && std::strcmp(argv[i], "-f") == 0)
+            minFreq = std::strtod(argv[++i], nullptr);
+        else if(i+2 < argc && std::strcmp(argv[i], "-e") == 0)
+        {
+            encMaxDb = std::strtod(argv[++i], nullptr);
+            encMaxDeg = std::strtod(argv[++i], nullptr);
+        }
+        else if(i+2 < argc && std::strcmp(argv[i], "-d") == 0)
+        {
+            decMaxDb = std::strtod(argv[++i], nullptr);
+            decMaxDeg = std::strtod(argv[++i], nullptr);
+        }
+        else
+        {
+            fprintf(stderr, "Unexpected argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if(!(minFreq > 0.0))
+    {
+        fprintf(stderr, "Invalid minimum frequency: %f\n", minFreq);
+        return 1;
+    }
+
+    /* Third-octave steps from the minimum frequency up to 20khz. */
+    std::vector<double> freqs;
+    for(double freq{minFreq};freq <= 20000.0;freq *= std::pow(2.0, 1.0/3.0))
+        freqs.emplace_back(freq);
+
+    Result encFir, encIir, encErr;
+    Result decFir, decIir, decErr;
+    Result stereoFir, stereoIir, stereoErr;
+    for(const double freq : freqs)
+    {
+        auto fir = std::make_unique<UhjEncoder>();
+        auto iir = std::make_unique<UhjEncoderIIR>();
+        encErr.update("Encoder L/R", freq, Encode(*fir, freq, encFir),
+            Encode(*iir, freq, encIir));
+
+        auto firdec = std::make_unique<UhjDecoder>();
+        auto iirdec = std::make_unique<UhjDecoderIIR>();
+        auto firres = Decode(*firdec, Lookahead, freq, decFir);
+        auto iirres = Decode(*iirdec, 0, freq, decIir);
+        decErr.update("Decoder X/W", freq, firres[0], iirres[0]);
+        decErr.update("Decoder Y/W", freq, firres[1], iirres[1]);
+
+        auto firstereo = std::make_unique<UhjStereoDecoder>();
+        auto iirstereo = std::make_unique<UhjStereoDecoderIIR>();
+        firres = Decode(*firstereo, Lookahead, freq, stereoFir);
+        iirres = Decode(*iirstereo, 0, freq, stereoIir);
+        stereoErr.update("Stereo X/W", freq, firres[0], iirres[0]);
+        stereoErr.update("Stereo Y/W", freq, firres[1], iirres[1]);
+    }
+
+    printf("%.0fhz to 20khz, %zu frequencies, %zu-sample blocks\n", minFreq, freqs.size(),
+        BlockSize);
+    printf("%-14s %11s %11s %12s %13s\n", "", "fir256", "iir", "max dB diff", "max phase diff");
+    PrintResult("Encoder L/R", encFir, encIir, encErr);
+    PrintResult("Decoder XY/W", decFir, decIir, decErr);
+    PrintResult("Stereo XY/W", stereoFir, stereoIir, stereoErr);
+
+    const bool failed{encErr.maxDb > encMaxDb || encErr.maxDeg > encMaxDeg
+        || decErr.maxDb > decMaxDb || decErr.maxDeg > decMaxDeg
+        || stereoErr.maxDb > decMaxDb || stereoErr.maxDeg > decMaxDeg};
+    if(failed)
+        printf("IIR filter differences exceed the tolerances\n");
+    return failed ? 1 : 0;
+}